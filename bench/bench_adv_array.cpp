@@ -0,0 +1,138 @@
+/*
+bench_adv_array - st::adv_array against std::vector.
+
+Push without reserve (ints, short strings, unique_ptrs), many short-lived
+arrays of 8 elements (the inline buffer case), and iteration by index and
+by range-for. Every case checks its result against the std::vector run,
+and the process exits 1 on a mismatch. The two containers take turns,
+five runs each, and the best time of each is shown.
+
+Built with NDEBUG, so operator[] is unchecked as in a release build.
+*/
+#define NDEBUG 1
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ext/adv_array.h"
+
+// unique_ptr is a single pointer whose moved-from state needs no
+// destructor call, so its bytes can be copied to a new buffer.
+template <typename T>
+struct st::is_trivially_relocatable<std::unique_ptr<T>> : std::true_type {};
+
+using bench_clock = std::chrono::steady_clock;
+
+static int failures = 0;
+
+template <typename F>
+static double time_ms(F& body) {
+    auto t0 = bench_clock::now();
+    body();
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+}
+
+// Runs adv and vec alternately so neither always gets the warm cache.
+template <typename A, typename V>
+static void compare(const char* name, A adv, V vec) {
+    double ta = 1e300, tv = 1e300;
+    bool same = true;
+    for (int r = 0; r < 5; ++r) {
+        double a = time_ms(adv), v = time_ms(vec);
+        ta = a < ta ? a : ta;
+        tv = v < tv ? v : tv;
+        same = same && adv.result == vec.result;
+    }
+    if (!same) ++failures;
+    std::printf("%-28s %10.2f %10.2f %8.2fx%s\n", name, ta, tv, tv / ta, same ? "" : "  MISMATCH");
+}
+
+// A callable that keeps what the last call returned.
+template <typename R, typename F>
+struct run {
+    F f;
+    R result{};
+    void operator()() { result = f(); }
+};
+template <typename F>
+static auto runner(F f) {
+    return run<decltype(f()), F>{f};
+}
+
+template <typename Array>
+static long long push_ints(std::size_t n) {
+    Array a;
+    for (std::size_t i = 0; i < n; ++i) a.push_back(int(i * 7));
+    return (long long)a.size() + a[n / 2];
+}
+
+template <typename Array>
+static std::size_t push_strings(std::size_t n) {
+    Array a;
+    for (std::size_t i = 0; i < n; ++i) a.push_back(std::to_string(i));
+    return a.size() + a[n - 1].size();
+}
+
+template <typename Array>
+static long long push_unique(std::size_t n) {
+    Array a;
+    for (std::size_t i = 0; i < n; ++i) a.push_back(std::make_unique<int>(int(i)));
+    return (long long)a.size() + *a[n / 3];
+}
+
+template <typename Array>
+static long long small_arrays(std::size_t count) {
+    long long total = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        Array a;
+        for (int j = 0; j < 8; ++j) a.push_back(int(i) + j);
+        for (int v : a) total += v;
+    }
+    return total;
+}
+
+template <typename Array>
+static long long sum_index(const Array& a) {
+    long long s = 0;
+    for (std::size_t i = 0; i < a.size(); ++i) s += a[i];
+    return s;
+}
+
+template <typename Array>
+static long long sum_range(const Array& a) {
+    long long s = 0;
+    for (int v : a) s += v;
+    return s;
+}
+
+int main() {
+    const std::size_t n = 10'000'000, m = 1'000'000;
+    std::printf("%-28s %10s %10s %9s\n", "case", "adv ms", "vector ms", "speedup");
+
+    compare("push 10M int", runner([&] { return push_ints<st::adv_array<int>>(n); }),
+            runner([&] { return push_ints<std::vector<int>>(n); }));
+    compare("push 1M std::string", runner([&] { return push_strings<st::adv_array<std::string>>(m); }),
+            runner([&] { return push_strings<std::vector<std::string>>(m); }));
+    compare("push 1M unique_ptr", runner([&] { return push_unique<st::adv_array<std::unique_ptr<int>>>(m); }),
+            runner([&] { return push_unique<std::vector<std::unique_ptr<int>>>(m); }));
+    compare("1M arrays of 8 int", runner([&] { return small_arrays<st::adv_array<int>>(m); }),
+            runner([&] { return small_arrays<std::vector<int>>(m); }));
+
+    st::adv_array<int> a;
+    std::vector<int> v;
+    for (std::size_t i = 0; i < n; ++i) {
+        a.push(int(i ^ (i >> 3)));
+        v.push_back(int(i ^ (i >> 3)));
+    }
+    compare("iterate 10M by index", runner([&] { return sum_index(a); }), runner([&] { return sum_index(v); }));
+    compare("iterate 10M range-for", runner([&] { return sum_range(a); }), runner([&] { return sum_range(v); }));
+
+    st::adv_array<int> copy = a, moved = std::move(copy);
+    if (moved.size() != n || !copy.empty() || sum_index(moved) != sum_index(v)) {
+        std::printf("copy/move lost elements\n");
+        ++failures;
+    }
+
+    return failures ? 1 : 0;
+}
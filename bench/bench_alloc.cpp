@@ -0,0 +1,173 @@
+/*
+bench_alloc - cstar::arena and cstar::pool against the default allocator.
+
+  small objects   allocate 1M 32-byte objects, then free them all:
+                  new/delete, pool<T>::make/destroy, arena::make + reset
+  std::map        insert 200k keys and destroy the map:
+                  std::allocator, pool_allocator, arena_allocator
+  per request     10k simulated requests, each building a std::map of
+                  std::vectors and throwing it away: std::allocator vs an
+                  arena released by a scope after every request
+  adv_array       push 1M strings into st::adv_array, default vs arena
+
+Each case checks its result against the std::allocator run and the process
+exits 1 on a mismatch. Times are the best of 5 runs.
+*/
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+#include "ext/adv_array.h"
+#include "ext/alloc.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+static int failures = 0;
+
+template <typename F>
+static double best_ms(F body) {
+    double best = 1e300;
+    for (int r = 0; r < 5; ++r) {
+        auto t0 = bench_clock::now();
+        body();
+        double ms = std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+        if (ms < best) best = ms;
+    }
+    return best;
+}
+
+static void row(const char* name, double ms, double base, bool ok) {
+    if (!ok) ++failures;
+    std::printf("  %-24s %9.2f ms %7.2fx%s\n", name, ms, base / ms, ok ? "" : "  MISMATCH");
+}
+
+struct particle {
+    double x, y, vx, vy;
+};
+
+template <typename Alloc>
+using int_map = std::map<int, int, std::less<int>, typename std::allocator_traits<Alloc>::template rebind_alloc<std::pair<const int, int>>>;
+
+template <typename Map>
+static long long fill_map(Map& m, int n) {
+    for (int i = 0; i < n; ++i) m.emplace(int((i * 2654435761u) >> 8), i);
+    long long s = 0;
+    for (auto& kv : m) s += kv.first ^ kv.second;
+    return s;
+}
+
+template <typename A>
+static long long request(A alloc, int id) {
+    using vec = std::vector<int, typename std::allocator_traits<A>::template rebind_alloc<int>>;
+    using map = std::map<int, vec, std::less<int>, typename std::allocator_traits<A>::template rebind_alloc<std::pair<const int, vec>>>;
+    map m(alloc);
+    for (int k = 0; k < 20; ++k) {
+        vec& v = m.emplace(k * 7 % 20, vec(alloc)).first->second;
+        for (int j = 0; j < 25 + k; ++j) v.push_back(id + j * k);
+    }
+    long long s = 0;
+    for (auto& kv : m)
+        for (int x : kv.second) s += x;
+    return s;
+}
+
+int main() {
+    const int objects = 1'000'000;
+    std::vector<particle*> ptrs(objects);
+
+    std::printf("small objects (%d x %zu bytes)\n", objects, sizeof(particle));
+    double sum_base = 0, sum_pool = 0, sum_arena = 0;
+    double base = best_ms([&] {
+        sum_base = 0;
+        for (int i = 0; i < objects; ++i) ptrs[i] = new particle{double(i), 0, 1, 1};
+        for (int i = 0; i < objects; ++i) sum_base += ptrs[i]->x;
+        for (int i = 0; i < objects; ++i) delete ptrs[i];
+    });
+    row("new / delete", base, base, true);
+
+    cstar::pool<particle> pool;
+    double t = best_ms([&] {
+        sum_pool = 0;
+        for (int i = 0; i < objects; ++i) ptrs[i] = pool.make(double(i), 0.0, 1.0, 1.0);
+        for (int i = 0; i < objects; ++i) sum_pool += ptrs[i]->x;
+        for (int i = 0; i < objects; ++i) pool.destroy(ptrs[i]);
+    });
+    row("pool<T>", t, base, sum_pool == sum_base && pool.in_use() == 0);
+
+    cstar::arena arena;
+    t = best_ms([&] {
+        cstar::arena::scope s(arena);
+        sum_arena = 0;
+        for (int i = 0; i < objects; ++i) ptrs[i] = arena.make<particle>(double(i), 0.0, 1.0, 1.0);
+        for (int i = 0; i < objects; ++i) sum_arena += ptrs[i]->x;
+    });
+    row("arena", t, base, sum_arena == sum_base);
+
+    const int keys = 200'000;
+    std::printf("std::map<int, int> (%d inserts + destroy)\n", keys);
+    long long ref = 0, got = 0;
+    base = best_ms([&] {
+        int_map<std::allocator<int>> m;
+        ref = fill_map(m, keys);
+    });
+    row("std::allocator", base, base, true);
+    t = best_ms([&] {
+        int_map<cstar::pool_allocator<int>> m;
+        got = fill_map(m, keys);
+    });
+    row("pool_allocator", t, base, got == ref);
+    t = best_ms([&] {
+        cstar::arena::scope s(arena);
+        int_map<cstar::arena_allocator<int>> m(arena);
+        got = fill_map(m, keys);
+    });
+    row("arena_allocator", t, base, got == ref);
+
+    const int requests = 10'000;
+    std::printf("per-request map of vectors (%d requests)\n", requests);
+    base = best_ms([&] {
+        ref = 0;
+        for (int r = 0; r < requests; ++r) ref += request(std::allocator<int>(), r);
+    });
+    row("std::allocator", base, base, true);
+    t = best_ms([&] {
+        got = 0;
+        for (int r = 0; r < requests; ++r) {
+            cstar::arena::scope s(arena);
+            got += request(cstar::arena_allocator<int>(arena), r);
+        }
+    });
+    row("arena + scope", t, base, got == ref);
+
+    const int strings = 1'000'000;
+    std::printf("st::adv_array<std::string> (%d pushes)\n", strings);
+    std::size_t len_ref = 0, len = 0;
+    base = best_ms([&] {
+        st::adv_array<std::string> a;
+        for (int i = 0; i < strings; ++i) a.push(std::to_string(i));
+        len_ref = a.length() + a[strings / 2].size();
+    });
+    row("std::allocator", base, base, true);
+    t = best_ms([&] {
+        cstar::arena::scope s(arena);
+        st::adv_array<std::string, 2, cstar::arena_allocator<std::string>> a(arena);
+        for (int i = 0; i < strings; ++i) a.push(std::to_string(i));
+        len = a.length() + a[strings / 2].size();
+    });
+    row("arena_allocator", t, base, len == len_ref);
+
+    // over-aligned requests and rollback to a checkpoint
+    cstar::arena::checkpoint cp = arena.mark();
+    auto* wide = static_cast<char*>(arena.allocate(100, 64));
+    auto* small = static_cast<char*>(arena.allocate(1, 1));
+    bool aligned = reinterpret_cast<std::uintptr_t>(wide) % 64 == 0;
+    arena.rollback(cp);
+    bool reused = arena.allocate(100, 64) == wide && small == wide + 100;
+    if (!aligned || !reused) {
+        std::printf("arena alignment/rollback check failed\n");
+        ++failures;
+    }
+    return failures ? 1 : 0;
+}
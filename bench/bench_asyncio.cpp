@@ -0,0 +1,130 @@
+/*
+bench_asyncio - many small random reads across many files.
+
+Compares a blocking filepread loop with cstar::async_io on io_uring (plain
+and with registered buffers) and on the thread-pool fallback, all at the
+same queue depth. Files live in the page cache after the first pass, so
+this measures submission overhead more than device queue depth; point
+CSTAR_BENCH_DIR at a real disk and drop caches to see the latter.
+
+Also checks that fileclose() refuses (EBUSY) a descriptor with a queued
+read, on both backends, instead of waiting forever for the read to be
+reaped by the same thread.
+
+Usage: bench_asyncio [reads] [queue-depth]   (default 100000 64)
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "ext/asyncio.h"
+
+static const int file_count = 32;
+static const size_t file_size = 4 << 20;
+static const size_t block = 4096;
+
+struct job { int fd; posix_off_t off; };
+
+static double rate(size_t n, std::chrono::steady_clock::time_point t0) {
+    return n / std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static void run_async(const char* name, cstar::io_backend want, bool fixed,
+                      const std::vector<job>& jobs, unsigned depth) {
+    cstar::async_io aio(depth, want);
+    if (want == cstar::io_backend::io_uring && aio.backend() != cstar::io_backend::io_uring) {
+        std::printf("%-24s unavailable\n", name);
+        return;
+    }
+    std::vector<char> arena(depth * block);
+    std::vector<unsigned> free_bufs;
+    for (unsigned i = 0; i < depth; ++i) free_bufs.push_back(i);
+    if (fixed) {
+        struct iovec iov = { arena.data(), arena.size() };
+        if (aio.register_buffers(&iov, 1) != 0) {
+            std::printf("%-24s register failed (%d)\n", name, posix_errno);
+            return;
+        }
+    }
+    size_t bytes = 0, errors = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (const job& j : jobs) {
+        while (free_bufs.empty()) aio.wait(1);
+        unsigned b = free_bufs.back();
+        free_bufs.pop_back();
+        auto cb = [&, b](ssize_t n, int) {
+            if (n == (ssize_t)block) bytes += n; else errors++;
+            free_bufs.push_back(b);
+        };
+        if (fixed) aio.read_fixed(j.fd, 0, b * block, block, j.off, cb);
+        else aio.read(j.fd, arena.data() + b * block, block, j.off, cb);
+        if (free_bufs.empty()) aio.submit();
+    }
+    aio.drain();
+    std::printf("%-24s %10.0f reads/s  (%zu MiB, %zu errors)\n", name, rate(jobs.size(), t0), bytes >> 20, errors);
+}
+
+// fileclose between queue and reap: EBUSY, then a normal close after drain()
+static bool close_while_queued(cstar::io_backend want, const std::string& path) {
+    int fd = fileopen(path.c_str(), O_RDWR);
+    char buf[block];
+    bool ran = false;
+    cstar::async_io aio(4, want);
+    aio.read(fd, buf, block, 0, [&](ssize_t, int) { ran = true; });
+    aio.submit();
+    int busy = fileclose(fd);
+    int busy_errno = posix_errno;
+    aio.drain();
+    char one;
+    bool still_open = filepread(fd, &one, 1, 0) == 1; // the refused close left it usable
+    bool ok = busy == -1 && busy_errno == EBUSY && ran && still_open && fileclose(fd) == 0;
+    std::printf("close while queued (%s): %s\n", want == cstar::io_backend::io_uring ? "io_uring" : "thread pool",
+                ok ? "EBUSY, then closed" : "MISMATCH");
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    size_t reads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    unsigned depth = argc > 2 ? (unsigned)std::atoi(argv[2]) : 64;
+    const char* dir = std::getenv("CSTAR_BENCH_DIR");
+    std::string base = std::string(dir ? dir : "/tmp") + "/cstar_bench_aio_";
+
+    std::vector<int> fds;
+    std::vector<char> fill(file_size, 'x');
+    for (int i = 0; i < file_count; ++i) {
+        int fd = fileopen((base + std::to_string(i)).c_str(), O_RDWR | O_CREAT | O_TRUNC);
+        if (fd < 0) { std::printf("fileopen failed: %d\n", posix_errno); return 1; }
+        filewrite(fd, fill.data(), fill.size());
+        fds.push_back(fd);
+    }
+
+    std::mt19937_64 rng(7);
+    std::vector<job> jobs(reads);
+    for (auto& j : jobs) {
+        j.fd = fds[rng() % file_count];
+        j.off = (posix_off_t)((rng() % (file_size / block)) * block);
+    }
+
+    std::printf("%zu random %zu-byte reads over %d files, queue depth %u\n", reads, block, file_count, depth);
+    {
+        std::vector<char> buf(block);
+        size_t ok = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (const job& j : jobs) ok += filepread(j.fd, buf.data(), block, j.off) == (ssize_t)block;
+        std::printf("%-24s %10.0f reads/s  (%zu ok)\n", "blocking filepread", rate(reads, t0), ok);
+    }
+    run_async("async_io io_uring", cstar::io_backend::io_uring, false, jobs, depth);
+    run_async("async_io io_uring fixed", cstar::io_backend::io_uring, true, jobs, depth);
+    run_async("async_io thread pool", cstar::io_backend::thread_pool, false, jobs, depth);
+
+    bool ok = close_while_queued(cstar::io_backend::io_uring, base + "0") &&
+              close_while_queued(cstar::io_backend::thread_pool, base + "0");
+
+    for (int i = 0; i < file_count; ++i) {
+        fileclose(fds[i]);
+        std::remove((base + std::to_string(i)).c_str());
+    }
+    return ok ? 0 : 1;
+}
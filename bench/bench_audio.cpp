@@ -0,0 +1,174 @@
+/*
+bench_audio - the in-process mixer behind play_sound (ext/audio.h).
+
+Decode: MB/s for turning a 10 s WAV image into engine samples, at the
+engine's rate and with resampling from 44.1 kHz.
+
+Mix: 64 looping voices into an unpaced null sink. Shows how many times
+faster than real time the mixer runs and ns per voice per frame.
+
+Latency: microseconds from play() until the mixer starts the voice. For
+sinks that must be fed silence this is bounded by the period, since the
+mixer picks up commands once per period; an idle null sink, paced or
+not, is woken by the channel at once.
+
+Idle: a paced null sink must stop mixing once its last voice ends.
+
+Round trip: a sound played into a file_sink must come back sample for
+sample, and a decoded 16-bit WAV must equal its source, or the process
+exits 1.
+*/
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include "ext/audio.h"
+
+using bench_clock = std::chrono::steady_clock;
+namespace audio = cstar::audio;
+
+static int failures = 0;
+
+static void fail(const char* what) {
+    std::printf("  MISMATCH: %s\n", what);
+    ++failures;
+}
+
+// A sine sweep as a WAV image: 16-bit stereo at rate.
+static std::vector<unsigned char> make_wav(unsigned rate, double seconds, std::vector<std::int16_t>* pcm = nullptr) {
+    std::size_t frames = (std::size_t)(rate * seconds);
+    std::vector<unsigned char> w(44 + frames * 4);
+    auto put = [&](std::size_t at, std::uint32_t v, int n) {
+        for (int i = 0; i < n; ++i) w[at + i] = (unsigned char)(v >> (8 * i));
+    };
+    std::memcpy(&w[0], "RIFF", 4);
+    put(4, (std::uint32_t)(36 + frames * 4), 4);
+    std::memcpy(&w[8], "WAVEfmt ", 8);
+    put(16, 16, 4);
+    put(20, 1, 2);
+    put(22, 2, 2);
+    put(24, rate, 4);
+    put(28, rate * 4, 4);
+    put(32, 4, 2);
+    put(34, 16, 2);
+    std::memcpy(&w[36], "data", 4);
+    put(40, (std::uint32_t)(frames * 4), 4);
+    for (std::size_t f = 0; f < frames; ++f) {
+        double t = (double)f / rate;
+        auto l = (std::int16_t)(12000 * std::sin(2 * M_PI * (220 + 200 * t) * t));
+        auto r = (std::int16_t)(9000 * std::sin(2 * M_PI * 330 * t));
+        put(44 + f * 4, (std::uint16_t)l, 2);
+        put(46 + f * 4, (std::uint16_t)r, 2);
+        if (pcm) pcm->push_back(l), pcm->push_back(r);
+    }
+    return w;
+}
+
+static void decode_row(const char* label, unsigned src_rate) {
+    auto wav = make_wav(src_rate, 10.0);
+    audio::sound s;
+    std::string err;
+    double best = 1e300;
+    for (int r = 0; r < 3; ++r) {
+        auto t0 = bench_clock::now();
+        if (!audio::decode_wav(wav.data(), wav.size(), 48000, s, err)) fail(err.c_str());
+        best = std::min(best, std::chrono::duration<double>(bench_clock::now() - t0).count());
+    }
+    std::printf("  %-28s %8.0f MB/s %8.2f ms\n", label, (double)wav.size() / best / 1e6, best * 1e3);
+}
+
+static void latency_row(const char* label, std::unique_ptr<audio::sink> out, unsigned period, int plays, bool wait_each) {
+    audio::sound blip; // outlives the engine, which may still be mixing it
+    blip.samples.assign(480 * 2, 1000); // 10 ms
+    audio::engine e(std::move(out), 48000, period);
+    audio::engine::voice_id id = 0;
+    for (int i = 0; i < plays; ++i) {
+        id = e.play(&blip);
+        if (!id) fail("no voice");
+        if (wait_each) e.wait(id);
+        else std::this_thread::sleep_for(std::chrono::microseconds(2000 + (i * 7919) % 3000));
+    }
+    e.wait(id); // the mixer has taken every start by the time the last voice ends
+    auto r = e.latency();
+    if (r.count != (std::uint64_t)plays) fail("latency samples");
+    std::printf("  %-28s %8.1f %8.1f %8.1f %8.1f\n", label, r.mean_us, r.p50_us, r.p99_us, r.max_us);
+}
+
+int main() {
+    std::printf("decode to 48 kHz\n");
+    decode_row("48 kHz 16-bit stereo", 48000);
+    decode_row("44.1 kHz 16-bit (resampled)", 44100);
+
+    {
+        std::vector<std::int16_t> pcm;
+        auto wav = make_wav(48000, 0.5, &pcm);
+        audio::sound s;
+        std::string err;
+        if (!audio::decode_wav(wav.data(), wav.size(), 48000, s, err) || s.samples != pcm) fail("decode round trip");
+    }
+
+    std::printf("mix, 64 looping voices\n");
+    {
+        audio::sound tone;
+        for (int i = 0; i < 48000; ++i) tone.samples.push_back((std::int16_t)(i % 200 * 10)), tone.samples.push_back(0);
+        audio::engine e(std::make_unique<audio::null_sink>(false));
+        for (unsigned v = 0; v < audio::engine::max_voices; ++v)
+            if (!e.play(&tone, 1.0f / 64, true)) fail("voice");
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::uint64_t f0 = e.frames_mixed();
+        auto t0 = bench_clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        double s = std::chrono::duration<double>(bench_clock::now() - t0).count();
+        std::uint64_t frames = e.frames_mixed() - f0;
+        e.stop_all();
+        std::printf("  %-28s %8.0f x\n", "speed vs real time", (double)frames / s / 48000);
+        std::printf("  %-28s %8.2f ns\n", "per voice per frame", s * 1e9 / (double)frames / 64);
+    }
+
+    std::printf("play() to mixer, us            mean      p50      p99      max\n");
+    latency_row("paced, period 256 (5.3 ms)", std::make_unique<audio::null_sink>(true), 256, 300, false);
+    latency_row("paced, period 64 (1.3 ms)", std::make_unique<audio::null_sink>(true), 64, 300, false);
+    latency_row("idle unpaced mixer", std::make_unique<audio::null_sink>(false), 256, 2000, true);
+
+    {
+        audio::sound blip;
+        blip.samples.assign(480 * 2, 1000);
+        audio::engine e(std::make_unique<audio::null_sink>(true));
+        e.wait(e.play(&blip));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::uint64_t f0 = e.frames_mixed();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        if (e.frames_mixed() != f0) fail("paced null sink kept mixing while idle");
+        e.wait(e.play(&blip)); // and wakes for the next sound
+    }
+
+    // what play_sound hears: exactly the source, padded to whole periods
+    std::string path = (std::filesystem::temp_directory_path() / "bench_audio_out.wav").string();
+    {
+        std::vector<std::int16_t> pcm;
+        auto wav = make_wav(48000, 0.25, &pcm);
+        std::string src = (std::filesystem::temp_directory_path() / "bench_audio_in.wav").string();
+        std::ofstream(src, std::ios::binary).write((const char*)wav.data(), (std::streamsize)wav.size());
+        {
+            audio::engine e(std::make_unique<audio::file_sink>(path));
+            e.wait(e.play(src));
+        }
+        std::ifstream in(path, std::ios::binary);
+        std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        audio::sound back;
+        std::string err;
+        if (!audio::decode_wav(bytes.data(), bytes.size(), 48000, back, err)) fail(err.c_str());
+        else if (back.samples.size() < pcm.size() || !std::equal(pcm.begin(), pcm.end(), back.samples.begin()))
+            fail("file sink round trip");
+        std::filesystem::remove(src);
+        std::filesystem::remove(path);
+    }
+
+    audio::engine dflt;
+    std::printf("default sink: %s\n", dflt.sink_name());
+    return failures ? 1 : 0;
+}
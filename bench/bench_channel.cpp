@@ -0,0 +1,195 @@
+/*
+bench_channel - cstar::spsc_channel, cstar::channel and select against a
+std::mutex + std::condition_variable queue.
+
+Throughput: P producers each send n/P integers into one bounded channel
+(capacity 1024) while C consumers receive until it is closed. Shows
+millions of messages per second. Run for 1P1C up to the thread count
+given on the command line.
+
+Latency: two threads bounce a message back and forth through a pair of
+channels; shows round-trip percentiles in microseconds.
+
+Select: four producers each feed their own channel and one consumer
+selects over all four.
+
+The sum of everything received must match what was sent, or the process
+exits 1.
+
+Usage: bench_channel [max_threads]
+*/
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ext/channel.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+static int failures = 0;
+
+// The baseline: a bounded queue as it is usually written by hand.
+template <typename T>
+class locked_queue {
+public:
+    explicit locked_queue(std::size_t capacity) : cap_(capacity) {}
+
+    bool send(T v) {
+        std::unique_lock<std::mutex> hold(m_);
+        not_full_.wait(hold, [&] { return q_.size() < cap_ || closed_; });
+        if (closed_) return false;
+        q_.push_back(v);
+        not_empty_.notify_one();
+        return true;
+    }
+
+    bool recv(T& out) {
+        std::unique_lock<std::mutex> hold(m_);
+        not_empty_.wait(hold, [&] { return !q_.empty() || closed_; });
+        if (q_.empty()) return false;
+        out = q_.front();
+        q_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> hold(m_);
+        closed_ = true;
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+private:
+    std::size_t cap_;
+    std::mutex m_;
+    std::condition_variable not_empty_, not_full_;
+    std::deque<T> q_;
+    bool closed_ = false;
+};
+
+static void check(const char* what, long long got, long long want) {
+    if (got != want) {
+        std::printf("  MISMATCH %s: sum %lld, expected %lld\n", what, got, want);
+        ++failures;
+    }
+}
+
+template <typename Queue>
+static double throughput(const char* what, unsigned producers, unsigned consumers, long n) {
+    Queue q(1024);
+    long per = n / producers;
+    std::vector<long long> sums(consumers, 0);
+    auto t0 = bench_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned c = 0; c < consumers; ++c)
+        threads.emplace_back([&, c] {
+            long v;
+            long long s = 0;
+            while (q.recv(v)) s += v;
+            sums[c] = s;
+        });
+    std::vector<std::thread> senders;
+    for (unsigned p = 0; p < producers; ++p)
+        senders.emplace_back([&, p] {
+            for (long i = 0; i < per; ++i) q.send((long)p * per + i);
+        });
+    for (auto& t : senders) t.join();
+    q.close();
+    for (auto& t : threads) t.join();
+    double s = std::chrono::duration<double>(bench_clock::now() - t0).count();
+
+    long long total = 0;
+    for (long long x : sums) total += x;
+    long long m = (long long)per * producers;
+    check(what, total, m * (m - 1) / 2);
+    return (double)m / s / 1e6;
+}
+
+template <typename Queue>
+static void latency(const char* what, long rounds) {
+    Queue ping(16), pong(16);
+    std::thread echo([&] {
+        long v;
+        while (ping.recv(v)) pong.send(v);
+        pong.close();
+    });
+    std::vector<double> us;
+    us.reserve(rounds);
+    long long sum = 0;
+    for (long i = 0; i < rounds; ++i) {
+        auto t0 = bench_clock::now();
+        ping.send(i);
+        long v = 0;
+        pong.recv(v);
+        us.push_back(std::chrono::duration<double, std::micro>(bench_clock::now() - t0).count());
+        sum += v;
+    }
+    ping.close();
+    echo.join();
+    check(what, sum, (long long)rounds * (rounds - 1) / 2);
+
+    std::sort(us.begin(), us.end());
+    auto pct = [&](double p) { return us[std::min(us.size() - 1, (std::size_t)(p * (double)us.size()))]; };
+    std::printf("  %-22s %8.2f %8.2f %8.2f %8.2f\n", what, pct(0.5), pct(0.99), pct(0.999), us.back());
+}
+
+static double select_bench(long n) {
+    const unsigned k = 4;
+    std::vector<std::unique_ptr<cstar::channel<long>>> chans;
+    for (unsigned i = 0; i < k; ++i) chans.push_back(std::make_unique<cstar::channel<long>>(1024));
+    long per = n / k;
+    auto t0 = bench_clock::now();
+    std::vector<std::thread> senders;
+    for (unsigned p = 0; p < k; ++p)
+        senders.emplace_back([&, p] {
+            for (long i = 0; i < per; ++i) chans[p]->send((long)p * per + i);
+            chans[p]->close();
+        });
+    long long sum = 0;
+    long got = 0;
+    auto take = [&](long v) { sum += v, ++got; };
+    while (cstar::select(cstar::on_recv(*chans[0], take), cstar::on_recv(*chans[1], take),
+                         cstar::on_recv(*chans[2], take), cstar::on_recv(*chans[3], take)) != cstar::select_closed) {
+    }
+    for (auto& t : senders) t.join();
+    double s = std::chrono::duration<double>(bench_clock::now() - t0).count();
+    long long m = (long long)per * k;
+    check("select", sum, m * (m - 1) / 2);
+    return (double)got / s / 1e6;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned max = argc > 1 ? (unsigned)std::atoi(argv[1]) : 4;
+    const long n = 4'000'000;
+
+    // as in bench_sync: make std::mutex pay for real locking
+    std::thread([] {}).join();
+
+    std::printf("throughput, M messages per second (%u hardware threads)\n", std::thread::hardware_concurrency());
+    std::printf("  %-10s %14s %14s %14s\n", "threads", "spsc_channel", "channel", "mutex+condvar");
+    for (unsigned t = 1; t <= max; t *= 2) {
+        char label[32];
+        std::snprintf(label, sizeof label, "%uP%uC", t, t);
+        double a = t == 1 ? throughput<cstar::spsc_channel<long>>("spsc_channel", 1, 1, n) : 0;
+        double b = throughput<cstar::channel<long>>("channel", t, t, n);
+        double c = throughput<locked_queue<long>>("mutex+condvar", t, t, n);
+        if (t == 1) std::printf("  %-10s %14.1f %14.1f %14.1f\n", label, a, b, c);
+        else std::printf("  %-10s %14s %14.1f %14.1f\n", label, "-", b, c);
+    }
+
+    std::printf("round trip, microseconds\n");
+    std::printf("  %-22s %8s %8s %8s %8s\n", "", "p50", "p99", "p99.9", "max");
+    latency<cstar::spsc_channel<long>>("spsc_channel", 100'000);
+    latency<cstar::channel<long>>("channel", 100'000);
+    latency<locked_queue<long>>("mutex+condvar", 100'000);
+
+    std::printf("select over 4 channels, M messages per second\n");
+    std::printf("  %-22s %8.1f\n", "4P1C", select_bench(n));
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,193 @@
+/*
+bench_coro - async/await tasks (ext/coro.h).
+
+Memory: 100k tasks (or the count given on the command line) are spawned
+and each sleeps on a timer. Once all of them are suspended, shows the
+coroutine frame bytes and the growth in resident memory per task.
+
+Switching: tasks take turns through cstar::yield(). Shows ns per switch
+for a few task counts, next to two OS threads handing a futex back and
+forth.
+
+Calls: ns for awaiting a task that returns at once (frame allocation,
+start and symmetric transfer back).
+
+Pipes: two tasks bounce a message through a pair of pipes with
+async_read/async_write. Shows microseconds per round trip.
+
+Every task must finish with the expected result, or the process exits 1.
+
+Usage: bench_coro [tasks]
+*/
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <unistd.h>
+#include "ext/coro.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+static int failures = 0;
+
+static double elapsed(bench_clock::time_point t0) {
+    return std::chrono::duration<double>(bench_clock::now() - t0).count();
+}
+
+static std::size_t rss_bytes() {
+    long pages = 0, resident = 0;
+    if (FILE* f = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+        std::fclose(f);
+    }
+    return (std::size_t)resident * (std::size_t)sysconf(_SC_PAGESIZE);
+}
+
+static void expect(const char* what, long long got, long long want) {
+    if (got != want) {
+        std::printf("  MISMATCH %s: %lld, expected %lld\n", what, got, want);
+        ++failures;
+    }
+}
+
+// --- memory ----------------------------------------------------------------
+
+static long finished = 0;
+
+static cstar::task<void> sleeper(int i) {
+    co_await cstar::sleep_for(100 + i % 16);
+    ++finished;
+}
+
+static cstar::task<void> probe(std::size_t& frames, std::size_t& rss) {
+    // queued behind every sleeper, so they have all suspended by now
+    co_await cstar::yield();
+    frames = cstar::live_frame_bytes();
+    rss = rss_bytes();
+}
+
+static void memory(long n) {
+    std::size_t rss0 = rss_bytes(), frames = 0, rss = 0;
+    auto t0 = bench_clock::now();
+    for (long i = 0; i < n; ++i) cstar::spawn(sleeper((int)i));
+    cstar::spawn(probe(frames, rss));
+    cstar::run();
+    double s = elapsed(t0);
+    expect("sleepers finished", finished, n);
+    std::printf("%ld tasks sleeping at once\n", n);
+    std::printf("  %-28s %8.0f\n", "frame bytes per task", (double)frames / (double)n);
+    std::printf("  %-28s %8.0f\n", "resident bytes per task", (double)(rss > rss0 ? rss - rss0 : 0) / (double)n);
+    std::printf("  %-28s %8.1f\n", "ms to spawn, sleep and end", s * 1e3);
+}
+
+// --- switching --------------------------------------------------------------
+
+static long long switches = 0;
+
+static cstar::task<void> yielder(int rounds) {
+    for (int r = 0; r < rounds; ++r) {
+        co_await cstar::yield();
+        ++switches;
+    }
+}
+
+static double yield_ns(long tasks, long total) {
+    int rounds = (int)(total / tasks);
+    switches = 0;
+    auto t0 = bench_clock::now();
+    for (long i = 0; i < tasks; ++i) cstar::spawn(yielder(rounds));
+    cstar::run();
+    double s = elapsed(t0);
+    expect("switches", switches, (long long)tasks * rounds);
+    return s * 1e9 / (double)switches;
+}
+
+static double thread_ns(long rounds) {
+    std::atomic<std::uint32_t> turn{0};
+    auto t0 = bench_clock::now();
+    std::thread other([&] {
+        for (long i = 0; i < rounds; ++i) {
+            turn.wait(0);
+            turn.store(0);
+            turn.notify_one();
+        }
+    });
+    for (long i = 0; i < rounds; ++i) {
+        turn.store(1);
+        turn.notify_one();
+        turn.wait(1);
+    }
+    other.join();
+    return elapsed(t0) * 1e9 / (double)(2 * rounds);
+}
+
+// --- calls ------------------------------------------------------------------
+
+static cstar::task<int> leaf(int x) {
+    co_return x + 1;
+}
+
+static cstar::task<long long> caller(int n) {
+    long long sum = 0;
+    for (int i = 0; i < n; ++i) sum += co_await leaf(i);
+    co_return sum;
+}
+
+// --- pipes ------------------------------------------------------------------
+
+static cstar::task<void> echo(int in, int out, int rounds) {
+    char buf[64];
+    for (int r = 0; r < rounds; ++r) {
+        ssize_t n = co_await cstar::async_read(in, buf, sizeof buf);
+        if (n <= 0) break;
+        co_await cstar::async_write(out, buf, (std::size_t)n);
+    }
+}
+
+static cstar::task<long long> pinger(int out, int in, int rounds) {
+    long long sum = 0;
+    for (int r = 0; r < rounds; ++r) {
+        int v = r;
+        co_await cstar::async_write(out, &v, sizeof v);
+        int back = 0;
+        ssize_t n = co_await cstar::async_read(in, &back, sizeof back);
+        if (n != (ssize_t)sizeof back) break;
+        sum += back;
+    }
+    co_return sum;
+}
+
+int main(int argc, char* argv[]) {
+    long n = argc > 1 ? std::atol(argv[1]) : 100'000;
+
+    memory(n);
+
+    std::printf("switch, ns\n");
+    const long total = 20'000'000;
+    for (long tasks : {2L, 1000L, n}) {
+        char label[40];
+        std::snprintf(label, sizeof label, "%ld tasks yielding", tasks);
+        std::printf("  %-28s %8.1f\n", label, yield_ns(tasks, total));
+    }
+    std::printf("  %-28s %8.1f\n", "2 threads, futex handoff", thread_ns(200'000));
+
+    const int calls = 10'000'000;
+    auto t0 = bench_clock::now();
+    long long sum = cstar::run(caller(calls));
+    double s = elapsed(t0);
+    expect("call sum", sum, (long long)calls * (calls + 1) / 2);
+    std::printf("await a finished task, ns\n  %-28s %8.1f\n", "call + co_return", s * 1e9 / calls);
+
+    int a[2], b[2];
+    if (pipe(a) != 0 || pipe(b) != 0) return 1;
+    const int rounds = 50'000;
+    cstar::spawn(echo(a[0], b[1], rounds));
+    t0 = bench_clock::now();
+    sum = cstar::run(pinger(a[1], b[0], rounds));
+    s = elapsed(t0);
+    cstar::run();
+    expect("pipe sum", sum, (long long)rounds * (rounds - 1) / 2);
+    std::printf("pipe round trip, us\n  %-28s %8.2f\n", "async_write + async_read", s * 1e6 / rounds);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,200 @@
+/*
+bench_cstmath - accuracy and throughput of the cstar::math batch kernels.
+
+Runs every kernel on every instruction set the CPU supports, first
+checking results against <cmath> (long double references for exp, log and
+root; bit-exact comparison for add, mul, fma, sqrt, min and max), then
+measuring throughput in elements per nanosecond on L1-resident arrays.
+Exits with status 1 if any accuracy check fails.
+
+Usage: bench_cstmath [elements]   (default 1024)
+*/
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "cstmath.h"
+
+namespace cm = cstar::math;
+
+static const cm::isa all_isas[] = {cm::isa::scalar, cm::isa::sse2, cm::isa::avx2, cm::isa::avx512};
+
+// |got - ref| in units of the last place of ref
+static double ulps(double got, long double ref) {
+    if (std::isnan(got) || std::isnan((double)ref)) return std::isnan(got) == std::isnan((double)ref) ? 0 : 1e9;
+    double r = (double)ref;
+    if (std::isinf(r) || std::isinf(got)) return got == r ? 0 : 1e9;
+    double ulp = std::nextafter(std::fabs(r), HUGE_VAL) - std::fabs(r);
+    if (ulp == 0 || !std::isfinite(ulp)) ulp = DBL_TRUE_MIN;
+    return (double)(std::fabs((long double)got - ref) / ulp);
+}
+
+static bool same(double a, double b) {
+    return std::memcmp(&a, &b, sizeof a) == 0 || (std::isnan(a) && std::isnan(b));
+}
+
+struct checker {
+    bool ok = true;
+    void expect(bool cond, const char* isa, const char* what) {
+        if (!cond) {
+            std::printf("  FAIL %s: %s\n", isa, what);
+            ok = false;
+        }
+    }
+};
+
+static double check_isa(checker& c, const char* name, std::size_t n, std::mt19937_64& rng, double* worst) {
+    std::uniform_real_distribution<double> wide(-700.0, 700.0), unit(-1.0, 1.0);
+    std::vector<double> a(n), b(n), d(n), out(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        a[i] = unit(rng) * 1e3;
+        b[i] = unit(rng);
+        d[i] = unit(rng) * 1e-3;
+    }
+
+    cm::add(a.data(), b.data(), out.data(), n);
+    for (std::size_t i = 0; i < n; ++i) c.expect(same(out[i], a[i] + b[i]), name, "add");
+    cm::mul(a.data(), b.data(), out.data(), n);
+    for (std::size_t i = 0; i < n; ++i) c.expect(same(out[i], a[i] * b[i]), name, "mul");
+    cm::fma(a.data(), b.data(), d.data(), out.data(), n);
+    for (std::size_t i = 0; i < n; ++i) c.expect(same(out[i], std::fma(a[i], b[i], d[i])), name, "fma");
+    cm::sqrt(a.data(), out.data(), n);
+    for (std::size_t i = 0; i < n; ++i) c.expect(same(out[i], std::sqrt(a[i])), name, "sqrt");
+
+    double m = 0;
+    std::vector<double> x(n);
+    for (auto& v : x) v = wide(rng);
+    cm::exp(x.data(), out.data(), n);
+    for (std::size_t i = 0; i < n; ++i) m = std::fmax(m, ulps(out[i], std::exp((long double)x[i])));
+    worst[0] = m;
+    c.expect(m <= 2.0, name, "exp within 2 ulp");
+
+    m = 0;
+    for (auto& v : x) v = std::exp(wide(rng));
+    x[0] = 1.0;
+    x[1] = std::nextafter(1.0, 2.0);
+    x[2] = 0.999;
+    cm::log(x.data(), out.data(), n);
+    for (std::size_t i = 0; i < n; ++i) m = std::fmax(m, ulps(out[i], std::log((long double)x[i])));
+    worst[1] = m;
+    c.expect(m <= 2.0, name, "log within 2 ulp");
+
+    m = 0;
+    for (double r : {3.0, 4.0, 5.0, 7.0, 16.0}) {
+        cm::root(x.data(), r, out.data(), n);
+        for (std::size_t i = 0; i < n; ++i) m = std::fmax(m, ulps(out[i], std::pow((long double)x[i], 1.0L / r)));
+    }
+    worst[2] = m;
+    c.expect(m <= 2.0, name, "root within 2 ulp (integer degrees)");
+
+    // special values go through <cmath>, whatever lane they land in
+    const double special[] = {0.0, -0.0, -1.0, HUGE_VAL, -HUGE_VAL, NAN, 1e-310, 710.0, -750.0, 1e308, -8.0};
+    const std::size_t ns = sizeof special / sizeof special[0];
+    double so[ns];
+    cm::exp(special, so, ns);
+    for (std::size_t i = 0; i < ns; ++i) c.expect(same(so[i], std::exp(special[i])), name, "exp special values");
+    cm::log(special, so, ns);
+    for (std::size_t i = 0; i < ns; ++i) c.expect(same(so[i], std::log(special[i])), name, "log special values");
+    cm::root(special, 3.0, so, ns);
+    for (std::size_t i = 0; i < ns; ++i) c.expect(same(so[i], root(special[i], 3.0)), name, "root special values");
+    c.expect(root(-8.0, 3.0) == -2.0 && std::isnan(root(-16.0, 4.0)) && root(81.0, 4.0) == 3.0, name, "scalar root");
+
+    long double ref = 0, mag = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        ref += (long double)a[i] * b[i];
+        mag += std::fabs((long double)a[i] * b[i]);
+    }
+    c.expect(std::fabs(cm::dot(a.data(), b.data(), n) - ref) <= mag * n * DBL_EPSILON, name, "dot");
+    ref = mag = 0;
+    for (double v : a) {
+        ref += v;
+        mag += std::fabs(v);
+    }
+    c.expect(std::fabs(cm::sum(a.data(), n) - ref) <= mag * n * DBL_EPSILON, name, "sum");
+    double lo = HUGE_VAL, hi = -HUGE_VAL;
+    for (double v : a) {
+        lo = std::fmin(lo, v);
+        hi = std::fmax(hi, v);
+    }
+    c.expect(cm::min(a.data(), n) == lo && cm::max(a.data(), n) == hi, name, "min/max");
+    c.expect(cm::min(a.data(), 0) == HUGE_VAL && cm::sum(a.data(), 0) == 0.0, name, "empty input");
+    return m;
+}
+
+template<typename F>
+static double rate(std::size_t n, F body) {
+    using clock = std::chrono::steady_clock;
+    long reps = 1;
+    for (;;) {
+        auto t0 = clock::now();
+        for (long r = 0; r < reps; ++r) body();
+        double s = std::chrono::duration<double>(clock::now() - t0).count();
+        if (s > 0.05) return n * reps / s / 1e9;
+        reps *= 2;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1024;
+    std::mt19937_64 rng(35);
+    std::vector<cm::isa> isas;
+    for (cm::isa which : all_isas)
+        if (cm::use_isa(which)) isas.push_back(which);
+
+    checker c;
+    std::printf("accuracy (max ulp)      exp    log   root\n");
+    for (cm::isa which : isas) {
+        cm::use_isa(which);
+        double worst[3];
+        check_isa(c, cm::isa_name(which), n + 3, rng, worst); // odd length exercises the tails
+        std::printf("%-18s %8.2f %6.2f %6.2f\n", cm::isa_name(which), worst[0], worst[1], worst[2]);
+    }
+
+    std::uniform_real_distribution<double> dist(0.5, 2.0);
+    std::vector<double> a(n), b(n), d(n), out(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        a[i] = dist(rng);
+        b[i] = dist(rng);
+        d[i] = dist(rng);
+    }
+    volatile double sink = 0;
+    std::printf("\nthroughput, %zu doubles (elements/ns)\n%-8s", n, "");
+    for (cm::isa which : isas) std::printf("%9s", cm::isa_name(which));
+    std::printf("\n");
+    struct row {
+        const char* name;
+        void (*run)(std::vector<double>&, std::vector<double>&, std::vector<double>&, std::vector<double>&,
+                    volatile double&);
+    };
+    const row rows[] = {
+        {"add", [](auto& a, auto& b, auto&, auto& o, volatile double&) { cm::add(a.data(), b.data(), o.data(), a.size()); }},
+        {"mul", [](auto& a, auto& b, auto&, auto& o, volatile double&) { cm::mul(a.data(), b.data(), o.data(), a.size()); }},
+        {"fma", [](auto& a, auto& b, auto& d, auto& o, volatile double&) {
+             cm::fma(a.data(), b.data(), d.data(), o.data(), a.size());
+         }},
+        {"sqrt", [](auto& a, auto&, auto&, auto& o, volatile double&) { cm::sqrt(a.data(), o.data(), a.size()); }},
+        {"root3", [](auto& a, auto&, auto&, auto& o, volatile double&) { cm::root(a.data(), 3.0, o.data(), a.size()); }},
+        {"exp", [](auto& a, auto&, auto&, auto& o, volatile double&) { cm::exp(a.data(), o.data(), a.size()); }},
+        {"log", [](auto& a, auto&, auto&, auto& o, volatile double&) { cm::log(a.data(), o.data(), a.size()); }},
+        {"dot", [](auto& a, auto& b, auto&, auto&, volatile double& s) { s = s + cm::dot(a.data(), b.data(), a.size()); }},
+        {"sum", [](auto& a, auto&, auto&, auto&, volatile double& s) { s = s + cm::sum(a.data(), a.size()); }},
+        {"max", [](auto& a, auto&, auto&, auto&, volatile double& s) { s = s + cm::max(a.data(), a.size()); }},
+    };
+    for (const row& r : rows) {
+        std::printf("%-8s", r.name);
+        for (cm::isa which : isas) {
+            cm::use_isa(which);
+            std::printf("%9.2f", rate(n, [&] { r.run(a, b, d, out, sink); }));
+        }
+        std::printf("\n");
+    }
+    if (!c.ok) {
+        std::printf("\naccuracy checks FAILED\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+/*
+bench_fdtable - multithreaded open/read/close stress on the descriptor table.
+
+Each thread repeatedly opens one of a few shared files, preads a block,
+closes it, and also probes a descriptor it closed earlier to check that
+the generation counter rejects it. Reports operations per second for
+1..N threads and fails if a stale descriptor was ever accepted or the
+table grew beyond the number of descriptors open at once.
+
+Usage: bench_fdtable [iterations-per-thread] [max-threads]
+*/
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "posix_util.h"
+
+static const int file_count = 4;
+
+int main(int argc, char* argv[]) {
+    long iters = argc > 1 ? std::atol(argv[1]) : 100000;
+    unsigned max_threads = argc > 2 ? (unsigned)std::atoi(argv[2]) : std::thread::hardware_concurrency();
+    if (max_threads == 0) max_threads = 1;
+
+    std::vector<std::string> paths;
+    char block[4096];
+    for (int i = 0; i < file_count; ++i) {
+        paths.push_back("/tmp/cstar_bench_fdtable_" + std::to_string(i));
+        int fd = fileopen(paths.back().c_str(), O_RDWR | O_CREAT | O_TRUNC);
+        for (unsigned j = 0; j < sizeof(block); ++j) block[j] = (char)(i + j);
+        filewrite(fd, block, sizeof(block));
+        fileclose(fd);
+    }
+
+    std::atomic<long> stale_accepted{0}, failures{0};
+    std::atomic<int> max_fd_slot{0};
+
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        std::vector<std::thread> pool;
+        auto t0 = std::chrono::steady_clock::now();
+        for (unsigned t = 0; t < threads; ++t) {
+            pool.emplace_back([&, t] {
+                char buf[512];
+                int stale = -1;
+                for (long i = 0; i < iters; ++i) {
+                    int fd = fileopen(paths[(t + i) % file_count].c_str(), O_RDONLY);
+                    if (fd < 0) { failures++; continue; }
+                    int slot = fd & (posix_fd_table::max_slots - 1);
+                    int seen = max_fd_slot.load(std::memory_order_relaxed);
+                    while (slot > seen && !max_fd_slot.compare_exchange_weak(seen, slot)) {}
+                    if (filepread(fd, buf, sizeof(buf), (i * 512) % 4096) != (ssize_t)sizeof(buf)) failures++;
+                    if (stale >= 0 && stale != fd && filepread(stale, buf, 1, 0) >= 0) stale_accepted++;
+                    if (fileclose(fd) != 0) failures++;
+                    stale = fd;
+                }
+            });
+        }
+        for (auto& th : pool) th.join();
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::printf("%2u threads  %10.0f open+pread+close/s\n", threads, threads * iters / s);
+    }
+
+    for (auto& p : paths) std::remove(p.c_str());
+    std::printf("highest slot used: %d, stale accepted: %ld, failures: %ld\n",
+                max_fd_slot.load(), stale_accepted.load(), failures.load());
+    bool ok = stale_accepted == 0 && failures == 0 && max_fd_slot.load() < (int)max_threads + file_count;
+    return ok ? 0 : 1;
+}
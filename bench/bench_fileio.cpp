@@ -0,0 +1,119 @@
+/*
+bench_fileio - fileread/filewrite throughput against the old byte loop.
+
+The "byte loop" rows reproduce the previous posix_util.h implementation:
+one std::fstream::get / put per byte. The other rows go through the
+descriptor-backed fileread/filewrite/filepread in 1 MiB chunks, and
+"filemap scan" maps the file read-only and sums every byte in place.
+
+Usage: bench_fileio [megabytes]   (default 64)
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+#include "posix_util.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+static double mbps(std::size_t bytes, bench_clock::time_point t0) {
+    double s = std::chrono::duration<double>(bench_clock::now() - t0).count();
+    return bytes / s / (1024.0 * 1024.0);
+}
+
+static std::size_t byte_loop_write(const char* path, const std::vector<char>& data) {
+    std::fstream stream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    std::size_t written = 0;
+    while (written < data.size() && stream.good()) {
+        stream.put(data[written]);
+        if (!stream.good()) break;
+        written++;
+    }
+    stream.flush();
+    return written;
+}
+
+static std::size_t byte_loop_read(const char* path, std::vector<char>& data) {
+    std::fstream stream(path, std::ios::in | std::ios::binary);
+    std::size_t count = 0;
+    while (count < data.size() && stream.good()) {
+        char ch;
+        stream.get(ch);
+        if (!stream.good()) break;
+        data[count++] = ch;
+    }
+    return count;
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t mb = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+    std::size_t total = mb << 20;
+    const std::size_t chunk = 1 << 20;
+    const char* path = "/tmp/cstar_bench_fileio.bin";
+
+    std::vector<char> data(total), back(total);
+    for (std::size_t i = 0; i < total; ++i) data[i] = (char)(i * 131 + 7);
+
+    std::printf("%zu MiB file\n", mb);
+
+    auto t0 = bench_clock::now();
+    std::size_t n = byte_loop_write(path, data);
+    std::printf("%-22s %9.1f MB/s\n", "byte loop write", mbps(n, t0));
+
+    t0 = bench_clock::now();
+    n = byte_loop_read(path, back);
+    std::printf("%-22s %9.1f MB/s\n", "byte loop read", mbps(n, t0));
+
+    int fd = fileopen(path, O_RDWR | O_CREAT | O_TRUNC);
+    if (fd < 0) { std::printf("fileopen failed: %d\n", posix_errno); return 1; }
+
+    t0 = bench_clock::now();
+    n = 0;
+    for (std::size_t off = 0; off < total; off += chunk) n += filewrite(fd, data.data() + off, chunk);
+    std::printf("%-22s %9.1f MB/s\n", "filewrite 1MiB", mbps(n, t0));
+
+    fileseek(fd, 0, SEEK_SET);
+    t0 = bench_clock::now();
+    n = 0;
+    for (std::size_t off = 0; off < total; off += chunk) n += fileread(fd, back.data() + off, chunk);
+    std::printf("%-22s %9.1f MB/s\n", "fileread 1MiB", mbps(n, t0));
+
+    t0 = bench_clock::now();
+    n = 0;
+    for (std::size_t off = 0; off < total; off += chunk) n += filepread(fd, back.data() + off, chunk, (posix_off_t)off);
+    std::printf("%-22s %9.1f MB/s\n", "filepread 1MiB", mbps(n, t0));
+
+    // zero-copy: touch every byte of the mapping once
+    {
+        unsigned long long sum = 0, expect = 0;
+        for (char c : data) expect += (unsigned char)c;
+        t0 = bench_clock::now();
+        mapped_region map = filemap(fd, map_mode::read_only, 0, 0, map_sequential | map_willneed);
+        for (cstar::byte b : map.data()) sum += b;
+        std::printf("%-22s %9.1f MB/s%s\n", "filemap scan", mbps(map.size(), t0), sum == expect ? "" : "  MISMATCH");
+    }
+
+    // a read past the end returns the short count, then 0
+    char tail[16];
+    ssize_t s1 = filepread(fd, tail, sizeof(tail), (posix_off_t)total - 5);
+    ssize_t s2 = filepread(fd, tail, sizeof(tail), (posix_off_t)total);
+    std::printf("short read at EOF: %zd then %zd, data %s\n", s1, s2, data == back ? "ok" : "MISMATCH");
+
+    // a mapping asked to run past EOF is cut at EOF (read-only) or refused
+    // (read-write), instead of faulting on the pages past the end
+    bool clamp_ok;
+    {
+        mapped_region ro = filemap(fd, map_mode::read_only, 3 * chunk, (posix_off_t)total - 100);
+        mapped_region rw = filemap(fd, map_mode::read_write, 3 * chunk, (posix_off_t)total - 100);
+        int rw_errno = posix_errno;
+        clamp_ok = ro.size() == 100 && (unsigned char)ro.data().back() == (unsigned char)data.back() &&
+                   rw.size() == 0 && rw_errno == EINVAL;
+        std::printf("map past EOF: read-only %zu bytes, read-write %s\n", ro.size(),
+                    clamp_ok ? "EINVAL" : "MISMATCH");
+    }
+
+    fileclose(fd);
+    std::remove(path);
+    return data == back && clamp_ok ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+/*
+bench_hashmap - cstar::hash_map against std::unordered_map and std::map.
+
+For each size: insert N random 64-bit keys without reserve, look all of
+them up in a scattered order (hits), look up N absent keys (misses), and
+iterate summing the values. Numbers are ns per operation.
+The std containers run up to 10M elements. Above that they would not
+fit in a small machine's memory next to each other, so only hash_map
+runs. A string section compares lookups by std::string_view, which
+hash_map serves without building a std::string.
+
+Every container must agree on the sums, and the process exits 1 if one
+does not.
+
+Usage: bench_hashmap [max_elements]   (default 10000000; try 100000000)
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "ext/hashmap.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+static int failures = 0;
+static const std::size_t std_limit = 10'000'000;
+
+struct result {
+    double insert, hit, miss, iterate;
+    std::uint64_t check;
+};
+
+template <typename F>
+static double ns_per(std::size_t ops, F body) {
+    auto t0 = bench_clock::now();
+    body();
+    return std::chrono::duration<double, std::nano>(bench_clock::now() - t0).count() / double(ops);
+}
+
+// Lookups visit keys[i * stride % n] for a stride coprime with n, which
+// jumps around the table without a second copy of the keys. Present keys
+// are odd; k ^ 1 is an absent one.
+static std::size_t coprime_stride(std::size_t n) {
+    std::size_t s = (std::size_t)(n * 0.6180339887) | 1;
+    while (std::gcd(s, n) != 1) s += 2;
+    return s;
+}
+
+template <typename Map>
+static result run(const std::vector<std::uint64_t>& keys) {
+    const std::size_t n = keys.size(), stride = coprime_stride(n);
+    // small sizes repeat so every figure covers at least ~1M operations
+    std::size_t reps = std::max<std::size_t>(1, 1'000'000 / n);
+    result r{1e300, 1e300, 1e300, 1e300, 0};
+    for (std::size_t rep = 0; rep < reps; ++rep) {
+        Map m;
+        r.insert = std::min(r.insert, ns_per(n, [&] {
+            for (std::uint64_t k : keys) m.emplace(k, k >> 3);
+        }));
+        std::uint64_t hits = 0, misses = 0, total = 0;
+        r.hit = std::min(r.hit, ns_per(n, [&] {
+            for (std::size_t i = 0, j = 0; i < n; ++i, j = j + stride >= n ? j + stride - n : j + stride) {
+                auto it = m.find(keys[j]);
+                if (it != m.end()) hits += it->second;
+            }
+        }));
+        r.miss = std::min(r.miss, ns_per(n, [&] {
+            for (std::size_t i = 0, j = 0; i < n; ++i, j = j + stride >= n ? j + stride - n : j + stride)
+                misses += m.find(keys[j] ^ 1) != m.end();
+        }));
+        r.iterate = std::min(r.iterate, ns_per(m.size(), [&] {
+            for (auto& kv : m) total += kv.second;
+        }));
+        r.check = hits + misses * 1000003 + total * 7;
+    }
+    return r;
+}
+
+static void print(const char* op, double a, double b, double c) {
+    auto cell = [](double v) {
+        static char buf[4][16];
+        static int n = 0;
+        char* s = buf[n++ & 3];
+        if (v < 0)
+            std::snprintf(s, 16, "%10s", "-");
+        else
+            std::snprintf(s, 16, "%10.1f", v);
+        return s;
+    };
+    std::printf("  %-10s %s %s %s\n", op, cell(a), cell(b), cell(c));
+}
+
+static void ints(std::size_t n) {
+    std::mt19937_64 rng(n);
+    std::vector<std::uint64_t> keys(n);
+    for (auto& k : keys) k = rng() | 1;
+
+    bool with_std = n <= std_limit;
+    result h = run<cstar::hash_map<std::uint64_t, std::uint64_t>>(keys);
+    result u{-1, -1, -1, -1, h.check}, o{-1, -1, -1, -1, h.check};
+    if (with_std) u = run<std::unordered_map<std::uint64_t, std::uint64_t>>(keys);
+    if (with_std) o = run<std::map<std::uint64_t, std::uint64_t>>(keys);
+
+    std::printf("%zu uint64 keys%s\n", n, h.check == u.check && h.check == o.check ? "" : "  MISMATCH");
+    if (h.check != u.check || h.check != o.check) ++failures;
+    print("insert", h.insert, u.insert, o.insert);
+    print("find hit", h.hit, u.hit, o.hit);
+    print("find miss", h.miss, u.miss, o.miss);
+    print("iterate", h.iterate, u.iterate, o.iterate);
+}
+
+static void strings(std::size_t n) {
+    std::vector<std::string> text(n);
+    for (std::size_t i = 0; i < n; ++i) text[i] = "user:" + std::to_string(i * 2654435761u) + ":session";
+    std::vector<std::string_view> views(text.begin(), text.end());
+    std::shuffle(views.begin(), views.end(), std::mt19937_64(n));
+
+    cstar::hash_map<std::string, std::size_t> h;
+    std::unordered_map<std::string, std::size_t> u;
+    std::map<std::string, std::size_t, std::less<>> o;
+    for (std::size_t i = 0; i < n; ++i) h.emplace(text[i], i), u.emplace(text[i], i), o.emplace(text[i], i);
+
+    std::size_t sh = 0, su = 0, so = 0;
+    double th = ns_per(n, [&] {
+        for (std::string_view v : views) sh += h.find(v)->second;
+    });
+    double tu = ns_per(n, [&] {
+        for (std::string_view v : views) su += u.find(std::string(v))->second;
+    });
+    double to = ns_per(n, [&] {
+        for (std::string_view v : views) so += o.find(v)->second;
+    });
+    std::printf("%zu string keys%s\n", n, sh == su && sh == so ? "" : "  MISMATCH");
+    if (sh != su || sh != so) ++failures;
+    print("find sv", th, tu, to);
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t max = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std_limit;
+    std::printf("ns per operation\n  %-10s %10s %10s %10s\n", "", "hash_map", "unordered", "std::map");
+    for (std::size_t n = 1000; n <= max; n *= 10) ints(n);
+    for (std::size_t n = 1000; n <= std::min<std::size_t>(max, 1'000'000); n *= 10) strings(n);
+    return failures ? 1 : 0;
+}
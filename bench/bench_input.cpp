@@ -0,0 +1,118 @@
+/*
+bench_input - integer parsing throughput on stdin.
+
+Writes N random integers to a temporary file, then reads them back through
+std::scanf, std::cin >> and cstar::stdin_reader. Each method runs in its
+own child process with the file dup'ed onto fd 0, so no method sees a warm
+stdio buffer from another.
+
+Also checks, over a pipe fed a few bytes at a time, that a number split
+across reads parses whole and that a number whose delimiter has arrived is
+returned without waiting for more input (as an interactive prompt needs).
+
+Usage: bench_input [count]   (default 10000000)
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ext/fastin.h"
+
+static long long run_scanf() {
+    long long sum = 0;
+    int v;
+    while (std::scanf("%d", &v) == 1) sum += v;
+    return sum;
+}
+
+static long long run_cin() {
+    std::ios::sync_with_stdio(false);
+    long long sum = 0;
+    int v;
+    while (std::cin >> v) sum += v;
+    return sum;
+}
+
+static long long run_reader() {
+    long long sum = 0;
+    int v;
+    cstar::stdin_reader& in = cstar::stdin_buf();
+    while (in.read(v)) sum += v;
+    return sum;
+}
+
+static void measure(const char* name, const char* path, long long (*fn)(), std::size_t count) {
+    std::fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        int fd = open(path, O_RDONLY);
+        dup2(fd, 0);
+        close(fd);
+        auto t0 = std::chrono::steady_clock::now();
+        long long sum = fn();
+        auto t1 = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>(t1 - t0).count();
+        std::printf("%-14s %8.3f s  %8.1f Mint/s  (sum %lld)\n", name, s, count / s / 1e6, sum);
+        std::fflush(stdout);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+}
+
+// Exits 1 when the reader misparses a split number or blocks on a complete one.
+static void check_split() {
+    int p[2];
+    if (pipe(p) != 0) { std::perror("pipe"); std::exit(1); }
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(p[0]);
+        const char* parts[] = {"42\n", "1", "2", "3 7", "\n"};
+        for (const char* part : parts) {
+            if (write(p[1], part, std::strlen(part)) < 0) _exit(1);
+            usleep(20000);
+        }
+        usleep(500000); // a reader waiting for this is blocking on "42\n"
+        _exit(0);
+    }
+    close(p[1]);
+    cstar::stdin_reader in(p[0]);
+    long a = 0, b = 0, c = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = in.read(a);
+    double first = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    ok = ok && in.read(b) && in.read(c);
+    waitpid(pid, nullptr, 0);
+    close(p[0]);
+    if (!ok || a != 42 || b != 123 || c != 7 || first > 0.25) {
+        std::printf("FAIL split reads: got %ld %ld %ld, first after %.3f s\n", a, b, c, first);
+        std::exit(1);
+    }
+    std::printf("split reads    ok (first value after %.3f s)\n", first);
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    char path[] = "/tmp/cstar_bench_input_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) { std::perror("mkstemp"); return 1; }
+    FILE* f = fdopen(fd, "w");
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> dist(-1000000000, 1000000000);
+    for (std::size_t i = 0; i < count; ++i) std::fprintf(f, "%d%c", dist(rng), (i % 16 == 15) ? '\n' : ' ');
+    std::fclose(f);
+
+    check_split();
+    std::printf("reading %zu integers\n", count);
+    measure("scanf", path, run_scanf, count);
+    measure("cin >>", path, run_cin, count);
+    measure("stdin_reader", path, run_reader, count);
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,136 @@
+/*
+bench_instrument - what `cstarc --instrument` probes cost (ext/instrument.h).
+
+Overhead: recursive fib, once plain and once with a probe in every call
+as the compiler inserts it. Shows ns added per call, next to the cost of
+one read of the probe's clock and of clock_gettime (steady_clock).
+
+Threads: four threads call a probed function at once; shows ns per call
+again, since each thread keeps its own counters.
+
+The report must hold exact call counts, a recursive function's
+inclusive time must equal its exclusive time, and a caller's inclusive
+time must be its exclusive time plus its callee's, or the process
+exits 1.
+
+Usage: bench_instrument [fib n]   (default 30)
+*/
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "ext/instrument.h"
+
+using bench_clock = std::chrono::steady_clock;
+namespace ins = cstar::instrument;
+
+static ins::site sites[] = {
+    {"fib", "bench_instrument.cpp", 1},
+    {"outer", "bench_instrument.cpp", 2},
+    {"leaf", "bench_instrument.cpp", 3},
+};
+static ins::registry site_registry(sites);
+
+static int failures = 0;
+
+static void expect(const char* what, bool ok) {
+    if (!ok) {
+        std::printf("  MISMATCH: %s\n", what);
+        ++failures;
+    }
+}
+
+static double elapsed(bench_clock::time_point t0) {
+    return std::chrono::duration<double>(bench_clock::now() - t0).count();
+}
+
+__attribute__((noinline)) static long fib_plain(int n) {
+    if (n < 2) return n;
+    return fib_plain(n - 1) + fib_plain(n - 2);
+}
+
+__attribute__((noinline)) static long fib(int n) {
+    ins::probe p(sites[0]);
+    if (n < 2) return n;
+    return fib(n - 1) + fib(n - 2);
+}
+
+static volatile long sink;
+
+__attribute__((noinline)) static void leaf(int i) {
+    ins::probe p(sites[2]);
+    sink = i;
+}
+
+__attribute__((noinline)) static void outer(int n) {
+    ins::probe p(sites[1]);
+    for (int i = 0; i < n; ++i) leaf(i);
+}
+
+static const ins::result* find(const std::vector<ins::result>& rs, const ins::site& s) {
+    for (const auto& r : rs)
+        if (r.where == &s) return &r;
+    return nullptr;
+}
+
+int main(int argc, char* argv[]) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 30;
+    long calls = 0;
+    {
+        long a = 0, b = 1; // calls(n) = 2 fib(n+1) - 1
+        for (int i = 0; i < n + 1; ++i) b += a, a = b - a;
+        calls = 2 * a - 1;
+    }
+
+    double plain = 1e300, probed = 1e300;
+    for (int r = 0; r < 3; ++r) {
+        auto t0 = bench_clock::now();
+        sink = fib_plain(n);
+        plain = std::min(plain, elapsed(t0));
+        t0 = bench_clock::now();
+        sink = fib(n);
+        probed = std::min(probed, elapsed(t0));
+    }
+    std::printf("fib(%d), %ld calls, ns per call\n", n, calls);
+    std::printf("  %-28s %8.2f\n", "plain", plain * 1e9 / (double)calls);
+    std::printf("  %-28s %8.2f\n", "probed", probed * 1e9 / (double)calls);
+    std::printf("  %-28s %8.2f\n", "probe overhead", (probed - plain) * 1e9 / (double)calls);
+
+    const int reads = 10'000'000;
+    std::uint64_t acc = 0;
+    auto t0 = bench_clock::now();
+    for (int i = 0; i < reads; ++i) acc += ins::ticks();
+    double tick_ns = elapsed(t0) * 1e9 / reads;
+    t0 = bench_clock::now();
+    for (int i = 0; i < reads; ++i) acc += (std::uint64_t)bench_clock::now().time_since_epoch().count();
+    double gettime_ns = elapsed(t0) * 1e9 / reads;
+    sink = (long)acc;
+    std::printf("one clock read, ns\n");
+    std::printf("  %-28s %8.2f\n", ins::clock_name(), tick_ns);
+    std::printf("  %-28s %8.2f\n", "clock_gettime", gettime_ns);
+
+    const int per_thread = 2'000'000;
+    t0 = bench_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) threads.emplace_back([] { outer(per_thread); });
+    for (auto& t : threads) t.join();
+    std::printf("4 threads, probed call in a loop, ns\n");
+    std::printf("  %-28s %8.2f\n", "per call", elapsed(t0) * 1e9 / (4.0 * per_thread));
+
+    auto rs = ins::results();
+    const ins::result* f = find(rs, sites[0]);
+    const ins::result* o = find(rs, sites[1]);
+    const ins::result* l = find(rs, sites[2]);
+    expect("fib calls", f && f->calls == (std::uint64_t)(3 * calls));
+    expect("recursive incl == excl", f && std::fabs(f->incl_ns - f->excl_ns) <= 1e-6 * f->incl_ns);
+    expect("outer calls", o && o->calls == 4);
+    expect("leaf calls", l && l->calls == 4ull * per_thread);
+    expect("incl == excl + callee", o && l && std::fabs(o->incl_ns - (o->excl_ns + l->incl_ns)) <= 1e-6 * o->incl_ns);
+
+    // keep the exit report out of the bench output
+    setenv("CSTAR_INSTRUMENT", "/dev/null", 1);
+    return failures ? 1 : 0;
+}
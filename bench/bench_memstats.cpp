@@ -0,0 +1,154 @@
+/*
+bench_memstats - what `cstarc --memstats` costs (ext/memstats.h).
+
+The bench includes memstats.h, so every new and delete in it is tracked.
+
+Cost: ns per new/delete pair of 32 bytes, next to malloc/free, which the
+hooks wrap. It is shown at the default sampling rate, with every
+allocation sampled (rate 1), and from four threads at once.
+
+Accuracy: a function allocating 1000-byte blocks, and one allocating
+64 KiB blocks, must be reported with estimated allocations and bytes
+within 10% at the default rate, and exactly at rate 1. Totals and peak
+live bytes must match what was allocated (the peak to
+within 64 KiB), and blocks freed on a thread that never allocates must
+be counted, or the process exits 1.
+*/
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "ext/memstats.h"
+
+using bench_clock = std::chrono::steady_clock;
+namespace ms = cstar::memstats;
+
+static int failures = 0;
+
+static void expect(const char* what, bool ok) {
+    if (!ok) {
+        std::printf("  MISMATCH: %s\n", what);
+        ++failures;
+    }
+}
+
+static double elapsed(bench_clock::time_point t0) {
+    return std::chrono::duration<double>(bench_clock::now() - t0).count();
+}
+
+static thread_local void* volatile keep;
+
+static double malloc_ns(int n) {
+    auto t0 = bench_clock::now();
+    for (int i = 0; i < n; ++i) {
+        keep = std::malloc(32);
+        std::free(keep);
+    }
+    return elapsed(t0) * 1e9 / n;
+}
+
+static double new_ns(int n) {
+    auto t0 = bench_clock::now();
+    for (int i = 0; i < n; ++i) {
+        keep = new char[32];
+        delete[] static_cast<char*>(keep);
+    }
+    return elapsed(t0) * 1e9 / n;
+}
+
+__attribute__((noinline)) static void small_blocks(int n) {
+    for (int i = 0; i < n; ++i) {
+        keep = new char[1000];
+        delete[] static_cast<char*>(keep);
+    }
+}
+
+__attribute__((noinline)) static void big_blocks(int n) {
+    for (int i = 0; i < n; ++i) {
+        keep = new char[65536];
+        delete[] static_cast<char*>(keep);
+    }
+}
+
+static const ms::site_stats* find(const std::vector<ms::site_stats>& ss, const char* name) {
+    for (const auto& s : ss)
+        if (s.where.find(name) != std::string::npos) return &s;
+    return nullptr;
+}
+
+static bool near(double got, double want, double tolerance) {
+    return got >= want * (1 - tolerance) && got <= want * (1 + tolerance);
+}
+
+int main() {
+    const int n = 5'000'000;
+    std::printf("new/delete of 32 bytes, ns per pair\n");
+    std::printf("  %-28s %8.1f\n", "malloc/free", malloc_ns(n));
+    std::printf("  %-28s %8.1f\n", "tracked, default rate", new_ns(n));
+
+    std::thread warm([] { keep = new char[1]; delete[] static_cast<char*>(keep); });
+    warm.join();
+    auto t0 = bench_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) threads.emplace_back([] { new_ns(n / 4); });
+    for (auto& t : threads) t.join();
+    std::printf("  %-28s %8.1f\n", "tracked, 4 threads", elapsed(t0) * 1e9 / n);
+
+    std::int64_t rate = ms::detail::rate();
+    ms::set_sample_rate(1);
+    std::printf("  %-28s %8.1f\n", "tracked, every call sampled", new_ns(200'000));
+    ms::set_sample_rate(rate);
+
+    ms::totals before = ms::current();
+    small_blocks(400'000);
+    big_blocks(8'000);
+    ms::totals after = ms::current();
+    expect("allocations counted", after.allocations - before.allocations == 408'000);
+    expect("bytes counted", after.bytes - before.bytes == 400'000ull * 1000 + 8'000ull * 65536);
+
+    // estimates are unbiased, but vary from run to run
+    auto ss = ms::sites();
+    const ms::site_stats* small = find(ss, "small_blocks");
+    const ms::site_stats* big = find(ss, "big_blocks");
+    std::printf("estimates at the default rate\n");
+    std::printf("  %-28s %8.0f of 400000\n", "small_blocks allocations", small ? small->allocations : 0);
+    std::printf("  %-28s %8.0f of 8000\n", "big_blocks allocations", big ? big->allocations : 0);
+    expect("small_blocks estimate", small && near(small->allocations, 400'000, 0.1));
+    expect("big_blocks estimate", big && near(big->bytes, 8'000.0 * 65536, 0.1));
+
+    ms::set_sample_rate(1);
+    auto base = ms::sites();
+    double small0 = find(base, "small_blocks") ? find(base, "small_blocks")->allocations : 0;
+    small_blocks(1'000);
+    ss = ms::sites();
+    small = find(ss, "small_blocks");
+    expect("exact at rate 1", small && small->allocations - small0 == 1'000.0);
+
+    std::vector<char*> held;
+    ms::totals start = ms::current();
+    for (int i = 0; i < 160; ++i) held.push_back(new char[65536]);
+    for (char* p : held) delete[] p;
+    ms::totals end = ms::current();
+    // threads publish live bytes in 64 KiB steps, so the peak may be off by one step
+    double rise = (double)(end.peak_live_bytes - start.live_bytes);
+    expect("peak live", std::abs(rise - 160.0 * 65536) <= 2.0 * 65536);
+
+    // allocated here, freed on a thread that allocates nothing itself
+    std::vector<int*> blocks;
+    blocks.reserve(1000);
+    ms::totals sent = ms::current();
+    for (int i = 0; i < 1000; ++i) blocks.push_back(new int[100]);
+    std::thread([&blocks] {
+        for (int* p : blocks) delete[] p;
+    }).join();
+    ms::totals back = ms::current();
+    // std::thread's own state is allocated here and freed there too
+    expect("cross-thread frees", back.frees - sent.frees == back.allocations - sent.allocations &&
+                                     back.frees - sent.frees >= 1000);
+    expect("cross-thread freed bytes", back.freed_bytes - sent.freed_bytes == back.bytes - sent.bytes);
+
+    setenv("CSTAR_MEMSTATS", "/dev/null", 1); // keep the exit report out of the bench output
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,131 @@
+/*
+bench_parallel - scaling of cstar::thread_pool and the parallel algorithms.
+
+Each workload runs serially first, then on pools of 1, 2, 4, ... workers
+up to the core count (or the count given on the command line), and
+shows milliseconds and the speedup over the serial run:
+
+  for     out[i] = sqrt(i) * sin(i) over 16M doubles (compute-bound)
+  reduce  sum of 64M integers (memory-bound)
+  sort    10M random 64-bit keys, against std::sort
+  fork    fib(27) forking at every level, against plain recursion;
+          measures the cost of invoke itself
+
+Every parallel result must equal the serial one, or the process exits 1.
+
+Usage: bench_parallel [max_threads]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+#include "ext/parallel.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+static int failures = 0;
+
+template <typename F>
+static double ms(F body) {
+    double best = 1e300;
+    for (int r = 0; r < 3; ++r) {
+        auto t0 = bench_clock::now();
+        body();
+        best = std::min(best, std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count());
+    }
+    return best;
+}
+
+static void report(const char* name, unsigned threads, double t, double serial, bool ok) {
+    if (threads == 0)
+        std::printf("  %-7s serial %9.1f ms\n", name, t);
+    else
+        std::printf("  %-7s %3u thr %9.1f ms  %5.2fx%s\n", name, threads, t, serial / t, ok ? "" : "  MISMATCH");
+    if (!ok) ++failures;
+}
+
+static long fib_serial(int n) { return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2); }
+
+static long fib(cstar::thread_pool& pool, int n) {
+    if (n < 2) return n;
+    long a, b;
+    pool.invoke([&] { a = fib(pool, n - 1); }, [&] { b = fib(pool, n - 2); });
+    return a + b;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned max = argc > 1 ? (unsigned)std::atoi(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> counts;
+    for (unsigned t = 1; t < max; t *= 2) counts.push_back(t);
+    counts.push_back(max);
+    std::printf("%u hardware threads\n", std::thread::hardware_concurrency());
+
+    const std::size_t n_for = 16u << 20, n_reduce = 64u << 20, n_sort = 10'000'000;
+    std::vector<double> out(n_for), want(n_for);
+    auto kernel = [](std::size_t i) { return std::sqrt((double)i) * std::sin((double)i); };
+    double serial_for = ms([&] {
+        for (std::size_t i = 0; i < n_for; ++i) want[i] = kernel(i);
+    });
+
+    std::vector<std::uint32_t> values(n_reduce);
+    std::mt19937 rng(7);
+    for (auto& v : values) v = rng();
+    std::uint64_t want_sum = 0;
+    double serial_reduce = ms([&] {
+        std::uint64_t s = 0;
+        for (std::uint32_t v : values) s += v;
+        want_sum = s;
+    });
+
+    std::vector<std::uint64_t> keys(n_sort), sorted;
+    std::mt19937_64 rng64(11);
+    for (auto& k : keys) k = rng64();
+    double serial_sort = ms([&] {
+        sorted = keys;
+        std::sort(sorted.begin(), sorted.end());
+    });
+
+    const int fib_n = 27;
+    long want_fib = 0;
+    double serial_fib = ms([&] { want_fib = fib_serial(fib_n); });
+
+    report("for", 0, serial_for, serial_for, true);
+    report("reduce", 0, serial_reduce, serial_reduce, true);
+    report("sort", 0, serial_sort, serial_sort, true);
+    report("fork", 0, serial_fib, serial_fib, true);
+
+    for (unsigned t : counts) {
+        cstar::thread_pool pool(t);
+        double t_for = ms([&] { cstar::parallel_for(pool, 0, n_for, [&](std::size_t i) { out[i] = kernel(i); }); });
+        report("for", t, t_for, serial_for, out == want);
+
+        std::uint64_t sum = 0;
+        double t_reduce = ms([&] {
+            sum = cstar::parallel_reduce(pool, 0, n_reduce, std::uint64_t(0),
+                                         [&](std::size_t lo, std::size_t hi) {
+                                             std::uint64_t s = 0;
+                                             for (std::size_t i = lo; i < hi; ++i) s += values[i];
+                                             return s;
+                                         },
+                                         [](std::uint64_t a, std::uint64_t b) { return a + b; });
+        });
+        report("reduce", t, t_reduce, serial_reduce, sum == want_sum);
+
+        std::vector<std::uint64_t> v;
+        double t_sort = ms([&] {
+            v = keys;
+            cstar::parallel_sort(pool, v.begin(), v.end());
+        });
+        report("sort", t, t_sort, serial_sort, v == sorted);
+
+        long f = 0;
+        double t_fib = ms([&] { pool.run([&] { f = fib(pool, fib_n); }); });
+        report("fork", t, t_fib, serial_fib, f == want_fib);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,51 @@
+/*
+bench_plugin - per-call cost of a plugin function.
+
+Calls cos() from the C math library three ways: the old importlib pattern
+(dlopen + dlsym + dlclose around every call), a registry lookup per call
+(hash probe on the cached symbol table), and a function pointer fetched
+once from the registry (one indirect call). libm is already mapped by
+libstdc++, so the dlopen row is a lower bound: a library that is not
+otherwise loaded is mapped and relocated on every call.
+
+Usage: bench_plugin [calls]   (default 2000000; the dlopen row runs calls/100)
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <dlfcn.h>
+#include "ext/plugin.h"
+
+static const char* libm_path = "libm.so.6";
+
+template<typename F>
+static void measure(const char* name, long calls, F body) {
+    volatile double sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (long i = 0; i < calls; ++i) sink = sink + body(i * 1e-6);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / calls;
+    std::printf("%-28s %10.1f ns/call\n", name, ns);
+}
+
+int main(int argc, char* argv[]) {
+    long calls = argc > 1 ? std::atol(argv[1]) : 2000000;
+    cstar::plugin* lib = cstar::plugins().preload(libm_path);
+    if (!lib) { std::printf("%s\n", cstar::plugins().last_error().c_str()); return 1; }
+
+    measure("dlopen/dlsym/dlclose", calls / 100, [](double x) {
+        void* h = dlopen(libm_path, RTLD_LAZY);
+        auto f = reinterpret_cast<double (*)(double)>(dlsym(h, "cos"));
+        double r = f(x);
+        dlclose(h);
+        return r;
+    });
+    measure("registry get per call", calls, [](double x) {
+        return cstar::plugins().get<double(double)>(libm_path, "cos")(x);
+    });
+    measure("plugin::get per call", calls, [lib](double x) {
+        return lib->get<double(double)>("cos")(x);
+    });
+    auto cached = lib->get<double(double)>("cos");
+    measure("cached function pointer", calls, [cached](double x) { return cached(x); });
+    return 0;
+}
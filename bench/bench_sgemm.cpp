@@ -0,0 +1,108 @@
+/*
+bench_sgemm - GFLOP/s of cstar::ml::sgemm.
+
+Square products from 128 to 1024 and the skinny shapes a dense layer
+sees (small batch times a wide weight matrix, and the transposed case),
+each checked against a double-precision reference and timed on all
+cores of cstar::default_pool(). A plain i-k-j triple loop gives the
+baseline. Also checks that softmax normalizes over the last axis for 1-D
+and 3-D tensors.
+
+Usage: bench_sgemm [threads]   (default: every core)
+*/
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "ext/AI/ml/stdml.h"
+
+using cstar::ml::tensor;
+using bench_clock = std::chrono::steady_clock;
+
+static void naive(std::size_t m, std::size_t n, std::size_t k, const float* A, const float* B, float* C) {
+    for (std::size_t i = 0; i < m * n; ++i) C[i] = 0.0f;
+    for (std::size_t i = 0; i < m; ++i)
+        for (std::size_t p = 0; p < k; ++p) {
+            float a = A[i * k + p];
+            for (std::size_t j = 0; j < n; ++j) C[i * n + j] += a * B[p * n + j];
+        }
+}
+
+template<typename F>
+static double gflops(std::size_t m, std::size_t n, std::size_t k, F body) {
+    double flop = 2.0 * m * n * k;
+    int reps = 1;
+    for (;;) {
+        auto t0 = bench_clock::now();
+        for (int r = 0; r < reps; ++r) body();
+        double s = std::chrono::duration<double>(bench_clock::now() - t0).count();
+        if (s > 0.2) return flop * reps / s / 1e9;
+        reps *= 2;
+    }
+}
+
+// Each last-axis slice must sum to 1 and keep the ordering of its logits.
+static bool softmax_ok(cstar::ml::tensor::shape_type shape) {
+    tensor t = tensor::uniform(shape, -3.0f, 3.0f, 3);
+    tensor p = cstar::ml::softmax(t);
+    std::size_t n = shape.back();
+    for (std::size_t r = 0; r < t.size() / n; ++r) {
+        double sum = 0;
+        for (std::size_t j = 0; j < n; ++j) {
+            sum += p[r * n + j];
+            if (j && (t[r * n + j] < t[r * n + j - 1]) != (p[r * n + j] < p[r * n + j - 1])) return false;
+        }
+        if (std::fabs(sum - 1.0) > 1e-5) return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (!softmax_ok({10}) || !softmax_ok({2, 3, 5})) {
+        std::printf("softmax: last-axis slices do not sum to 1\n");
+        return 1;
+    }
+
+    unsigned threads = argc > 1 ? (unsigned)std::atoi(argv[1]) : 0;
+    unsigned shown = threads ? threads : cstar::default_pool().size();
+    std::printf("sgemm, %u thread(s)\n%-22s %10s %10s %10s\n", shown, "m x n x k", "GFLOP/s", "naive", "max err");
+
+    struct shape {
+        std::size_t m, n, k;
+    };
+    const shape shapes[] = {
+        {128, 128, 128}, {256, 256, 256}, {512, 512, 512}, {1024, 1024, 1024},
+        {1, 4096, 1024}, {32, 4096, 1024}, {4096, 32, 1024}, {1024, 64, 4096},
+    };
+    for (const shape& s : shapes) {
+        tensor a = tensor::uniform({s.m, s.k}, -1.0f, 1.0f, 1);
+        tensor b = tensor::uniform({s.k, s.n}, -1.0f, 1.0f, 2);
+        tensor c({s.m, s.n}), ref({s.m, s.n});
+
+        cstar::ml::sgemm(s.m, s.n, s.k, 1.0f, a.data(), s.k, b.data(), s.n, 0.0f, c.data(), s.n, threads);
+        double err = 0;
+        for (std::size_t i = 0; i < s.m; i += 7)
+            for (std::size_t j = 0; j < s.n; j += 5) {
+                double acc = 0;
+                for (std::size_t p = 0; p < s.k; ++p) acc += (double)a(i, p) * b(p, j);
+                err = std::fmax(err, std::fabs(acc - c(i, j)));
+            }
+
+        double fast = gflops(s.m, s.n, s.k, [&] {
+            cstar::ml::sgemm(s.m, s.n, s.k, 1.0f, a.data(), s.k, b.data(), s.n, 0.0f, c.data(), s.n, threads);
+        });
+        double slow = s.m * s.n * s.k <= (1u << 28)
+                          ? gflops(s.m, s.n, s.k, [&] { naive(s.m, s.n, s.k, a.data(), b.data(), ref.data()); })
+                          : NAN;
+        char label[40];
+        std::snprintf(label, sizeof label, "%zu x %zu x %zu", s.m, s.n, s.k);
+        std::printf("%-22s %10.1f %10.1f %10.2g\n", label, fast, slow, err);
+    }
+
+    cstar::ml::dense layer(784, 512, cstar::ml::activation::relu);
+    tensor x = tensor::uniform({64, 784}, 0.0f, 1.0f);
+    volatile float sink = 0;
+    double g = gflops(64, 512, 784, [&] { sink = sink + layer.forward(x)[0]; });
+    std::printf("%-22s %10.1f   (dense 784->512, relu, batch 64)\n", "dense forward", g);
+    return 0;
+}
@@ -0,0 +1,124 @@
+/*
+bench_startup - what a CStar program costs before main runs.
+
+The binary is a hello-world built the way cstarc builds programs (it
+includes ext/stdcstar.h). It re-executes itself as a child and reports:
+
+  time to main   exec() to the first line of main, median over the runs
+  total          exec() to exit, for the whole hello-world
+  new before main  calls to operator new made by static initializers
+  heap at main   malloc'd bytes in use at main (mallinfo2); this includes
+                 libstdc++'s own exception emergency pool, which the
+                 runtime cannot avoid
+
+The runtime's target is zero operator new calls before main.
+
+Usage: bench_startup [runs]   (default 200)
+*/
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <vector>
+#include <fcntl.h>
+#include <malloc.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ext/stdcstar.h"
+
+extern char** environ;
+
+// zero-initialized, so counting works from the very first static initializer
+static long news_before_main;
+static bool in_main;
+
+void* operator new(std::size_t n) {
+    if (!in_main) ++news_before_main;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t n, std::align_val_t al) {
+    if (!in_main) ++news_before_main;
+    std::size_t a = static_cast<std::size_t>(al);
+    if (void* p = std::aligned_alloc(a, (n + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+// Out of line, like memstats.h: with free() inlined into callers, g++
+// pairs it with the operator new call and warns (-Wmismatched-new-delete).
+[[gnu::noinline]] static void release(void* p) noexcept { std::free(p); }
+void operator delete(void* p) noexcept { release(p); }
+void operator delete(void* p, std::size_t) noexcept { release(p); }
+void operator delete(void* p, std::align_val_t) noexcept { release(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { release(p); }
+
+static long long now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct child_report {
+    long long main_ns;
+    long news;
+    long heap;
+};
+
+static int child() {
+    child_report r{now_ns(), news_before_main, 0};
+    in_main = true;
+    r.heap = static_cast<long>(mallinfo2().uordblks);
+    Console.WriteLine("Hello, World!");
+    ssize_t w = write(3, &r, sizeof(r));
+    return w == (ssize_t)sizeof(r) ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::strcmp(argv[1], "--child") == 0) return child();
+    in_main = true;
+
+    int runs = argc > 1 ? std::atoi(argv[1]) : 200;
+    std::vector<double> to_main, total;
+    child_report last{};
+    for (int i = 0; i < runs; ++i) {
+        int fds[2];
+        if (pipe(fds) != 0) return 1;
+        posix_spawn_file_actions_t fa;
+        posix_spawn_file_actions_init(&fa);
+        posix_spawn_file_actions_adddup2(&fa, fds[1], 3);
+        posix_spawn_file_actions_addopen(&fa, 1, "/dev/null", O_WRONLY, 0);
+        char arg[] = "--child";
+        char* child_argv[] = {argv[0], arg, nullptr};
+
+        pid_t pid;
+        long long t0 = now_ns();
+        if (posix_spawn(&pid, argv[0], &fa, nullptr, child_argv, environ) != 0) return 1;
+        close(fds[1]);
+        child_report r{};
+        ssize_t got = read(fds[0], &r, sizeof(r));
+        int status = 0;
+        waitpid(pid, &status, 0);
+        long long t1 = now_ns();
+        close(fds[0]);
+        posix_spawn_file_actions_destroy(&fa);
+        if (got != (ssize_t)sizeof(r) || status != 0) {
+            std::fprintf(stderr, "child failed\n");
+            return 1;
+        }
+        to_main.push_back((r.main_ns - t0) / 1e3);
+        total.push_back((t1 - t0) / 1e3);
+        last = r;
+    }
+    auto median = [](std::vector<double>& v) {
+        std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+        return v[v.size() / 2];
+    };
+    std::printf("hello-world via ext/stdcstar.h, %d runs\n", runs);
+    std::printf("%-18s %10.1f us (median)\n", "time to main", median(to_main));
+    std::printf("%-18s %10.1f us (median)\n", "total", median(total));
+    std::printf("%-18s %10ld\n", "new before main", last.news);
+    std::printf("%-18s %10ld bytes\n", "heap at main", last.heap);
+    return 0;
+}
@@ -0,0 +1,164 @@
+/*
+bench_text - cstar::text on a 16 MB mixed ASCII / UTF-8 document.
+
+Each operation runs on every code path the CPU supports (scalar, SSE4.2,
+AVX2) next to the obvious standard-library way to do it, and shows GB/s
+of input processed. Every path must give the baseline's answer, or the
+process exits 1.
+*/
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ext/text.h"
+
+namespace text = cstar::text;
+using bench_clock = std::chrono::steady_clock;
+
+static int failures = 0;
+
+template <typename F>
+static double gbps(std::size_t bytes, F body) {
+    double best = 1e300;
+    for (int r = 0; r < 5; ++r) {
+        auto t0 = bench_clock::now();
+        body();
+        best = std::min(best, std::chrono::duration<double>(bench_clock::now() - t0).count());
+    }
+    return double(bytes) / best / 1e9;
+}
+
+// Times base (the standard-library version) and op on every code path;
+// each must return the same value.
+template <typename Base, typename Op>
+static void row(const char* name, std::size_t bytes, Base base, Op op) {
+    decltype(base()) want{}, got{};
+    std::printf("  %-16s %8.2f", name, gbps(bytes, [&] { want = base(); }));
+    for (text::isa i : {text::isa::scalar, text::isa::sse42, text::isa::avx2}) {
+        if (!text::use_isa(i)) {
+            std::printf(" %8s", "-");
+            continue;
+        }
+        std::printf(" %8.2f", gbps(bytes, [&] { got = op(); }));
+        if (!(got == want)) {
+            std::printf(" MISMATCH(%s)", text::isa_name(i));
+            ++failures;
+        }
+    }
+    std::printf("\n");
+    text::use_isa(text::best_isa());
+}
+
+static std::string document(std::size_t size) {
+    const char* words[] = {"the", "CStar", "compiler", "emits", "C++", "from", "source", "files,", "xin", "chào",
+                           "Việt", "Nam", "tiếng", "Việt", "đẹp", "naïve", "café", "→", "€5", "日本語", "😀",
+                           "value;", "key=value", "<tag>", "&amp;", "loop", "return", "struct", "Hello", "WORLD"};
+    std::mt19937 rng(42);
+    std::string s;
+    s.reserve(size + 64);
+    std::size_t line = 0;
+    while (s.size() < size) {
+        s += words[rng() % (sizeof words / sizeof *words)];
+        line += 6;
+        if (line > 60 + rng() % 20) {
+            s += '\n';
+            line = 0;
+        } else {
+            s += ' ';
+        }
+    }
+    return s;
+}
+
+int main() {
+    const std::string doc = document(16 << 20);
+    const std::string_view sv = doc;
+    std::printf("cstar::text, %zu MB, best path: %s\n", doc.size() >> 20, text::isa_name(text::best_isa()));
+    std::printf("  %-16s %8s %8s %8s %8s   (GB/s)\n", "", "std", "scalar", "sse4.2", "avx2");
+
+    row("find", doc.size(), [&] { return sv.find("needle-not-here"); },
+        [&] { return text::find(sv, "needle-not-here"); });
+    // absent, but 't' ... 'e' pairs are everywhere: exercises the verify step
+    row("find near-miss", doc.size(), [&] { return sv.find("the source code"); },
+        [&] { return text::find(sv, "the source code"); });
+    row("find_first_of", doc.size(), [&] { return sv.find_first_of("@#$%"); },
+        [&] { return text::find_first_of(sv, "@#$%"); });
+    row("count_lines", doc.size(), [&] { return (std::size_t)std::count(doc.begin(), doc.end(), '\n') + 1; },
+        [&] { return text::count_lines(sv); });
+
+    row("split lines", doc.size(),
+        [&] {
+            std::vector<std::string_view> out;
+            for (std::size_t start = 0;;) {
+                std::size_t at = sv.find('\n', start);
+                out.push_back(sv.substr(start, at == sv.npos ? sv.npos : at - start));
+                if (at == sv.npos) break;
+                start = at + 1;
+            }
+            return out;
+        },
+        [&] { return text::split(sv, '\n'); });
+    row("split_any \" ,;\"", doc.size(),
+        [&] {
+            std::vector<std::string_view> out;
+            for (std::size_t start = 0;;) {
+                std::size_t at = sv.find_first_of(" ,;", start);
+                out.push_back(sv.substr(start, at == sv.npos ? sv.npos : at - start));
+                if (at == sv.npos) break;
+                start = at + 1;
+            }
+            return out;
+        },
+        [&] { return text::split_any(sv, " ,;"); });
+
+    // trim every line after padding it the way user input arrives
+    std::vector<std::string> padded;
+    std::size_t padded_bytes = 0;
+    for (std::string_view line : text::split(sv.substr(0, 4 << 20), '\n')) {
+        padded.push_back("   \t" + std::string(line) + "  \r");
+        padded_bytes += padded.back().size();
+    }
+    row("trim lines", padded_bytes,
+        [&] {
+            std::size_t kept = 0;
+            for (const std::string& s : padded) {
+                std::size_t b = s.find_first_not_of(" \t\n\v\f\r"), e = s.find_last_not_of(" \t\n\v\f\r");
+                kept += b == s.npos ? 0 : e - b + 1;
+            }
+            return kept;
+        },
+        [&] {
+            std::size_t kept = 0;
+            for (const std::string& s : padded) kept += text::trim(s).size();
+            return kept;
+        });
+
+    row("lower", doc.size(),
+        [&] {
+            std::string out(doc.size(), '\0');
+            std::transform(doc.begin(), doc.end(), out.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+            return out;
+        },
+        [&] { return text::lower(sv); });
+    const std::string shouted = text::upper(sv);
+    row("iequals", doc.size(),
+        [&] {
+            return std::equal(doc.begin(), doc.end(), shouted.begin(), shouted.end(),
+                              [](unsigned char a, unsigned char b) { return std::tolower(a) == std::tolower(b); });
+        },
+        [&] { return text::iequals(sv, shouted); });
+
+    row("valid_utf8", doc.size(), [&] { return text::detail::portable::valid_utf8(doc.data(), doc.size()); },
+        [&] { return text::valid_utf8(sv); });
+    std::string broken = doc;
+    broken[broken.size() - 3] = '\xC3';
+    row("invalid_utf8", doc.size(), [&] { return text::detail::portable::valid_utf8(broken.data(), broken.size()); },
+        [&] { return text::valid_utf8(broken); });
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+/*
+bench_timers - timer churn on cstar::timer_wheel.
+
+Typical service timers (timeouts) are armed and cancelled far more often
+than they fire. Measures, for N live timers with delays spread over a
+minute: bulk insert, add+cancel churn with N timers live, and firing
+everything by advancing the clock. A std::multimap timer queue (ordered
+tree, O(log n)) runs the same workload for reference.
+
+Usage: bench_timers [live-timers] [churn-ops]   (default 1000000 5000000)
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <random>
+#include <vector>
+#include "ext/eventloop.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+static double mops(std::size_t n, bench_clock::time_point t0) {
+    return n / std::chrono::duration<double>(bench_clock::now() - t0).count() / 1e6;
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t live = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    std::size_t churn = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5000000;
+    std::mt19937_64 rng(3);
+    std::vector<std::uint64_t> delays(live + churn);
+    for (auto& d : delays) d = 1 + rng() % 60000;
+    std::size_t fired = 0;
+    auto cb = [&fired] { ++fired; };
+
+    std::printf("%zu live timers, %zu add+cancel pairs (Mops/s)\n", live, churn);
+    std::printf("%-16s %10s %10s %10s\n", "", "insert", "churn", "fire");
+    {
+        cstar::timer_wheel wheel;
+        std::vector<cstar::timer_id> ids(live);
+        auto t0 = bench_clock::now();
+        for (std::size_t i = 0; i < live; ++i) ids[i] = wheel.add(delays[i], 0, cb);
+        double ins = mops(live, t0);
+
+        t0 = bench_clock::now();
+        for (std::size_t i = 0; i < churn; ++i) {
+            std::size_t k = i % live;
+            wheel.cancel(ids[k]);
+            ids[k] = wheel.add(delays[live + i], 0, cb);
+        }
+        double ch = mops(churn, t0);
+
+        t0 = bench_clock::now();
+        wheel.advance_to(wheel.now() + 60001);
+        double fi = mops(live, t0);
+        std::printf("%-16s %10.1f %10.1f %10.1f   (fired %zu)\n", "timer_wheel", ins, ch, fi, fired);
+    }
+    fired = 0;
+    {
+        using queue_t = std::multimap<std::uint64_t, std::function<void()>>;
+        queue_t q;
+        std::vector<queue_t::iterator> ids(live);
+        auto t0 = bench_clock::now();
+        for (std::size_t i = 0; i < live; ++i) ids[i] = q.emplace(delays[i], cb);
+        double ins = mops(live, t0);
+
+        t0 = bench_clock::now();
+        for (std::size_t i = 0; i < churn; ++i) {
+            std::size_t k = i % live;
+            q.erase(ids[k]);
+            ids[k] = q.emplace(delays[live + i], cb);
+        }
+        double ch = mops(churn, t0);
+
+        t0 = bench_clock::now();
+        while (!q.empty()) {
+            auto it = q.begin();
+            it->second();
+            q.erase(it);
+        }
+        double fi = mops(live, t0);
+        std::printf("%-16s %10.1f %10.1f %10.1f   (fired %zu)\n", "std::multimap", ins, ch, fi, fired);
+    }
+    return 0;
+}
@@ -0,0 +1,175 @@
+/*
+bench_trace - what TRACE_SCOPE costs (ext/trace.h, built with CSTAR_TRACE).
+
+Cost: ns per TRACE_SCOPE around an empty body, next to the loop alone
+and to one read of the trace clock. A span reads the clock twice; the
+rest is the ring write. Also shown from four threads at
+once, since each thread writes its own ring.
+
+Snapshot: ms to copy four full rings, and to write them as Chrome JSON.
+
+A snapshot must hold exactly the newest events of each ring, with
+nested spans inside their parents. While one thread writes events
+non-stop, repeated snapshots must never show a torn event. A dump must
+load back unchanged. Otherwise the process exits 1.
+*/
+#define CSTAR_TRACE 1
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ext/trace.h"
+
+using bench_clock = std::chrono::steady_clock;
+namespace tr = cstar::trace;
+
+static int failures = 0;
+
+static void expect(const char* what, bool ok) {
+    if (!ok) {
+        std::printf("  MISMATCH: %s\n", what);
+        ++failures;
+    }
+}
+
+static double elapsed(bench_clock::time_point t0) {
+    return std::chrono::duration<double>(bench_clock::now() - t0).count();
+}
+
+static volatile long sink;
+
+__attribute__((noinline)) static void plain_loop(long n) {
+    for (long i = 0; i < n; ++i) sink = i;
+}
+
+__attribute__((noinline)) static void traced_loop(long n) {
+    for (long i = 0; i < n; ++i) {
+        TRACE_SCOPE("span");
+        sink = i;
+    }
+}
+
+__attribute__((noinline)) static void nested(int n) {
+    for (int i = 0; i < n; ++i) {
+        TRACE_SCOPE("outer");
+        for (int j = 0; j < 3; ++j) {
+            TRACE_SCOPE("inner");
+            sink = j;
+        }
+        TRACE_INSTANT("mark");
+    }
+}
+
+static const tr::thread_events* thread_of(const tr::capture& c, const std::string& name) {
+    for (const auto& t : c.threads)
+        if (t.name == name) return &t;
+    return nullptr;
+}
+
+int main() {
+    setenv("CSTAR_TRACE_OUT", "0", 1); // no dump at exit
+    const long n = 10'000'000;
+    tr::name_thread("bench");
+
+    auto t0 = bench_clock::now();
+    plain_loop(n);
+    double plain = elapsed(t0) * 1e9 / n;
+    t0 = bench_clock::now();
+    traced_loop(n);
+    double traced = elapsed(t0) * 1e9 / n;
+    std::uint64_t acc = 0;
+    t0 = bench_clock::now();
+    for (long i = 0; i < n; ++i) acc += tr::ticks();
+    double tick = elapsed(t0) * 1e9 / n;
+    sink = (long)acc;
+
+    std::vector<std::thread> threads;
+    t0 = bench_clock::now();
+    for (int t = 0; t < 4; ++t) threads.emplace_back([] { traced_loop(n / 4); });
+    for (auto& t : threads) t.join();
+    double four = elapsed(t0) * 1e9 / n;
+    threads.clear();
+
+    std::printf("ns per event\n");
+    std::printf("  %-28s %8.2f\n", "loop alone", plain);
+    std::printf("  %-28s %8.2f\n", "TRACE_SCOPE", traced);
+    std::printf("  %-28s %8.2f\n", "added by the span", traced - plain);
+    std::printf("  %-28s %8.2f\n", "of which not clock reads", traced - plain - 2 * tick);
+    std::printf("  %-28s %8.2f\n", "TRACE_SCOPE, 4 threads", four);
+    std::printf("  %-28s %8.2f\n", "one clock read", tick);
+
+    t0 = bench_clock::now();
+    tr::capture c = tr::snapshot();
+    double snap = elapsed(t0);
+    std::string json = (std::filesystem::temp_directory_path() / "bench_trace.json").string();
+    t0 = bench_clock::now();
+    tr::write_json(c, json);
+    double write = elapsed(t0);
+    std::printf("snapshot of %zu events\n", tr::event_count(c));
+    std::printf("  %-28s %8.1f ms\n", "copy (incl. 20 ms clock fit)", snap * 1e3);
+    std::printf("  %-28s %8.1f ms, %.1f MB\n", "Chrome JSON", write * 1e3,
+                (double)std::filesystem::file_size(json) / 1e6);
+    std::filesystem::remove(json);
+    const tr::thread_events* b = thread_of(c, "bench");
+    expect("ring holds the newest events", b && b->events.size() == 65536);
+
+    // nesting: inner spans and the mark sit inside the outer span before them
+    std::thread nest([] {
+        tr::name_thread("nest");
+        nested(1000);
+    });
+    nest.join();
+    c = tr::snapshot();
+    const tr::thread_events* t = thread_of(c, "nest");
+    bool inside = t && t->events.size() == 5000;
+    const tr::event* outer = nullptr;
+    for (std::size_t i = 0; t && i < t->events.size(); ++i) {
+        const tr::event& e = t->events[i];
+        const std::string& name = c.names[e.name];
+        if (name == "outer") outer = &e;
+        else if (name == "inner") inside = inside && outer && e.start >= outer->start && e.end <= outer->end;
+        else inside = inside && name == "mark" && e.instant && outer && e.start >= outer->start && e.start <= outer->end;
+    }
+    expect("nested spans", inside);
+
+    // torn events: each event has end == start + 1 and a name given by start
+    static const char* const parity[2] = {"even", "odd"};
+    std::atomic<bool> stop{false};
+    std::thread writer([&] {
+        tr::name_thread("writer");
+        for (std::uint64_t k = 1; !stop.load(std::memory_order_relaxed); ++k)
+            tr::detail::record(parity[k & 1], k, k + 1);
+    });
+    bool torn = false;
+    std::size_t seen = 0;
+    for (int r = 0; r < 200; ++r) {
+        c = tr::snapshot();
+        const tr::thread_events* w = thread_of(c, "writer");
+        for (std::size_t i = 0; w && i < w->events.size(); ++i) {
+            const tr::event& e = w->events[i];
+            torn |= e.end != e.start + 1 || c.names[e.name] != parity[e.start & 1] ||
+                    (i && e.start != w->events[i - 1].start + 1);
+        }
+        seen += w ? w->events.size() : 0;
+    }
+    stop = true;
+    writer.join();
+    expect("no torn events", !torn && seen > 0);
+
+    std::string dump = (std::filesystem::temp_directory_path() / "bench_trace.cstrace").string();
+    c = tr::snapshot();
+    tr::capture back;
+    bool same = tr::save(c, dump) && tr::load(dump, back) && back.names == c.names &&
+                back.threads.size() == c.threads.size() && back.ns_per_tick == c.ns_per_tick;
+    for (std::size_t i = 0; same && i < c.threads.size(); ++i)
+        same = back.threads[i].tid == c.threads[i].tid && back.threads[i].name == c.threads[i].name &&
+               back.threads[i].events.size() == c.threads[i].events.size() &&
+               std::memcmp(back.threads[i].events.data(), c.threads[i].events.data(),
+                           c.threads[i].events.size() * sizeof(tr::event)) == 0;
+    std::filesystem::remove(dump);
+    expect("dump loads back", same);
+    return failures ? 1 : 0;
+}
@@ -17,6 +17,10 @@ Copyright (c) November 2025 Hoang Viet. All rights reserved.
 #include <vector>
 #include <regex>
 #include <cstdlib>   // for system/getenv
+#include <filesystem>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include "keywords.h"
 
 bool endsWith(const std::string& str, const std::string& suffix) {
@@ -26,6 +30,281 @@ bool endsWith(const std::string& str, const std::string& suffix) {
 
 std::string current_ver = "CStar26 Debug 3";
 
+// Stands for "#line <this line> <the .cpp>" until the output is complete
+const std::string cppLineMarker = "#line __CSTAR_CPP_LINE__";
+
+// Escape a string for use inside a C++ string literal
+std::string cppQuote(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+// A `reloadable returnf` function, split for the hot-reload side library
+struct HotFunction {
+    std::string ret, name, params, args;
+    std::vector<std::string> lines;
+};
+
+// A function given a probe by --instrument, with the line it starts on
+struct ProbeSite {
+    std::string name;
+    int line;
+};
+
+// Top-level parts of a parameter list: "int a, std::map<int, int> m = {}"
+// -> {"int a", " std::map<int, int> m = {}"}
+std::vector<std::string> splitParams(const std::string& params) {
+    std::vector<std::string> parts;
+    std::string cur;
+    int depth = 0;
+    char quote = 0;
+    for (size_t i = 0; i < params.size(); ++i) {
+        char c = params[i];
+        if (quote) {
+            if (c == '\\' && i + 1 < params.size()) cur += params[i++];
+            else if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '<' || c == '(' || c == '[' || c == '{') {
+            depth++;
+        } else if (c == '>' || c == ')' || c == ']' || c == '}') {
+            depth--;
+        } else if (c == ',' && depth == 0) {
+            parts.push_back(cur);
+            cur.clear();
+            continue;
+        }
+        cur += c;
+    }
+    parts.push_back(cur);
+    return parts;
+}
+
+// Index of a parameter's default-argument '=', or npos
+size_t defaultArgPos(const std::string& param) {
+    int depth = 0;
+    for (size_t i = 0; i < param.size(); ++i) {
+        char c = param[i];
+        if (c == '<' || c == '(' || c == '[' || c == '{') depth++;
+        if (c == '>' || c == ')' || c == ']' || c == '}') depth--;
+        if (c == '=' && depth == 0) return i;
+    }
+    return std::string::npos;
+}
+
+// "int a, long b = 2" -> "int a, long b". Default arguments may appear in
+// one declaration only, and never in a function pointer type.
+std::string stripDefaults(const std::string& params) {
+    std::string out;
+    for (auto p : splitParams(params)) {
+        size_t eq = defaultArgPos(p);
+        if (eq != std::string::npos) p.erase(p.find_last_not_of(" \t", eq - 1) + 1);
+        size_t first = p.find_first_not_of(" \t");
+        if (first == std::string::npos) continue;
+        if (!out.empty()) out += ", ";
+        out += p.substr(first);
+    }
+    return out;
+}
+
+// "int a, const std::string& b = x" -> "a, b"
+std::string paramNames(const std::string& params) {
+    std::string args;
+    std::regex nameRe(R"((\w+)\s*(\[[^\]]*\])?\s*$)");
+    for (auto& p : splitParams(stripDefaults(params))) {
+        std::smatch m;
+        if (p.find_first_not_of(" \t") == std::string::npos || p == "void") continue;
+        if (std::regex_search(p, m, nameRe)) {
+            if (!args.empty()) args += ", ";
+            args += m[1].str();
+        }
+    }
+    return args;
+}
+
+// line with the insides of string and character literals and a trailing
+// // comment blanked to spaces, so keywords and braces can be matched by
+// position without seeing text that is not code
+std::string codeOnly(const std::string& line) {
+    std::string code = line;
+    char quote = 0;
+    for (size_t i = 0; i < code.size(); ++i) {
+        char c = code[i];
+        if (quote) {
+            if (c == quote) { quote = 0; continue; }
+            code[i] = ' ';
+            if (c == '\\' && i + 1 < code.size()) code[++i] = ' ';
+            continue;
+        }
+        if (c == '"' || c == '\'') quote = c;
+        if (c == '/' && i + 1 < code.size() && code[i + 1] == '/') {
+            std::fill(code.begin() + (long)i, code.end(), ' ');
+            break;
+        }
+    }
+    return code;
+}
+
+// Scope tracking for lowering `async` functions: the depth of the body
+// being lowered and of any lambda bodies inside it
+struct AsyncState {
+    int depth = 0;               // brace depth at the current character
+    int bodyDepth = -1;          // depth inside the async body, -1 outside
+    bool pendingBody = false;    // async signature seen, '{' not yet
+    bool returnsVoid = false;
+    std::vector<int> lambdas;    // depths inside lambda bodies
+};
+
+// async T f(...) { ... }  ->  cstar::task<T> f(...) { ... }
+// In the body (not in lambdas, strings or comments) await becomes co_await
+// and return/rtrn become co_return. A task<void> body also ends in
+// co_return, so it is a coroutine even when it never awaits (ext/coro.h).
+std::string lowerAsync(std::string line, AsyncState& st) {
+    static const std::regex asyncRe(
+        R"(^(\s*(?:(?:static|virtual|inline|reloadable|returnf)\s+)*)async\s+((?:(?:static|virtual|inline|reloadable|returnf)\s+)*)(.*?\S)\s+(\w+)\s*\()");
+    static const std::regex lambdaRe(R"(\[[^\[\]]*\]\s*(?:\([^()]*\))?\s*(?:mutable\s*)?(?:->\s*[^{;]*)?\{)");
+    std::smatch m;
+    if (st.bodyDepth < 0 && !st.pendingBody && std::regex_search(line, m, asyncRe)) {
+        st.returnsVoid = m[3].str() == "void";
+        line = m[1].str() + m[2].str() + "cstar::task<" + m[3].str() + "> " + m[4].str() + "(" +
+               line.substr((size_t)m.length(0));
+        size_t last = line.find_last_not_of(" \t");
+        st.pendingBody = last != std::string::npos && line[last] != ';';
+    }
+    if (st.bodyDepth < 0 && !st.pendingBody) return line;
+
+    std::string code = codeOnly(line);
+    std::vector<size_t> lambdaBraces;
+    for (auto it = std::sregex_iterator(code.begin(), code.end(), lambdaRe); it != std::sregex_iterator(); ++it)
+        lambdaBraces.push_back((size_t)(it->position(0) + it->length(0) - 1));
+    auto ident = [](char c) { return std::isalnum((unsigned char)c) || c == '_'; };
+    auto wordAt = [&](size_t i, const char* w) {
+        size_t n = std::strlen(w);
+        return code.compare(i, n, w) == 0 && (i == 0 || !ident(code[i - 1])) &&
+               (i + n >= code.size() || !ident(code[i + n]));
+    };
+
+    std::string out;
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = code[i];
+        if (st.bodyDepth >= 0 && st.lambdas.empty()) {
+            if (wordAt(i, "await")) { out += "co_await"; i += 4; continue; }
+            if (wordAt(i, "return")) { out += "co_return"; i += 5; continue; }
+            if (wordAt(i, "rtrn")) { out += "co_return"; i += 3; continue; }
+        }
+        if (c == '{') {
+            st.depth++;
+            if (st.pendingBody) {
+                st.pendingBody = false;
+                st.bodyDepth = st.depth;
+            } else if (st.bodyDepth >= 0 &&
+                       std::find(lambdaBraces.begin(), lambdaBraces.end(), i) != lambdaBraces.end()) {
+                st.lambdas.push_back(st.depth);
+            }
+        }
+        if (c == '}') {
+            if (!st.lambdas.empty() && st.lambdas.back() == st.depth) st.lambdas.pop_back();
+            if (st.depth == st.bodyDepth) {
+                if (st.returnsVoid) out += "co_return; ";
+                st.bodyDepth = -1;
+            }
+            st.depth--;
+        }
+        out += line[i];
+    }
+    return out;
+}
+
+// Enough scope tracking to lower `synchronized`: which class body a line
+// sits directly in, and a method guard still waiting for its '{'
+struct SyncState {
+    int depth = 0;                                   // brace depth at line start
+    std::vector<std::pair<std::string, int>> classes; // class name, depth inside its body
+    std::string pendingClass;                        // class head seen, '{' not yet
+    std::string pendingGuard;                        // goes after the next '{'
+    int counter = 0;
+};
+
+// Index of the ')' matching the '(' at open, or npos
+size_t matchParen(const std::string& s, size_t open) {
+    int depth = 0;
+    for (size_t i = open; i < s.size(); ++i) {
+        if (s[i] == '(') depth++;
+        if (s[i] == ')' && --depth == 0) return i;
+    }
+    return std::string::npos;
+}
+
+// synchronized (obj) { ... }  ->  if (cstar::sync_guard g{obj}; true) { ... }
+// synchronized T f(...) { ... }  ->  T f(...) { cstar::sync_guard g{this}; ... }
+// The guard holds obj's monitor (ext/sync.h) until the block ends. Methods,
+// in the class body or defined out of it as T A::f(...), lock this; static
+// methods lock their class, free functions a shared monitor. Strings and
+// comments are left alone.
+std::string lowerSynchronized(std::string line, SyncState& st) {
+    static const std::regex classRe(R"(^\s*(?:template\s*<.*>\s*)?(?:class|struct)\s+(\w+)[^;]*$)");
+    static const std::regex blockRe(R"(\bsynchronized\s*\()");
+    static const std::regex methodRe(R"(^(.*?)\bsynchronized\s+([^;]*\w\s*\())");
+    static const std::regex staticRe(R"(\bstatic\b)");
+    static const std::regex memberRe(R"(\w\s*::\s*~?\w+\s*\($)");   // T A::f( outside the class
+    std::smatch m;
+    std::string code = codeOnly(line);
+
+    if (std::regex_search(code, m, classRe)) st.pendingClass = m[1].str();
+    auto guardAfterBrace = [&](size_t from, const std::string& guard) {
+        size_t brace = code.find('{', from);
+        if (brace == std::string::npos) return false;
+        line.insert(brace + 1, " " + guard);
+        code.insert(brace + 1, " " + guard);
+        return true;
+    };
+    if (!st.pendingGuard.empty() && guardAfterBrace(0, st.pendingGuard)) st.pendingGuard.clear();
+
+    while (std::regex_search(code, m, blockRe)) {
+        size_t kw = (size_t)m.position(0), open = kw + (size_t)m.length(0) - 1, close = matchParen(code, open);
+        if (close == std::string::npos) break;
+        std::string obj = line.substr(open + 1, close - open - 1);
+        line.replace(kw, close + 1 - kw,
+                     "if (cstar::sync_guard cstar_sync_" + std::to_string(st.counter++) + "{" + obj + "}; true)");
+        code = codeOnly(line);
+    }
+    if (std::regex_search(code, m, methodRe)) {
+        bool inClass = !st.classes.empty() && st.classes.back().second == st.depth;
+        std::string target = "this";
+        if (inClass && std::regex_search(code, staticRe))
+            target = "cstar::class_monitor<" + st.classes.back().first + ">()";
+        else if (!inClass && !std::regex_search(m[2].first, m[2].second, memberRe))
+            target = "cstar::class_monitor<void>()";
+        std::string guard = "cstar::sync_guard cstar_sync_" + std::to_string(st.counter++) + "{" + target + "};";
+        size_t prefix = (size_t)m.length(1), keyword = (size_t)m.position(2) - prefix;
+        line.erase(prefix, keyword);
+        code.erase(prefix, keyword);
+        size_t open = code.find('(', prefix), close = matchParen(code, open);
+        size_t last = code.find_last_not_of(" \t");
+        bool declaration = last != std::string::npos && code[last] == ';';
+        if (close != std::string::npos && !declaration && !guardAfterBrace(close, guard)) st.pendingGuard = guard;
+    }
+
+    for (char c : code) {
+        if (c == '{') {
+            st.depth++;
+            if (!st.pendingClass.empty()) {
+                st.classes.emplace_back(st.pendingClass, st.depth);
+                st.pendingClass.clear();
+            }
+        }
+        if (c == '}') {
+            st.depth--;
+            while (!st.classes.empty() && st.classes.back().second > st.depth) st.classes.pop_back();
+        }
+    }
+    return line;
+}
+
 int main(int argc, char* argv[]) {
     std::string filename = "testfile.cstar";
     bool compileFlag = false;
@@ -34,12 +313,23 @@ int main(int argc, char* argv[]) {
     bool callLinker = false;
     bool linkerVersion = false;
     bool silent = false; // -s silences compiler output
+    bool hotReload = false; // --hot-reload: reloadable functions go to a side library
+    bool instrument = false; // --instrument: count and time every function call
+    bool profileRun = false; // --profile-run: build for the sampling profiler and run under it
+    bool memstats = false; // --memstats: track heap allocations per call site
+    bool trace = false; // --trace: compile in TRACE_SCOPE spans
+    bool debug = false; // --debug: build for cstardb, with .cstar line info
 
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "-s") silent = true;
+    }
+    if (!silent) {
     #ifdef _WIN32
         system("cls");
     #else
         system("clear");
     #endif
+    }
 
     #warning "This is an early version of the CStar Compiler. Expect bugs and incomplete features."
 
@@ -59,6 +349,19 @@ int main(int argc, char* argv[]) {
             linkerVersion = true;
         } else if (arg == "-s") {
             silent = true;
+        } else if (arg == "--hot-reload") {
+            hotReload = true;
+        } else if (arg == "--instrument") {
+            instrument = true;
+        } else if (arg == "--profile-run") {
+            profileRun = true;
+            compileFlag = true;
+        } else if (arg == "--memstats") {
+            memstats = true;
+        } else if (arg == "--trace") {
+            trace = true;
+        } else if (arg == "--debug") {
+            debug = true;
         }
     }
 
@@ -109,6 +412,10 @@ int main(int argc, char* argv[]) {
     std::vector<std::string> includes;
     std::vector<std::string> body;
     std::vector<std::string> globalFunctions;
+    std::vector<HotFunction> hotFunctions;
+    std::vector<std::string> hotPrototypes;   // other returnf functions, declared for the side library
+    std::vector<ProbeSite> probeSites;
+    std::vector<std::string>* functionSink = &globalFunctions;
     std::string line;
 
     // Regex patterns for entry point detection and transformations
@@ -117,24 +424,56 @@ int main(int argc, char* argv[]) {
     std::regex importRegex(R"(import\s*\(\s*\"([^\"]+)\"\s*,\s*\"([^\"]+)\"\s*\))");
     std::regex sysRegex(R"(System\.out\.println)");
     std::regex strArrayRegex(R"(string\s+args\[\d+\]\s*=\s*\{)");
-    std::regex returnfRegex(R"(^\s*returnf\s+)");
+    std::regex returnfRegex(R"(^\s*(reloadable\s+)?returnf\s+)");
+    std::regex signatureRegex(R"(^\s*(.*\S)\s+(\w+)\s*\()");   // parameters end at matchParen
+    std::regex localLinkageRegex(R"(\b(static|inline|constexpr|consteval|template)\b)");
+    std::regex probeNameRegex(R"(^[^(]*?(\w+)\s*\()");  // first name before '(', the function's
+    std::regex cstapiIncludeRegex(R"(#\s*include\s*<(cstapi|random_header)>)");
+    std::regex randomObjectRegex(R"((^|[^\w:.>])random(\s*\.))");  // <cstapi>'s object, not libc random()
 
     bool inFunctionDefinition = false;
     bool inMainFunction = false;
     bool foundMainDeclaration = false;  // track if we found main() line
     int braceCount = 0;
+    SyncState syncState;
+    AsyncState asyncState;
+    int lineNo = 0;
+    int mainLine = 1;            // where mainfunc's probe says it starts
+    ProbeSite pendingProbe;      // returnf function whose '{' is still to come
+    bool probePending = false;
+    size_t probeFrom = 0;        // where to resume looking for it on the current line
+    int probeParens = 0;         // open parentheses of its signature
+    bool usesCstapi = false;     // <cstapi> keeps its random object in namespace cstapi
+
+    // #line directives map generated code back to the .cstar file; one
+    // goes in wherever a sink's next line is not the next source line
+    bool lineDirectives = profileRun || memstats || debug;
+    std::string sourceName = cppQuote(std::filesystem::absolute(filename).string());
+    int bodyNext = 0, functionNext = 0;
+    auto markLine = [&](std::vector<std::string>& sink, int& next) {
+        if (!lineDirectives) return;
+        if (lineNo != next) sink.push_back("#line " + std::to_string(lineNo) + " " + sourceName);
+        next = lineNo + 1;
+    };
 
     while (std::getline(f, line)) {
         bool keywordFound = false;
+        lineNo++;
 
         for (const auto& keyword : keywords) {
             if (line.find(keyword) != std::string::npos) {
-                printOutln("Keyword found: " + keyword + " in line: " + line);
+                printOutln("Keyword found: " + std::string(keyword) + " in line: " + line);
                 keywordFound = true;
                 break;
             }
         }
 
+        // Lower `synchronized` blocks and methods to monitor guards
+        line = lowerSynchronized(line, syncState);
+
+        // Lower `async` functions and `await` to C++20 coroutines
+        line = lowerAsync(line, asyncState);
+
         // Detect argument usage
         if (line.find("argc") != std::string::npos || 
             line.find("argv") != std::string::npos || 
@@ -163,15 +502,20 @@ int main(int argc, char* argv[]) {
 
         // Handle traditional includes
         if (line.find("#include") != std::string::npos) {
+            if (std::regex_search(line, cstapiIncludeRegex)) usesCstapi = true;
             if (line.find("ext/stdcstar.h") == std::string::npos) {
                 includes.push_back(line);
             }
             continue;
         }
 
+        // random.yes() → cstapi::random.yes(); a global `random` would clash with libc's
+        if (usesCstapi) line = std::regex_replace(line, randomObjectRegex, "$1cstapi::random$2");
+
         // Detect main function declaration
         if (std::regex_search(line, mainfuncRegex) || std::regex_search(line, usingMainRegex)) {
             foundMainDeclaration = true;
+            mainLine = lineNo;
             
             // Count braces on this line
             for (char c : line) {
@@ -223,19 +567,79 @@ int main(int argc, char* argv[]) {
             line = std::regex_replace(line, sysRegex, "System::out.println");
             line = std::regex_replace(line, strArrayRegex, "std::string args[] = {");
             
+            markLine(body, bodyNext);
             body.push_back(line);
             continue;
         }
         
         // Handle returnf function definitions
-        if (std::regex_search(line, returnfRegex) && !inFunctionDefinition) {
+        std::smatch returnfMatch;
+        if (!inFunctionDefinition && std::regex_search(line, returnfMatch, returnfRegex)) {
             inFunctionDefinition = true;
             braceCount = 0;
+            bool reloadable = returnfMatch[1].matched;
             line = std::regex_replace(line, returnfRegex, "");
+            functionSink = &globalFunctions;
+
+            std::smatch sig;
+            size_t sigClose = std::string::npos;
+            if (hotReload && std::regex_search(line, sig, signatureRegex))
+                sigClose = matchParen(line, (size_t)sig.length(0) - 1);
+            if (reloadable && sigClose != std::string::npos) {
+                HotFunction hf;
+                hf.ret = sig[1].str();
+                hf.name = sig[2].str();
+                hf.params = line.substr(sig.length(0), sigClose - sig.length(0));
+                hf.args = paramNames(hf.params);
+                // exported under an unmangled name for dlsym; the defaults
+                // stay on the wrappers that keep the function's name
+                line = "extern \"C\" " + hf.ret + " cstar_hot_" + hf.name + "(" + stripDefaults(hf.params) + ")" +
+                       line.substr(sigClose + 1);
+                hotFunctions.push_back(hf);
+                functionSink = &hotFunctions.back().lines;
+                printOutln("Reloadable function: " + hf.name);
+            } else if (reloadable && hotReload) {
+                printErrln("\033[1;33mWarning:\033[0m cannot parse reloadable signature, compiled normally: " + line);
+            } else if (sigClose != std::string::npos && !std::regex_search(sig[1].str(), localLinkageRegex)) {
+                // reloadable code calls it through the program (-rdynamic)
+                hotPrototypes.push_back(sig[1].str() + " " + sig[2].str() + "(" +
+                                        line.substr(sig.length(0), sigClose - sig.length(0)) + ");");
+            }
+
+            // Coroutines are skipped: a probe would time their suspensions
+            // too, and constexpr functions cannot hold one
+            probePending = instrument && functionSink == &globalFunctions &&
+                           line.find("cstar::task<") == std::string::npos &&
+                           line.find("constexpr") == std::string::npos &&
+                           line.find("consteval") == std::string::npos && std::regex_search(line, sig, probeNameRegex);
+            if (probePending) {
+                pendingProbe = {sig[1].str(), lineNo};
+                probeFrom = (size_t)sig.length(0) - 1;
+                probeParens = 0;
+            }
         }
 
         if (inFunctionDefinition) {
-            globalFunctions.push_back(line);
+            // the body's '{' is the first one after the parameter list, so
+            // braces in default arguments (v = {}) are skipped
+            size_t brace = std::string::npos;
+            if (probePending) {
+                std::string code = codeOnly(line);
+                for (size_t i = probeFrom; i < code.size() && brace == std::string::npos; ++i) {
+                    if (code[i] == '(') probeParens++;
+                    if (code[i] == ')') probeParens--;
+                    if (code[i] == '{' && probeParens == 0) brace = i;
+                }
+                probeFrom = 0;
+            }
+            if (brace != std::string::npos) {
+                line.insert(brace + 1, " cstar::instrument::probe cstar_probe_(cstar_sites[" +
+                                           std::to_string(probeSites.size()) + "]);");
+                probeSites.push_back(pendingProbe);
+                probePending = false;
+            }
+            if (functionSink == &globalFunctions) markLine(globalFunctions, functionNext);
+            functionSink->push_back(line);
             
             // Count braces
             for (char c : line) {
@@ -255,6 +659,7 @@ int main(int argc, char* argv[]) {
         // Fix string args declaration
         line = std::regex_replace(line, strArrayRegex, "std::string args[] = {");
 
+        markLine(body, bodyNext);
         body.push_back(line);
     }
 
@@ -265,11 +670,80 @@ int main(int argc, char* argv[]) {
         ofs << inc << "\n";
     }
     ofs << "\n";
+
+    // --instrument: the probed functions, with mainfunc last
+    if (instrument) {
+        probeSites.push_back({"mainfunc", mainLine});
+        ofs << "#include \"ext/instrument.h\"\n\n";
+        ofs << "static cstar::instrument::site cstar_sites[] = {\n";
+        for (const auto& ps : probeSites)
+            ofs << "    {" << cppQuote(ps.name) << ", " << cppQuote(filename) << ", " << ps.line << "},\n";
+        ofs << "};\n";
+        ofs << "static cstar::instrument::registry cstar_site_registry(cstar_sites);\n\n";
+    }
+
+    // --memstats: replaces the program's operator new and delete
+    if (memstats) ofs << "#include \"ext/memstats.h\"\n\n";
     
+    // Reloadable functions: call through the hot module's slots. The module
+    // is created on first call, so programs pay nothing before main.
+    std::string hotCpp = base + "_hot.cpp";
+    std::string hotLib = std::filesystem::absolute(base + "_hot.so").string();
+    std::string includePath = "-I\"D:/CStar/include\"";
+    if (const char* envInc = std::getenv("CSTAR_INCLUDE")) includePath = "-I\"" + std::string(envInc) + "\"";
+    const char* envCxx = std::getenv("CXX");
+    std::string compiler = envCxx ? std::string(envCxx) : "g++";
+    // use gnu++23 for GNU/Clang toolchains
+    std::string stdFlag = "-std=gnu++23";
+    std::string hotCompile = compiler + " " + includePath + " \"" + std::filesystem::absolute(hotCpp).string() +
+                             "\" -w " + stdFlag + " -shared -fPIC -o ";
+    if (!hotFunctions.empty()) {
+        std::string source = std::filesystem::absolute(filename).string();
+        std::string rebuild = "\"" + std::filesystem::absolute(argv[0]).string() + "\" \"" + source +
+                              "\" --hot-reload -s && " + hotCompile + "\"{out}\"";
+        ofs << "#include \"ext/hotreload.h\"\n\n";
+        ofs << "inline cstar::hot_module& cstar_hot() {\n";
+        ofs << "    static cstar::hot_module module(" << cppQuote(source) << ", " << cppQuote(hotLib) << ",\n";
+        ofs << "        " << cppQuote(rebuild) << ",\n        {";
+        for (size_t i = 0; i < hotFunctions.size(); ++i) ofs << (i ? ", " : "") << cppQuote(hotFunctions[i].name);
+        ofs << "});\n    return module;\n}\n";
+        for (size_t i = 0; i < hotFunctions.size(); ++i) {
+            const HotFunction& hf = hotFunctions[i];
+            ofs << "inline " << hf.ret << " " << hf.name << "(" << hf.params << ") { return reinterpret_cast<"
+                << hf.ret << " (*)(" << stripDefaults(hf.params) << ")>(cstar_hot().fn(" << i << "))(" << hf.args
+                << "); }\n";
+        }
+        ofs << "\n";
+
+        // Side library: the reloadable bodies, calling each other directly
+        std::ofstream hot(hotCpp);
+        if (!hot.is_open()) {
+            printErrln("Cannot create output file: " + hotCpp);
+            return 1;
+        }
+        hot << "// Transpiled from CStar (reloadable functions)\n";
+        hot << "#include \"ext/stdcstar.h\"\n";
+        for (const auto& inc : includes) hot << inc << "\n";
+        hot << "\n";
+        // the program's other returnf functions, resolved in the program
+        for (const auto& proto : hotPrototypes) hot << proto << "\n";
+        for (const auto& hf : hotFunctions) {
+            hot << "extern \"C\" " << hf.ret << " cstar_hot_" << hf.name << "(" << stripDefaults(hf.params) << ");\n";
+            hot << "static inline " << hf.ret << " " << hf.name << "(" << hf.params << ") { return cstar_hot_"
+                << hf.name << "(" << hf.args << "); }\n";
+        }
+        hot << "\n";
+        for (const auto& hf : hotFunctions) {
+            for (const auto& l : hf.lines) hot << l << "\n";
+            hot << "\n";
+        }
+    }
+
     // Write global function definitions (helper functions)
     for (const auto& funcLine : globalFunctions) {
         ofs << funcLine << "\n";
     }
+    if (lineDirectives) ofs << cppLineMarker << "\n";
     ofs << "\n";
 
     // Write mainfunc signature
@@ -278,10 +752,14 @@ int main(int argc, char* argv[]) {
     } else {
         ofs << "usingfunc::integerfunc mainfunc() {\n";
     }
+    if (instrument) {
+        ofs << "    cstar::instrument::probe cstar_probe_(cstar_sites[" << probeSites.size() - 1 << "]);\n";
+    }
 
     for (const auto& b : body) {
         ofs << "    " << b << "\n";
     }
+    if (lineDirectives) ofs << cppLineMarker << "\n";
 
     ofs << "}\n\n";
 
@@ -294,26 +772,71 @@ int main(int argc, char* argv[]) {
 
     ofs.close();
 
+    // Code written after the .cstar lines is the .cpp's own again
+    if (lineDirectives) {
+        std::ifstream in(cppFilename);
+        std::vector<std::string> out;
+        for (std::string l; std::getline(in, l);) {
+            if (l == cppLineMarker) l = "#line " + std::to_string(out.size() + 2) + " " + cppQuote(cppFilename);
+            out.push_back(l);
+        }
+        in.close();
+        std::ofstream rewrite(cppFilename);
+        for (const auto& l : out) rewrite << l << "\n";
+    }
+
     // Compile to .exe if -c flag is present
     if (compileFlag) {
-        std::string includePath = "-I\"D:/CStar/include\"";
         std::string exeFilename = base + ".exe";
 
-        // prefer $CXX if provided, otherwise fall back to g++
-        const char* envCxx = std::getenv("CXX");
-        std::string compiler = envCxx ? std::string(envCxx) : "g++";
-
-        // use gnu++23 for GNU/Clang toolchains
-        std::string stdFlag = "-std=gnu++23";
+        std::string extraFlags;
+        if (!hotFunctions.empty()) {
+            // the side library must exist before the program starts, and it
+            // binds to the program's copies of runtime globals (-rdynamic)
+            printOutln("\033[1;34mCompiling reloadable functions...\033[0m");
+            if (system((hotCompile + "\"" + hotLib + "\"").c_str()) != 0) {
+                printErrln("\033[1;31mCompilation failed.\033[0m");
+                return 1;
+            }
+            extraFlags = " -rdynamic -pthread";
+        }
+        if (profileRun) {
+            // frame pointers for the profiler's unwinder, debug info for addr2line
+            if (extraFlags.empty()) extraFlags = " -rdynamic -pthread";
+            extraFlags += " -g -fno-omit-frame-pointer -DCSTAR_PROFILER_ENV";
+        }
+        if (memstats) {
+            // debug info to resolve allocation sites to .cstar lines
+            if (extraFlags.empty()) extraFlags = " -rdynamic -pthread";
+            if (!profileRun) extraFlags += " -g";
+        }
+        if (trace) extraFlags += " -DCSTAR_TRACE";
+        if (debug) {
+            // cstardb maps .cstar lines through the line table and reads
+            // locals at fixed offsets from the frame pointer
+            extraFlags += " -g -O0 -fno-omit-frame-pointer";
+        }
 
-        std::string compileCommand = compiler + " " + includePath + " \"" + cppFilename + "\" -w " + stdFlag + " -lm -o \"" + exeFilename + "\"";
+        std::string compileCommand = compiler + " " + includePath + " \"" + cppFilename + "\" -w " + stdFlag + extraFlags + " -lm -o \"" + exeFilename + "\"";
         printOutln("\033[1;34mCompiling...\033[0m");
         int result = system(compileCommand.c_str());
         std::string executecommand = "\"" + exeFilename + "\"";
 
         if (result == 0) {
             printOutln("\033[1;32mCompilation successful!\033[0m Output: " + exeFilename);
-            if (!silent) system(executecommand.c_str());
+            if (profileRun) {
+                std::string folded = std::filesystem::absolute(base + ".folded").string();
+            #ifdef _WIN32
+                _putenv_s("CSTAR_PROFILE", folded.c_str());
+                printErrln("\033[1;33mWarning:\033[0m the sampling profiler is only available on Linux");
+            #else
+                setenv("CSTAR_PROFILE", folded.c_str(), 1);
+            #endif
+                system(("\"" + std::filesystem::absolute(exeFilename).string() + "\"").c_str());
+                printOutln("Profile: " + folded);
+            } else if (!silent) {
+                system(executecommand.c_str());
+            }
         } else {
             printErrln("\033[1;31mCompilation failed.\033[0m");
             return 1;
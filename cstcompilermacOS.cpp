@@ -5,6 +5,8 @@
 #include <regex>
 #include "keywords.h"
 
+using namespace std;
+
 std::string cstar_version = "CStar25"
 
 bool endsWith(const std::string& str, const std::string& suffix) {
@@ -0,0 +1,1734 @@
+// cstdb - CStar debugger (cstardb), Linux ptrace backend
+//
+//   cstardb program.cstar [-- args...]    builds with `cstarc --debug`, then debugs
+//   cstardb program.exe [-- args...]      debugs a program already built with --debug
+//
+// The program is started stopped, under ptrace. The debugger blocks in
+// waitpid() while it runs and only wakes for events: a breakpoint, a
+// signal, a new thread, or exit. Breakpoints are int3 bytes at the
+// addresses that the line table (from readelf) gives for .cstar lines;
+// cstarc --debug writes #line directives so those lines are the .cstar
+// file's own. A breakpoint condition (`break 12 if total > 100`) is
+// evaluated by the debugger when the breakpoint is hit, reading locals
+// from the stopped thread at their frame-pointer offsets, and the
+// program resumes at once if it is false: no prompt, no stop reported.
+//
+// All-stop: when one thread stops for the user, the others are stopped
+// too, and all resume together. x86-64 Linux only.
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__) && defined(__x86_64__)
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <climits>
+
+static const char* const cstardbVersion = "cstardb 2.0 (ptrace)";
+
+bool endsWith(const std::string& str, const std::string& suffix) {
+    return str.size() >= suffix.size() &&
+           str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static std::string baseName(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+static std::string trim(const std::string& s) {
+    size_t a = s.find_first_not_of(" \t");
+    if (a == std::string::npos) return "";
+    size_t b = s.find_last_not_of(" \t\r\n");
+    return s.substr(a, b - a + 1);
+}
+
+// ---------------------------------------------------------------------------
+// Debug info, read from `readelf --debug-dump` output
+// ---------------------------------------------------------------------------
+
+struct LineRow {
+    uint64_t addr;
+    int line;  // 0 for the end of a sequence
+    int file;
+    bool stmt;
+};
+
+struct TypeDie {
+    std::string tag, name;
+    int size = 0, encoding = 0;
+    uint64_t ref = 0; // type this one is built on, 0 for none (void)
+};
+
+struct Variable {
+    std::string name;
+    uint64_t type = 0;
+    long long frameOffset = 0; // from the frame's CFA
+    uint64_t lo = 0, hi = 0;   // where it is in scope
+    bool param = false;
+};
+
+struct Function {
+    std::string name;
+    uint64_t lo = 0, hi = 0;
+    bool cstar = false; // has .cstar lines, so locals are known
+    std::vector<Variable> vars;
+};
+
+struct LineStart {
+    int file, line;
+    uint64_t addr;
+};
+
+class DebugInfo {
+public:
+    std::vector<std::string> files;
+    std::vector<LineRow> rows;          // by address
+    std::vector<LineStart> lineStarts;  // first is_stmt address of each run of a line
+    std::set<uint64_t> lineStartAddrs;
+    std::vector<Function> functions;    // by lo
+    std::map<uint64_t, TypeDie> types;
+    int mainFile = -1;
+
+    bool load(const std::string& exe, std::string& error) {
+        if (!loadLines(exe, error)) return false;
+        if (!loadInfo(exe, error)) return false;
+        std::sort(functions.begin(), functions.end(),
+                  [](const Function& a, const Function& b) { return a.lo < b.lo; });
+        return true;
+    }
+
+    bool isCstar(int file) const { return file >= 0 && endsWith(files[file], ".cstar"); }
+
+    const Function* functionAt(uint64_t pc) const {
+        auto it = std::upper_bound(functions.begin(), functions.end(), pc,
+                                   [](uint64_t p, const Function& f) { return p < f.lo; });
+        if (it == functions.begin()) return nullptr;
+        --it;
+        return pc < it->hi ? &*it : nullptr;
+    }
+
+    const Function* functionNamed(const std::string& name) const {
+        for (const auto& f : functions)
+            if (f.name == name && f.cstar) return &f;
+        for (const auto& f : functions)
+            if (f.name == name) return &f;
+        return nullptr;
+    }
+
+    // The row covering pc, or nullptr outside any sequence.
+    const LineRow* rowAt(uint64_t pc) const {
+        auto it = std::upper_bound(rows.begin(), rows.end(), pc,
+                                   [](uint64_t p, const LineRow& r) { return p < r.addr; });
+        if (it == rows.begin()) return nullptr;
+        --it;
+        return it->line ? &*it : nullptr;
+    }
+
+    // Where a breakpoint on the function's first line goes: past the
+    // prologue, at the second row of the function, like gdb.
+    uint64_t afterPrologue(const Function& f) const {
+        auto it = std::upper_bound(rows.begin(), rows.end(), f.lo,
+                                   [](uint64_t p, const LineRow& r) { return p < r.addr; });
+        return it != rows.end() && it->addr < f.hi && it->line ? it->addr : f.lo;
+    }
+
+    // Breakpoint addresses for file:line, one per function the line has
+    // code in. A line without code moves to the next one that has.
+    std::vector<uint64_t> addressesFor(int file, int& line) const {
+        for (int l = line; l < line + 50; ++l) {
+            std::map<const Function*, uint64_t> first;
+            for (const auto& s : lineStarts) {
+                if (s.file != file || s.line != l) continue;
+                const Function* f = functionAt(s.addr);
+                auto it = first.find(f);
+                if (it == first.end() || s.addr < it->second) first[f] = s.addr;
+            }
+            if (first.empty()) continue;
+            std::vector<uint64_t> out;
+            for (auto& [f, addr] : first) out.push_back(f && addr == f->lo ? afterPrologue(*f) : addr);
+            line = l;
+            return out;
+        }
+        return {};
+    }
+
+    int fileNamed(const std::string& name) const {
+        for (size_t i = 0; i < files.size(); ++i)
+            if (isCstar((int)i) && (files[i] == name || baseName(files[i]) == baseName(name))) return (int)i;
+        return -1;
+    }
+
+private:
+    int fileId(const std::string& path) {
+        for (size_t i = 0; i < files.size(); ++i)
+            if (files[i] == path) return (int)i;
+        files.push_back(path);
+        return (int)files.size() - 1;
+    }
+
+    static FILE* readelf(const std::string& what, const std::string& exe) {
+        std::string command = "readelf --wide --debug-dump=" + what + " \"" + exe + "\" 2>/dev/null";
+        return popen(command.c_str(), "r");
+    }
+
+    static bool getLine(FILE* in, std::string& line) {
+        line.clear();
+        char buf[4096];
+        while (std::fgets(buf, sizeof buf, in)) {
+            line += buf;
+            if (!line.empty() && line.back() == '\n') {
+                line.pop_back();
+                return true;
+            }
+        }
+        return !line.empty();
+    }
+
+    bool loadLines(const std::string& exe, std::string& error) {
+        FILE* in = readelf("decodedline", exe);
+        if (!in) return error = "cannot run readelf", false;
+        int file = -1, prevLine = -1, prevFile = -1;
+        std::string line;
+        while (getLine(in, line)) {
+            if (line.empty()) continue;
+            if (line.back() == ':' && line.compare(0, 8, "Contents") != 0) {
+                file = fileId(line.substr(0, line.size() - 1)); // "path:" heads the rows of a file
+                continue;
+            }
+            std::istringstream ss(line);
+            std::vector<std::string> tok;
+            for (std::string t; ss >> t;) tok.push_back(t);
+            if (tok.size() < 3 || tok[2].compare(0, 2, "0x") != 0 || file < 0) continue;
+            LineRow r;
+            r.addr = std::strtoull(tok[2].c_str(), nullptr, 16);
+            r.line = tok[1] == "-" ? 0 : std::atoi(tok[1].c_str());
+            r.file = file;
+            r.stmt = tok.back() == "x";
+            rows.push_back(r);
+            if (!r.line) {
+                prevLine = prevFile = -1; // end of sequence
+                continue;
+            }
+            if (r.stmt && (r.line != prevLine || r.file != prevFile)) {
+                lineStarts.push_back({r.file, r.line, r.addr});
+                lineStartAddrs.insert(r.addr);
+            }
+            prevLine = r.line;
+            prevFile = r.file;
+        }
+        pclose(in);
+        if (rows.empty()) return error = "no line table; build the program with cstarc --debug", false;
+        std::stable_sort(rows.begin(), rows.end(), [](const LineRow& a, const LineRow& b) {
+            return a.addr != b.addr ? a.addr < b.addr : a.line < b.line; // sequence ends first
+        });
+        for (size_t i = 0; i < files.size(); ++i)
+            if (isCstar((int)i)) {
+                mainFile = (int)i;
+                break;
+            }
+        return true;
+    }
+
+    // One DIE of the info dump, with the attributes used here.
+    struct Die {
+        int depth = 0;
+        uint64_t offset = 0;
+        std::string tag, name;
+        uint64_t lo = 0, hi = 0, type = 0;
+        bool hasLo = false, hiIsLength = false, hasFrameOffset = false;
+        long long frameOffset = 0;
+        int size = 0, encoding = 0;
+    };
+
+    static std::string attrValue(const std::string& line, size_t colon) {
+        return trim(line.substr(colon + 1));
+    }
+
+    static void parseAttr(Die& d, const std::string& line) {
+        size_t at = line.find("DW_AT_");
+        size_t colon = line.find(':', at);
+        if (at == std::string::npos || colon == std::string::npos) return;
+        std::string attr = trim(line.substr(at, colon - at));
+        std::string value = attrValue(line, colon);
+        if (attr == "DW_AT_name") {
+            size_t p = value.rfind("): "); // (strp) (offset: 0x..): name
+            if (p != std::string::npos && value.compare(0, 2, "(s") == 0 && value.find("(offset") != std::string::npos)
+                d.name = value.substr(p + 3);
+            else if ((p = value.find(") ")) != std::string::npos)
+                d.name = value.substr(p + 2);
+        } else if (attr == "DW_AT_type") {
+            size_t lt = value.find("<0x");
+            if (lt != std::string::npos) d.type = std::strtoull(value.c_str() + lt + 3, nullptr, 16);
+        } else if (attr == "DW_AT_low_pc") {
+            size_t x = value.find("0x");
+            if (x != std::string::npos) d.lo = std::strtoull(value.c_str() + x, nullptr, 16), d.hasLo = true;
+        } else if (attr == "DW_AT_high_pc") {
+            size_t x = value.find("0x");
+            d.hiIsLength = value.compare(0, 6, "(addr)") != 0;
+            if (x != std::string::npos) d.hi = std::strtoull(value.c_str() + x, nullptr, 16);
+            else if ((x = value.find(") ")) != std::string::npos) d.hi = std::strtoull(value.c_str() + x + 2, nullptr, 10);
+        } else if (attr == "DW_AT_location") {
+            size_t op = value.find("DW_OP_fbreg: ");
+            if (op != std::string::npos && value.find(';') == std::string::npos) {
+                d.frameOffset = std::strtoll(value.c_str() + op + 13, nullptr, 10);
+                d.hasFrameOffset = true;
+            }
+        } else if (attr == "DW_AT_byte_size" || attr == "DW_AT_encoding") {
+            size_t p = value.find(") ");
+            int v = p == std::string::npos ? 0 : (int)std::strtol(value.c_str() + p + 2, nullptr, 0);
+            (attr == "DW_AT_byte_size" ? d.size : d.encoding) = v;
+        }
+    }
+
+    static bool isTypeTag(const std::string& tag) {
+        static const char* const tags[] = {
+            "DW_TAG_base_type",        "DW_TAG_pointer_type",  "DW_TAG_reference_type",
+            "DW_TAG_rvalue_reference_type", "DW_TAG_const_type", "DW_TAG_volatile_type",
+            "DW_TAG_typedef",          "DW_TAG_enumeration_type", "DW_TAG_structure_type",
+            "DW_TAG_class_type",       "DW_TAG_union_type",    "DW_TAG_array_type",
+        };
+        for (const char* t : tags)
+            if (tag == t) return true;
+        return false;
+    }
+
+    bool hasCstarRows(uint64_t lo, uint64_t hi) const {
+        auto it = std::lower_bound(rows.begin(), rows.end(), lo,
+                                   [](const LineRow& r, uint64_t p) { return r.addr < p; });
+        for (; it != rows.end() && it->addr < hi; ++it)
+            if (it->line && isCstar(it->file)) return true;
+        return false;
+    }
+
+    bool loadInfo(const std::string& exe, std::string& error) {
+        FILE* in = readelf("info", exe);
+        if (!in) return error = "cannot run readelf", false;
+        Die die;
+        bool open = false;
+        // by depth: the cstar function a DIE's children belong to, and
+        // the address range they are in scope for
+        std::vector<int> owner(64, -1);
+        std::vector<std::pair<uint64_t, uint64_t>> scope(64);
+
+        auto commit = [&](Die& d) {
+            if (d.depth < 1 || d.depth > 62) return;
+            uint64_t hi = d.hiIsLength ? d.lo + d.hi : d.hi;
+            int fn = owner[d.depth - 1];
+            owner[d.depth] = fn;
+            scope[d.depth] = scope[d.depth - 1];
+            if (isTypeTag(d.tag)) {
+                TypeDie& t = types[d.offset];
+                t.tag = d.tag.substr(7);
+                t.name = d.name;
+                t.size = d.size;
+                t.encoding = d.encoding;
+                t.ref = d.type;
+            } else if (d.tag == "DW_TAG_subprogram") {
+                owner[d.depth] = -1; // a declaration's parameters are not locals
+                if (!d.hasLo) return;
+                Function f;
+                f.name = d.name.empty() ? "??" : d.name;
+                f.lo = d.lo;
+                f.hi = hi;
+                f.cstar = hasCstarRows(f.lo, f.hi);
+                functions.push_back(f);
+                if (f.cstar) {
+                    owner[d.depth] = (int)functions.size() - 1;
+                    scope[d.depth] = {f.lo, f.hi};
+                }
+            } else if (fn >= 0) {
+                if (d.tag == "DW_TAG_lexical_block" && d.hasLo)
+                    scope[d.depth] = {d.lo, hi};
+                else if ((d.tag == "DW_TAG_variable" || d.tag == "DW_TAG_formal_parameter") && d.hasFrameOffset &&
+                         !d.name.empty()) {
+                    Variable v;
+                    v.name = d.name;
+                    v.type = d.type;
+                    v.frameOffset = d.frameOffset;
+                    v.lo = scope[d.depth - 1].first;
+                    v.hi = scope[d.depth - 1].second;
+                    v.param = d.tag == "DW_TAG_formal_parameter";
+                    functions[fn].vars.push_back(v);
+                }
+            }
+        };
+
+        std::string line;
+        while (getLine(in, line)) {
+            size_t abbrev = line.find(": Abbrev Number: ");
+            if (abbrev != std::string::npos && line.size() > 2 && line[1] == '<') {
+                if (open) commit(die);
+                die = Die();
+                size_t close = line.find('>');
+                die.depth = std::atoi(line.c_str() + 2);
+                die.offset = std::strtoull(line.c_str() + close + 2, nullptr, 16);
+                size_t tag = line.find("(DW_TAG_", abbrev);
+                open = tag != std::string::npos;
+                if (open) die.tag = line.substr(tag + 1, line.find(')', tag) - tag - 1);
+            } else if (open && line.find("DW_AT_") != std::string::npos) {
+                parseAttr(die, line);
+            }
+        }
+        if (open) commit(die);
+        pclose(in);
+        if (functions.empty()) return error = "no debug info; build the program with cstarc --debug", false;
+        return true;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Types and values
+// ---------------------------------------------------------------------------
+
+enum class Kind { Void, Signed, Unsigned, Bool, Char, Float, Pointer, Reference, Enum, Other };
+
+struct Resolved {
+    Kind kind = Kind::Other;
+    int size = 0;
+    uint64_t pointee = 0; // for pointers and references
+    std::string name;     // of the underlying type
+};
+
+static Resolved resolveType(const DebugInfo& info, uint64_t off) {
+    Resolved r;
+    for (int hops = 0; hops < 32; ++hops) {
+        if (!off) return r.kind = Kind::Void, r.name = "void", r;
+        auto it = info.types.find(off);
+        if (it == info.types.end()) return r;
+        const TypeDie& t = it->second;
+        if (t.tag == "typedef" || t.tag == "const_type" || t.tag == "volatile_type") {
+            off = t.ref;
+            continue;
+        }
+        r.size = t.size;
+        r.name = t.name;
+        if (t.tag == "base_type") {
+            switch (t.encoding) {
+            case 2: r.kind = Kind::Bool; break;
+            case 4: r.kind = Kind::Float; break;
+            case 5: r.kind = Kind::Signed; break;
+            case 6: r.kind = Kind::Char; break;
+            case 7: case 8: case 0x10: r.kind = Kind::Unsigned; break;
+            default: r.kind = Kind::Other;
+            }
+            if (t.encoding == 8 && t.name == "char") r.kind = Kind::Char;
+        } else if (t.tag == "pointer_type" || t.tag == "reference_type" || t.tag == "rvalue_reference_type") {
+            r.kind = t.tag == "pointer_type" ? Kind::Pointer : Kind::Reference;
+            r.size = 8;
+            r.pointee = t.ref;
+        } else if (t.tag == "enumeration_type") {
+            r.kind = Kind::Enum;
+        }
+        return r;
+    }
+    return r;
+}
+
+static std::string typeName(const DebugInfo& info, uint64_t off, int depth = 0) {
+    if (!off) return "void";
+    auto it = info.types.find(off);
+    if (it == info.types.end() || depth > 16) return "?";
+    const TypeDie& t = it->second;
+    if (t.tag == "pointer_type") return typeName(info, t.ref, depth + 1) + " *";
+    if (t.tag == "reference_type") return typeName(info, t.ref, depth + 1) + " &";
+    if (t.tag == "rvalue_reference_type") return typeName(info, t.ref, depth + 1) + " &&";
+    if (t.tag == "const_type") return "const " + typeName(info, t.ref, depth + 1);
+    if (t.tag == "volatile_type") return "volatile " + typeName(info, t.ref, depth + 1);
+    return t.name.empty() ? "{" + t.tag.substr(0, t.tag.size() - 5) + "}" : t.name;
+}
+
+struct Value {
+    enum { Int, Float, Pointer } kind = Int;
+    long long i = 0;
+    double f = 0;
+    uint64_t pointee = 0; // type of what a Pointer points at
+
+    double asFloat() const { return kind == Float ? f : (double)i; }
+    bool truth() const { return kind == Float ? f != 0 : i != 0; }
+};
+
+struct EvalError {
+    std::string what;
+};
+
+// ---------------------------------------------------------------------------
+// The traced process
+// ---------------------------------------------------------------------------
+
+struct Breakpoint {
+    int id = 0;
+    int file = 0, line = 0;
+    std::vector<uint64_t> addrs; // unrelocated
+    std::string condition;       // empty: always stop
+    uint64_t hits = 0, stops = 0;
+};
+
+struct Thread {
+    bool running = false;
+    bool fresh = false;       // cloned, first stop not seen yet
+    bool swallowStop = false; // a SIGSTOP we sent is still to arrive
+    int pending = -1;         // a wait status seen while stopping it
+    int deliver = 0;          // signal to pass on when resumed
+};
+
+enum class Stop { Exited, User, TempReached };
+
+class Session {
+public:
+    explicit Session(const DebugInfo& d) : info(d) {}
+
+    const DebugInfo& info;
+    std::string exe;
+    std::vector<std::string> args;
+    pid_t pid = 0;
+    pid_t current = 0;
+    uint64_t base = 0;
+    std::map<pid_t, Thread> threads;
+    std::map<uint64_t, long> saved; // runtime address -> original word
+    std::vector<Breakpoint> breakpoints;
+    int nextId = 1;
+    int frameNo = 0;
+    bool started = false; // past the exec stop
+
+    // temporary breakpoint for next/finish: reached when tempTid is there
+    // with rsp == tempRsp
+    uint64_t tempAddr = 0, tempRsp = 0;
+    pid_t tempTid = 0;
+
+    // --- process control ---
+
+    bool launch() {
+        pid_t child = fork();
+        if (child < 0) return false;
+        if (child == 0) {
+            std::signal(SIGINT, SIG_DFL);
+            ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+            std::vector<char*> argv;
+            argv.push_back(const_cast<char*>(exe.c_str()));
+            for (auto& a : args) argv.push_back(const_cast<char*>(a.c_str()));
+            argv.push_back(nullptr);
+            execv(exe.c_str(), argv.data());
+            std::perror("execv");
+            _exit(127);
+        }
+        int status = 0;
+        if (waitpid(child, &status, 0) != child || !WIFSTOPPED(status)) return false;
+        pid = current = child;
+        threads.clear();
+        threads[pid] = Thread();
+        saved.clear();
+        started = false;
+        frameNo = 0;
+        for (auto& b : breakpoints) b.hits = b.stops = 0;
+        ptrace(PTRACE_SETOPTIONS, pid, nullptr, (void*)(long)(PTRACE_O_TRACECLONE | PTRACE_O_EXITKILL));
+        base = loadBase();
+        syncBreakpoints();
+        return true;
+    }
+
+    void kill() {
+        if (!pid) return;
+        ::kill(pid, SIGKILL);
+        int status;
+        for (;;) {
+            pid_t t = waitpid(-1, &status, __WALL);
+            if (t < 0 || (t == pid && (WIFEXITED(status) || WIFSIGNALED(status)))) break;
+        }
+        pid = 0;
+        threads.clear();
+        saved.clear();
+    }
+
+    uint64_t loadBase() {
+        // PIE executables are mapped at a random base; ET_EXEC at 0
+        unsigned char ehdr[18] = {};
+        std::ifstream f(exe, std::ios::binary);
+        f.read((char*)ehdr, sizeof ehdr);
+        if (ehdr[16] != 3) return 0; // e_type != ET_DYN
+        char real[PATH_MAX];
+        std::string path = realpath(exe.c_str(), real) ? real : exe;
+        std::ifstream maps("/proc/" + std::to_string(pid) + "/maps");
+        for (std::string line; std::getline(maps, line);) {
+            size_t slash = line.find('/');
+            if (slash == std::string::npos || line.substr(slash) != path) continue;
+            std::istringstream ss(line);
+            std::string range, perms, offset;
+            ss >> range >> perms >> offset;
+            uint64_t start = std::strtoull(range.c_str(), nullptr, 16);
+            return start - std::strtoull(offset.c_str(), nullptr, 16);
+        }
+        return 0;
+    }
+
+    pid_t anyStopped() const {
+        if (threads.count(current) && !threads.at(current).running) return current;
+        for (auto& [tid, t] : threads)
+            if (!t.running) return tid;
+        return pid;
+    }
+
+    bool readMem(uint64_t addr, void* out, size_t n) {
+        unsigned char* p = (unsigned char*)out;
+        pid_t tid = anyStopped();
+        for (size_t done = 0; done < n;) {
+            uint64_t word = (addr + done) & ~7ull;
+            size_t skip = (addr + done) - word;
+            errno = 0;
+            long v = ptrace(PTRACE_PEEKDATA, tid, (void*)word, nullptr);
+            if (errno) return false;
+            size_t take = std::min(n - done, 8 - skip);
+            std::memcpy(p + done, (unsigned char*)&v + skip, take);
+            done += take;
+        }
+        return true;
+    }
+
+    user_regs_struct regs(pid_t tid) {
+        user_regs_struct r{};
+        ptrace(PTRACE_GETREGS, tid, nullptr, &r);
+        return r;
+    }
+
+    void setPc(pid_t tid, uint64_t pc) {
+        user_regs_struct r = regs(tid);
+        r.rip = pc;
+        ptrace(PTRACE_SETREGS, tid, nullptr, &r);
+    }
+
+    // --- breakpoints ---
+
+    bool insert(uint64_t addr) {
+        if (saved.count(addr)) return true;
+        pid_t tid = anyStopped();
+        errno = 0;
+        long word = ptrace(PTRACE_PEEKTEXT, tid, (void*)addr, nullptr);
+        if (errno) return false;
+        if (ptrace(PTRACE_POKETEXT, tid, (void*)addr, (void*)((word & ~0xffL) | 0xcc)) != 0) return false;
+        saved[addr] = word;
+        return true;
+    }
+
+    void remove(uint64_t addr) {
+        auto it = saved.find(addr);
+        if (it == saved.end()) return;
+        pid_t tid = anyStopped();
+        errno = 0;
+        long word = ptrace(PTRACE_PEEKTEXT, tid, (void*)addr, nullptr);
+        if (!errno) ptrace(PTRACE_POKETEXT, tid, (void*)addr, (void*)((word & ~0xffL) | (it->second & 0xff)));
+        saved.erase(it);
+    }
+
+    // Makes the int3s in memory match the breakpoint list (and the
+    // temporary breakpoint). Needs every thread stopped.
+    void syncBreakpoints() {
+        if (!pid) return;
+        std::set<uint64_t> want;
+        for (auto& b : breakpoints)
+            for (uint64_t a : b.addrs) want.insert(base + a);
+        if (tempAddr) want.insert(tempAddr);
+        std::vector<uint64_t> stale;
+        for (auto& [addr, word] : saved)
+            if (!want.count(addr)) stale.push_back(addr);
+        for (uint64_t a : stale) remove(a);
+        for (uint64_t a : want) insert(a);
+    }
+
+    // --- threads ---
+
+    void resume(pid_t tid, bool step = false) {
+        Thread& t = threads[tid];
+        ptrace(step ? PTRACE_SINGLESTEP : PTRACE_CONT, tid, nullptr, (void*)(long)t.deliver);
+        t.deliver = 0;
+        t.running = true;
+    }
+
+    void resumeAll() {
+        for (auto& [tid, t] : threads)
+            if (!t.running && t.pending == -1) resume(tid);
+    }
+
+    // True if the stop is an int3 of ours that tid has just executed, in
+    // which case its pc is moved back onto the int3 and the stop dropped.
+    // Resumed, the thread traps there again if the breakpoint is still
+    // set, or runs the original instruction if it was deleted meanwhile.
+    bool cancelBreakpointHit(pid_t tid, int status) {
+        if (WSTOPSIG(status) != SIGTRAP || (status >> 16) != 0) return false;
+        siginfo_t si{};
+        if (ptrace(PTRACE_GETSIGINFO, tid, nullptr, &si) != 0 || si.si_code != SI_KERNEL) return false;
+        uint64_t pc = regs(tid).rip - 1;
+        if (!saved.count(pc)) return false;
+        setPc(tid, pc);
+        return true;
+    }
+
+    // All-stop: stops every running thread but except. An event a thread
+    // reports instead of our SIGSTOP is kept and handled next, except a
+    // breakpoint hit, which is undone (cancelBreakpointHit) so that it is
+    // not reported after the breakpoint has been deleted.
+    void stopAll(pid_t except) {
+        std::vector<pid_t> gone;
+        for (auto& [tid, t] : threads) {
+            if (tid == except || !t.running) continue;
+            if (!t.fresh) syscall(SYS_tgkill, pid, tid, SIGSTOP);
+            int status;
+            if (waitpid(tid, &status, __WALL) != tid || WIFEXITED(status) || WIFSIGNALED(status)) {
+                gone.push_back(tid);
+                continue;
+            }
+            t.running = false;
+            if (t.fresh) {
+                t.fresh = false; // its first stop; no SIGSTOP was sent
+            } else if (!(WSTOPSIG(status) == SIGSTOP && (status >> 16) == 0)) {
+                if (!cancelBreakpointHit(tid, status)) t.pending = status;
+                t.swallowStop = true;
+            }
+        }
+        for (pid_t tid : gone)
+            if (tid != pid) threads.erase(tid);
+    }
+
+    // Single-steps tid, over the int3 at its pc if there is one. Other
+    // threads must be stopped. False if the process went away.
+    bool stepInstruction(pid_t tid) {
+        uint64_t pc = regs(tid).rip;
+        bool lifted = saved.count(pc);
+        long word = lifted ? saved[pc] : 0;
+        if (lifted) ptrace(PTRACE_POKETEXT, tid, (void*)pc, (void*)word);
+        for (;;) {
+            resume(tid, true);
+            int status;
+            if (waitpid(tid, &status, __WALL) != tid || WIFEXITED(status) || WIFSIGNALED(status)) {
+                if (tid == pid) return exited(status), false;
+                threads.erase(tid);
+                return false;
+            }
+            Thread& t = threads[tid];
+            t.running = false;
+            int sig = WSTOPSIG(status);
+            if (sig == SIGTRAP && (status >> 16) == 0) break;
+            if (sig == SIGSTOP && t.swallowStop) {
+                t.swallowStop = false;
+                continue;
+            }
+            if ((status >> 16) == PTRACE_EVENT_CLONE) {
+                addClone(tid);
+                continue; // the clone stop comes before the step
+            }
+            t.deliver = sig; // delivered with the next resume
+            break;
+        }
+        if (lifted) {
+            errno = 0;
+            long now = ptrace(PTRACE_PEEKTEXT, tid, (void*)pc, nullptr);
+            if (!errno) ptrace(PTRACE_POKETEXT, tid, (void*)pc, (void*)((now & ~0xffL) | 0xcc));
+        }
+        return true;
+    }
+
+    void addClone(pid_t parent) {
+        unsigned long child = 0;
+        ptrace(PTRACE_GETEVENTMSG, parent, nullptr, &child);
+        if (!threads.count((pid_t)child)) {
+            Thread& t = threads[(pid_t)child];
+            t.running = true;
+            t.fresh = true;
+        }
+    }
+
+    void exited(int status) {
+        if (WIFEXITED(status))
+            std::cout << "\033[1;34m[program exited with code " << WEXITSTATUS(status) << "]\033[0m" << std::endl;
+        else
+            std::cout << "\033[1;31m[program killed by " << strsignal(WTERMSIG(status)) << "]\033[0m" << std::endl;
+        // remaining threads are gone with the leader
+        for (;;) {
+            int st;
+            if (waitpid(-1, &st, __WALL | WNOHANG) <= 0) break;
+        }
+        pid = 0;
+        threads.clear();
+        saved.clear();
+        tempAddr = 0;
+    }
+
+    // Resumes every thread and blocks until something needs the user.
+    Stop run() {
+        pid_t tid = current;
+        if (threads.count(tid) && !threads[tid].running && saved.count(regs(tid).rip)) {
+            if (!stepInstruction(tid)) return pid ? Stop::User : Stop::Exited;
+        }
+        started = true;
+        resumeAll();
+        return waitEvents();
+    }
+
+    Stop waitEvents() {
+        for (;;) {
+            pid_t tid = -1;
+            int status = 0;
+            for (auto& [t, th] : threads)
+                if (th.pending != -1) {
+                    tid = t;
+                    status = th.pending;
+                    th.pending = -1;
+                    break;
+                }
+            if (tid == -1) {
+                tid = waitpid(-1, &status, __WALL); // blocks until the next event
+                if (tid < 0) {
+                    if (errno == EINTR) continue;
+                    pid = 0;
+                    threads.clear();
+                    return Stop::Exited;
+                }
+            }
+            if (WIFEXITED(status) || WIFSIGNALED(status)) {
+                if (tid == pid) {
+                    exited(status);
+                    return Stop::Exited;
+                }
+                threads.erase(tid);
+                continue;
+            }
+            if (!WIFSTOPPED(status)) continue;
+            bool known = threads.count(tid);
+            Thread& t = threads[tid];
+            t.running = false;
+            int sig = WSTOPSIG(status);
+            int event = status >> 16;
+
+            if (event == PTRACE_EVENT_CLONE) {
+                addClone(tid);
+                resume(tid);
+                continue;
+            }
+            if (sig == SIGSTOP && event == 0 && (!known || t.fresh || t.swallowStop)) {
+                t.fresh = false;
+                t.swallowStop = false;
+                resume(tid);
+                continue;
+            }
+            if (sig == SIGTRAP && event == 0) {
+                uint64_t pc = regs(tid).rip - 1;
+                if (saved.count(pc)) {
+                    setPc(tid, pc);
+                    current = tid;
+                    Stop s = hitBreakpoint(tid, pc);
+                    if (s != Stop::Exited && pid && threads.count(tid) && threads[tid].running) continue;
+                    return s;
+                }
+            }
+            if (passSignal(sig)) {
+                t.deliver = sig;
+                resume(tid);
+                continue;
+            }
+            // any other signal stops the program for the user; SIGINT is
+            // the user's Ctrl+C and is not passed on
+            t.deliver = sig == SIGINT ? 0 : sig;
+            stopAll(tid);
+            current = tid;
+            frameNo = 0;
+            std::cout << "\n\033[1;33mProgram received signal " << sigabbrev(sig) << "\033[0m, " << strsignal(sig) << "."
+                      << std::endl;
+            showFrame(0, true);
+            return Stop::User;
+        }
+    }
+
+    static bool passSignal(int sig) {
+        return sig == SIGCHLD || sig == SIGWINCH || sig == SIGPROF || sig == SIGALRM || sig == SIGURG ||
+               sig == SIGVTALRM || sig == SIGIO || sig >= SIGRTMIN;
+    }
+
+    static std::string sigabbrev(int sig) {
+        const char* name = sigabbrev_np(sig);
+        return name ? std::string("SIG") + name : std::to_string(sig);
+    }
+
+    // tid sits on an int3 at pc (already rewound). Either stops for the
+    // user, or steps tid over it and leaves it running.
+    Stop hitBreakpoint(pid_t tid, uint64_t pc) {
+        user_regs_struct r = regs(tid);
+        if (pc == tempAddr && tid == tempTid && r.rsp == tempRsp) {
+            stopAll(tid);
+            return Stop::TempReached;
+        }
+        Breakpoint* stopAt = nullptr;
+        std::string error;
+        for (auto& b : breakpoints) {
+            if (std::find(b.addrs.begin(), b.addrs.end(), pc - base) == b.addrs.end()) continue;
+            ++b.hits;
+            bool stop = true;
+            if (!b.condition.empty()) {
+                try {
+                    stop = evaluate(b.condition, tid, r.rbp + 16, pc, &b).truth();
+                } catch (const EvalError& e) {
+                    error = "Error in condition of breakpoint " + std::to_string(b.id) + ": " + e.what;
+                }
+            }
+            if (stop && !stopAt) stopAt = &b;
+        }
+        if (stopAt || !error.empty()) {
+            stopAll(tid);
+            frameNo = 0;
+            if (stopAt) {
+                ++stopAt->stops;
+                std::cout << "\n\033[1;32mBreakpoint " << stopAt->id << "\033[0m, ";
+            } else {
+                std::cout << "\n\033[1;31m" << error << "\033[0m\n";
+            }
+            showFrame(0, true);
+            return Stop::User;
+        }
+        // condition false: over the int3 and on, without the user
+        if (threads.size() > 1) stopAll(tid);
+        if (!stepInstruction(tid)) return pid ? Stop::User : Stop::Exited;
+        resumeAll();
+        return Stop::User;
+    }
+
+    // --- frames ---
+
+    struct Frame {
+        uint64_t pc, cfa; // runtime
+    };
+
+    std::vector<Frame> frames() {
+        std::vector<Frame> out;
+        if (!pid || !threads.count(current)) return out;
+        user_regs_struct r = regs(current);
+        uint64_t pc = r.rip, rbp = r.rbp;
+        for (int depth = 0; depth < 256; ++depth) {
+            out.push_back({pc, rbp + 16});
+            const Function* f = info.functionAt(pc - base);
+            if (!f || f->name == "main" || !rbp) break;
+            uint64_t next[2];
+            if (!readMem(rbp, next, sizeof next) || next[0] <= rbp) break;
+            rbp = next[0];
+            pc = next[1] - 1; // inside the call, for the line
+        }
+        return out;
+    }
+
+    std::string location(uint64_t pc) {
+        const LineRow* row = info.rowAt(pc - base);
+        if (!row) return "??";
+        return baseName(info.files[row->file]) + ":" + std::to_string(row->line);
+    }
+
+    void showFrame(size_t n, bool withSource) {
+        std::vector<Frame> fs = frames();
+        if (n >= fs.size()) return;
+        const Frame& fr = fs[n];
+        uint64_t pc = fr.pc;
+        const Function* f = info.functionAt(pc - base);
+        std::cout << (f ? f->name : "??") << " (";
+        if (f) {
+            bool first = true;
+            for (const auto& v : f->vars)
+                if (v.param) {
+                    std::cout << (first ? "" : ", ") << v.name << "=" << formatVariable(v, fr.cfa, true);
+                    first = false;
+                }
+        }
+        std::cout << ") at " << location(pc) << std::endl;
+        if (withSource) {
+            const LineRow* row = info.rowAt(pc - base);
+            if (row) printSource(row->file, row->line, row->line);
+        }
+    }
+
+    void printSource(int file, int from, int to) {
+        std::ifstream src(info.files[file]);
+        if (!src) return;
+        std::string text;
+        for (int l = 1; std::getline(src, text); ++l) {
+            if (l > to) break;
+            if (l >= from) std::cout << l << "\t" << text << "\n";
+        }
+        std::cout.flush();
+    }
+
+    // --- values ---
+
+    const Variable* lookup(const std::string& name, uint64_t pc) {
+        const Function* f = info.functionAt(pc - base);
+        if (!f) return nullptr;
+        const Variable* best = nullptr;
+        uint64_t rel = pc - base;
+        for (const auto& v : f->vars)
+            if (v.name == name && rel >= v.lo && rel < v.hi && (!best || v.hi - v.lo < best->hi - best->lo)) best = &v;
+        return best;
+    }
+
+    Value readValue(uint64_t addr, uint64_t type) {
+        Resolved t = resolveType(info, type);
+        if (t.kind == Kind::Reference) {
+            uint64_t target = 0;
+            if (!readMem(addr, &target, 8)) throw EvalError{"cannot read memory"};
+            return readValue(target, t.pointee);
+        }
+        Value v;
+        unsigned char raw[8] = {};
+        int size = t.size;
+        if (t.kind == Kind::Other || t.kind == Kind::Void || size <= 0 || size > 8)
+            throw EvalError{"cannot use a value of type " + typeName(info, type) + " here"};
+        if (!readMem(addr, raw, (size_t)size)) throw EvalError{"cannot read memory at " + hex(addr)};
+        uint64_t bits = 0;
+        std::memcpy(&bits, raw, (size_t)size);
+        switch (t.kind) {
+        case Kind::Float:
+            v.kind = Value::Float;
+            if (size == 4) {
+                float x;
+                std::memcpy(&x, raw, 4);
+                v.f = x;
+            } else {
+                std::memcpy(&v.f, raw, 8);
+            }
+            break;
+        case Kind::Pointer:
+            v.kind = Value::Pointer;
+            v.i = (long long)bits;
+            v.pointee = t.pointee;
+            break;
+        case Kind::Signed: case Kind::Char: case Kind::Enum:
+            v.i = size == 8 ? (long long)bits : (long long)(bits << (64 - 8 * size)) >> (64 - 8 * size);
+            break;
+        default:
+            v.i = (long long)bits;
+        }
+        return v;
+    }
+
+    static std::string hex(uint64_t v) {
+        char buf[32];
+        std::snprintf(buf, sizeof buf, "0x%llx", (unsigned long long)v);
+        return buf;
+    }
+
+    std::string readCString(uint64_t addr, size_t max = 64) {
+        std::string s;
+        char c;
+        while (s.size() < max && readMem(addr + s.size(), &c, 1) && c) s += c;
+        return s;
+    }
+
+    std::string formatValue(uint64_t addr, uint64_t type) {
+        Resolved t = resolveType(info, type);
+        if (t.kind == Kind::Reference) {
+            uint64_t target = 0;
+            if (!readMem(addr, &target, 8)) return "<unreadable>";
+            return formatValue(target, t.pointee);
+        }
+        if (t.kind == Kind::Other) {
+            // std::string: pointer to the characters, then the length
+            if (t.name.compare(0, 18, "basic_string<char,") == 0) {
+                uint64_t hdr[2];
+                if (readMem(addr, hdr, sizeof hdr) && hdr[1] < (1u << 20)) {
+                    std::string s(std::min<uint64_t>(hdr[1], 200), '\0');
+                    if (readMem(hdr[0], &s[0], s.size())) return "\"" + s + (hdr[1] > 200 ? "\"..." : "\"");
+                }
+            }
+            return "{" + typeName(info, type) + ", " + std::to_string(t.size) + " bytes at " + hex(addr) + "}";
+        }
+        Value v;
+        try {
+            v = readValue(addr, type);
+        } catch (const EvalError& e) {
+            return "<" + e.what + ">";
+        }
+        std::ostringstream out;
+        out.precision(15);
+        switch (t.kind) {
+        case Kind::Bool: out << (v.i ? "true" : "false"); break;
+        case Kind::Char:
+            out << v.i;
+            if (v.i >= 32 && v.i < 127) out << " '" << (char)v.i << "'";
+            break;
+        case Kind::Float: out << v.f; break;
+        case Kind::Pointer: {
+            out << hex((uint64_t)v.i);
+            Resolved p = resolveType(info, t.pointee);
+            if (p.kind == Kind::Char && v.i) out << " \"" << readCString((uint64_t)v.i) << "\"";
+            break;
+        }
+        case Kind::Unsigned: out << (unsigned long long)v.i; break;
+        default: out << v.i;
+        }
+        return out.str();
+    }
+
+    std::string formatVariable(const Variable& v, uint64_t cfa, bool brief = false) {
+        std::string s = formatValue(cfa + v.frameOffset, v.type);
+        if (brief && s.size() > 40) s = s.substr(0, 37) + "...";
+        return s;
+    }
+
+    // --- expressions: C operators over locals, numbers and $hits ---
+
+    struct Parser {
+        Session& s;
+        const std::string& text;
+        size_t at = 0;
+        pid_t tid;
+        uint64_t cfa, pc;
+        const Breakpoint* bp;
+        bool dry = false; // syntax only: no process, names read as 0
+
+        void skip() {
+            while (at < text.size() && std::isspace((unsigned char)text[at])) ++at;
+        }
+        bool eat(const char* op) {
+            skip();
+            size_t n = std::strlen(op);
+            if (text.compare(at, n, op) != 0) return false;
+            if (n == 1 && at + 1 < text.size()) {
+                // keep "<" from eating "<=", "!" from "!=", "&" from "&&"
+                char next = text[at + 1];
+                if (std::strchr("<>=!", op[0]) && next == '=') return false;
+                if (std::strchr("&|", op[0]) && next == op[0]) return false;
+            }
+            at += n;
+            return true;
+        }
+
+        Value parse() {
+            Value v = orExpr();
+            skip();
+            if (at != text.size()) throw EvalError{"unexpected '" + text.substr(at) + "'"};
+            return v;
+        }
+
+        static Value boolean(bool b) {
+            Value v;
+            v.i = b;
+            return v;
+        }
+
+        // The right side of || and && is only parsed, like C, when the
+        // left side decides the result.
+        template <typename F> Value shortCircuit(bool decided, F side) {
+            bool was = dry;
+            dry = dry || decided;
+            Value v = side();
+            dry = was;
+            return v;
+        }
+
+        Value orExpr() {
+            Value v = andExpr();
+            while (eat("||")) {
+                bool known = v.truth();
+                Value r = shortCircuit(known, [&] { return andExpr(); });
+                v = boolean(known || r.truth());
+            }
+            return v;
+        }
+        Value andExpr() {
+            Value v = compare();
+            while (eat("&&")) {
+                bool known = !v.truth();
+                Value r = shortCircuit(known, [&] { return compare(); });
+                v = boolean(!known && r.truth());
+            }
+            return v;
+        }
+        Value compare() {
+            Value v = additive();
+            for (;;) {
+                const char* ops[] = {"==", "!=", "<=", ">=", "<", ">"};
+                int op = -1;
+                for (int i = 0; i < 6 && op < 0; ++i)
+                    if (eat(ops[i])) op = i;
+                if (op < 0) return v;
+                Value r = additive();
+                bool f = v.kind == Value::Float || r.kind == Value::Float;
+                double a = v.asFloat(), b = r.asFloat();
+                long long x = v.i, y = r.i;
+                bool res = false;
+                switch (op) {
+                case 0: res = f ? a == b : x == y; break;
+                case 1: res = f ? a != b : x != y; break;
+                case 2: res = f ? a <= b : x <= y; break;
+                case 3: res = f ? a >= b : x >= y; break;
+                case 4: res = f ? a < b : x < y; break;
+                case 5: res = f ? a > b : x > y; break;
+                }
+                v = boolean(res);
+            }
+        }
+        Value arith(const Value& a, const Value& b, char op) {
+            Value v;
+            if (a.kind == Value::Pointer && (op == '+' || op == '-') && b.kind == Value::Int) {
+                v = a;
+                v.i += (op == '+' ? 1 : -1) * b.i * std::max(1, resolveType(s.info, a.pointee).size);
+                return v;
+            }
+            if (a.kind == Value::Float || b.kind == Value::Float) {
+                v.kind = Value::Float;
+                double x = a.asFloat(), y = b.asFloat();
+                if (op == '%') throw EvalError{"% needs integers"};
+                v.f = op == '+' ? x + y : op == '-' ? x - y : op == '*' ? x * y : x / y;
+                return v;
+            }
+            if ((op == '/' || op == '%') && b.i == 0) {
+                if (dry) return v;
+                throw EvalError{"division by zero"};
+            }
+            v.i = op == '+' ? a.i + b.i : op == '-' ? a.i - b.i : op == '*' ? a.i * b.i : op == '/' ? a.i / b.i : a.i % b.i;
+            return v;
+        }
+        Value additive() {
+            Value v = multiplicative();
+            for (;;) {
+                if (eat("+")) v = arith(v, multiplicative(), '+');
+                else if (eat("-")) v = arith(v, multiplicative(), '-');
+                else return v;
+            }
+        }
+        Value multiplicative() {
+            Value v = unary();
+            for (;;) {
+                if (eat("*")) v = arith(v, unary(), '*');
+                else if (eat("/")) v = arith(v, unary(), '/');
+                else if (eat("%")) v = arith(v, unary(), '%');
+                else return v;
+            }
+        }
+        Value deref(const Value& p) {
+            if (dry) return Value();
+            if (p.kind != Value::Pointer) throw EvalError{"not a pointer"};
+            return s.readValue((uint64_t)p.i, p.pointee);
+        }
+        Value unary() {
+            if (eat("-")) {
+                Value v = unary();
+                if (v.kind == Value::Float) v.f = -v.f;
+                else v.i = -v.i;
+                return v;
+            }
+            if (eat("!")) return boolean(!unary().truth());
+            if (eat("*")) return deref(unary());
+            return postfix();
+        }
+        Value postfix() {
+            Value v = primary();
+            while (eat("[")) {
+                Value index = orExpr();
+                if (!eat("]")) throw EvalError{"missing ]"};
+                v = deref(arith(v, index, '+'));
+            }
+            return v;
+        }
+        Value primary() {
+            skip();
+            if (eat("(")) {
+                Value v = orExpr();
+                if (!eat(")")) throw EvalError{"missing )"};
+                return v;
+            }
+            if (at < text.size() && text[at] == '\'' && at + 2 < text.size() && text[at + 2] == '\'') {
+                Value v;
+                v.i = (unsigned char)text[at + 1];
+                at += 3;
+                return v;
+            }
+            if (at < text.size() && (std::isdigit((unsigned char)text[at]) || text[at] == '.')) {
+                const char* start = text.c_str() + at;
+                char* end;
+                Value v;
+                long long i = std::strtoll(start, &end, 0);
+                if (*end == '.' || *end == 'e' || *end == 'E') {
+                    v.kind = Value::Float;
+                    v.f = std::strtod(start, &end);
+                } else {
+                    v.i = i;
+                }
+                at += end - start;
+                return v;
+            }
+            size_t begin = at;
+            while (at < text.size() && (std::isalnum((unsigned char)text[at]) || text[at] == '_' || text[at] == '$')) ++at;
+            std::string name = text.substr(begin, at - begin);
+            if (name.empty()) throw EvalError{at < text.size() ? "unexpected '" + text.substr(at, 1) + "'" : "missing operand"};
+            if (dry) return Value();
+            if (name == "$hits") {
+                if (!bp) throw EvalError{"$hits is only known in a breakpoint condition"};
+                Value v;
+                v.i = (long long)bp->hits;
+                return v;
+            }
+            if (name == "true" || name == "false") return boolean(name == "true");
+            const Variable* var = s.lookup(name, pc);
+            if (!var) throw EvalError{"no variable '" + name + "' here"};
+            return s.readValue(cfa + var->frameOffset, var->type);
+        }
+    };
+
+    Value evaluate(const std::string& text, pid_t tid, uint64_t cfa, uint64_t pc, const Breakpoint* bp = nullptr) {
+        Parser p{*this, text, 0, tid, cfa, pc, bp};
+        return p.parse();
+    }
+
+    // Parses a condition without a process, for its syntax; names are
+    // looked up when the breakpoint is hit.
+    std::string checkCondition(const std::string& text) {
+        if (text.empty()) return "";
+        Parser p{*this, text, 0, 0, 0, 0, nullptr};
+        p.dry = true;
+        try {
+            p.parse();
+        } catch (const EvalError& e) {
+            return e.what;
+        }
+        return "";
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Commands
+// ---------------------------------------------------------------------------
+
+static void help() {
+    std::cout << "  run, r                 start the program, or restart it\n"
+                 "  break, b LINE|FN [if COND]   breakpoint at a .cstar line or function\n"
+                 "  condition N [COND]     set or clear breakpoint N's condition\n"
+                 "  delete, d [N]          delete breakpoint N, or all\n"
+                 "  info breakpoints|locals\n"
+                 "  continue, c            resume until the next stop\n"
+                 "  step, s / next, n      one .cstar line, into / over calls\n"
+                 "  finish                 run until the current function returns\n"
+                 "  print, p EXPR          value of a local or expression\n"
+                 "  backtrace, bt          call stack; frame, f N selects a frame\n"
+                 "  list, l [LINE]         source around the current or given line\n"
+                 "  kill, quit, q\n"
+                 "Conditions use C operators over locals and numbers, and $hits (the\n"
+                 "breakpoint's hit count). They are evaluated in the debugger, so a\n"
+                 "false condition costs no stop: `break 12 if i % 1000 == 0`.\n";
+}
+
+static std::string findCompiler(const char* self) {
+    char path[PATH_MAX];
+    ssize_t n = readlink("/proc/self/exe", path, sizeof path - 1);
+    if (n > 0) {
+        path[n] = 0;
+        std::string dir = path;
+        dir = dir.substr(0, dir.find_last_of('/') + 1);
+        if (access((dir + "cstarc").c_str(), X_OK) == 0) return dir + "cstarc";
+    }
+    (void)self;
+    return "cstarc";
+}
+
+class Debugger {
+public:
+    Debugger(Session& s) : s(s), info(s.info) {}
+
+    Session& s;
+    const DebugInfo& info;
+
+    bool parseLocation(const std::string& spec, int& file, int& line, std::vector<uint64_t>& addrs) {
+        std::string where = spec;
+        file = info.mainFile;
+        size_t colon = where.rfind(':');
+        if (colon != std::string::npos) {
+            file = info.fileNamed(where.substr(0, colon));
+            where = where.substr(colon + 1);
+            if (file < 0) {
+                std::cout << "No source file named " << spec.substr(0, colon) << ".\n";
+                return false;
+            }
+        }
+        if (!where.empty() && std::all_of(where.begin(), where.end(), ::isdigit)) {
+            line = std::atoi(where.c_str());
+            if (file < 0) {
+                std::cout << "The program has no .cstar line information.\n";
+                return false;
+            }
+            addrs = info.addressesFor(file, line);
+            if (addrs.empty()) {
+                std::cout << "No code at or after line " << where << ".\n";
+                return false;
+            }
+            return true;
+        }
+        const Function* f = info.functionNamed(where);
+        if (!f) {
+            std::cout << "No function or line \"" << where << "\".\n";
+            return false;
+        }
+        uint64_t a = info.afterPrologue(*f);
+        const LineRow* row = info.rowAt(a);
+        file = row ? row->file : -1;
+        line = row ? row->line : 0;
+        addrs = {a};
+        return true;
+    }
+
+    void breakCommand(const std::string& argsText) {
+        std::string rest = trim(argsText);
+        std::string condition;
+        size_t cond = rest.find(" if ");
+        if (cond != std::string::npos) {
+            condition = trim(rest.substr(cond + 4));
+            rest = trim(rest.substr(0, cond));
+        }
+        if (rest.empty() && s.pid && s.started) {
+            const LineRow* row = info.rowAt(s.regs(s.current).rip - s.base);
+            if (row) rest = baseName(info.files[row->file]) + ":" + std::to_string(row->line);
+        }
+        Breakpoint b;
+        if (!parseLocation(rest, b.file, b.line, b.addrs)) return;
+        std::string bad = s.checkCondition(condition);
+        if (!bad.empty()) {
+            std::cout << "Bad condition: " << bad << ".\n";
+            return;
+        }
+        b.condition = condition;
+        b.id = s.nextId++;
+        s.breakpoints.push_back(b);
+        std::cout << "Breakpoint " << b.id << " at " << (b.file >= 0 ? baseName(info.files[b.file]) : "??") << ":"
+                  << b.line;
+        if (!condition.empty()) std::cout << " if " << condition;
+        std::cout << std::endl;
+        if (s.pid) s.syncBreakpoints();
+    }
+
+    void infoBreakpoints() {
+        if (s.breakpoints.empty()) {
+            std::cout << "No breakpoints.\n";
+            return;
+        }
+        std::cout << "Num  Where              Hits    Stops  Condition\n";
+        for (const auto& b : s.breakpoints) {
+            std::string where = (b.file >= 0 ? baseName(info.files[b.file]) : "??") + ":" + std::to_string(b.line);
+            std::printf("%-4d %-16s %6llu %8llu  %s\n", b.id, where.c_str(), (unsigned long long)b.hits,
+                        (unsigned long long)b.stops, b.condition.c_str());
+        }
+        std::fflush(stdout);
+    }
+
+    bool needProcess() {
+        if (s.pid && s.started) return true;
+        std::cout << "The program is not running.\n";
+        return false;
+    }
+
+    Session::Frame selected(std::vector<Session::Frame>& fs) {
+        fs = s.frames();
+        if (fs.empty()) return {0, 0};
+        if ((size_t)s.frameNo >= fs.size()) s.frameNo = 0;
+        return fs[(size_t)s.frameNo];
+    }
+
+    void infoLocals() {
+        if (!needProcess()) return;
+        std::vector<Session::Frame> fs;
+        Session::Frame fr = selected(fs);
+        const Function* f = info.functionAt(fr.pc - s.base);
+        if (!f || f->vars.empty()) {
+            std::cout << "No locals.\n";
+            return;
+        }
+        uint64_t rel = fr.pc - s.base;
+        for (const auto& v : f->vars)
+            if (rel >= v.lo && rel < v.hi && s.lookup(v.name, fr.pc) == &v)
+                std::cout << v.name << " = " << s.formatVariable(v, fr.cfa) << "\n";
+        std::cout.flush();
+    }
+
+    void print(const std::string& expr) {
+        if (!needProcess()) return;
+        std::vector<Session::Frame> fs;
+        Session::Frame fr = selected(fs);
+        std::string e = trim(expr);
+        const Variable* v = s.lookup(e, fr.pc);
+        if (v) {
+            std::cout << e << " = " << s.formatVariable(*v, fr.cfa) << std::endl;
+            return;
+        }
+        try {
+            Value val = s.evaluate(e, s.current, fr.cfa, fr.pc);
+            std::cout << e << " = ";
+            if (val.kind == Value::Float) std::cout << val.f;
+            else if (val.kind == Value::Pointer) std::cout << Session::hex((uint64_t)val.i);
+            else std::cout << val.i;
+            std::cout << std::endl;
+        } catch (const EvalError& err) {
+            std::cout << err.what << "." << std::endl;
+        }
+    }
+
+    void backtrace() {
+        if (!needProcess()) return;
+        std::vector<Session::Frame> fs = s.frames();
+        for (size_t i = 0; i < fs.size(); ++i) {
+            std::cout << (i == (size_t)s.frameNo ? "* " : "  ") << "#" << i << "  ";
+            s.showFrame(i, false);
+        }
+    }
+
+    void list(const std::string& arg) {
+        int file = info.mainFile, line = 1;
+        if (!trim(arg).empty()) {
+            line = std::atoi(arg.c_str());
+        } else if (s.pid && s.started) {
+            std::vector<Session::Frame> fs;
+            const LineRow* row = info.rowAt(selected(fs).pc - s.base);
+            if (row) file = row->file, line = row->line;
+        }
+        if (file < 0) return;
+        s.printSource(file, std::max(1, line - 5), line + 5);
+    }
+
+    // One .cstar line. Calls into code without .cstar lines (the runtime,
+    // libraries) are run at full speed to their return, as are calls
+    // into CStar functions for next.
+    Stop step(bool over) {
+        pid_t tid = s.current;
+        user_regs_struct r = s.regs(tid);
+        const LineRow* startRow = info.rowAt(r.rip - s.base);
+        int startLine = startRow ? startRow->line : -1;
+        uint64_t startRsp = r.rsp;
+        for (;;) {
+            uint64_t prevPc = r.rip, prevRsp = r.rsp;
+            if (!s.stepInstruction(tid)) return s.pid ? Stop::User : Stop::Exited;
+            if (s.threads[tid].deliver) return s.run(); // a signal: let it be handled
+            r = s.regs(tid);
+            uint64_t rel = r.rip - s.base;
+            const Function* f = info.functionAt(rel);
+            uint64_t retAddr = 0;
+            bool called = r.rsp == prevRsp - 8 && s.readMem(r.rsp, &retAddr, 8) && retAddr > prevPc && retAddr <= prevPc + 16;
+            if (called && (over || !f || !f->cstar)) {
+                Stop st = runTo(tid, retAddr, prevRsp);
+                if (st != Stop::TempReached) return st;
+                r = s.regs(tid);
+                continue;
+            }
+            if (called) {
+                // into a CStar function: on to the end of its prologue
+                uint64_t body = s.base + info.afterPrologue(*f);
+                while (r.rip != body) {
+                    if (!s.stepInstruction(tid)) return s.pid ? Stop::User : Stop::Exited;
+                    r = s.regs(tid);
+                }
+                break;
+            }
+            if (!f || !f->cstar) return s.run(); // returned out of CStar code
+            if (!info.lineStartAddrs.count(rel)) continue;
+            const LineRow* row = info.rowAt(rel);
+            if (!row || !info.isCstar(row->file)) continue;
+            if (row->line != startLine || r.rsp != startRsp || r.rip < prevPc) break;
+        }
+        s.frameNo = 0;
+        s.showFrame(0, true);
+        return Stop::User;
+    }
+
+    // Runs every thread until tid reaches addr with rsp == rsp.
+    Stop runTo(pid_t tid, uint64_t addr, uint64_t rsp) {
+        s.tempAddr = addr;
+        s.tempTid = tid;
+        s.tempRsp = rsp;
+        s.syncBreakpoints();
+        Stop st = s.run();
+        s.tempAddr = 0;
+        if (s.pid) s.syncBreakpoints();
+        return st;
+    }
+
+    Stop finish() {
+        user_regs_struct r = s.regs(s.current);
+        uint64_t ret = 0;
+        if (!s.readMem(r.rbp + 8, &ret, 8)) return Stop::User;
+        const Function* f = info.functionAt(r.rip - s.base);
+        std::cout << "Run till exit from " << (f ? f->name : "??") << std::endl;
+        Stop st = runTo(s.current, ret, r.rbp + 16);
+        if (st == Stop::TempReached) {
+            s.frameNo = 0;
+            user_regs_struct now = s.regs(s.current);
+            std::cout << "Value returned: " << (long long)now.rax << std::endl;
+            s.showFrame(0, true);
+            return Stop::User;
+        }
+        return st;
+    }
+
+    bool ensureStarted() {
+        if (s.pid) return true;
+        if (!s.launch()) {
+            std::cout << "Cannot start " << s.exe << ".\n";
+            return false;
+        }
+        return true;
+    }
+
+    // Returns false to quit.
+    bool command(const std::string& lineText) {
+        std::string line = trim(lineText);
+        if (line.empty()) return true;
+        size_t sp = line.find(' ');
+        std::string cmd = line.substr(0, sp);
+        std::string arg = sp == std::string::npos ? "" : trim(line.substr(sp + 1));
+
+        if (cmd == "q" || cmd == "quit") return false;
+        if (cmd == "help" || cmd == "h") help();
+        else if (cmd == "b" || cmd == "break") breakCommand(arg);
+        else if (cmd == "condition") {
+            std::string n = arg.substr(0, arg.find(' '));
+            std::string cond = arg.find(' ') == std::string::npos ? "" : trim(arg.substr(arg.find(' ') + 1));
+            std::string bad = s.checkCondition(cond);
+            if (!bad.empty()) {
+                std::cout << "Bad condition: " << bad << ".\n";
+                return true;
+            }
+            for (auto& b : s.breakpoints)
+                if (b.id == std::atoi(n.c_str())) {
+                    b.condition = cond;
+                    std::cout << "Breakpoint " << b.id << (cond.empty() ? " is now unconditional" : " now stops if " + cond)
+                              << ".\n";
+                    return true;
+                }
+            std::cout << "No breakpoint " << n << ".\n";
+        } else if (cmd == "d" || cmd == "delete") {
+            if (arg.empty()) s.breakpoints.clear();
+            else
+                s.breakpoints.erase(std::remove_if(s.breakpoints.begin(), s.breakpoints.end(),
+                                                   [&](const Breakpoint& b) { return b.id == std::atoi(arg.c_str()); }),
+                                    s.breakpoints.end());
+            if (s.pid) s.syncBreakpoints();
+        } else if (cmd == "info" || cmd == "i") {
+            if (arg.compare(0, 1, "b") == 0) infoBreakpoints();
+            else if (arg.compare(0, 1, "l") == 0) infoLocals();
+            else std::cout << "info breakpoints | info locals\n";
+        } else if (cmd == "r" || cmd == "run") {
+            if (s.pid && s.started) s.kill();
+            if (ensureStarted()) s.run();
+        } else if (cmd == "c" || cmd == "continue") {
+            if (!s.pid) std::cout << "The program is not running.\n";
+            else s.run();
+        } else if (cmd == "s" || cmd == "step" || cmd == "n" || cmd == "next") {
+            if (needProcess()) step(cmd[0] == 'n');
+        } else if (cmd == "finish") {
+            if (needProcess()) finish();
+        } else if (cmd == "p" || cmd == "print") {
+            print(arg);
+        } else if (cmd == "bt" || cmd == "backtrace" || cmd == "where") {
+            backtrace();
+        } else if (cmd == "f" || cmd == "frame") {
+            if (needProcess()) {
+                std::vector<Session::Frame> fs = s.frames();
+                int n = std::atoi(arg.c_str());
+                if (n < 0 || (size_t)n >= fs.size()) std::cout << "No frame " << n << ".\n";
+                else {
+                    s.frameNo = n;
+                    std::cout << "#" << n << "  ";
+                    s.showFrame((size_t)n, true);
+                }
+            }
+        } else if (cmd == "l" || cmd == "list") {
+            list(arg);
+        } else if (cmd == "kill" || cmd == "k") {
+            if (s.pid) {
+                s.kill();
+                std::cout << "[program killed]\n";
+            }
+        } else {
+            std::cout << "Unknown command \"" << cmd << "\". Try \"help\".\n";
+        }
+        return true;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    std::string target;
+    std::vector<std::string> programArgs;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--version" || arg == "-v") {
+            std::cout << cstardbVersion << std::endl;
+            return 0;
+        } else if (arg == "--") {
+            for (++i; i < argc; ++i) programArgs.push_back(argv[i]);
+        } else if (target.empty()) {
+            target = arg;
+        } else {
+            programArgs.push_back(arg);
+        }
+    }
+    if (target.empty()) {
+        std::cerr << "usage: cstardb <program.cstar | program.exe> [-- args...]" << std::endl;
+        return 2;
+    }
+
+    std::cout << "\033[1;34mCStar Debugger\033[0m" << std::endl;
+    std::string exe = target;
+    if (endsWith(target, ".cstar")) {
+        std::string command = "\"" + findCompiler(argv[0]) + "\" \"" + target + "\" -c -s --debug";
+        if (std::system(command.c_str()) != 0) {
+            std::cerr << "\033[1;31mCompilation failed.\033[0m" << std::endl;
+            return 1;
+        }
+        exe = target.substr(0, target.find_last_of('.')) + ".exe";
+    }
+    if (exe.find('/') == std::string::npos) exe = "./" + exe;
+
+    DebugInfo info;
+    std::string error;
+    if (!info.load(exe, error)) {
+        std::cerr << "cstardb: " << exe << ": " << error << std::endl;
+        return 1;
+    }
+    std::signal(SIGINT, SIG_IGN); // Ctrl+C stops the program, not the debugger
+    std::cout.precision(15);
+
+    Session session(info);
+    session.exe = exe;
+    session.args = programArgs;
+    Debugger dbg(session);
+    if (!session.launch()) {
+        std::cerr << "cstardb: cannot start " << exe << std::endl;
+        return 1;
+    }
+    std::cout << "Reading " << exe << " (" << info.functions.size() << " functions). Type \"help\" for commands."
+              << std::endl;
+
+    std::string line, last;
+    for (;;) {
+        std::cout << "(cstardb) " << std::flush;
+        if (!std::getline(std::cin, line)) break;
+        if (trim(line).empty()) line = last; // repeat, like gdb
+        else last = line;
+        if (!dbg.command(line)) break;
+    }
+    session.kill();
+    return 0;
+}
+
+#else
+
+int main() {
+    std::cerr << "cstardb: the ptrace backend needs Linux on x86-64" << std::endl;
+    return 1;
+}
+
+#endif
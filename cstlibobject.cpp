@@ -5,6 +5,8 @@
 #include <regex>
 #include "keywords.h"
 
+using namespace std;
+
 bool endsWith(const std::string& str, const std::string& suffix) {
     return str.size() >= suffix.size() &&
            str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
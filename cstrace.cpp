@@ -0,0 +1,30 @@
+// cstrace - converts a trace dump (include/ext/trace.h) to Chrome trace JSON
+//
+//   cstrace trace.cstrace [trace.json]
+//
+// Open the JSON in ui.perfetto.dev or chrome://tracing.
+#include <iostream>
+#include <string>
+#include "ext/trace.h"
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "usage: cstrace <dump.cstrace> [out.json]" << std::endl;
+        return 2;
+    }
+    std::string in = argv[1];
+    std::string out = argc > 2 ? argv[2] : in.substr(0, in.rfind('.')) + ".json";
+    if (out == in) out += ".json";
+
+    cstar::trace::capture c;
+    if (!cstar::trace::load(in, c)) {
+        std::cerr << "cstrace: " << in << " is not a readable trace dump" << std::endl;
+        return 1;
+    }
+    if (!cstar::trace::write_json(c, out)) {
+        std::cerr << "cstrace: cannot write " << out << std::endl;
+        return 1;
+    }
+    std::cout << cstar::trace::event_count(c) << " events from " << c.threads.size() << " threads -> " << out << std::endl;
+    return 0;
+}
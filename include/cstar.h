@@ -5,6 +5,10 @@
 #include <vector>
 #include <thread>
 #include <chrono>
+#include <sstream>
+#include <type_traits>
+#include "ext/fastin.h"
+#include "ext/eventloop.h"
 
 // Forward declarations
 class Out;
@@ -38,7 +42,13 @@ namespace cstar25 {
     template<typename T>
     void pinput(T& input, const std::string& prompt = "") {
         std::cout << prompt;
-        std::cin >> input;
+        if constexpr (std::is_arithmetic_v<T> || std::is_same_v<T, std::string>) {
+            cstar::stdin_buf().read(input);
+        } else {
+            // user types with their own operator>>: parse one token
+            std::istringstream tok(std::string(cstar::stdin_buf().token()));
+            tok >> input;
+        }
     }
 }
 
@@ -51,9 +61,24 @@ namespace cpp20 {
 
 class Delay {
     public:
+    // Blocks the calling thread.
     static inline void ms(int milliseconds) {
         std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
     }
+
+    // Non-blocking: schedule on cstar::default_loop(); callbacks run inside Delay::run().
+    template<typename F>
+    static inline cstar::timer_id after(int milliseconds, F&& callback) {
+        return cstar::default_loop().after(milliseconds < 0 ? 0 : (std::uint64_t)milliseconds, std::forward<F>(callback));
+    }
+    template<typename F>
+    static inline cstar::timer_id every(int milliseconds, F&& callback) {
+        return cstar::default_loop().every(milliseconds < 1 ? 1 : (std::uint64_t)milliseconds, std::forward<F>(callback));
+    }
+    static inline bool cancel(cstar::timer_id id) { return cstar::default_loop().cancel(id); }
+    // Run scheduled callbacks until stop() or nothing is left.
+    static inline void run() { cstar::default_loop().run(); }
+    static inline void stop() { cstar::default_loop().stop(); }
 };
 
 inline Delay delay;
@@ -1,10 +1,74 @@
+/*
+cstmath.h - CStar math library (implemented in libcstmath.cpp).
+
+Besides the scalar helpers, cstar::math has batch kernels over arrays of
+doubles. Each call picks the widest instruction set the CPU supports
+(AVX-512F, AVX2+FMA, SSE2, or plain C++ elsewhere), detected once through
+CPUID:
+
+    std::vector<double> x(n), y(n);
+    cstar::math::exp(x.data(), y.data(), n);
+    double d = cstar::math::dot(x.data(), y.data(), n);
+
+Accuracy: add, mul, fma, sqrt, min and max are exact (fma rounds once on
+every path). exp and log are within 2 ulp of the true result, and so is
+root for integer degrees up to 64. Other degrees are computed like
+pow(x, 1/r), whose error grows with |log x|. Lanes outside the
+vector kernels' range (negative, zero, infinite, NaN, huge or subnormal)
+go through <cmath>, so edge cases match the standard functions. sum and
+dot add in a different order than a plain loop, so the last bits can
+differ from one.
+
+Output arrays may be the same array as an input, but must not partially
+overlap one.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
 #ifndef CSTMATH
 #define CSTMATH 1
 
 #include <cmath>
+#include <cstddef>
 
 int add(int a, int b);
 
+// r-th root of n. A negative n has a real root only for odd integer r.
 double root(double n, double r);
 
-#endif
\ No newline at end of file
+namespace cstar {
+namespace math {
+
+enum class isa { scalar, sse2, avx2, avx512 };
+
+// Widest instruction set this CPU (and OS) supports.
+isa best_isa();
+// Instruction set the kernels currently use.
+isa active_isa();
+// Force a code path, e.g. to compare them. Returns false, changing
+// nothing, if the CPU cannot run it.
+bool use_isa(isa which);
+const char* isa_name(isa which);
+
+// out[i] = a[i] + b[i]
+void add(const double* a, const double* b, double* out, std::size_t n);
+// out[i] = a[i] * b[i]
+void mul(const double* a, const double* b, double* out, std::size_t n);
+// out[i] = a[i] * b[i] + c[i], rounded once
+void fma(const double* a, const double* b, const double* c, double* out, std::size_t n);
+void sqrt(const double* x, double* out, std::size_t n);
+// out[i] = r-th root of x[i], same rules as ::root
+void root(const double* x, double r, double* out, std::size_t n);
+void exp(const double* x, double* out, std::size_t n);
+// natural logarithm
+void log(const double* x, double* out, std::size_t n);
+
+double dot(const double* a, const double* b, std::size_t n);
+double sum(const double* x, std::size_t n);
+// +inf / -inf for n == 0; unspecified if x holds NaNs
+double min(const double* x, std::size_t n);
+double max(const double* x, std::size_t n);
+
+} // namespace math
+} // namespace cstar
+
+#endif
@@ -3,22 +3,443 @@ Standard Machine Learning Header file
 
 Yeah, AI addition in CStar. Who knows why?
 
+cstar::ml has a CPU tensor (row-major float storage, 64-byte aligned),
+a blocked multithreaded SGEMM, elementwise ops, softmax and a dense layer:
+
+    cstar::ml::dense layer(784, 128, cstar::ml::activation::relu);
+    cstar::ml::tensor x = cstar::ml::tensor::uniform({32, 784}, 0.0f, 1.0f);
+    cstar::ml::tensor y = layer.forward(x);      // 32 x 128
+
+The SGEMM follows the usual BLIS layout. B is packed into kc x nr
+panels that stay in L3, A into mr x kc panels that stay in L2, and a
+register-tiled micro-kernel (AVX-512, AVX2+FMA or SSE2, picked by CPUID)
+keeps an mr x nr block of C in registers. Large products are split
+by rows or columns of C across cstar::default_pool() (ext/parallel.h).
+
 Copyright (c) 2025 Hoang Viet. All rights reserved.
 */
 
 #ifndef STD_ML_H
 #define STD_ML_H
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../../fastin.h"
+#include "../../parallel.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define CSTAR_ML_X86 1
+    #include <immintrin.h>
+#endif
+
+// after the standard headers: libstdc++ has members named space
 #define brl "\n"
 #define rtrn_code 0x12
 #define tab '\t'
 #define space " "
 
-#include <iostream>
-#include <string>
+// Read one line of standard input into variable. Returns false at end of input.
+inline bool getinp(std::string& variable) {
+    return cstar::stdin_buf().read_line(variable);
+}
+
+namespace cstar {
+namespace ml {
+
+namespace detail {
+    struct gemm_kernel {
+        std::size_t mr, nr;
+        void (*run)(std::size_t kc, const float* a, const float* b, float* c, std::size_t ldc, float alpha,
+                    float beta);
+    };
+
+#ifdef CSTAR_ML_X86
+    namespace sse2 {
+    #define CSTAR_ML_TARGET __attribute__((target("sse2")))
+        struct vec {
+            using reg = __m128;
+            static constexpr std::size_t width = 4, mr = 6;
+            CSTAR_ML_TARGET static reg zero() { return _mm_setzero_ps(); }
+            CSTAR_ML_TARGET static reg load(const float* p) { return _mm_loadu_ps(p); }
+            CSTAR_ML_TARGET static void store(float* p, reg v) { _mm_storeu_ps(p, v); }
+            CSTAR_ML_TARGET static reg set1(float v) { return _mm_set1_ps(v); }
+            CSTAR_ML_TARGET static reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+            CSTAR_ML_TARGET static reg fmadd(reg a, reg b, reg c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+        };
+    #include "sgemm_kernel.inc"
+    #undef CSTAR_ML_TARGET
+    }
+
+    namespace avx2 {
+    #define CSTAR_ML_TARGET __attribute__((target("avx2,fma")))
+        struct vec {
+            using reg = __m256;
+            static constexpr std::size_t width = 8, mr = 6;
+            CSTAR_ML_TARGET static reg zero() { return _mm256_setzero_ps(); }
+            CSTAR_ML_TARGET static reg load(const float* p) { return _mm256_loadu_ps(p); }
+            CSTAR_ML_TARGET static void store(float* p, reg v) { _mm256_storeu_ps(p, v); }
+            CSTAR_ML_TARGET static reg set1(float v) { return _mm256_set1_ps(v); }
+            CSTAR_ML_TARGET static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+            CSTAR_ML_TARGET static reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_ps(a, b, c); }
+        };
+    #include "sgemm_kernel.inc"
+    #undef CSTAR_ML_TARGET
+    }
+
+    namespace avx512 {
+    #define CSTAR_ML_TARGET __attribute__((target("avx512f")))
+        struct vec {
+            using reg = __m512;
+            static constexpr std::size_t width = 16, mr = 12;
+            CSTAR_ML_TARGET static reg zero() { return _mm512_setzero_ps(); }
+            CSTAR_ML_TARGET static reg load(const float* p) { return _mm512_loadu_ps(p); }
+            CSTAR_ML_TARGET static void store(float* p, reg v) { _mm512_storeu_ps(p, v); }
+            CSTAR_ML_TARGET static reg set1(float v) { return _mm512_set1_ps(v); }
+            CSTAR_ML_TARGET static reg mul(reg a, reg b) { return _mm512_mul_ps(a, b); }
+            CSTAR_ML_TARGET static reg fmadd(reg a, reg b, reg c) { return _mm512_fmadd_ps(a, b, c); }
+        };
+    #include "sgemm_kernel.inc"
+    #undef CSTAR_ML_TARGET
+    }
+#endif
 
-void getinp(std::string variable) {
-    std::getline(cin, variable);
+    namespace portable {
+    #define CSTAR_ML_TARGET
+        struct vec {
+            using reg = float;
+            static constexpr std::size_t width = 1, mr = 4;
+            static reg zero() { return 0.0f; }
+            static reg load(const float* p) { return *p; }
+            static void store(float* p, reg v) { *p = v; }
+            static reg set1(float v) { return v; }
+            static reg mul(reg a, reg b) { return a * b; }
+            static reg fmadd(reg a, reg b, reg c) { return a * b + c; }
+        };
+    #include "sgemm_kernel.inc"
+    #undef CSTAR_ML_TARGET
+    }
+
+    inline const gemm_kernel& pick_kernel() {
+        static const gemm_kernel* k = [] {
+#ifdef CSTAR_ML_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f")) return &avx512::kernel;
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return &avx2::kernel;
+            return &sse2::kernel;
+#else
+            return &portable::kernel;
+#endif
+        }();
+        return *k;
+    }
+
+    // kc x nc block of B stays in L3, mc x kc block of A in L2
+    constexpr std::size_t KC = 256, MC = 144, NC = 4080;
+
+    struct aligned_free {
+        void operator()(float* p) const { ::operator delete(p, std::align_val_t(64)); }
+    };
+    using aligned_ptr = std::unique_ptr<float[], aligned_free>;
+
+    inline aligned_ptr aligned_floats(std::size_t n) {
+        return aligned_ptr(static_cast<float*>(::operator new(n * sizeof(float), std::align_val_t(64))));
+    }
+
+    // Per-thread packing space, grown on demand and kept for later calls.
+    inline float* pack_space(int which, std::size_t n) {
+        thread_local aligned_ptr buf[2];
+        thread_local std::size_t cap[2] = {0, 0};
+        if (cap[which] < n) {
+            buf[which] = aligned_floats(n);
+            cap[which] = n;
+        }
+        return buf[which].get();
+    }
+
+    // mc x kc block of A (row stride lda) -> mr-row panels, k-major, zero padded.
+    // Reads whole rows: walking down a column with a power-of-two lda
+    // would hit one cache set over and over.
+    inline void pack_a(const float* A, std::size_t lda, std::size_t mc, std::size_t kc, std::size_t mr, float* dst) {
+        for (std::size_t ir = 0; ir < mc; ir += mr, dst += mr * kc) {
+            std::size_t rows = std::min(mr, mc - ir);
+            for (std::size_t i = 0; i < rows; ++i) {
+                const float* src = A + (ir + i) * lda;
+                for (std::size_t p = 0; p < kc; ++p) dst[p * mr + i] = src[p];
+            }
+            for (std::size_t i = rows; i < mr; ++i)
+                for (std::size_t p = 0; p < kc; ++p) dst[p * mr + i] = 0.0f;
+        }
+    }
+
+    // kc x nc block of B (row stride ldb) -> nr-column panels, zero padded
+    inline void pack_b(const float* B, std::size_t ldb, std::size_t kc, std::size_t nc, std::size_t nr, float* dst) {
+        for (std::size_t jr = 0; jr < nc; jr += nr) {
+            std::size_t cols = std::min(nr, nc - jr);
+            for (std::size_t p = 0; p < kc; ++p) {
+                std::memcpy(dst, B + p * ldb + jr, cols * sizeof(float));
+                for (std::size_t j = cols; j < nr; ++j) dst[j] = 0.0f;
+                dst += nr;
+            }
+        }
+    }
+
+    inline void scale_c(std::size_t m, std::size_t n, float beta, float* C, std::size_t ldc) {
+        for (std::size_t i = 0; i < m; ++i)
+            for (std::size_t j = 0; j < n; ++j) C[i * ldc + j] = beta == 0.0f ? 0.0f : beta * C[i * ldc + j];
+    }
+
+    inline void gemm_serial(std::size_t m, std::size_t n, std::size_t k, float alpha, const float* A, std::size_t lda,
+                            const float* B, std::size_t ldb, float beta, float* C, std::size_t ldc) {
+        const gemm_kernel& uk = pick_kernel();
+        const std::size_t mr = uk.mr, nr = uk.nr;
+        const std::size_t mc_max = MC / mr * mr, nc_max = NC / nr * nr;
+        float* pa = pack_space(0, mc_max * KC);
+        float* pb = pack_space(1, KC * nc_max);
+        alignas(64) float edge[12 * 32];
+
+        for (std::size_t jc = 0; jc < n; jc += nc_max) {
+            std::size_t nc = std::min(nc_max, n - jc);
+            for (std::size_t pc = 0; pc < k; pc += KC) {
+                std::size_t kc = std::min(KC, k - pc);
+                float b_eff = pc == 0 ? beta : 1.0f; // later k-blocks accumulate
+                pack_b(B + pc * ldb + jc, ldb, kc, nc, nr, pb);
+                for (std::size_t ic = 0; ic < m; ic += mc_max) {
+                    std::size_t mc = std::min(mc_max, m - ic);
+                    pack_a(A + ic * lda + pc, lda, mc, kc, mr, pa);
+                    for (std::size_t jr = 0; jr < nc; jr += nr) {
+                        for (std::size_t ir = 0; ir < mc; ir += mr) {
+                            float* c = C + (ic + ir) * ldc + jc + jr;
+                            const float* a = pa + ir * kc;
+                            const float* b = pb + jr * kc;
+                            std::size_t rows = std::min(mr, mc - ir), cols = std::min(nr, nc - jr);
+                            if (rows == mr && cols == nr) {
+                                uk.run(kc, a, b, c, ldc, alpha, b_eff);
+                                continue;
+                            }
+                            // partial tile: compute the full tile aside, merge what fits
+                            uk.run(kc, a, b, edge, nr, alpha, 0.0f);
+                            for (std::size_t i = 0; i < rows; ++i)
+                                for (std::size_t j = 0; j < cols; ++j) {
+                                    float& dst = c[i * ldc + j];
+                                    dst = edge[i * nr + j] + (b_eff == 0.0f ? 0.0f : b_eff * dst);
+                                }
+                        }
+                    }
+                }
+            }
+        }
+    }
+} // namespace detail
+
+// C = alpha * A * B + beta * C for row-major A (m x k), B (k x n), C (m x n)
+// with row strides lda, ldb, ldc. With beta == 0, C is not read, so it
+// may hold garbage. Large products run as up to threads slabs on
+// cstar::default_pool(); threads = 0 means one slab per pool worker.
+inline void sgemm(std::size_t m, std::size_t n, std::size_t k, float alpha, const float* A, std::size_t lda,
+                  const float* B, std::size_t ldb, float beta, float* C, std::size_t ldc, unsigned threads = 0) {
+    if (m == 0 || n == 0) return;
+    if (k == 0 || alpha == 0.0f) return detail::scale_c(m, n, beta, C, ldc);
+
+    if (threads == 0) threads = default_pool().size();
+    // below ~4 MFLOP per slab, handing work to another thread costs more than it saves
+    double flops = 2.0 * m * n * k;
+    threads = (unsigned)std::min<double>(threads, std::max(1.0, flops / 4e6));
+    if (threads <= 1) return detail::gemm_serial(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+
+    // split the longer side of C into tile-aligned slabs, one per thread,
+    // and run them on the shared pool
+    const detail::gemm_kernel& uk = detail::pick_kernel();
+    bool by_rows = m >= n;
+    std::size_t len = by_rows ? m : n, step = by_rows ? uk.mr : uk.nr;
+    std::size_t chunk = ((len + threads - 1) / threads + step - 1) / step * step;
+    parallel_for(0, (len + chunk - 1) / chunk, [=](std::size_t s) {
+        std::size_t lo = s * chunk, cnt = std::min(chunk, len - lo);
+        if (by_rows) detail::gemm_serial(cnt, n, k, alpha, A + lo * lda, lda, B, ldb, beta, C + lo * ldc, ldc);
+        else detail::gemm_serial(m, cnt, k, alpha, A, lda, B + lo, ldb, beta, C + lo, ldc);
+    }, 1);
 }
 
-#endif
\ No newline at end of file
+class tensor {
+public:
+    using shape_type = std::vector<std::size_t>;
+
+    tensor() = default;
+
+    explicit tensor(shape_type shape, float value = 0.0f) : shape_(std::move(shape)) {
+        size_ = 1;
+        for (std::size_t d : shape_) size_ *= d;
+        data_ = detail::aligned_floats(size_);
+        std::fill(data_.get(), data_.get() + size_, value);
+    }
+
+    tensor(const tensor& o) : shape_(o.shape_), size_(o.size_), data_(detail::aligned_floats(o.size_)) {
+        std::copy(o.begin(), o.end(), data_.get());
+    }
+    tensor(tensor&&) noexcept = default;
+    tensor& operator=(const tensor& o) {
+        if (this != &o) *this = tensor(o);
+        return *this;
+    }
+    tensor& operator=(tensor&&) noexcept = default;
+
+    static tensor zeros(shape_type shape) { return tensor(std::move(shape)); }
+    static tensor full(shape_type shape, float value) { return tensor(std::move(shape), value); }
+    // Uniform values in [lo, hi), reproducible for a given seed.
+    static tensor uniform(shape_type shape, float lo, float hi, unsigned seed = 1) {
+        tensor t(std::move(shape));
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> dist(lo, hi);
+        for (float& v : t) v = dist(rng);
+        return t;
+    }
+
+    const shape_type& shape() const { return shape_; }
+    std::size_t rank() const { return shape_.size(); }
+    std::size_t dim(std::size_t i) const { return shape_.at(i); }
+    std::size_t size() const { return size_; }
+    // 2-D views: cols = last dimension, rows = product of the others, so
+    // a 1-D tensor is one row and row-wise ops work on the last axis
+    std::size_t cols() const { return shape_.empty() ? 0 : shape_.back(); }
+    std::size_t rows() const { return cols() ? size_ / cols() : 0; }
+
+    float* data() { return data_.get(); }
+    const float* data() const { return data_.get(); }
+    float* begin() { return data_.get(); }
+    float* end() { return data_.get() + size_; }
+    const float* begin() const { return data_.get(); }
+    const float* end() const { return data_.get() + size_; }
+
+    float& operator[](std::size_t i) { return data_[i]; }
+    float operator[](std::size_t i) const { return data_[i]; }
+    float& operator()(std::size_t r, std::size_t c) { return data_[r * cols() + c]; }
+    float operator()(std::size_t r, std::size_t c) const { return data_[r * cols() + c]; }
+
+    // Same data, new shape; the element count must not change.
+    tensor& reshape(shape_type shape) {
+        std::size_t n = 1;
+        for (std::size_t d : shape) n *= d;
+        if (n != size_) throw std::invalid_argument("tensor::reshape: element count differs");
+        shape_ = std::move(shape);
+        return *this;
+    }
+
+    tensor& operator+=(const tensor& o) { return zip(o, [](float a, float b) { return a + b; }); }
+    tensor& operator-=(const tensor& o) { return zip(o, [](float a, float b) { return a - b; }); }
+    tensor& operator*=(const tensor& o) { return zip(o, [](float a, float b) { return a * b; }); }
+    tensor& operator*=(float s) {
+        for (float& v : *this) v *= s;
+        return *this;
+    }
+
+private:
+    template<typename F>
+    tensor& zip(const tensor& o, F f) {
+        if (o.size_ != size_) throw std::invalid_argument("tensor: shape mismatch");
+        float* a = data();
+        const float* b = o.data();
+        for (std::size_t i = 0; i < size_; ++i) a[i] = f(a[i], b[i]);
+        return *this;
+    }
+
+    shape_type shape_;
+    std::size_t size_ = 0;
+    detail::aligned_ptr data_;
+};
+
+// Elementwise, same shapes
+inline tensor operator+(tensor a, const tensor& b) { return a += b; }
+inline tensor operator-(tensor a, const tensor& b) { return a -= b; }
+inline tensor operator*(tensor a, const tensor& b) { return a *= b; }
+inline tensor operator*(tensor a, float s) { return a *= s; }
+
+template<typename F>
+inline tensor map(tensor a, F f) {
+    for (float& v : a) v = f(v);
+    return a;
+}
+
+inline tensor relu(tensor a) { return map(std::move(a), [](float v) { return v > 0.0f ? v : 0.0f; }); }
+inline tensor sigmoid(tensor a) { return map(std::move(a), [](float v) { return 1.0f / (1.0f + std::exp(-v)); }); }
+inline tensor tanh(tensor a) { return map(std::move(a), [](float v) { return std::tanh(v); }); }
+
+// Row-wise softmax over the last dimension (max-subtracted, so large
+// logits do not overflow).
+inline tensor softmax(tensor a) {
+    std::size_t n = a.cols();
+    for (std::size_t r = 0; r < a.rows(); ++r) {
+        float* row = a.data() + r * n;
+        float hi = *std::max_element(row, row + n);
+        float sum = 0.0f;
+        for (std::size_t j = 0; j < n; ++j) sum += (row[j] = std::exp(row[j] - hi));
+        float inv = 1.0f / sum;
+        for (std::size_t j = 0; j < n; ++j) row[j] *= inv;
+    }
+    return a;
+}
+
+// Matrix product of 2-D tensors: (m x k) * (k x n) -> m x n.
+inline tensor matmul(const tensor& a, const tensor& b, unsigned threads = 0) {
+    if (a.cols() != b.rows()) throw std::invalid_argument("matmul: inner dimensions differ");
+    tensor c({a.rows(), b.cols()});
+    sgemm(a.rows(), b.cols(), a.cols(), 1.0f, a.data(), a.cols(), b.data(), b.cols(), 0.0f, c.data(), c.cols(), threads);
+    return c;
+}
+
+enum class activation { none, relu, sigmoid, tanh, softmax };
+
+// Fully connected layer: y = act(x W + b), x is batch x in, W is in x out.
+class dense {
+public:
+    // Glorot-uniform weights, zero bias.
+    dense(std::size_t in, std::size_t out, activation act = activation::none, unsigned seed = 1)
+        : weight_(tensor::uniform({in, out}, -limit(in, out), limit(in, out), seed)), bias_({out}), act_(act) {}
+
+    tensor forward(const tensor& x) const {
+        std::size_t in = weight_.rows(), out = weight_.cols();
+        if (x.cols() != in) throw std::invalid_argument("dense::forward: input width differs from layer");
+        tensor y({x.rows(), out});
+        for (std::size_t r = 0; r < x.rows(); ++r) std::copy(bias_.begin(), bias_.end(), y.data() + r * out);
+        sgemm(x.rows(), out, in, 1.0f, x.data(), in, weight_.data(), out, 1.0f, y.data(), out);
+        switch (act_) {
+        case activation::relu: return relu(std::move(y));
+        case activation::sigmoid: return sigmoid(std::move(y));
+        case activation::tanh: return ml::tanh(std::move(y));
+        case activation::softmax: return softmax(std::move(y));
+        default: return y;
+        }
+    }
+
+    tensor& weight() { return weight_; }
+    tensor& bias() { return bias_; }
+    const tensor& weight() const { return weight_; }
+    const tensor& bias() const { return bias_; }
+
+private:
+    static float limit(std::size_t in, std::size_t out) { return std::sqrt(6.0f / (float)(in + out)); }
+
+    tensor weight_;
+    tensor bias_;
+    activation act_;
+};
+
+// Prints 2-D tensors row by row, anything else flat.
+inline std::ostream& operator<<(std::ostream& os, const tensor& t) {
+    std::size_t n = t.rank() == 2 ? t.cols() : t.size();
+    for (std::size_t i = 0; i < t.size(); ++i) os << t[i] << ((i + 1) % n == 0 ? '\n' : ' ');
+    return os;
+}
+
+} // namespace ml
+} // namespace cstar
+
+#endif
@@ -0,0 +1,338 @@
+/*
+adv_array.h - st::adv_array, the CStar dynamic array.
+
+    st::adv_array<int> a;          // first 16 ints live inside the object
+    a.push(1);
+    a.push(2);
+    a.dump();                      // [1, 2]
+
+Design, for speed:
+  - The first N elements are stored inline (N defaults to what fits in
+    64 bytes), so short arrays never touch the heap.
+  - Capacity doubles when full.
+  - Trivially relocatable types are moved to a new buffer with memcpy
+    instead of move-construct + destroy. That covers trivially copyable
+    types by default; specialize st::is_trivially_relocatable for your own.
+  - operator[] is bounds-checked (std::out_of_range) unless NDEBUG is
+    defined. Define CSTAR_ADV_ARRAY_CHECKED to 0 or 1 to override. at()
+    is always checked.
+  - Memory comes from the Allocator parameter (std::allocator by default).
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_ADV_ARRAY_H
+#define CSTLIB26_ADV_ARRAY_H 1
+
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#ifndef CSTAR_ADV_ARRAY_CHECKED
+    #ifdef NDEBUG
+        #define CSTAR_ADV_ARRAY_CHECKED 0
+    #else
+        #define CSTAR_ADV_ARRAY_CHECKED 1
+    #endif
+#endif
+
+namespace st {
+
+// True if moving a T to a new address and forgetting the old one is the
+// same as copying its bytes.
+template <typename T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+template <typename T>
+inline constexpr std::size_t adv_array_inline_default = sizeof(T) <= 32 ? 64 / sizeof(T) : 1;
+
+template <typename T, std::size_t N = adv_array_inline_default<T>, typename Allocator = std::allocator<T>>
+class adv_array : private Allocator {
+    using traits = std::allocator_traits<Allocator>;
+    static constexpr bool relocatable = is_trivially_relocatable<T>::value;
+
+public:
+    using value_type = T;
+    using allocator_type = Allocator;
+    using size_type = std::size_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using iterator = T*;
+    using const_iterator = const T*;
+    static constexpr size_type inline_capacity = N;
+
+    adv_array() noexcept(noexcept(Allocator())) : Allocator(), data_(inline_ptr()) {}
+    explicit adv_array(const Allocator& a) noexcept : Allocator(a), data_(inline_ptr()) {}
+
+    adv_array(std::initializer_list<T> init, const Allocator& a = Allocator()) : adv_array(a) {
+        reserve(init.size());
+        for (const T& v : init) traits::construct(alloc(), data_ + size_++, v);
+    }
+
+    explicit adv_array(size_type n, const T& value = T(), const Allocator& a = Allocator()) : adv_array(a) {
+        resize(n, value);
+    }
+
+    adv_array(const adv_array& o) : adv_array(traits::select_on_container_copy_construction(o.alloc())) {
+        append_copy(o);
+    }
+
+    adv_array(adv_array&& o) noexcept(relocatable || std::is_nothrow_move_constructible_v<T>)
+        : Allocator(std::move(o.alloc())), data_(inline_ptr()) {
+        take(o);
+    }
+
+    adv_array& operator=(const adv_array& o) {
+        if (this != &o) {
+            clear();
+            append_copy(o);
+        }
+        return *this;
+    }
+
+    adv_array& operator=(adv_array&& o) noexcept(relocatable || std::is_nothrow_move_constructible_v<T>) {
+        if (this == &o) return *this;
+        clear();
+        if (!o.on_heap() || traits::is_always_equal::value || alloc() == o.alloc()) {
+            release();
+            take(o);
+        } else {
+            // allocators differ: the buffer cannot change hands
+            reserve(o.size_);
+            for (size_type i = 0; i < o.size_; ++i) traits::construct(alloc(), data_ + i, std::move(o.data_[i]));
+            size_ = o.size_;
+            o.clear();
+        }
+        return *this;
+    }
+
+    ~adv_array() {
+        destroy_all();
+        release();
+    }
+
+    // --- adding and removing ---------------------------------------------
+
+    void push(const T& value) { emplace(value); }
+    void push(T&& value) { emplace(std::move(value)); }
+    void push_back(const T& value) { emplace(value); }
+    void push_back(T&& value) { emplace(std::move(value)); }
+
+    template <typename... Args>
+    T& emplace(Args&&... args) {
+        if (size_ < cap_) {
+            traits::construct(alloc(), data_ + size_, std::forward<Args>(args)...);
+            return data_[size_++];
+        }
+        return emplace_grow(std::forward<Args>(args)...);
+    }
+    template <typename... Args>
+    T& emplace_back(Args&&... args) { return emplace(std::forward<Args>(args)...); }
+
+    // Removes the last element; does nothing when empty.
+    void pop() noexcept {
+        if (size_) traits::destroy(alloc(), data_ + --size_);
+    }
+    void pop_back() noexcept { pop(); }
+
+    void clear() noexcept {
+        destroy_all();
+        size_ = 0;
+    }
+
+    void reserve(size_type n) {
+        if (n > cap_) reallocate(n);
+    }
+
+    void resize(size_type n) { resize_impl(n); }
+    void resize(size_type n, const T& value) { resize_impl(n, value); }
+
+    // --- access ----------------------------------------------------------
+
+    T& operator[](size_type index) {
+#if CSTAR_ADV_ARRAY_CHECKED
+        check(index);
+#endif
+        return data_[index];
+    }
+    const T& operator[](size_type index) const {
+#if CSTAR_ADV_ARRAY_CHECKED
+        check(index);
+#endif
+        return data_[index];
+    }
+
+    T& at(size_type index) {
+        check(index);
+        return data_[index];
+    }
+    const T& at(size_type index) const {
+        check(index);
+        return data_[index];
+    }
+
+    T& front() { return (*this)[0]; }
+    const T& front() const { return (*this)[0]; }
+    T& back() { return (*this)[size_ - 1]; }
+    const T& back() const { return (*this)[size_ - 1]; }
+
+    T* data() noexcept { return data_; }
+    const T* data() const noexcept { return data_; }
+    iterator begin() noexcept { return data_; }
+    iterator end() noexcept { return data_ + size_; }
+    const_iterator begin() const noexcept { return data_; }
+    const_iterator end() const noexcept { return data_ + size_; }
+
+    size_type length() const noexcept { return size_; }
+    size_type size() const noexcept { return size_; }
+    size_type capacity() const noexcept { return cap_; }
+    bool empty() const noexcept { return size_ == 0; }
+    allocator_type get_allocator() const { return alloc(); }
+
+    void dump() const {
+        std::cout << "[";
+        for (size_type i = 0; i < size_; ++i) {
+            std::cout << data_[i];
+            if (i + 1 < size_) std::cout << ", ";
+        }
+        std::cout << "]\n";
+    }
+
+private:
+    Allocator& alloc() noexcept { return *this; }
+    const Allocator& alloc() const noexcept { return *this; }
+
+    T* inline_ptr() noexcept { return reinterpret_cast<T*>(inline_); }
+    bool on_heap() const noexcept { return data_ != reinterpret_cast<const T*>(inline_); }
+
+    void check(size_type index) const {
+        if (index >= size_) throw std::out_of_range("adv_array index out of range");
+    }
+
+    void destroy_all() noexcept {
+        if constexpr (!std::is_trivially_destructible_v<T>)
+            for (size_type i = 0; i < size_; ++i) traits::destroy(alloc(), data_ + i);
+    }
+
+    void release() noexcept {
+        if (on_heap()) traits::deallocate(alloc(), data_, cap_);
+        data_ = inline_ptr();
+        cap_ = N;
+    }
+
+    size_type grown(size_type need) const {
+        size_type doubled = cap_ ? cap_ * 2 : 4;
+        return doubled > need ? doubled : need;
+    }
+
+    // Move size_ elements from src into raw memory at dst and end their
+    // lifetime at src.
+    void relocate(T* src, T* dst) {
+        if constexpr (relocatable) {
+            if (size_) std::memcpy(static_cast<void*>(dst), static_cast<const void*>(src), size_ * sizeof(T));
+        } else {
+            size_type i = 0;
+            try {
+                for (; i < size_; ++i) traits::construct(alloc(), dst + i, std::move_if_noexcept(src[i]));
+            } catch (...) {
+                while (i) traits::destroy(alloc(), dst + --i);
+                throw;
+            }
+            for (i = 0; i < size_; ++i) traits::destroy(alloc(), src + i);
+        }
+    }
+
+    void reallocate(size_type n) {
+        T* fresh = traits::allocate(alloc(), n);
+        try {
+            relocate(data_, fresh);
+        } catch (...) {
+            traits::deallocate(alloc(), fresh, n);
+            throw;
+        }
+        if (on_heap()) traits::deallocate(alloc(), data_, cap_);
+        data_ = fresh;
+        cap_ = n;
+    }
+
+    // Slow path of emplace. The new element is built before the old ones
+    // move, because args may refer to one of them.
+    template <typename... Args>
+    T& emplace_grow(Args&&... args) {
+        size_type n = grown(size_ + 1);
+        T* fresh = traits::allocate(alloc(), n);
+        try {
+            traits::construct(alloc(), fresh + size_, std::forward<Args>(args)...);
+        } catch (...) {
+            traits::deallocate(alloc(), fresh, n);
+            throw;
+        }
+        try {
+            relocate(data_, fresh);
+        } catch (...) {
+            traits::destroy(alloc(), fresh + size_);
+            traits::deallocate(alloc(), fresh, n);
+            throw;
+        }
+        if (on_heap()) traits::deallocate(alloc(), data_, cap_);
+        data_ = fresh;
+        cap_ = n;
+        return data_[size_++];
+    }
+
+    template <typename... Fill>
+    void resize_impl(size_type n, const Fill&... value) {
+        if (n <= size_) {
+            while (size_ > n) pop();
+            return;
+        }
+        if (n > cap_) reallocate(grown(n));
+        for (; size_ < n; ++size_) traits::construct(alloc(), data_ + size_, value...);
+    }
+
+    void append_copy(const adv_array& o) {
+        reserve(o.size_);
+        for (; size_ < o.size_; ++size_) traits::construct(alloc(), data_ + size_, o.data_[size_]);
+    }
+
+    // Take o's elements; this must be empty and own no heap buffer.
+    void take(adv_array& o) {
+        if (o.on_heap()) {
+            data_ = o.data_;
+            size_ = o.size_;
+            cap_ = o.cap_;
+            o.data_ = o.inline_ptr();
+            o.size_ = 0;
+            o.cap_ = N;
+            return;
+        }
+        size_ = o.size_;
+        relocate_from_inline(o);
+    }
+
+    void relocate_from_inline(adv_array& o) {
+        if constexpr (relocatable) {
+            if (size_) std::memcpy(static_cast<void*>(data_), static_cast<const void*>(o.data_), size_ * sizeof(T));
+        } else {
+            for (size_type i = 0; i < size_; ++i) {
+                traits::construct(alloc(), data_ + i, std::move(o.data_[i]));
+                traits::destroy(alloc(), o.data_ + i);
+            }
+        }
+        o.size_ = 0;
+    }
+
+    T* data_;
+    size_type size_ = 0;
+    size_type cap_ = N;
+    alignas(T) unsigned char inline_[N ? N * sizeof(T) : 1];
+};
+
+} // namespace st
+
+#endif // CSTLIB26_ADV_ARRAY_H
@@ -0,0 +1,399 @@
+/*
+alloc.h - Arena and pool allocators for CStar.
+
+cstar::arena hands out memory by bumping a pointer through large blocks.
+Nothing is freed one allocation at a time; instead the whole arena (or
+everything since a checkpoint) is released at once. That suits work that
+builds many short-lived objects and then drops them together, such as
+one request or one frame:
+
+    cstar::arena a;
+    for (auto& request : requests) {
+        cstar::arena::scope s(a);            // released at end of iteration
+        std::vector<int, cstar::arena_allocator<int>> ids(a);
+        Node* n = a.make<Node>(1, 2);         // destructor runs at release
+        ...
+    }
+
+mark() / rollback() do the same without a scope object. Checkpoints must
+be rolled back in reverse order of creation. An arena is not
+thread-safe; give each thread its own.
+
+cstar::pool<T> is a free list of fixed-size slots for objects of one
+type. allocate and deallocate are a couple of pointer moves, and freed
+slots are reused before new memory is taken:
+
+    cstar::pool<Node> nodes;
+    Node* n = nodes.make(1, 2);
+    nodes.destroy(n);
+
+cstar::pool_allocator<T> gives node-based containers (std::map,
+std::set, std::list, std::unordered_map) the same free lists. Each
+object size has one process-wide pool, guarded by a spinlock. Requests
+for more than one object go to operator new, so std::vector gains nothing
+from it:
+
+    std::map<int, int, std::less<int>, cstar::pool_allocator<std::pair<const int, int>>> m;
+
+Both allocators also work with st::adv_array.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_ALLOC_H
+#define CSTLIB26_ALLOC_H 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cstar {
+
+// --- arena -------------------------------------------------------------
+
+class arena {
+    struct block {
+        block* prev;
+        std::size_t size;  // usable bytes after the header
+    };
+    struct dtor_node {
+        void (*destroy)(void*);
+        void* object;
+        dtor_node* next;
+    };
+
+public:
+    struct checkpoint {
+        block* blk;
+        char* cur;
+        dtor_node* dtors;
+    };
+
+    // Releases everything allocated since it was created.
+    class scope {
+    public:
+        explicit scope(arena& a) noexcept : arena_(a), mark_(a.mark()) {}
+        ~scope() { arena_.rollback(mark_); }
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+
+    private:
+        arena& arena_;
+        checkpoint mark_;
+    };
+
+    // block_size: size of the first block. Later blocks double, up to
+    // 1 MiB, and a request bigger than that gets a block of its own.
+    explicit arena(std::size_t block_size = 4096) noexcept : next_size_(block_size < 256 ? 256 : block_size) {}
+    ~arena() {
+        reset();
+        free_block(spare_);
+    }
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+
+    void* allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t)) {
+        std::uintptr_t p = (reinterpret_cast<std::uintptr_t>(cur_) + align - 1) & ~(std::uintptr_t)(align - 1);
+        if (cur_ && p + bytes <= reinterpret_cast<std::uintptr_t>(end_)) {
+            cur_ = reinterpret_cast<char*>(p + bytes);
+            return reinterpret_cast<void*>(p);
+        }
+        return allocate_slow(bytes, align);
+    }
+
+    // Only the most recent allocation is actually given back (so a growing
+    // vector can reuse its old space); anything else waits for rollback.
+    void deallocate(void* p, std::size_t bytes) noexcept {
+        if (static_cast<char*>(p) + bytes == cur_) cur_ = static_cast<char*>(p);
+    }
+
+    // Constructs a T in the arena. Its destructor, unless trivial, runs
+    // when the arena is rolled back past it or reset.
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        if constexpr (std::is_trivially_destructible_v<T>) {
+            return ::new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        } else {
+            auto* node = static_cast<dtor_node*>(allocate(sizeof(dtor_node), alignof(dtor_node)));
+            T* obj = ::new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            *node = {[](void* o) { static_cast<T*>(o)->~T(); }, obj, dtors_};
+            dtors_ = node;
+            return obj;
+        }
+    }
+
+    checkpoint mark() const noexcept { return {head_, cur_, dtors_}; }
+
+    void rollback(const checkpoint& to) noexcept {
+        while (dtors_ != to.dtors) {
+            dtors_->destroy(dtors_->object);
+            dtors_ = dtors_->next;
+        }
+        while (head_ != to.blk) {
+            block* b = head_;
+            head_ = b->prev;
+            reserved_ -= b->size;
+            // keep the biggest released block for the next slow path
+            if (!spare_ || b->size > spare_->size) std::swap(b, spare_);
+            free_block(b);
+        }
+        cur_ = to.cur;
+        end_ = head_ ? data(head_) + head_->size : nullptr;
+    }
+
+    // Releases everything. One block is kept for reuse.
+    void reset() noexcept { rollback({nullptr, nullptr, nullptr}); }
+
+    // Bytes held in live blocks (the spare block not included).
+    std::size_t reserved() const noexcept { return reserved_; }
+
+private:
+    static constexpr std::size_t max_block = 1 << 20;
+    static constexpr std::size_t header = (sizeof(block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+    static char* data(block* b) noexcept { return reinterpret_cast<char*>(b) + header; }
+    static void free_block(block* b) noexcept { ::operator delete(b); }
+
+    void* allocate_slow(std::size_t bytes, std::size_t align) {
+        std::size_t need = bytes + align;
+        block* b;
+        if (spare_ && spare_->size >= need) {
+            b = spare_;
+            spare_ = nullptr;
+        } else {
+            std::size_t size = need > next_size_ ? need : next_size_;
+            if (next_size_ < max_block) next_size_ *= 2;
+            b = static_cast<block*>(::operator new(header + size));
+            b->size = size;
+        }
+        b->prev = head_;
+        head_ = b;
+        reserved_ += b->size;
+        cur_ = data(b);
+        end_ = cur_ + b->size;
+        return allocate(bytes, align);
+    }
+
+    block* head_ = nullptr;
+    block* spare_ = nullptr;
+    char* cur_ = nullptr;
+    char* end_ = nullptr;
+    dtor_node* dtors_ = nullptr;
+    std::size_t next_size_;
+    std::size_t reserved_ = 0;
+};
+
+// Standard allocator over an arena. Copies share the arena; containers
+// must not outlive it or a rollback past their memory.
+template <typename T>
+class arena_allocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    arena_allocator(arena& a) noexcept : arena_(&a) {}
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& o) noexcept : arena_(o.get_arena()) {}
+
+    T* allocate(std::size_t n) {
+        if (n > std::size_t(-1) / sizeof(T)) throw std::bad_array_new_length();
+        return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, std::size_t n) noexcept { arena_->deallocate(p, n * sizeof(T)); }
+
+    arena* get_arena() const noexcept { return arena_; }
+
+    template <typename U>
+    bool operator==(const arena_allocator<U>& o) const noexcept { return arena_ == o.get_arena(); }
+    template <typename U>
+    bool operator!=(const arena_allocator<U>& o) const noexcept { return arena_ != o.get_arena(); }
+
+private:
+    arena* arena_;
+};
+
+// --- pools -------------------------------------------------------------
+
+// Free list of slots of one size. Memory comes in chunks that double from
+// 32 slots up to 64 KiB and is returned when the pool is destroyed.
+class fixed_pool {
+    struct node {
+        node* next;
+    };
+    struct chunk {
+        chunk* next;
+    };
+
+public:
+    fixed_pool(std::size_t size, std::size_t align) noexcept
+        : align_(align < alignof(node) ? alignof(node) : align),
+          slot_(round_up(size < sizeof(node) ? sizeof(node) : size, align_)),
+          header_(round_up(sizeof(chunk), align_)) {}
+    ~fixed_pool() {
+        while (chunks_) {
+            chunk* c = chunks_;
+            chunks_ = c->next;
+            ::operator delete(c, std::align_val_t(align_));
+        }
+    }
+    fixed_pool(const fixed_pool&) = delete;
+    fixed_pool& operator=(const fixed_pool&) = delete;
+
+    void* allocate() {
+        ++live_;
+        if (free_) {
+            node* n = free_;
+            free_ = n->next;
+            return n;
+        }
+        if (bump_ != bump_end_) {
+            void* p = bump_;
+            bump_ += slot_;
+            return p;
+        }
+        return refill();
+    }
+
+    void deallocate(void* p) noexcept {
+        --live_;
+        node* n = static_cast<node*>(p);
+        n->next = free_;
+        free_ = n;
+    }
+
+    std::size_t slot_size() const noexcept { return slot_; }
+    std::size_t in_use() const noexcept { return live_; }
+
+private:
+    static std::size_t round_up(std::size_t n, std::size_t a) noexcept { return (n + a - 1) / a * a; }
+
+    void* refill() {
+        std::size_t bytes = header_ + slot_ * next_count_;
+        auto* c = static_cast<chunk*>(::operator new(bytes, std::align_val_t(align_)));
+        c->next = chunks_;
+        chunks_ = c;
+        bump_ = reinterpret_cast<char*>(c) + header_;
+        bump_end_ = bump_ + slot_ * next_count_;
+        if (slot_ * next_count_ < (64u << 10)) next_count_ *= 2;
+        void* p = bump_;
+        bump_ += slot_;
+        return p;
+    }
+
+    std::size_t align_, slot_, header_;
+    std::size_t next_count_ = 32;
+    std::size_t live_ = 0;
+    node* free_ = nullptr;
+    chunk* chunks_ = nullptr;
+    char* bump_ = nullptr;
+    char* bump_end_ = nullptr;
+};
+
+// Pool of T objects. Not thread-safe.
+template <typename T>
+class pool : public fixed_pool {
+public:
+    pool() noexcept : fixed_pool(sizeof(T), alignof(T)) {}
+
+    T* allocate() { return static_cast<T*>(fixed_pool::allocate()); }
+    void deallocate(T* p) noexcept { fixed_pool::deallocate(p); }
+
+    template <typename... Args>
+    T* make(Args&&... args) {
+        void* p = fixed_pool::allocate();
+        try {
+            return ::new (p) T(std::forward<Args>(args)...);
+        } catch (...) {
+            fixed_pool::deallocate(p);
+            throw;
+        }
+    }
+    void destroy(T* p) noexcept {
+        p->~T();
+        fixed_pool::deallocate(p);
+    }
+};
+
+namespace detail {
+
+struct locked_pool {
+    std::atomic<bool> busy{false};
+    fixed_pool pool;
+
+    locked_pool(std::size_t size, std::size_t align) noexcept : pool(size, align) {}
+
+    void lock() noexcept {
+        while (busy.exchange(true, std::memory_order_acquire))
+            while (busy.load(std::memory_order_relaxed)) {
+#if defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_pause();
+#endif
+            }
+    }
+    void unlock() noexcept { busy.store(false, std::memory_order_release); }
+};
+
+// One pool per slot shape, created on first use and never destroyed, so
+// containers with static storage can still free into it at exit.
+template <std::size_t Size, std::size_t Align>
+inline locked_pool& shared_pool() {
+    static locked_pool* p = new locked_pool(Size, Align);
+    return *p;
+}
+
+} // namespace detail
+
+// Standard allocator that serves single objects from process-wide pools.
+template <typename T>
+class pool_allocator {
+public:
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    pool_allocator() noexcept = default;
+    template <typename U>
+    pool_allocator(const pool_allocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        if (n != 1) return std::allocator<T>().allocate(n);
+        detail::locked_pool& p = shared();
+        p.lock();
+        void* r;
+        try {
+            r = p.pool.allocate();
+        } catch (...) {
+            p.unlock();
+            throw;
+        }
+        p.unlock();
+        return static_cast<T*>(r);
+    }
+
+    void deallocate(T* ptr, std::size_t n) noexcept {
+        if (n != 1) return std::allocator<T>().deallocate(ptr, n);
+        detail::locked_pool& p = shared();
+        p.lock();
+        p.pool.deallocate(ptr);
+        p.unlock();
+    }
+
+    template <typename U>
+    bool operator==(const pool_allocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const pool_allocator<U>&) const noexcept { return false; }
+
+private:
+    static detail::locked_pool& shared() {
+        // round the size so similar node types share a pool
+        return detail::shared_pool<(sizeof(T) + 15) / 16 * 16, alignof(T)>();
+    }
+};
+
+} // namespace cstar
+
+#endif // CSTLIB26_ALLOC_H
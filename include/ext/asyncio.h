@@ -0,0 +1,489 @@
+/*
+asyncio.h - Asynchronous file I/O for CStar.
+
+cstar::async_io queues reads and writes on posix_util descriptors and
+submits them as a batch. On Linux it talks to io_uring directly (no
+liburing needed); when io_uring is missing or refused (old kernel,
+seccomp, other platforms) the same interface runs on a small thread pool
+doing filepread/filepwrite.
+
+Completion callbacks always run on the thread that calls poll(), wait()
+or drain(), never on a kernel or pool thread, so they need no locking.
+A read may complete short exactly like pread(); the callback gets the
+byte count or -1 with the error code.
+
+A queued operation holds its descriptor open until its callback has run:
+fileclose() on it fails with EBUSY until then, so poll(), wait() or
+drain() before closing.
+
+    cstar::async_io aio;
+    aio.read(fd, buf, 4096, 0, [](ssize_t n, int err) { ... });
+    aio.read(fd, buf2, 4096, 8192, [](ssize_t n, int err) { ... });
+    aio.submit();
+    aio.drain();
+
+Link posix_util.cpp and -pthread.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_ASYNCIO_H
+#define CSTLIB26_ASYNCIO_H 1
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../posix_util.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <sys/uio.h>
+    #define CSTAR_HAVE_IO_URING 1
+#else
+    #if !defined(_WIN32) && !defined(_WIN64)
+        #include <sys/uio.h>
+    #else
+        struct iovec { void* iov_base; size_t iov_len; };
+    #endif
+#endif
+
+namespace cstar {
+
+// (bytes transferred or -1, error code when -1)
+using io_callback = std::function<void(ssize_t, int)>;
+
+enum class io_backend { automatic, io_uring, thread_pool };
+
+class async_io {
+public:
+    // queue_depth bounds the number of operations in flight; queuing more
+    // first waits for a completion (running its callback).
+    explicit async_io(unsigned queue_depth = 256, io_backend want = io_backend::automatic,
+                      unsigned pool_threads = 16)
+        : slots_(queue_depth ? queue_depth : 1) {
+        for (unsigned i = 0; i < slots_.size(); ++i) slots_[i].next_free = i + 1;
+#ifdef CSTAR_HAVE_IO_URING
+        if (want != io_backend::thread_pool && ring_.setup((unsigned)slots_.size())) {
+            backend_ = io_backend::io_uring;
+            return;
+        }
+#endif
+        (void)want;
+        backend_ = io_backend::thread_pool;
+        if (pool_threads == 0) pool_threads = 1;
+        for (unsigned i = 0; i < pool_threads; ++i) workers_.emplace_back([this] { worker_loop(); });
+    }
+
+    async_io(const async_io&) = delete;
+    async_io& operator=(const async_io&) = delete;
+
+    ~async_io() {
+        drain();
+        if (backend_ == io_backend::thread_pool) {
+            {
+                std::lock_guard<std::mutex> lock(pool_mutex_);
+                stopping_ = true;
+            }
+            work_cv_.notify_all();
+            for (auto& t : workers_) t.join();
+        }
+#ifdef CSTAR_HAVE_IO_URING
+        ring_.teardown();
+#endif
+    }
+
+    io_backend backend() const { return backend_; }
+    unsigned in_flight() const { return in_flight_; }
+
+    // Queue an operation; it is not started until submit() (or a wait).
+    // Returns false with posix_errno set if the descriptor is not open.
+    bool read(int fd, void* buf, size_t len, posix_off_t offset, io_callback cb) {
+        return queue(op_read, fd, buf, len, offset, -1, std::move(cb));
+    }
+    bool write(int fd, const void* buf, size_t len, posix_off_t offset, io_callback cb) {
+        return queue(op_write, fd, const_cast<void*>(buf), len, offset, -1, std::move(cb));
+    }
+
+    // Pin buffers once so the kernel can skip per-I/O page mapping; address
+    // them by index with read_fixed/write_fixed. Replaces any previous set.
+    // Returns 0 or -1 (posix_errno set). Must be called with nothing in flight.
+    int register_buffers(const struct iovec* iov, unsigned count) {
+        if (in_flight_) {
+            posix_errno = EBUSY;
+            return -1;
+        }
+        buffers_.assign(iov, iov + count);
+#ifdef CSTAR_HAVE_IO_URING
+        if (backend_ == io_backend::io_uring) {
+            ring_.enter_register(IORING_UNREGISTER_BUFFERS, nullptr, 0);
+            if (count && ring_.enter_register(IORING_REGISTER_BUFFERS, buffers_.data(), count) < 0) {
+                buffers_.clear();
+                return -1;
+            }
+        }
+#endif
+        posix_errno = 0;
+        return 0;
+    }
+
+    bool read_fixed(int fd, unsigned buf_index, size_t buf_offset, size_t len, posix_off_t offset, io_callback cb) {
+        void* p = fixed_ptr(buf_index, buf_offset, len);
+        return p && queue(op_read, fd, p, len, offset, (int)buf_index, std::move(cb));
+    }
+    bool write_fixed(int fd, unsigned buf_index, size_t buf_offset, size_t len, posix_off_t offset, io_callback cb) {
+        void* p = fixed_ptr(buf_index, buf_offset, len);
+        return p && queue(op_write, fd, p, len, offset, (int)buf_index, std::move(cb));
+    }
+
+    // Start everything queued so far. Returns the number of operations handed over.
+    int submit() {
+#ifdef CSTAR_HAVE_IO_URING
+        if (backend_ == io_backend::io_uring) {
+            if (!ring_.pending) return 0;
+            int n = ring_.submit();
+            if (n < 0) { fail_unsubmitted(); return -1; }
+            return n;
+        }
+#endif
+        if (staged_.empty()) return 0;
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex_);
+            for (unsigned idx : staged_) work_.push_back(idx);
+        }
+        int n = (int)staged_.size();
+        staged_.clear();
+        work_cv_.notify_all();
+        return n;
+    }
+
+    // Run callbacks for operations that already finished, without blocking.
+    int poll() {
+        submit();
+        return reap();
+    }
+
+    // Submit, then block until at least min_complete callbacks have run
+    // (or nothing is left in flight). Returns the number run.
+    int wait(unsigned min_complete = 1) {
+        submit();
+        int done = reap();
+        while ((unsigned)done < min_complete && in_flight_) {
+#ifdef CSTAR_HAVE_IO_URING
+            if (backend_ == io_backend::io_uring) {
+                ring_.wait_cqe();
+                done += reap();
+                continue;
+            }
+#endif
+            {
+                std::unique_lock<std::mutex> lock(pool_mutex_);
+                done_cv_.wait(lock, [&] { return !completed_.empty(); });
+            }
+            done += reap();
+        }
+        return done;
+    }
+
+    // Wait for every queued and in-flight operation.
+    void drain() {
+        while (in_flight_) wait(in_flight_);
+    }
+
+private:
+    enum op_kind : std::uint8_t { op_read, op_write };
+
+    struct op_slot {
+        posix_fd_table::lease file;
+        io_callback cb;
+        void* buf = nullptr;
+        size_t len = 0;
+        posix_off_t offset = 0;
+        ssize_t result = 0;
+        int error = 0;
+        int fixed = -1;
+        op_kind kind = op_read;
+        unsigned next_free = 0;
+    };
+
+    void* fixed_ptr(unsigned index, size_t buf_offset, size_t len) {
+        if (index >= buffers_.size() || buf_offset + len > buffers_[index].iov_len) {
+            posix_errno = EINVAL;
+            return nullptr;
+        }
+        return static_cast<char*>(buffers_[index].iov_base) + buf_offset;
+    }
+
+    bool queue(op_kind kind, int fd, void* buf, size_t len, posix_off_t offset, int fixed, io_callback cb) {
+        if (buf == nullptr) {
+            posix_errno = EIO;
+            return false;
+        }
+        posix_fd_table::lease file = fd_table.acquire_queued(fd);
+        if (!file) return false;
+        // backpressure: every slot busy, so let one finish first
+        while (free_head_ == slots_.size()) wait(1);
+
+        unsigned idx = free_head_;
+        op_slot& s = slots_[idx];
+        free_head_ = s.next_free;
+        s.file = std::move(file);
+        s.cb = std::move(cb);
+        s.buf = buf;
+        s.len = len;
+        s.offset = offset;
+        s.fixed = fixed;
+        s.kind = kind;
+        ++in_flight_;
+#ifdef CSTAR_HAVE_IO_URING
+        if (backend_ == io_backend::io_uring) {
+            io_uring_sqe* sqe = ring_.next_sqe();
+            if (!sqe) {          // SQ full of unsubmitted entries: push them out
+                submit();
+                sqe = ring_.next_sqe();
+            }
+            std::memset(sqe, 0, sizeof(*sqe));
+            if (fixed >= 0) {
+                sqe->opcode = kind == op_read ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+                sqe->buf_index = (std::uint16_t)fixed;
+            } else {
+                sqe->opcode = kind == op_read ? IORING_OP_READ : IORING_OP_WRITE;
+            }
+            sqe->fd = s.file.osfd();
+            sqe->addr = (std::uint64_t)(uintptr_t)buf;
+            sqe->len = (std::uint32_t)(len > 0x7ffff000u ? 0x7ffff000u : len);
+            sqe->off = (std::uint64_t)offset;
+            sqe->user_data = idx;
+            ring_.commit_sqe();
+            return true;
+        }
+#endif
+        staged_.push_back(idx);
+        return true;
+    }
+
+    void finish(unsigned idx, ssize_t result, int error) {
+        op_slot& s = slots_[idx];
+        io_callback cb = std::move(s.cb);
+        s.cb = nullptr;
+        s.file = posix_fd_table::lease();
+        s.next_free = free_head_;
+        free_head_ = idx;
+        --in_flight_;
+        // the slot is free again, so the callback may queue more work
+        if (cb) cb(result, error);
+    }
+
+    int reap() {
+        int n = 0;
+#ifdef CSTAR_HAVE_IO_URING
+        if (backend_ == io_backend::io_uring) {
+            io_uring_cqe cqe;
+            while (ring_.pop_cqe(cqe)) {
+                if (cqe.res < 0) finish((unsigned)cqe.user_data, -1, -cqe.res);
+                else finish((unsigned)cqe.user_data, cqe.res, 0);
+                ++n;
+            }
+            return n;
+        }
+#endif
+        std::deque<unsigned> ready;
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex_);
+            ready.swap(completed_);
+        }
+        for (unsigned idx : ready) {
+            finish(idx, slots_[idx].result, slots_[idx].error);
+            ++n;
+        }
+        return n;
+    }
+
+    void fail_unsubmitted() {
+        // io_uring_enter itself failed; nothing queued will ever complete
+        int err = posix_errno ? posix_errno : EIO;
+#ifdef CSTAR_HAVE_IO_URING
+        while (ring_.pending) finish(ring_.unqueue_sqe(), -1, err);
+#endif
+        (void)err;
+    }
+
+    void worker_loop() {
+        for (;;) {
+            unsigned idx;
+            {
+                std::unique_lock<std::mutex> lock(pool_mutex_);
+                work_cv_.wait(lock, [&] { return stopping_ || !work_.empty(); });
+                if (work_.empty()) return;
+                idx = work_.front();
+                work_.pop_front();
+            }
+            op_slot& s = slots_[idx];
+            int fd_os = s.file.osfd();
+            ssize_t r;
+            if (s.kind == op_read) r = posix_detail::sys_pread(fd_os, s.buf, s.len, s.offset);
+            else r = posix_detail::sys_pwrite(fd_os, s.buf, s.len, s.offset);
+            s.result = r < 0 ? -1 : r;
+            s.error = r < 0 ? errno : 0;
+            {
+                std::lock_guard<std::mutex> lock(pool_mutex_);
+                completed_.push_back(idx);
+            }
+            done_cv_.notify_one();
+        }
+    }
+
+#ifdef CSTAR_HAVE_IO_URING
+    // Minimal io_uring binding: one SQ ring, one CQ ring, raw syscalls.
+    struct uring {
+        int fd = -1;
+        void* sq_ptr = nullptr;
+        void* cq_ptr = nullptr;
+        size_t sq_size = 0, cq_size = 0, sqe_size = 0;
+        unsigned *sq_head = nullptr, *sq_tail = nullptr, *sq_mask = nullptr, *sq_array = nullptr;
+        unsigned *cq_head = nullptr, *cq_tail = nullptr, *cq_mask = nullptr;
+        io_uring_sqe* sqes = nullptr;
+        io_uring_cqe* cqes = nullptr;
+        unsigned sq_entries = 0;
+        unsigned local_tail = 0;   // next SQE slot we fill
+        unsigned pending = 0;      // filled but not yet passed to io_uring_enter
+
+        bool setup(unsigned entries) {
+            io_uring_params p;
+            std::memset(&p, 0, sizeof(p));
+            p.flags = IORING_SETUP_CQSIZE;
+            p.cq_entries = entries * 2;
+            fd = (int)::syscall(__NR_io_uring_setup, entries, &p);
+            if (fd < 0) return false;
+            // IORING_OP_READ/WRITE need 5.6; FAST_POLL (5.7) is the nearest feature bit
+            if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_FAST_POLL)) {
+                ::close(fd);
+                fd = -1;
+                return false;
+            }
+            sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+            if (cq_size > sq_size) sq_size = cq_size;
+            sq_ptr = ::mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (sq_ptr == MAP_FAILED) { sq_ptr = nullptr; teardown(); return false; }
+            cq_ptr = sq_ptr;
+            sqe_size = p.sq_entries * sizeof(io_uring_sqe);
+            void* s = ::mmap(nullptr, sqe_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+            if (s == MAP_FAILED) { teardown(); return false; }
+            sqes = static_cast<io_uring_sqe*>(s);
+
+            char* sq = static_cast<char*>(sq_ptr);
+            sq_head = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+            sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+            sq_mask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+            sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+            char* cq = static_cast<char*>(cq_ptr);
+            cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+            cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+            cq_mask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+            sq_entries = p.sq_entries;
+            local_tail = *sq_tail;
+            return true;
+        }
+
+        void teardown() {
+            if (sqes) ::munmap(sqes, sqe_size);
+            if (sq_ptr) ::munmap(sq_ptr, sq_size);
+            if (fd >= 0) ::close(fd);
+            sqes = nullptr;
+            sq_ptr = cq_ptr = nullptr;
+            fd = -1;
+        }
+
+        io_uring_sqe* next_sqe() {
+            unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+            if (local_tail - head >= sq_entries) return nullptr;
+            return &sqes[local_tail & *sq_mask];
+        }
+
+        void commit_sqe() {
+            sq_array[local_tail & *sq_mask] = local_tail & *sq_mask;
+            ++local_tail;
+            ++pending;
+            __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+        }
+
+        // Take back the most recently filled, never submitted SQE.
+        unsigned unqueue_sqe() {
+            --local_tail;
+            --pending;
+            __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+            return (unsigned)sqes[local_tail & *sq_mask].user_data;
+        }
+
+        int enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+            for (;;) {
+                int r = (int)::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+                if (r >= 0 || errno != EINTR) return r;
+            }
+        }
+
+        int enter_register(unsigned opcode, void* arg, unsigned nr) {
+            int r = (int)::syscall(__NR_io_uring_register, fd, opcode, arg, nr);
+            if (r < 0) posix_errno = errno;
+            return r;
+        }
+
+        int submit() {
+            int total = 0;
+            while (pending) {
+                int r = enter(pending, 0, 0);
+                if (r < 0) {
+                    if (errno == EAGAIN || errno == EBUSY) return total; // retried on the next wait
+                    posix_errno = errno;
+                    return total ? total : -1;
+                }
+                pending -= (unsigned)r;
+                total += r;
+                if (r == 0) break;
+            }
+            return total;
+        }
+
+        void wait_cqe() {
+            if (__atomic_load_n(cq_tail, __ATOMIC_ACQUIRE) != *cq_head) return;
+            int r = enter(pending, 1, IORING_ENTER_GETEVENTS);
+            if (r > 0) pending -= (unsigned)r;
+        }
+
+        bool pop_cqe(io_uring_cqe& out) {
+            unsigned head = *cq_head;
+            if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) return false;
+            out = cqes[head & *cq_mask];
+            __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+            return true;
+        }
+    } ring_;
+#endif
+
+    io_backend backend_ = io_backend::thread_pool;
+    std::vector<op_slot> slots_;
+    unsigned free_head_ = 0;
+    unsigned in_flight_ = 0;
+    std::vector<struct iovec> buffers_;
+
+    // thread-pool backend
+    std::vector<unsigned> staged_;
+    std::deque<unsigned> work_;
+    std::deque<unsigned> completed_;
+    std::mutex pool_mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    std::vector<std::thread> workers_;
+    bool stopping_ = false;
+};
+
+} // namespace cstar
+
+#endif // CSTLIB26_ASYNCIO_H
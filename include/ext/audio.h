@@ -0,0 +1,751 @@
+/*
+audio.h - In-process sound playback for CStar.
+
+cstar::audio::engine mixes up to 64 voices on its own thread and hands
+the result to a sink. Sounds are decoded once, converted to the engine's
+rate and kept in a cache, so playing the same file again costs one
+message to the mixer:
+
+    auto& audio = cstar::audio::default_engine();
+    auto id = audio.play("beep.wav");           // returns at once
+    audio.play("music.wav", 0.5f, true);        // half volume, looping
+    audio.wait(id);                             // until beep.wav has ended
+
+play(), stop() and friends may be called from any thread. They allocate
+a voice slot with one atomic operation and post a command through a
+cstar::channel. The mixer thread never locks or allocates. When it has
+nothing to play and the sink does not need silence (null_sink, an
+unpaced file_sink), it sleeps on the channel until the next command
+instead of waking once per period.
+
+The mixer runs at normal priority. Pass realtime = true to the engine,
+or set CSTAR_AUDIO_REALTIME=1 for default_engine(), to ask for
+SCHED_FIFO on Linux; it is kept only if the process is allowed it.
+
+Sinks:
+  - alsa_sink    libasound.so.2, loaded at run time through plugins(), so
+                 there is no build dependency; Linux default
+  - winmm_sink   waveOut from winmm.dll; Windows default
+  - null_sink    discards audio, keeping real time or not (headless runs)
+  - file_sink    writes a 16-bit stereo WAV file
+
+CSTAR_AUDIO picks a sink: "null", "file:out.wav", "alsa" or "alsa:hw:0".
+When the chosen device cannot be opened, the engine falls back to
+null_sink.
+
+Only WAV is decoded: 8/16/24/32-bit integer or 32/64-bit float PCM, mono
+or stereo (further channels are dropped). latency() reports how long
+play() took to reach the mixer, in microseconds.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_AUDIO_H
+#define CSTLIB26_AUDIO_H 1
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "channel.h"
+#include "plugin.h"
+
+#if defined(_WIN32)
+    #include <mmsystem.h>
+#elif defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+namespace cstar {
+namespace audio {
+
+// Decoded audio: interleaved stereo 16-bit samples at the engine's rate.
+struct sound {
+    std::vector<std::int16_t> samples;
+    std::size_t frames() const noexcept { return samples.size() / 2; }
+};
+
+namespace detail {
+
+inline std::uint32_t le16(const unsigned char* p) { return (std::uint32_t)p[0] | (std::uint32_t)p[1] << 8; }
+inline std::uint32_t le32(const unsigned char* p) { return le16(p) | le16(p + 2) << 16; }
+
+// One sample as a float in [-1, 1).
+inline float pcm_sample(const unsigned char* p, unsigned bits, bool is_float) {
+    if (is_float) {
+        if (bits == 64) {
+            double d;
+            std::memcpy(&d, p, 8);
+            return (float)d;
+        }
+        float f;
+        std::memcpy(&f, p, 4);
+        return f;
+    }
+    switch (bits) {
+    case 8: return ((int)p[0] - 128) / 128.0f;
+    case 16: return (std::int16_t)le16(p) / 32768.0f;
+    case 24: return (std::int32_t)((le16(p) << 8 | (std::uint32_t)p[2] << 24)) / 2147483648.0f;
+    default: return (std::int32_t)le32(p) / 2147483648.0f;
+    }
+}
+
+inline std::int16_t to_pcm16(float x) {
+    float s = x * 32768.0f;
+    if (s >= 32767.0f) return 32767;
+    if (s <= -32768.0f) return -32768;
+    return (std::int16_t)std::lrintf(s);
+}
+
+} // namespace detail
+
+// Decode a WAV file image into out at the given rate. False, with a
+// reason in error, if the data is not a WAV this decoder understands.
+inline bool decode_wav(const unsigned char* data, std::size_t size, unsigned rate, sound& out, std::string& error) {
+    if (size < 12 || std::memcmp(data, "RIFF", 4) != 0 || std::memcmp(data + 8, "WAVE", 4) != 0) {
+        error = "not a WAV file";
+        return false;
+    }
+    unsigned format = 0, channels = 0, src_rate = 0, block = 0, bits = 0;
+    const unsigned char* pcm = nullptr;
+    std::size_t pcm_bytes = 0;
+    for (std::size_t at = 12; at + 8 <= size;) {
+        std::size_t len = detail::le32(data + at + 4);
+        const unsigned char* body = data + at + 8;
+        std::size_t avail = std::min(len, size - at - 8);
+        if (std::memcmp(data + at, "fmt ", 4) == 0 && avail >= 16) {
+            format = detail::le16(body);
+            channels = detail::le16(body + 2);
+            src_rate = detail::le32(body + 4);
+            block = detail::le16(body + 12);
+            bits = detail::le16(body + 14);
+            if (format == 0xFFFE && avail >= 26) format = detail::le16(body + 24); // WAVE_FORMAT_EXTENSIBLE
+        } else if (std::memcmp(data + at, "data", 4) == 0) {
+            pcm = body;
+            pcm_bytes = avail;
+        }
+        at += 8 + len + (len & 1);
+    }
+    bool is_float = format == 3;
+    if (!pcm || !channels || !src_rate || (format != 1 && !is_float) ||
+        (is_float ? bits != 32 && bits != 64 : bits != 8 && bits != 16 && bits != 24 && bits != 32) ||
+        block < channels * bits / 8) {
+        error = "unsupported WAV encoding";
+        return false;
+    }
+
+    std::size_t frames = pcm_bytes / block;
+    std::size_t bytes = bits / 8;
+    auto at = [&](std::size_t f, unsigned c) {
+        return detail::pcm_sample(pcm + f * block + (c < channels ? c : 0) * bytes, bits, is_float);
+    };
+    if (src_rate == rate) {
+        out.samples.resize(frames * 2);
+        for (std::size_t f = 0; f < frames; ++f) {
+            out.samples[2 * f] = detail::to_pcm16(at(f, 0));
+            out.samples[2 * f + 1] = detail::to_pcm16(at(f, 1));
+        }
+        return true;
+    }
+    // linear interpolation to the engine rate
+    std::size_t out_frames = frames ? (std::size_t)((double)(frames - 1) * rate / src_rate) + 1 : 0;
+    out.samples.resize(out_frames * 2);
+    double step = (double)src_rate / rate;
+    for (std::size_t f = 0; f < out_frames; ++f) {
+        double pos = (double)f * step;
+        std::size_t i = (std::size_t)pos;
+        float t = (float)(pos - (double)i);
+        std::size_t j = i + 1 < frames ? i + 1 : i;
+        for (unsigned c = 0; c < 2; ++c) out.samples[2 * f + c] = detail::to_pcm16(at(i, c) + (at(j, c) - at(i, c)) * t);
+    }
+    return true;
+}
+
+inline bool load_wav(const std::string& path, unsigned rate, sound& out, std::string& error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (!decode_wav(bytes.data(), bytes.size(), rate, out, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+// --- sinks -----------------------------------------------------------------
+
+// Where mixed audio goes: interleaved stereo 16-bit frames. Called only
+// from the mixer thread.
+class sink {
+public:
+    virtual ~sink() = default;
+    // False if the device is not available.
+    virtual bool open(unsigned rate, unsigned period) = 0;
+    // Blocks while the device is full. False on an unrecoverable error.
+    virtual bool write(const std::int16_t* frames, unsigned count) = 0;
+    // True if write() takes as long as the audio it is given.
+    virtual bool paced() const = 0;
+    // True if the sink must be fed silence while nothing plays.
+    virtual bool needs_silence() const { return paced(); }
+    // The mixer slept while idle and is about to write again.
+    virtual void resume() {}
+    // Frames written but not yet heard.
+    virtual unsigned buffered() { return 0; }
+    virtual const char* name() const = 0;
+};
+
+class null_sink : public sink {
+public:
+    explicit null_sink(bool paced = true) : paced_(paced) {}
+
+    bool open(unsigned rate, unsigned) override {
+        rate_ = rate;
+        next_ = std::chrono::steady_clock::now();
+        return true;
+    }
+    bool write(const std::int16_t*, unsigned count) override {
+        if (!paced_) return true;
+        next_ += std::chrono::nanoseconds((std::int64_t)count * 1000000000 / rate_);
+        auto now = std::chrono::steady_clock::now();
+        if (next_ < now - std::chrono::milliseconds(100)) next_ = now; // fell far behind: drop the debt
+        std::this_thread::sleep_until(next_);
+        return true;
+    }
+    bool paced() const override { return paced_; }
+    // nobody hears the gap, so the mixer may sleep between sounds
+    bool needs_silence() const override { return false; }
+    void resume() override { next_ = std::chrono::steady_clock::now(); }
+    const char* name() const override { return "null"; }
+
+private:
+    bool paced_;
+    unsigned rate_ = 48000;
+    std::chrono::steady_clock::time_point next_;
+};
+
+// An unpaced file sink skips the silence between sounds.
+class file_sink : public sink {
+public:
+    explicit file_sink(std::string path, bool paced = false) : path_(std::move(path)), clock_(paced) {}
+    ~file_sink() override {
+        if (!f_) return;
+        finish_header();
+        std::fclose(f_);
+    }
+
+    bool open(unsigned rate, unsigned period) override {
+        f_ = std::fopen(path_.c_str(), "wb");
+        if (!f_) return false;
+        rate_ = rate;
+        unsigned char header[44] = {};
+        std::fwrite(header, 1, sizeof header, f_); // filled in on close
+        return clock_.open(rate, period);
+    }
+    bool write(const std::int16_t* frames, unsigned count) override {
+        unsigned char buf[4096];
+        for (unsigned done = 0; done < count;) {
+            unsigned n = std::min(count - done, (unsigned)sizeof buf / 4);
+            for (unsigned i = 0; i < 2 * n; ++i) {
+                std::uint16_t s = (std::uint16_t)frames[2 * done + i];
+                buf[2 * i] = (unsigned char)s;
+                buf[2 * i + 1] = (unsigned char)(s >> 8);
+            }
+            if (std::fwrite(buf, 4, n, f_) != n) return false;
+            done += n;
+        }
+        bytes_ += (std::uint64_t)count * 4;
+        return clock_.write(frames, count);
+    }
+    bool paced() const override { return clock_.paced(); }
+    bool needs_silence() const override { return clock_.paced(); } // the gaps are part of the file
+    const char* name() const override { return "file"; }
+
+private:
+    void finish_header() {
+        auto put32 = [](unsigned char* p, std::uint32_t v) {
+            for (int i = 0; i < 4; ++i) p[i] = (unsigned char)(v >> (8 * i));
+        };
+        std::uint32_t data = (std::uint32_t)std::min<std::uint64_t>(bytes_, 0xFFFFFFFFu - 36);
+        unsigned char h[44];
+        std::memcpy(h, "RIFF", 4);
+        put32(h + 4, 36 + data);
+        std::memcpy(h + 8, "WAVEfmt ", 8);
+        put32(h + 16, 16);
+        put32(h + 20, 1 | 2u << 16);      // PCM, 2 channels
+        put32(h + 24, rate_);
+        put32(h + 28, rate_ * 4);
+        put32(h + 32, 4 | 16u << 16);     // block 4 bytes, 16 bits
+        std::memcpy(h + 36, "data", 4);
+        put32(h + 40, data);
+        std::fseek(f_, 0, SEEK_SET);
+        std::fwrite(h, 1, sizeof h, f_);
+    }
+
+    std::string path_;
+    null_sink clock_;
+    std::FILE* f_ = nullptr;
+    unsigned rate_ = 48000;
+    std::uint64_t bytes_ = 0;
+};
+
+#if !defined(_WIN32)
+
+// ALSA through libasound.so.2, bound at run time.
+class alsa_sink : public sink {
+public:
+    explicit alsa_sink(std::string device = "default", unsigned latency_us = 20000)
+        : device_(std::move(device)), latency_us_(latency_us) {}
+    ~alsa_sink() override {
+        if (!pcm_) return;
+        drain_(pcm_);
+        close_(pcm_);
+    }
+
+    bool open(unsigned rate, unsigned) override {
+        plugin* lib = plugins().load("libasound.so.2");
+        if (!lib) return false;
+        open_ = lib->get<int(void**, const char*, int, int)>("snd_pcm_open");
+        set_params_ = lib->get<int(void*, int, int, unsigned, unsigned, int, unsigned)>("snd_pcm_set_params");
+        writei_ = lib->get<long(void*, const void*, unsigned long)>("snd_pcm_writei");
+        recover_ = lib->get<int(void*, int, int)>("snd_pcm_recover");
+        delay_ = lib->get<int(void*, long*)>("snd_pcm_delay");
+        drain_ = lib->get<int(void*)>("snd_pcm_drain");
+        close_ = lib->get<int(void*)>("snd_pcm_close");
+        if (!open_ || !set_params_ || !writei_ || !recover_ || !delay_ || !drain_ || !close_) return false;
+        if (open_(&pcm_, device_.c_str(), stream_playback, 0) < 0) {
+            pcm_ = nullptr;
+            return false;
+        }
+        if (set_params_(pcm_, format_s16_le, access_rw_interleaved, 2, rate, 1, latency_us_) < 0) {
+            close_(pcm_);
+            pcm_ = nullptr;
+            return false;
+        }
+        return true;
+    }
+    bool write(const std::int16_t* frames, unsigned count) override {
+        while (count) {
+            long n = writei_(pcm_, frames, count);
+            if (n < 0) {
+                if (recover_(pcm_, (int)n, 1) < 0) return false; // underrun or suspend: re-prepare
+                continue;
+            }
+            frames += 2 * n;
+            count -= (unsigned)n;
+        }
+        return true;
+    }
+    bool paced() const override { return true; }
+    unsigned buffered() override {
+        long d = 0;
+        return delay_(pcm_, &d) == 0 && d > 0 ? (unsigned)d : 0;
+    }
+    const char* name() const override { return "alsa"; }
+
+private:
+    // values from <alsa/pcm.h>
+    static constexpr int stream_playback = 0, format_s16_le = 2, access_rw_interleaved = 3;
+
+    std::string device_;
+    unsigned latency_us_;
+    void* pcm_ = nullptr;
+    int (*open_)(void**, const char*, int, int) = nullptr;
+    int (*set_params_)(void*, int, int, unsigned, unsigned, int, unsigned) = nullptr;
+    long (*writei_)(void*, const void*, unsigned long) = nullptr;
+    int (*recover_)(void*, int, int) = nullptr;
+    int (*delay_)(void*, long*) = nullptr;
+    int (*drain_)(void*) = nullptr;
+    int (*close_)(void*) = nullptr;
+};
+
+#else
+
+// waveOut from winmm.dll, bound at run time, with four period buffers in
+// flight.
+class winmm_sink : public sink {
+public:
+    ~winmm_sink() override {
+        if (!out_) return;
+        reset_(out_);
+        for (auto& b : bufs_) unprepare_(out_, &b.hdr, sizeof(WAVEHDR));
+        close_(out_);
+        CloseHandle(event_);
+    }
+
+    bool open(unsigned rate, unsigned period) override {
+        plugin* lib = plugins().load("winmm.dll");
+        if (!lib) return false;
+        open_ = reinterpret_cast<decltype(open_)>(lib->symbol("waveOutOpen"));
+        prepare_ = reinterpret_cast<decltype(prepare_)>(lib->symbol("waveOutPrepareHeader"));
+        write_ = reinterpret_cast<decltype(write_)>(lib->symbol("waveOutWrite"));
+        unprepare_ = reinterpret_cast<decltype(unprepare_)>(lib->symbol("waveOutUnprepareHeader"));
+        reset_ = reinterpret_cast<decltype(reset_)>(lib->symbol("waveOutReset"));
+        close_ = reinterpret_cast<decltype(close_)>(lib->symbol("waveOutClose"));
+        if (!open_ || !prepare_ || !write_ || !unprepare_ || !reset_ || !close_) return false;
+
+        event_ = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+        WAVEFORMATEX fmt{};
+        fmt.wFormatTag = WAVE_FORMAT_PCM;
+        fmt.nChannels = 2;
+        fmt.nSamplesPerSec = rate;
+        fmt.wBitsPerSample = 16;
+        fmt.nBlockAlign = 4;
+        fmt.nAvgBytesPerSec = rate * 4;
+        if (open_(&out_, WAVE_MAPPER, &fmt, (DWORD_PTR)event_, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR) {
+            out_ = nullptr;
+            CloseHandle(event_);
+            return false;
+        }
+        for (auto& b : bufs_) {
+            b.pcm.assign((std::size_t)period * 2, 0);
+            b.hdr = WAVEHDR{};
+            b.hdr.lpData = reinterpret_cast<LPSTR>(b.pcm.data());
+            b.hdr.dwBufferLength = period * 4;
+            prepare_(out_, &b.hdr, sizeof(WAVEHDR));
+        }
+        return true;
+    }
+    bool write(const std::int16_t* frames, unsigned count) override {
+        buffer& b = bufs_[next_];
+        while (b.queued && !(((volatile DWORD&)b.hdr.dwFlags) & WHDR_DONE)) WaitForSingleObject(event_, INFINITE);
+        count = std::min<unsigned>(count, (unsigned)b.pcm.size() / 2);
+        std::memcpy(b.pcm.data(), frames, (std::size_t)count * 4);
+        b.hdr.dwBufferLength = count * 4;
+        b.queued = true;
+        next_ = (next_ + 1) % 4;
+        return write_(out_, &b.hdr, sizeof(WAVEHDR)) == MMSYSERR_NOERROR;
+    }
+    bool paced() const override { return true; }
+    const char* name() const override { return "winmm"; }
+
+private:
+    struct buffer {
+        std::vector<std::int16_t> pcm;
+        WAVEHDR hdr{};
+        bool queued = false;
+    };
+
+    HWAVEOUT out_ = nullptr;
+    HANDLE event_ = nullptr;
+    buffer bufs_[4];
+    unsigned next_ = 0;
+    MMRESULT(WINAPI* open_)(LPHWAVEOUT, UINT, LPCWAVEFORMATEX, DWORD_PTR, DWORD_PTR, DWORD) = nullptr;
+    MMRESULT(WINAPI* prepare_)(HWAVEOUT, LPWAVEHDR, UINT) = nullptr;
+    MMRESULT(WINAPI* write_)(HWAVEOUT, LPWAVEHDR, UINT) = nullptr;
+    MMRESULT(WINAPI* unprepare_)(HWAVEOUT, LPWAVEHDR, UINT) = nullptr;
+    MMRESULT(WINAPI* reset_)(HWAVEOUT) = nullptr;
+    MMRESULT(WINAPI* close_)(HWAVEOUT) = nullptr;
+};
+
+#endif
+
+// The sink named by CSTAR_AUDIO, else the platform's device.
+inline std::unique_ptr<sink> default_sink() {
+    std::string want;
+    if (const char* env = std::getenv("CSTAR_AUDIO")) want = env;
+    if (want == "null") return std::make_unique<null_sink>();
+    if (want.rfind("file:", 0) == 0) return std::make_unique<file_sink>(want.substr(5));
+#if defined(_WIN32)
+    return std::make_unique<winmm_sink>();
+#else
+    if (want.rfind("alsa:", 0) == 0) return std::make_unique<alsa_sink>(want.substr(5));
+    return std::make_unique<alsa_sink>();
+#endif
+}
+
+// --- engine ----------------------------------------------------------------
+
+// play() to mixer, in microseconds, over the most recent voices.
+struct latency_report {
+    std::uint64_t count = 0;
+    double mean_us = 0, p50_us = 0, p99_us = 0, max_us = 0;
+    double output_us = 0; // what the sink still holds before it is heard
+};
+
+class engine {
+public:
+    static constexpr unsigned max_voices = 64;
+    // 0 means no voice (the sound could not be loaded or all voices are busy).
+    using voice_id = std::uint64_t;
+
+    // realtime asks for SCHED_FIFO on the mixer thread (Linux only).
+    explicit engine(std::unique_ptr<sink> out = default_sink(), unsigned rate = 48000, unsigned period = 256,
+                    bool realtime = false)
+        : out_(std::move(out)), rate_(rate), period_(period ? period : 256), commands_(256) {
+        if (!out_ || !out_->open(rate_, period_)) {
+            out_ = std::make_unique<null_sink>();
+            out_->open(rate_, period_);
+        }
+        mixer_ = std::thread([this, realtime] { mix_loop(realtime); });
+    }
+
+    engine(const engine&) = delete;
+    engine& operator=(const engine&) = delete;
+
+    ~engine() {
+        quit_.store(true, std::memory_order_release);
+        commands_.close();
+        mixer_.join();
+    }
+
+    unsigned rate() const noexcept { return rate_; }
+    unsigned period() const noexcept { return period_; }
+    const char* sink_name() const noexcept { return out_->name(); }
+
+    // Decode path once and keep it. nullptr on failure (see last_error()).
+    const sound* load(const std::string& path) {
+        std::lock_guard<std::mutex> hold(cache_mutex_);
+        auto it = cache_.find(path);
+        if (it != cache_.end()) return it->second.get();
+        auto s = std::make_unique<sound>();
+        std::string error;
+        if (!load_wav(path, rate_, *s, error)) {
+            error_ = error;
+            return nullptr;
+        }
+        return cache_.emplace(path, std::move(s)).first->second.get();
+    }
+
+    std::string last_error() const {
+        std::lock_guard<std::mutex> hold(cache_mutex_);
+        return error_;
+    }
+
+    voice_id play(const std::string& path, float gain = 1.0f, bool loop = false) {
+        const sound* s = load(path);
+        return s ? play(s, gain, loop) : 0;
+    }
+
+    // s must stay alive while it plays; sounds from load() always do.
+    voice_id play(const sound* s, float gain = 1.0f, bool loop = false) {
+        if (!s || !s->frames()) return 0;
+        std::uint64_t busy = busy_.load(std::memory_order_relaxed);
+        unsigned slot;
+        do {
+            if (busy == ~0ull) return 0;
+            slot = (unsigned)__builtin_ctzll(~busy);
+        } while (!busy_.compare_exchange_weak(busy, busy | 1ull << slot, std::memory_order_acquire,
+                                              std::memory_order_relaxed));
+        std::uint32_t gen = gens_[slot].load(std::memory_order_relaxed);
+        command c{command::start, (std::uint8_t)slot, loop, gain, gen, s, now_ns()};
+        if (!commands_.try_send(c)) {
+            busy_.fetch_and(~(1ull << slot), std::memory_order_release);
+            return 0;
+        }
+        return (std::uint64_t)gen << 32 | (slot + 1);
+    }
+
+    void stop(voice_id id) {
+        if (!id) return;
+        commands_.send(command{command::stop, (std::uint8_t)((id & 0xFFFFFFFFu) - 1), false, 0, (std::uint32_t)(id >> 32)});
+    }
+    void stop_all() { commands_.send(command{command::stop_all}); }
+    void set_gain(float master) { commands_.send(command{command::master, 0, false, master}); }
+
+    // True until the voice ends or is stopped.
+    bool playing(voice_id id) const {
+        if (!id || (id & 0xFFFFFFFFu) > max_voices) return false;
+        return gens_[(id & 0xFFFFFFFFu) - 1].load(std::memory_order_acquire) == (std::uint32_t)(id >> 32);
+    }
+
+    // Block until the voice ends (never, for a looping voice left playing).
+    void wait(voice_id id) const {
+        if (!id || (id & 0xFFFFFFFFu) > max_voices) return;
+        const std::atomic<std::uint32_t>& g = gens_[(id & 0xFFFFFFFFu) - 1];
+        std::uint32_t gen = (std::uint32_t)(id >> 32);
+        while (g.load(std::memory_order_acquire) == gen) g.wait(gen, std::memory_order_acquire);
+    }
+
+    std::uint64_t frames_mixed() const noexcept { return frames_mixed_.load(std::memory_order_relaxed); }
+
+    latency_report latency() const {
+        latency_report r;
+        r.count = lat_count_.load(std::memory_order_acquire);
+        std::size_t n = (std::size_t)std::min<std::uint64_t>(r.count, lat_slots);
+        r.output_us = out_frames_.load(std::memory_order_relaxed) * 1e6 / rate_;
+        if (!n) return r;
+        std::vector<std::uint32_t> v(n);
+        for (std::size_t i = 0; i < n; ++i) v[i] = lat_[i].load(std::memory_order_relaxed);
+        std::sort(v.begin(), v.end());
+        double sum = 0;
+        for (std::uint32_t x : v) sum += x;
+        r.mean_us = sum / (double)n / 1e3;
+        r.p50_us = v[n / 2] / 1e3;
+        r.p99_us = v[std::min(n - 1, n * 99 / 100)] / 1e3;
+        r.max_us = v.back() / 1e3;
+        return r;
+    }
+
+private:
+    struct command {
+        enum kind : std::uint8_t { start, stop, stop_all, master };
+        kind what = start;
+        std::uint8_t slot = 0;
+        bool loop = false;
+        float gain = 1.0f;
+        std::uint32_t gen = 0;
+        const sound* s = nullptr;
+        std::int64_t sent_ns = 0;
+    };
+
+    struct voice {
+        const sound* s = nullptr;
+        std::size_t pos = 0; // frames
+        float gain = 1.0f;
+        bool loop = false;
+    };
+
+    static std::int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void apply(const command& c) {
+        switch (c.what) {
+        case command::start: {
+            voices_[c.slot] = voice{c.s, 0, c.gain, c.loop};
+            ++active_;
+            std::int64_t d = now_ns() - c.sent_ns;
+            std::uint64_t k = lat_count_.load(std::memory_order_relaxed);
+            lat_[k % lat_slots].store((std::uint32_t)std::min<std::int64_t>(d, 0xFFFFFFFF), std::memory_order_relaxed);
+            lat_count_.store(k + 1, std::memory_order_release);
+            break;
+        }
+        case command::stop:
+            if (voices_[c.slot].s && gens_[c.slot].load(std::memory_order_relaxed) == c.gen) finish(c.slot);
+            break;
+        case command::stop_all:
+            for (unsigned i = 0; i < max_voices; ++i)
+                if (voices_[i].s) finish(i);
+            break;
+        case command::master:
+            master_ = c.gain;
+            break;
+        }
+    }
+
+    void finish(unsigned slot) {
+        voices_[slot].s = nullptr;
+        --active_;
+        gens_[slot].fetch_add(1, std::memory_order_release);
+        gens_[slot].notify_all();
+        busy_.fetch_and(~(1ull << slot), std::memory_order_release);
+    }
+
+    void mix(float* acc, unsigned frames) {
+        std::fill(acc, acc + 2 * frames, 0.0f);
+        for (unsigned v = 0; v < max_voices && active_; ++v) {
+            voice& vc = voices_[v];
+            if (!vc.s) continue;
+            const std::int16_t* src = vc.s->samples.data();
+            std::size_t len = vc.s->frames();
+            float g = vc.gain * (1.0f / 32768.0f);
+            for (unsigned done = 0; done < frames;) {
+                unsigned n = (unsigned)std::min<std::size_t>(frames - done, len - vc.pos);
+                const std::int16_t* p = src + 2 * vc.pos;
+                float* a = acc + 2 * done;
+                for (unsigned i = 0; i < 2 * n; ++i) a[i] += (float)p[i] * g;
+                done += n;
+                vc.pos += n;
+                if (vc.pos < len) continue;
+                if (!vc.loop) {
+                    finish(v);
+                    break;
+                }
+                vc.pos = 0;
+            }
+        }
+    }
+
+    void mix_loop(bool realtime) {
+#if defined(__linux__)
+        // real-time priority when asked and the process is allowed it; fine without
+        if (realtime) {
+            sched_param sp{};
+            sp.sched_priority = 10;
+            pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+        }
+#else
+        (void)realtime;
+#endif
+        std::vector<float> acc((std::size_t)period_ * 2);
+        std::vector<std::int16_t> pcm((std::size_t)period_ * 2);
+        command c;
+        for (;;) {
+            if (!active_ && !out_->needs_silence()) {
+                // nothing to play and no device to keep fed: sleep until told
+                if (!commands_.recv(c)) break;
+                apply(c);
+                out_->resume();
+            }
+            while (commands_.try_recv(c)) apply(c);
+            if (quit_.load(std::memory_order_acquire)) break;
+
+            mix(acc.data(), period_);
+            float m = master_;
+            for (std::size_t i = 0; i < acc.size(); ++i) pcm[i] = detail::to_pcm16(acc[i] * m);
+            if (!out_->write(pcm.data(), period_)) {
+                // device gone: keep time without it so callers still see voices end
+                out_ = std::make_unique<null_sink>();
+                out_->open(rate_, period_);
+            }
+            frames_mixed_.fetch_add(period_, std::memory_order_relaxed);
+            out_frames_.store(out_->buffered(), std::memory_order_relaxed);
+        }
+        for (unsigned i = 0; i < max_voices; ++i)
+            if (voices_[i].s) finish(i);
+    }
+
+    static constexpr std::size_t lat_slots = 4096;
+
+    std::unique_ptr<sink> out_;
+    unsigned rate_, period_;
+    channel<command> commands_;
+    std::atomic<std::uint64_t> busy_{0};
+    std::atomic<std::uint32_t> gens_[max_voices] = {};
+    std::atomic<bool> quit_{false};
+    std::atomic<std::uint64_t> frames_mixed_{0};
+    std::atomic<unsigned> out_frames_{0};
+    std::atomic<std::uint64_t> lat_count_{0};
+    std::atomic<std::uint32_t> lat_[lat_slots] = {};
+
+    // mixer thread only
+    voice voices_[max_voices];
+    unsigned active_ = 0;
+    float master_ = 1.0f;
+
+    mutable std::mutex cache_mutex_;
+    std::unordered_map<std::string, std::unique_ptr<sound>> cache_;
+    std::string error_;
+
+    std::thread mixer_;
+};
+
+// Process-wide engine on default_sink(), started on first use.
+inline engine& default_engine() {
+    static engine e(default_sink(), 48000, 256, [] {
+        const char* rt = std::getenv("CSTAR_AUDIO_REALTIME");
+        return rt && *rt && std::strcmp(rt, "0") != 0;
+    }());
+    return e;
+}
+
+} // namespace audio
+} // namespace cstar
+
+#endif // CSTLIB26_AUDIO_H
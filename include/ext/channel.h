@@ -0,0 +1,533 @@
+/*
+channel.h - Bounded channels between CStar threads.
+
+cstar::spsc_channel<T> is a ring buffer for exactly one sending and one
+receiving thread. Each side owns its index and keeps a cached copy of
+the other's, so a send or receive touches shared cache lines only when
+the cached view runs out.
+
+cstar::channel<T> takes any number of senders and receivers (Vyukov's
+bounded MPMC queue: every slot carries a sequence number, and claiming
+a slot is one compare-and-swap on the head or tail).
+
+    cstar::channel<Job> jobs(1024);
+    std::thread worker([&] {
+        Job j;
+        while (jobs.recv(j)) run(j);      // false once closed and drained
+    });
+    jobs.send(Job{...});                  // waits while the channel is full
+    jobs.close();
+
+try_send / try_recv never wait. send / recv spin briefly, then sleep on a
+futex until the other side makes progress or the channel is closed.
+select waits on several channels at once and runs the case that becomes
+ready first:
+
+    cstar::select(cstar::on_recv(numbers, [](int n) { ... }),
+                  cstar::on_recv(names, [](std::string s) { ... }),
+                  cstar::on_send(out, value, [] { ... }));
+
+A sleeper announces itself with a flag that the other side reads after
+every operation. On Linux the two sides are ordered by an
+asymmetric barrier: the sleeper issues membarrier(2), so the hot path
+needs no fence of its own.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_CHANNEL_H
+#define CSTLIB26_CHANNEL_H 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <tuple>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "sync.h"
+
+#if defined(__linux__)
+    #include <linux/membarrier.h>
+#endif
+
+namespace cstar {
+
+namespace detail {
+
+// 0: not set up yet, 1: membarrier registered, 2: plain fences
+inline std::atomic<int> barrier_mode{0};
+
+inline int setup_barrier() noexcept {
+    int mode = 2;
+#if defined(__linux__) && defined(SYS_membarrier)
+    if (syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0) mode = 1;
+#endif
+    barrier_mode.store(mode, std::memory_order_relaxed);
+    return mode;
+}
+
+// Fast side of a store-then-load handshake with a sleeper.
+inline void light_barrier() noexcept {
+    if (barrier_mode.load(std::memory_order_relaxed) == 1)
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    else
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+// Slow side: a full fence on every running thread of the process.
+inline void heavy_barrier() noexcept {
+    int mode = barrier_mode.load(std::memory_order_relaxed);
+    if (mode == 0) mode = setup_barrier();
+#if defined(__linux__) && defined(SYS_membarrier)
+    if (mode == 1 && syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0) == 0) return;
+#endif
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+// The low bit of an epoch word means "someone is asleep on it". Waking
+// clears the bit and advances the epoch in one step, so only the first
+// notify after a thread goes to sleep makes a system call, and a sleeper
+// that read the word before the wake cannot sleep through it.
+inline bool epoch_wake(std::atomic<std::uint32_t>& word, bool all) noexcept {
+    std::uint32_t e = word.load(std::memory_order_relaxed);
+    do {
+        if (!(e & 1)) return false;
+    } while (!word.compare_exchange_weak(e, e + 1, std::memory_order_release, std::memory_order_relaxed));
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE_PRIVATE, all ? INT32_MAX : 1, nullptr,
+            nullptr, 0);
+#else
+    if (all) word.notify_all();
+    else word.notify_one();
+#endif
+    return true;
+}
+
+// Announce a sleeper; the value to pass to futex_wait afterwards.
+inline std::uint32_t epoch_announce(std::atomic<std::uint32_t>& word) noexcept {
+    return word.fetch_or(1, std::memory_order_relaxed) | 1;
+}
+
+// A thread blocked in select. Every channel it watches signals it.
+struct select_waiter {
+    std::atomic<std::uint32_t> word{0};
+    void signal() noexcept { epoch_wake(word, false); }
+};
+
+// Threads waiting for one kind of progress (data to receive, or room to
+// send) on one channel.
+class wait_queue {
+public:
+    // Registering early lets the fast side skip its fence from the start.
+    wait_queue() noexcept {
+        if (barrier_mode.load(std::memory_order_relaxed) == 0) setup_barrier();
+    }
+
+    // After making progress. Cheap unless someone is asleep.
+    void notify() noexcept {
+        light_barrier();
+        if ((epoch_.load(std::memory_order_relaxed) & 1) | selectors_.load(std::memory_order_relaxed))
+            notify_slow();
+    }
+
+    // On close. Sleepers are all woken whenever the bit is cleared, since
+    // each of them relies on it.
+    void notify_all() noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        notify_slow();
+    }
+
+    // Sleep until notified, unless ready() turns true after announcing.
+    template <typename Ready>
+    void wait(Ready ready) noexcept {
+        std::uint32_t seen = epoch_announce(epoch_);
+        heavy_barrier();
+        if (!ready()) futex_wait(epoch_, seen);
+    }
+
+    void watch(select_waiter* w) {
+        lock();
+        list_.push_back(w);
+        unlock();
+        selectors_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void unwatch(select_waiter* w) noexcept {
+        lock();
+        for (std::size_t i = 0; i < list_.size(); ++i)
+            if (list_[i] == w) {
+                list_[i] = list_.back();
+                list_.pop_back();
+                break;
+            }
+        unlock();
+        selectors_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+private:
+    void notify_slow() noexcept {
+        epoch_wake(epoch_, true);
+        if (selectors_.load(std::memory_order_relaxed)) {
+            lock();
+            for (select_waiter* w : list_) w->signal();
+            unlock();
+        }
+    }
+
+    void lock() noexcept {
+        while (busy_.exchange(true, std::memory_order_acquire))
+            while (busy_.load(std::memory_order_relaxed)) std::this_thread::yield();
+    }
+    void unlock() noexcept { busy_.store(false, std::memory_order_release); }
+
+    std::atomic<std::uint32_t> epoch_{0};
+    std::atomic<std::uint32_t> selectors_{0};
+    std::atomic<bool> busy_{false};
+    std::vector<select_waiter*> list_;
+};
+
+inline std::size_t channel_capacity(std::size_t want) {
+    std::size_t cap = 2;
+    while (cap < want) cap <<= 1;
+    return cap;
+}
+
+// Spin (on multicore machines), then sleep on q, until attempt() succeeds
+// or the channel closes. ready() tells, without side effects, whether
+// attempt() could succeed now. A receive still drains what was sent
+// before close; a send gives up at once.
+template <typename Attempt, typename Ready, typename Closed>
+bool block_on(wait_queue& q, Attempt attempt, Ready ready, Closed closed, bool draining) {
+    for (unsigned spin = 0;; ++spin) {
+        if (attempt()) return true;
+        if (closed()) return draining && attempt();
+        if (spin < max_spin()) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+            continue;
+        }
+        q.wait([&] { return ready() || closed(); });
+    }
+}
+
+} // namespace detail
+
+template <typename T>
+class spsc_channel {
+public:
+    using value_type = T;
+
+    explicit spsc_channel(std::size_t capacity)
+        : mask_(detail::channel_capacity(capacity) - 1), slots_(new slot[mask_ + 1]) {}
+
+    ~spsc_channel() {
+        for (std::size_t h = head_.load(std::memory_order_relaxed); h != tail_.load(std::memory_order_relaxed); ++h)
+            slots_[h & mask_].get()->~T();
+    }
+
+    spsc_channel(const spsc_channel&) = delete;
+    spsc_channel& operator=(const spsc_channel&) = delete;
+
+    std::size_t capacity() const noexcept { return mask_ + 1; }
+
+    template <typename U = T>
+    bool try_send(U&& value) {
+        std::size_t t = tail_.load(std::memory_order_relaxed);
+        if (t - head_cache_ > mask_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (t - head_cache_ > mask_) return false;
+        }
+        ::new (slots_[t & mask_].bytes) T(std::forward<U>(value));
+        tail_.store(t + 1, std::memory_order_release);
+        readable_.notify();
+        return true;
+    }
+
+    bool try_recv(T& out) {
+        std::size_t h = head_.load(std::memory_order_relaxed);
+        if (h == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (h == tail_cache_) return false;
+        }
+        T* p = slots_[h & mask_].get();
+        out = std::move(*p);
+        p->~T();
+        head_.store(h + 1, std::memory_order_release);
+        writable_.notify();
+        return true;
+    }
+
+    // Waits for room. False if the channel is closed (value is dropped).
+    template <typename U = T>
+    bool send(U&& value) {
+        if (closed()) return false;
+        return detail::block_on(
+            writable_, [&] { return try_send(std::forward<U>(value)); }, [&] { return writable(); },
+            [&] { return closed(); }, false);
+    }
+
+    // Waits for a value. False once the channel is closed and empty.
+    bool recv(T& out) {
+        return detail::block_on(
+            readable_, [&] { return try_recv(out); }, [&] { return readable(); }, [&] { return closed(); }, true);
+    }
+
+    std::optional<T> recv() {
+        T out;
+        if (recv(out)) return out;
+        return std::nullopt;
+    }
+
+    void close() noexcept {
+        closed_.store(true, std::memory_order_release);
+        readable_.notify_all();
+        writable_.notify_all();
+    }
+    bool closed() const noexcept { return closed_.load(std::memory_order_acquire); }
+
+    // For select.
+    bool readable() const noexcept { return head_.load(std::memory_order_relaxed) != tail_.load(std::memory_order_acquire); }
+    bool writable() const noexcept { return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_acquire) <= mask_; }
+    detail::wait_queue& readers() noexcept { return readable_; }
+    detail::wait_queue& writers() noexcept { return writable_; }
+
+private:
+    struct slot {
+        alignas(T) unsigned char bytes[sizeof(T)];
+        T* get() noexcept { return std::launder(reinterpret_cast<T*>(bytes)); }
+    };
+
+    const std::size_t mask_;
+    std::unique_ptr<slot[]> slots_;
+    std::atomic<bool> closed_{false};
+    // consumer's line
+    alignas(64) std::atomic<std::size_t> head_{0};
+    std::size_t tail_cache_ = 0;
+    // producer's line
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    std::size_t head_cache_ = 0;
+    alignas(64) detail::wait_queue readable_;
+    alignas(64) detail::wait_queue writable_;
+};
+
+template <typename T>
+class channel {
+public:
+    using value_type = T;
+
+    explicit channel(std::size_t capacity)
+        : mask_(detail::channel_capacity(capacity) - 1), cells_(new cell[mask_ + 1]) {
+        for (std::size_t i = 0; i <= mask_; ++i) cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    ~channel() {
+        for (std::size_t p = head_.load(std::memory_order_relaxed); p != tail_.load(std::memory_order_relaxed); ++p)
+            cells_[p & mask_].get()->~T();
+    }
+
+    channel(const channel&) = delete;
+    channel& operator=(const channel&) = delete;
+
+    std::size_t capacity() const noexcept { return mask_ + 1; }
+
+    template <typename U = T>
+    bool try_send(U&& value) {
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell& c = cells_[pos & mask_];
+            std::size_t seq = c.seq.load(std::memory_order_acquire);
+            std::intptr_t diff = (std::intptr_t)seq - (std::intptr_t)pos;
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    ::new (c.bytes) T(std::forward<U>(value));
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    readable_.notify();
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_recv(T& out) {
+        if (!try_take(out)) return false;
+        writable_.notify();
+        return true;
+    }
+
+    template <typename U = T>
+    bool send(U&& value) {
+        if (closed()) return false;
+        return detail::block_on(
+            writable_, [&] { return try_send(std::forward<U>(value)); }, [&] { return writable(); },
+            [&] { return closed(); }, false);
+    }
+
+    bool recv(T& out) {
+        return detail::block_on(
+            readable_, [&] { return try_recv(out); }, [&] { return readable(); }, [&] { return closed(); }, true);
+    }
+
+    std::optional<T> recv() {
+        T out;
+        if (recv(out)) return out;
+        return std::nullopt;
+    }
+
+    void close() noexcept {
+        closed_.store(true, std::memory_order_release);
+        readable_.notify_all();
+        writable_.notify_all();
+    }
+    bool closed() const noexcept { return closed_.load(std::memory_order_acquire); }
+
+    bool readable() const noexcept {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        return cells_[pos & mask_].seq.load(std::memory_order_acquire) == pos + 1;
+    }
+    bool writable() const noexcept {
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        return cells_[pos & mask_].seq.load(std::memory_order_acquire) == pos;
+    }
+    detail::wait_queue& readers() noexcept { return readable_; }
+    detail::wait_queue& writers() noexcept { return writable_; }
+
+private:
+    struct cell {
+        std::atomic<std::size_t> seq;
+        alignas(T) unsigned char bytes[sizeof(T)];
+        T* get() noexcept { return std::launder(reinterpret_cast<T*>(bytes)); }
+    };
+
+    bool try_take(T& out) {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell& c = cells_[pos & mask_];
+            std::size_t seq = c.seq.load(std::memory_order_acquire);
+            std::intptr_t diff = (std::intptr_t)seq - (std::intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    T* p = c.get();
+                    out = std::move(*p);
+                    p->~T();
+                    c.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    const std::size_t mask_;
+    std::unique_ptr<cell[]> cells_;
+    std::atomic<bool> closed_{false};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) detail::wait_queue readable_;
+    alignas(64) detail::wait_queue writable_;
+};
+
+// select cases. on_recv(ch, f) calls f(value) with a received value;
+// on_send(ch, value, f) sends value and then calls f().
+template <typename Channel, typename F>
+struct recv_case {
+    Channel& ch;
+    F f;
+    bool try_fire() {
+        typename Channel::value_type v;
+        if (!ch.try_recv(v)) return false;
+        f(std::move(v));
+        return true;
+    }
+    bool done() const { return ch.closed() && !ch.readable(); }
+    bool ready() const { return ch.readable() || ch.closed(); }
+    detail::wait_queue& queue() { return ch.readers(); }
+};
+
+template <typename Channel, typename T, typename F>
+struct send_case {
+    Channel& ch;
+    T value;
+    F f;
+    bool try_fire() {
+        if (ch.closed() || !ch.try_send(std::move(value))) return false;
+        f();
+        return true;
+    }
+    bool done() const { return ch.closed(); }
+    bool ready() const { return ch.writable() || ch.closed(); }
+    detail::wait_queue& queue() { return ch.writers(); }
+};
+
+template <typename Channel, typename F>
+recv_case<Channel, F> on_recv(Channel& ch, F f) {
+    return {ch, std::move(f)};
+}
+
+template <typename Channel, typename T, typename F>
+send_case<Channel, std::decay_t<T>, F> on_send(Channel& ch, T&& value, F f) {
+    return {ch, std::forward<T>(value), std::move(f)};
+}
+
+inline constexpr std::size_t select_closed = (std::size_t)-1;
+
+namespace detail {
+
+inline thread_local unsigned select_rotor = 0;
+
+template <typename... Cases, std::size_t... I>
+std::size_t select_once(std::tuple<Cases&...>& cases, std::index_sequence<I...>) {
+    // start at a rotating case so one busy channel cannot starve the rest
+    constexpr std::size_t n = sizeof...(Cases);
+    std::size_t start = select_rotor++ % n, fired = select_closed;
+    for (std::size_t k = 0; k < n && fired == select_closed; ++k) {
+        std::size_t i = (start + k) % n;
+        ((i == I && fired == select_closed && std::get<I>(cases).try_fire() ? (void)(fired = I) : (void)0), ...);
+    }
+    return fired;
+}
+
+} // namespace detail
+
+// Like select, but returns immediately: select_closed if no case can proceed now.
+template <typename... Cases>
+std::size_t try_select(Cases&&... cases) {
+    std::tuple<Cases&...> all(cases...);
+    return detail::select_once(all, std::index_sequence_for<Cases...>{});
+}
+
+// Run the first case that can proceed, waiting until one can. Returns its
+// index, or select_closed when every case's channel is closed (and, for
+// receives, drained).
+template <typename... Cases>
+std::size_t select(Cases&&... cases) {
+    static_assert(sizeof...(Cases) > 0, "select needs at least one case");
+    std::tuple<Cases&...> all(cases...);
+    detail::select_waiter waiter;
+    for (;;) {
+        std::size_t fired = detail::select_once(all, std::index_sequence_for<Cases...>{});
+        if (fired != select_closed) return fired;
+        if ((cases.done() && ...)) return select_closed;
+
+        (cases.queue().watch(&waiter), ...);
+        std::uint32_t seen = detail::epoch_announce(waiter.word);
+        detail::heavy_barrier();
+        if (!(cases.ready() || ...)) detail::futex_wait(waiter.word, seen);
+        (cases.queue().unwatch(&waiter), ...);
+    }
+}
+
+} // namespace cstar
+
+#endif // CSTLIB26_CHANNEL_H
@@ -0,0 +1,446 @@
+/*
+coro.h - async/await for CStar.
+
+The compiler lowers
+
+    async returnf int fetch(int id) {
+        await cstar::sleep_for(100);
+        return id * 2;
+    }
+
+to a C++20 coroutine returning cstar::task<int>: `await` becomes
+co_await and `return` becomes co_return. A task does not start until
+it is awaited, spawned or run:
+
+    int v = cstar::run(fetch(21));        // drive the executor until done
+    cstar::spawn(fetch(1));               // fire and forget
+    cstar::run();                         // until every spawned task ends
+
+Tasks run on a cstar::executor: a queue of ready coroutines on one
+thread, driven together with an event_loop (eventloop.h), which supplies
+timers and, on Linux, epoll readiness for descriptors. The default
+executor uses cstar::default_loop(), so Delay::after callbacks and tasks
+share one thread. What a task can wait for:
+
+    await cstar::yield();                 // let other ready tasks run
+    await cstar::sleep_for(ms);           // timer wheel, 1 ms ticks
+    await cstar::readable(fd);            // epoll; also writable(fd)
+    ssize_t n = await cstar::async_read(fd, buf, len);
+    ssize_t n = await cstar::async_write(fd, buf, len);
+
+async_read/async_write switch the descriptor to non-blocking mode and
+wait for readiness on EAGAIN. Regular files cannot be polled and are
+always ready, so they are read directly. Only one task at a time may wait
+on a given descriptor.
+
+Coroutine frames come from per-thread free lists in 64-byte size classes,
+so starting a task does not go to malloc once the lists are warm. An
+exception that escapes a spawned task is rethrown from run().
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_CORO_H
+#define CSTLIB26_CORO_H 1
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include "eventloop.h"
+
+#if defined(__linux__)
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace cstar {
+
+class executor;
+
+namespace detail {
+
+// Free lists of coroutine frames, one per 64-byte size class up to 1 KiB.
+struct frame_cache {
+    static constexpr std::size_t granule = 64, classes = 16;
+    void* lists[classes] = {};
+    std::size_t live = 0;
+
+    ~frame_cache() {
+        for (void*& head : lists)
+            while (head) {
+                void* p = head;
+                head = *static_cast<void**>(p);
+                ::operator delete(p);
+            }
+    }
+};
+
+inline thread_local frame_cache frames;
+
+inline void* frame_alloc(std::size_t n) {
+    std::size_t c = (n + frame_cache::granule - 1) / frame_cache::granule;
+    frames.live += n;
+    if (c > frame_cache::classes) return ::operator new(n);
+    if (void*& head = frames.lists[c - 1]) {
+        void* p = head;
+        head = *static_cast<void**>(p);
+        return p;
+    }
+    return ::operator new(c * frame_cache::granule);
+}
+
+inline void frame_free(void* p, std::size_t n) noexcept {
+    std::size_t c = (n + frame_cache::granule - 1) / frame_cache::granule;
+    frames.live -= n;
+    if (c > frame_cache::classes) return ::operator delete(p);
+    *static_cast<void**>(p) = frames.lists[c - 1];
+    frames.lists[c - 1] = p;
+}
+
+// First exception to escape a spawned task, for run() to rethrow.
+inline thread_local std::exception_ptr detached_error;
+
+struct promise_base {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+    bool detached = false;
+    bool starting = false;       // inside the awaiter that started it
+    bool finished_early = false; // finished before that awaiter returned
+
+    static void* operator new(std::size_t n) { return frame_alloc(n); }
+    static void operator delete(void* p, std::size_t n) noexcept { frame_free(p, n); }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    // A task that finishes while its awaiter is still starting it just
+    // returns there, and the awaiter carries on without suspending. One
+    // that finishes later, after a real suspension, resumes its awaiter
+    // directly. This keeps the stack flat in loops of awaits that complete
+    // at once, even at -O0 where symmetric transfer is not a tail call. A
+    // spawned task has no awaiter and frees itself.
+    struct final_awaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+            promise_base& p = h.promise();
+            if (p.detached) {
+                if (p.error && !detached_error) detached_error = p.error;
+                h.destroy();
+                return std::noop_coroutine();
+            }
+            if (p.starting) {
+                p.finished_early = true;
+                return std::noop_coroutine();
+            }
+            if (p.continuation) return p.continuation;
+            return std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+    final_awaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+template <typename T>
+struct promise : promise_base {
+    std::optional<T> value;
+
+    template <typename U = T>
+    void return_value(U&& v) {
+        value.emplace(std::forward<U>(v));
+    }
+    T take() {
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct promise<void> : promise_base {
+    void return_void() noexcept {}
+    void take() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+} // namespace detail
+
+// The result of an async function. Owns the coroutine; awaiting it starts
+// it and resumes the awaiter with its result.
+template <typename T = void>
+class task {
+public:
+    struct promise_type : detail::promise<T> {
+        task get_return_object() noexcept { return task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    };
+    using handle = std::coroutine_handle<promise_type>;
+
+    task() noexcept = default;
+    task(task&& o) noexcept : h_(std::exchange(o.h_, nullptr)) {}
+    task& operator=(task&& o) noexcept {
+        if (this != &o) {
+            if (h_) h_.destroy();
+            h_ = std::exchange(o.h_, nullptr);
+        }
+        return *this;
+    }
+    ~task() {
+        if (h_) h_.destroy();
+    }
+
+    bool valid() const noexcept { return (bool)h_; }
+    bool done() const noexcept { return !h_ || h_.done(); }
+
+    auto operator co_await() && noexcept {
+        struct awaiter {
+            handle h;
+            bool await_ready() noexcept { return !h || h.done(); }
+            bool await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                auto& p = h.promise();
+                p.continuation = awaiting;
+                p.starting = true;
+                h.resume();
+                p.starting = false;
+                return !p.finished_early;
+            }
+            T await_resume() { return h.promise().take(); }
+        };
+        return awaiter{h_};
+    }
+    auto operator co_await() & noexcept { return std::move(*this).operator co_await(); }
+
+    // For the executor: the coroutine, ownership kept or given up.
+    handle get() const noexcept { return h_; }
+    handle release() noexcept { return std::exchange(h_, nullptr); }
+    T result() { return h_.promise().take(); }
+
+private:
+    explicit task(handle h) noexcept : h_(h) {}
+    handle h_ = nullptr;
+};
+
+namespace detail {
+inline thread_local executor* current_executor = nullptr;
+} // namespace detail
+
+// Runs coroutines on the thread that calls run(). Everything but post()
+// belongs to that thread.
+class executor {
+public:
+    explicit executor(event_loop& loop = default_loop()) : loop_(loop) {}
+    executor(const executor&) = delete;
+    executor& operator=(const executor&) = delete;
+
+    event_loop& loop() noexcept { return loop_; }
+    std::size_t ready() const noexcept { return ready_.size(); }
+
+    // Queue a suspended coroutine to be resumed by run().
+    void schedule(std::coroutine_handle<> h) { ready_.push_back(h); }
+
+    // From any thread.
+    void post(std::coroutine_handle<> h) {
+        loop_.post([this, h] { schedule(h); });
+    }
+
+    // Start t without waiting for it; it frees itself when it finishes.
+    template <typename T>
+    void spawn(task<T> t) {
+        auto h = t.release();
+        if (!h) return;
+        h.promise().detached = true;
+        schedule(h);
+    }
+
+    // Run until no task is ready and the loop has nothing left to wait for.
+    void run() {
+        drive([] { return false; });
+    }
+
+    // Run until t finishes, and return its result.
+    template <typename T>
+    T run(task<T> t) {
+        if (!t.valid()) throw std::invalid_argument("cstar::run: empty task");
+        schedule(t.get());
+        drive([&] { return t.done(); });
+        if (!t.done()) throw std::logic_error("cstar::run: task is waiting for something that can never happen");
+        return t.result();
+    }
+
+    // The executor running on this thread, else default_executor().
+    static executor& current();
+
+private:
+    template <typename Done>
+    void drive(Done done) {
+        executor* outer = std::exchange(detail::current_executor, this);
+        struct restore {
+            executor* e;
+            ~restore() { detail::current_executor = e; }
+        } restore_outer{outer};
+
+        while (!done()) {
+            if (ready_.empty()) {
+                if (!loop_.run_once(true) && ready_.empty()) break;
+                continue;
+            }
+            // a bounded batch, then a look at timers and descriptors so a
+            // task that keeps yielding cannot starve them
+            for (unsigned n = 0; n < 1024 && !ready_.empty(); ++n) {
+                std::coroutine_handle<> h = ready_.front();
+                ready_.pop_front();
+                h.resume();
+                if (detail::detached_error) std::rethrow_exception(std::exchange(detail::detached_error, nullptr));
+            }
+            if (!ready_.empty()) loop_.run_once(false);
+        }
+    }
+
+    event_loop& loop_;
+    std::deque<std::coroutine_handle<>> ready_;
+};
+
+// Process-wide executor on default_loop(), created on first use.
+inline executor& default_executor() {
+    static executor ex;
+    return ex;
+}
+
+inline executor& executor::current() {
+    return detail::current_executor ? *detail::current_executor : default_executor();
+}
+
+template <typename T>
+inline void spawn(task<T> t) {
+    executor::current().spawn(std::move(t));
+}
+
+template <typename T>
+inline T run(task<T> t) {
+    return executor::current().run(std::move(t));
+}
+
+inline void run() {
+    executor::current().run();
+}
+
+// --- awaitables ----------------------------------------------------------
+
+struct yield_awaiter {
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) { executor::current().schedule(h); }
+    void await_resume() const noexcept {}
+};
+
+// Go to the back of the ready queue.
+inline yield_awaiter yield() noexcept {
+    return {};
+}
+
+struct sleep_awaiter {
+    std::uint64_t ms;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+        executor& ex = executor::current();
+        if (ms == 0) ex.schedule(h);
+        else ex.loop().after(ms, [&ex, h] { ex.schedule(h); });
+    }
+    void await_resume() const noexcept {}
+};
+
+inline sleep_awaiter sleep_for(std::uint64_t ms) noexcept {
+    return {ms};
+}
+
+// Resumes with the ready mask (EPOLLIN, EPOLLOUT, EPOLLHUP, ...). A
+// descriptor that cannot be polled reports ready at once.
+struct fd_awaiter {
+    int fd;
+    std::uint32_t events;
+    std::uint32_t got = 0;
+    executor* ex = nullptr;
+    std::coroutine_handle<> h = nullptr;
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> awaiting) {
+        ex = &executor::current();
+        h = awaiting;
+        if (ex->loop().watch(fd, events, [this](std::uint32_t ev) {
+                got = ev;
+                ex->loop().unwatch(fd);
+                ex->schedule(h);
+            }))
+            return true;
+        got = events;
+        return false;
+    }
+    std::uint32_t await_resume() const noexcept { return got; }
+};
+
+#ifdef CSTAR_EVENTLOOP_EPOLL
+inline fd_awaiter readable(int fd) noexcept {
+    return {fd, EPOLLIN};
+}
+inline fd_awaiter writable(int fd) noexcept {
+    return {fd, EPOLLOUT};
+}
+#else
+inline fd_awaiter readable(int fd) noexcept {
+    return {fd, 1};
+}
+inline fd_awaiter writable(int fd) noexcept {
+    return {fd, 4};
+}
+#endif
+
+#if defined(__linux__)
+
+namespace detail {
+inline void set_nonblocking(int fd) noexcept {
+    int flags = ::fcntl(fd, F_GETFL);
+    if (flags >= 0 && !(flags & O_NONBLOCK)) ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+} // namespace detail
+
+// read(2) that waits for data instead of blocking the thread. Returns the
+// byte count, 0 at end of file, or -1 with errno set.
+inline task<ssize_t> async_read(int fd, void* buf, std::size_t len) {
+    detail::set_nonblocking(fd);
+    for (;;) {
+        ssize_t n = ::read(fd, buf, len);
+        if (n >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) co_return n;
+        co_await readable(fd);
+    }
+}
+
+// Writes all of buf, waiting whenever the descriptor is full. Returns len,
+// or -1 with errno set.
+inline task<ssize_t> async_write(int fd, const void* buf, std::size_t len) {
+    detail::set_nonblocking(fd);
+    const char* p = static_cast<const char*>(buf);
+    std::size_t done = 0;
+    while (done < len) {
+        ssize_t n = ::write(fd, p + done, len - done);
+        if (n >= 0) done += (std::size_t)n;
+        else if (errno == EAGAIN || errno == EWOULDBLOCK) co_await writable(fd);
+        else co_return -1;
+    }
+    co_return (ssize_t)len;
+}
+
+#endif
+
+// Bytes of coroutine frames currently alive on this thread.
+inline std::size_t live_frame_bytes() noexcept {
+    return detail::frames.live;
+}
+
+} // namespace cstar
+
+#endif // CSTLIB26_CORO_H
@@ -0,0 +1,458 @@
+/*
+eventloop.h - Timers and an event loop for CStar.
+
+cstar::timer_wheel is a hierarchical timing wheel (4 levels x 256 slots,
+1 ms ticks, ~49 days of range) with O(1) insertion and cancellation:
+timers sit in intrusive doubly-linked slot lists, and a per-level
+occupancy bitmap lets the clock skip empty ticks.
+
+cstar::event_loop drives a wheel from one thread. On Linux it sleeps in
+epoll_wait with a timerfd armed for the next expiry, and it can also watch
+file descriptors. Elsewhere it sleeps on a condition variable. Timers and
+fd watches belong to the loop thread; other threads hand work over with
+post().
+
+Delay::after / Delay::every / Delay::run in cstar.h use
+cstar::default_loop(), so a program can keep thousands of delayed
+actions going on one thread:
+
+    Delay::every(1000, [] { Console.WriteLine("tick"); });
+    Delay::after(5000, [] { Delay::stop(); });
+    Delay::run();
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_EVENTLOOP_H
+#define CSTLIB26_EVENTLOOP_H 1
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <sys/timerfd.h>
+    #include <unistd.h>
+    #define CSTAR_EVENTLOOP_EPOLL 1
+#endif
+
+namespace cstar {
+
+// Identifies a scheduled timer; 0 is never a valid id.
+using timer_id = std::uint64_t;
+
+class timer_wheel {
+public:
+    static constexpr unsigned level_bits = 8;
+    static constexpr unsigned levels = 4;
+    static constexpr unsigned slots = 1u << level_bits;
+
+    timer_wheel() {
+        for (auto& level : heads_)
+            for (auto& h : level) h = npos;
+    }
+
+    timer_wheel(const timer_wheel&) = delete;
+    timer_wheel& operator=(const timer_wheel&) = delete;
+
+    // Run cb once after delay ticks (at least 1), or every period ticks
+    // from then on when period > 0.
+    timer_id add(std::uint64_t delay, std::uint64_t period, std::function<void()> cb) {
+        std::uint32_t idx;
+        if (free_head_ != npos) {
+            idx = free_head_;
+            free_head_ = nodes_[idx].next;
+        } else {
+            idx = (std::uint32_t)nodes_.size();
+            nodes_.emplace_back();
+        }
+        node& n = nodes_[idx];
+        n.expires = now_ + (delay ? delay : 1);
+        n.period = period;
+        n.cb = std::move(cb);
+        n.active = true;
+        place(idx);
+        ++count_;
+        return ((std::uint64_t)n.gen << 32) | (idx + 1);
+    }
+
+    // False if the timer already fired (one-shot) or was cancelled.
+    bool cancel(timer_id id) {
+        std::uint32_t idx = (std::uint32_t)id - 1;
+        if (idx >= nodes_.size()) return false;
+        node& n = nodes_[idx];
+        if (!n.active || n.gen != (std::uint32_t)(id >> 32)) return false;
+        if (n.linked) unlink(idx);
+        release(idx); // a running callback keeps its own copy, see fire()
+        return true;
+    }
+
+    // Fire everything due up to and including tick.
+    void advance_to(std::uint64_t tick) {
+        while (now_ < tick) {
+            std::uint64_t boundary = ((now_ >> level_bits) + 1) << level_bits;
+            std::uint64_t last = boundary - 1 < tick ? boundary - 1 : tick;
+            std::uint64_t next = next_level0(now_ + 1, last);
+            if (next == npos64) next = boundary <= tick ? boundary : tick;
+            now_ = next;
+            if ((now_ & (slots - 1)) == 0) cascade();
+            fire((unsigned)(now_ & (slots - 1)));
+        }
+    }
+
+    // Earliest tick worth waking up for, or npos64 with no timers. This can
+    // be a cascade boundary that fires nothing; it is never later than the
+    // first real expiry.
+    std::uint64_t next_wakeup() const {
+        if (!count_) return npos64;
+        std::uint64_t boundary = ((now_ >> level_bits) + 1) << level_bits;
+        std::uint64_t next = next_level0(now_ + 1, boundary - 1);
+        return next == npos64 ? boundary : next;
+    }
+
+    std::uint64_t now() const { return now_; }
+    std::size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+    static constexpr std::uint64_t npos64 = ~0ull;
+
+private:
+    static constexpr std::uint32_t npos = 0xFFFFFFFFu;
+
+    struct node {
+        std::uint64_t expires = 0;
+        std::uint64_t period = 0;
+        std::function<void()> cb;
+        std::uint32_t prev = npos, next = npos;
+        std::uint32_t gen = 1;
+        std::uint16_t slot = 0;
+        std::uint8_t level = 0;
+        bool active = false;
+        bool linked = false;
+    };
+
+    void place(std::uint32_t idx) {
+        node& n = nodes_[idx];
+        std::uint64_t expires = n.expires;
+        std::uint64_t delta = expires > now_ ? expires - now_ : 0;
+        unsigned level = 0;
+        while (level + 1 < levels && delta >= (1ull << (level_bits * (level + 1)))) ++level;
+        if (level == levels - 1 && delta >= (1ull << (level_bits * levels))) {
+            // beyond the wheel's range: park at the far edge, re-placed on cascade
+            expires = now_ + (1ull << (level_bits * levels)) - 1;
+        }
+        unsigned slot = (unsigned)((expires >> (level_bits * level)) & (slots - 1));
+        n.level = (std::uint8_t)level;
+        n.slot = (std::uint16_t)slot;
+        n.prev = npos;
+        n.next = heads_[level][slot];
+        if (n.next != npos) nodes_[n.next].prev = idx;
+        heads_[level][slot] = idx;
+        bits_[level][slot >> 6] |= 1ull << (slot & 63);
+        n.linked = true;
+    }
+
+    void unlink(std::uint32_t idx) {
+        node& n = nodes_[idx];
+        if (n.prev != npos) nodes_[n.prev].next = n.next;
+        else heads_[n.level][n.slot] = n.next;
+        if (n.next != npos) nodes_[n.next].prev = n.prev;
+        if (heads_[n.level][n.slot] == npos) bits_[n.level][n.slot >> 6] &= ~(1ull << (n.slot & 63));
+        n.linked = false;
+    }
+
+    void release(std::uint32_t idx) {
+        node& n = nodes_[idx];
+        n.active = false;
+        n.cb = nullptr;
+        ++n.gen;
+        if (n.gen == 0) n.gen = 1;
+        n.next = free_head_;
+        free_head_ = idx;
+        --count_;
+    }
+
+    // Called when level 0 wraps: pull the next slot of each higher level
+    // that just came into range down, highest level first.
+    void cascade() {
+        unsigned top = 1;
+        while (top + 1 < levels && ((now_ >> (level_bits * top)) & (slots - 1)) == 0) ++top;
+        for (unsigned level = top; level >= 1; --level) {
+            unsigned slot = (unsigned)((now_ >> (level_bits * level)) & (slots - 1));
+            std::uint32_t idx = heads_[level][slot];
+            heads_[level][slot] = npos;
+            bits_[level][slot >> 6] &= ~(1ull << (slot & 63));
+            while (idx != npos) {
+                std::uint32_t next = nodes_[idx].next;
+                place(idx);
+                idx = next;
+            }
+        }
+    }
+
+    void fire(unsigned slot) {
+        std::uint32_t idx;
+        while ((idx = heads_[0][slot]) != npos) {
+            unlink(idx);
+            node& n = nodes_[idx];
+            if (n.expires > now_) { place(idx); continue; } // parked past the range
+            if (n.period) {
+                // re-arm first, run the callback out of the node (it may
+                // cancel its own timer), then hand it back if still armed
+                std::uint32_t gen = n.gen;
+                std::function<void()> cb = std::move(n.cb);
+                n.expires = now_ + n.period;
+                place(idx);
+                cb();
+                node& after = nodes_[idx];
+                if (after.active && after.gen == gen) after.cb = std::move(cb);
+            } else {
+                std::function<void()> cb = std::move(n.cb);
+                release(idx);
+                cb();
+            }
+        }
+    }
+
+    std::uint64_t next_level0(std::uint64_t from, std::uint64_t to) const {
+        // from..to lie in the same 256-tick block
+        if (from > to) return npos64;
+        unsigned s = (unsigned)(from & (slots - 1));
+        unsigned e = (unsigned)(to & (slots - 1));
+        std::uint64_t base = from - s;
+        for (unsigned w = s >> 6; w <= (e >> 6); ++w) {
+            std::uint64_t word = bits_[0][w];
+            if (w == (s >> 6)) word &= ~0ull << (s & 63);
+            if (w == (e >> 6) && (e & 63) != 63) word &= (2ull << (e & 63)) - 1;
+            if (word) return base + w * 64 + (unsigned)__builtin_ctzll(word);
+        }
+        return npos64;
+    }
+
+    std::deque<node> nodes_; // deque: node references survive growth during callbacks
+    std::uint32_t free_head_ = npos;
+    std::uint32_t heads_[levels][slots];
+    std::uint64_t bits_[levels][slots / 64] = {};
+    std::uint64_t now_ = 0;
+    std::size_t count_ = 0;
+};
+
+class event_loop {
+public:
+    using clock = std::chrono::steady_clock;
+
+    event_loop() : start_(clock::now()) {
+#ifdef CSTAR_EVENTLOOP_EPOLL
+        epfd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        tfd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        wakefd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = tfd_;
+        ::epoll_ctl(epfd_, EPOLL_CTL_ADD, tfd_, &ev);
+        ev.data.fd = wakefd_;
+        ::epoll_ctl(epfd_, EPOLL_CTL_ADD, wakefd_, &ev);
+#endif
+    }
+
+    event_loop(const event_loop&) = delete;
+    event_loop& operator=(const event_loop&) = delete;
+
+    ~event_loop() {
+#ifdef CSTAR_EVENTLOOP_EPOLL
+        ::close(wakefd_);
+        ::close(tfd_);
+        ::close(epfd_);
+#endif
+    }
+
+    // --- timers (loop thread only) ---
+    timer_id after(std::uint64_t ms, std::function<void()> cb) {
+        sync_clock();
+        return wheel_.add(ms, 0, std::move(cb));
+    }
+    timer_id every(std::uint64_t ms, std::function<void()> cb) {
+        sync_clock();
+        return wheel_.add(ms, ms ? ms : 1, std::move(cb));
+    }
+    bool cancel(timer_id id) { return wheel_.cancel(id); }
+    std::size_t pending_timers() const { return wheel_.size(); }
+
+    // --- fd readiness (Linux, loop thread only) ---
+    // events are EPOLLIN/EPOLLOUT/...; cb receives the ready mask.
+    bool watch(int fd, std::uint32_t events, std::function<void(std::uint32_t)> cb) {
+#ifdef CSTAR_EVENTLOOP_EPOLL
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        bool existing = fds_.count(fd) != 0;
+        if (::epoll_ctl(epfd_, existing ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev) != 0) return false;
+        fds_[fd] = std::move(cb);
+        return true;
+#else
+        (void)fd; (void)events; (void)cb;
+        return false;
+#endif
+    }
+    void unwatch(int fd) {
+#ifdef CSTAR_EVENTLOOP_EPOLL
+        if (fds_.erase(fd)) ::epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+#else
+        (void)fd;
+#endif
+    }
+
+    // --- any thread ---
+    void post(std::function<void()> fn) {
+        {
+            std::lock_guard<std::mutex> lock(post_mutex_);
+            posted_.push_back(std::move(fn));
+        }
+        wake();
+    }
+
+    void stop() {
+        stop_requested_ = true;
+        wake();
+    }
+
+    // Run until stop(), or until there are no timers, fd watches or posted
+    // work left.
+    void run() {
+        stop_requested_ = false;
+        while (!stop_requested_) {
+            run_posted();
+            sync_clock();
+            if (stop_requested_) break;
+            if (wheel_.empty() && !has_fds() && !has_posted()) break;
+            wait(wheel_.next_wakeup());
+        }
+    }
+
+    // One pass of run(): posted work and due timers, then one wait for the
+    // next timer, fd event or post (just a poll when block is false).
+    // False, without waiting, when nothing is left to wait for.
+    bool run_once(bool block = true) {
+        run_posted();
+        sync_clock();
+        if (wheel_.empty() && !has_fds() && !has_posted()) return false;
+        wait(wheel_.next_wakeup(), block);
+        sync_clock();
+        return true;
+    }
+
+    // Milliseconds since the loop was created (the wheel's clock).
+    std::uint64_t now_ms() const {
+        return (std::uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start_).count();
+    }
+
+private:
+    void sync_clock() { wheel_.advance_to(now_ms()); }
+
+    bool has_fds() const {
+#ifdef CSTAR_EVENTLOOP_EPOLL
+        return !fds_.empty();
+#else
+        return false;
+#endif
+    }
+
+    bool has_posted() {
+        std::lock_guard<std::mutex> lock(post_mutex_);
+        return !posted_.empty();
+    }
+
+    void run_posted() {
+        std::vector<std::function<void()>> batch;
+        {
+            std::lock_guard<std::mutex> lock(post_mutex_);
+            batch.swap(posted_);
+        }
+        for (auto& fn : batch) fn();
+    }
+
+    void wake() {
+#ifdef CSTAR_EVENTLOOP_EPOLL
+        std::uint64_t one = 1;
+        ssize_t r = ::write(wakefd_, &one, sizeof(one));
+        (void)r;
+#else
+        std::lock_guard<std::mutex> lock(post_mutex_);
+        woken_ = true;
+        cv_.notify_one();
+#endif
+    }
+
+    void wait(std::uint64_t tick, bool block = true) {
+#ifdef CSTAR_EVENTLOOP_EPOLL
+        itimerspec its{};
+        if (!block) {
+            // poll: leave the timerfd as it is
+        } else if (tick != timer_wheel::npos64) {
+            auto when = start_ + std::chrono::milliseconds(tick);
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(when.time_since_epoch()).count();
+            if (ns <= 0) ns = 1;
+            its.it_value.tv_sec = ns / 1000000000;
+            its.it_value.tv_nsec = ns % 1000000000;
+        }
+        // steady_clock is CLOCK_MONOTONIC on Linux, so its epoch matches
+        if (block) ::timerfd_settime(tfd_, TFD_TIMER_ABSTIME, &its, nullptr);
+
+        epoll_event events[64];
+        int n = ::epoll_wait(epfd_, events, 64, block ? -1 : 0);
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == tfd_ || fd == wakefd_) {
+                std::uint64_t drained;
+                ssize_t r = ::read(fd, &drained, sizeof(drained));
+                (void)r;
+                continue;
+            }
+            auto it = fds_.find(fd);
+            if (it != fds_.end()) {
+                auto cb = it->second; // the callback may unwatch itself
+                cb(events[i].events);
+            }
+        }
+#else
+        std::unique_lock<std::mutex> lock(post_mutex_);
+        auto pred = [&] { return woken_ || !posted_.empty(); };
+        if (!block) {
+            // poll: posted work runs on the next pass
+        } else if (tick == timer_wheel::npos64) cv_.wait(lock, pred);
+        else cv_.wait_until(lock, start_ + std::chrono::milliseconds(tick), pred);
+        woken_ = false;
+#endif
+    }
+
+    clock::time_point start_;
+    timer_wheel wheel_;
+    std::mutex post_mutex_;
+    std::vector<std::function<void()>> posted_;
+    std::atomic<bool> stop_requested_{false};
+#ifdef CSTAR_EVENTLOOP_EPOLL
+    int epfd_ = -1, tfd_ = -1, wakefd_ = -1;
+    std::unordered_map<int, std::function<void(std::uint32_t)>> fds_;
+#else
+    std::condition_variable cv_;
+    bool woken_ = false;
+#endif
+};
+
+// Process-wide loop used by Delay::after / every / run, created on first use.
+inline event_loop& default_loop() {
+    static event_loop loop;
+    return loop;
+}
+
+} // namespace cstar
+
+#endif // CSTLIB26_EVENTLOOP_H
@@ -0,0 +1,256 @@
+/*
+fastin.h - Buffered standard input for CStar.
+
+Reads stdin in large blocks and parses numbers straight out of the buffer
+with std::from_chars, instead of one std::scanf / std::cin >> per value.
+UNIX::posixscanf, cstar25::pinput and CONSOLE::ReadLine all go through the
+shared reader returned by cstar::stdin_buf(), so mixing them is safe.
+Do not mix them with direct std::cin / std::scanf reads on the same stream:
+the reader owns whatever it has already pulled out of the descriptor.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_FASTIN_H
+#define CSTLIB26_FASTIN_H 1
+
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <io.h>
+    #define CSTAR_STDIN_FD 0
+#else
+    #include <unistd.h>
+    #define CSTAR_STDIN_FD STDIN_FILENO
+#endif
+
+namespace cstar {
+
+class stdin_reader {
+public:
+    static constexpr std::size_t block_size = 1 << 16;
+
+    explicit stdin_reader(int fd = CSTAR_STDIN_FD) : fd_(fd) {}
+
+    stdin_reader(const stdin_reader&) = delete;
+    stdin_reader& operator=(const stdin_reader&) = delete;
+
+    // Next whitespace-separated token. The view points into the internal
+    // buffer and stays valid until the next call on this reader.
+    // Returns an empty view at end of input.
+    std::string_view token() {
+        if (!skip_space()) return {};
+        std::size_t i = token_end();
+        std::string_view tok(buf_.data() + pos_, i - pos_);
+        pos_ = i;
+        return tok;
+    }
+
+    // Rest of the current line without the terminator ("\n" or "\r\n").
+    // Returns false only when there is no input left at all.
+    bool line(std::string_view& out) {
+        if (pos_ >= end_ && !refill()) return false;
+        std::size_t i = pos_;
+        for (;;) {
+            const void* nl = std::memchr(buf_.data() + i, '\n', end_ - i);
+            if (nl) { i = static_cast<const char*>(nl) - buf_.data(); break; }
+            std::size_t off = end_ - pos_;
+            if (!refill()) { i = end_; break; }
+            i = pos_ + off;
+        }
+        std::size_t start = pos_;
+        std::size_t stop = i;
+        pos_ = (i < end_) ? i + 1 : i;
+        if (stop > start && buf_[stop - 1] == '\r') --stop;
+        out = std::string_view(buf_.data() + start, stop - start);
+        return true;
+    }
+
+    // Returns true when a value was parsed. On a malformed token the token
+    // is still consumed and the output is left untouched.
+    template<typename T>
+    bool read(T& out) {
+        if constexpr (std::is_same_v<T, bool>) {
+            long v = 0;
+            if (!read(v)) return false;
+            out = (v != 0);
+            return true;
+        } else if constexpr (std::is_same_v<T, char>) {
+            if (!skip_space()) return false;
+            out = buf_[pos_++];
+            return true;
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            if (!skip_space()) return false;
+            // parse in place once the whole token is buffered
+            std::size_t stop = token_end();
+            const char* first = buf_.data() + pos_;
+            const char* last = buf_.data() + stop;
+            if constexpr (std::is_integral_v<T>) {
+                // from_chars rejects a leading '+', scanf accepts it
+                if (*first == '+' && last - first > 1) ++first;
+            }
+            auto res = std::from_chars(first, last, out);
+            pos_ = stop; // a malformed token is dropped too
+            return res.ec == std::errc() && res.ptr == last;
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            std::string_view tok = token();
+            if (tok.empty()) return false;
+            out.assign(tok.data(), tok.size());
+            return true;
+        } else {
+            static_assert(!sizeof(T*), "stdin_reader::read: unsupported type");
+            return false;
+        }
+    }
+
+    // scanf-style result: 1 on success, 0 on a malformed token, EOF at end of input.
+    template<typename T>
+    int scan(T& out) {
+        if (read(out)) return 1;
+        return eof() ? EOF : 0;
+    }
+
+    bool read_line(std::string& out) {
+        std::string_view v;
+        if (!line(v)) return false;
+        out.assign(v.data(), v.size());
+        return true;
+    }
+
+    bool eof() {
+        return pos_ >= end_ && !refill();
+    }
+
+    // Iterate tokens / lines: for (std::string_view t : reader.tokens()) ...
+    // Each view is only valid until the iterator is advanced.
+    template<bool Lines>
+    class view_range {
+    public:
+        class iterator {
+        public:
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+
+            iterator() = default;
+            explicit iterator(stdin_reader* r) : r_(r) { ++*this; }
+
+            std::string_view operator*() const { return cur_; }
+            iterator& operator++() {
+                bool ok;
+                if constexpr (Lines) {
+                    ok = r_->line(cur_);
+                } else {
+                    cur_ = r_->token();
+                    ok = !cur_.empty();
+                }
+                if (!ok) r_ = nullptr;
+                return *this;
+            }
+            bool operator==(const iterator& o) const { return r_ == o.r_; }
+            bool operator!=(const iterator& o) const { return r_ != o.r_; }
+
+        private:
+            stdin_reader* r_ = nullptr;
+            std::string_view cur_;
+        };
+
+        explicit view_range(stdin_reader* r) : r_(r) {}
+        iterator begin() const { return iterator(r_); }
+        iterator end() const { return iterator(); }
+
+    private:
+        stdin_reader* r_;
+    };
+
+    view_range<false> tokens() { return view_range<false>(this); }
+    view_range<true> lines() { return view_range<true>(this); }
+
+private:
+    static bool is_space(char c) {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    // End of the token starting at pos_. Refills only while the token runs
+    // into the end of the buffer, so a token whose delimiter is already
+    // buffered never waits on an interactive stdin. May move pos_ (see
+    // refill); the returned index is valid for the current pos_.
+    std::size_t token_end() {
+        std::size_t i = pos_;
+        for (;;) {
+            while (i < end_ && !is_space(buf_[i])) ++i;
+            if (i < end_) return i;
+            std::size_t off = i - pos_;
+            if (!refill()) return end_;
+            i = pos_ + off;
+        }
+    }
+
+    bool skip_space() {
+        for (;;) {
+            while (pos_ < end_ && is_space(buf_[pos_])) ++pos_;
+            if (pos_ < end_) return true;
+            if (!refill()) return false;
+        }
+    }
+
+    // Pull more bytes from the descriptor. Unconsumed data [pos_, end_) is
+    // moved to the front first, so pos_ becomes 0 and callers must rebase
+    // any offsets they hold. Returns false when nothing more could be read.
+    bool refill() {
+        if (eof_) return false;
+        // prompts written through std::cout / printf must be visible before we block
+        std::cout.flush();
+        std::fflush(stdout);
+
+        if (pos_ > 0) {
+            std::size_t live = end_ - pos_;
+            if (live) std::memmove(buf_.data(), buf_.data() + pos_, live);
+            pos_ = 0;
+            end_ = live;
+        }
+        if (buf_.size() - end_ < block_size / 2) {
+            buf_.resize(buf_.size() < block_size ? block_size : buf_.size() * 2);
+        }
+
+        for (;;) {
+#if defined(_WIN32) || defined(_WIN64)
+            int n = ::_read(fd_, buf_.data() + end_, static_cast<unsigned>(buf_.size() - end_));
+#else
+            ssize_t n = ::read(fd_, buf_.data() + end_, buf_.size() - end_);
+#endif
+            if (n > 0) {
+                end_ += static_cast<std::size_t>(n);
+                return true;
+            }
+#if !defined(_WIN32) && !defined(_WIN64)
+            if (n < 0 && errno == EINTR) continue;
+#endif
+            eof_ = true;
+            return false;
+        }
+    }
+
+    int fd_;
+    std::vector<char> buf_;
+    std::size_t pos_ = 0;
+    std::size_t end_ = 0;
+    bool eof_ = false;
+};
+
+// Process-wide reader for standard input, created on first use.
+inline stdin_reader& stdin_buf() {
+    static stdin_reader reader;
+    return reader;
+}
+
+} // namespace cstar
+
+#endif // CSTLIB26_FASTIN_H
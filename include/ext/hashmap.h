@@ -0,0 +1,823 @@
+/*
+hashmap.h - Open-addressing hash map and set for CStar.
+
+cstar::hash_map<K, V> and cstar::hash_set<K> keep their elements in one
+flat array instead of one heap node per element, so lookups touch
+one or two cache lines. The table is laid out SwissTable style:
+
+  - every slot has a control byte: empty, deleted, or 7 bits of the
+    key's hash
+  - a probe loads 16 control bytes at once and compares them all against
+    the hash byte with SSE2 (plain loops on other CPUs), so only slots
+    whose byte matches are ever compared key by key
+  - the table grows by doubling once 7/8 of its slots are used
+
+    cstar::hash_map<std::string, int> ages;
+    ages["ada"] = 36;
+    if (auto it = ages.find("ada"); it != ages.end()) ...   // no temporary std::string
+    for (auto& [name, age] : ages) ...
+
+cstar::hash<T> is the default hash: a multiply-fold mix for integers,
+pointers and floats, and a wyhash-style byte hash for strings.
+std::string, std::string_view and const char* hash the same way, so
+string keys can be looked up with any of them (heterogeneous lookup,
+via is_transparent). Other types go through std::hash and the mixer.
+
+Differences from std::unordered_map: inserting can move elements, so
+pointers, references and iterators are invalidated by any insert that
+grows the table (erase invalidates only the erased element), and there
+is no bucket interface. Iteration order is unspecified.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_HASHMAP_H
+#define CSTLIB26_HASHMAP_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define CSTAR_HASHMAP_SSE2 1
+#endif
+
+namespace cstar {
+
+// --- hashing -----------------------------------------------------------
+
+namespace detail {
+
+inline std::uint64_t mum(std::uint64_t a, std::uint64_t b) noexcept {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)a * b;
+    return (std::uint64_t)r ^ (std::uint64_t)(r >> 64);
+#else
+    std::uint64_t ha = a >> 32, la = (std::uint32_t)a, hb = b >> 32, lb = (std::uint32_t)b;
+    std::uint64_t hi = ha * hb, mid1 = ha * lb, mid2 = la * hb, lo = la * lb;
+    std::uint64_t t = lo + (mid1 << 32);
+    hi += (mid1 >> 32) + (t < lo);
+    lo = t + (mid2 << 32);
+    hi += (mid2 >> 32) + (lo < t);
+    return hi ^ lo;
+#endif
+}
+
+inline std::uint64_t read64(const unsigned char* p) noexcept {
+    std::uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+}
+inline std::uint64_t read32(const unsigned char* p) noexcept {
+    std::uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+constexpr std::uint64_t k0 = 0xa0761d6478bd642full, k1 = 0xe7037ed1a0b428dbull, k2 = 0x8ebc6af09c88c6e3ull;
+
+inline std::uint64_t hash_int(std::uint64_t x) noexcept { return mum(x ^ k0, k1); }
+
+inline std::uint64_t hash_bytes(const void* data, std::size_t len) noexcept {
+    auto p = static_cast<const unsigned char*>(data);
+    std::uint64_t seed = k0 ^ mum(len ^ k2, k1), a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (read32(p) << 32) | read32(p + ((len >> 3) << 2));
+            b = (read32(p + len - 4) << 32) | read32(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = ((std::uint64_t)p[0] << 16) | ((std::uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        std::size_t i = len;
+        for (; i > 16; i -= 16, p += 16) seed = mum(read64(p) ^ k1, read64(p + 8) ^ seed);
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
+    }
+    return mum(k1 ^ len, mum(a ^ k1, b ^ seed));
+}
+
+} // namespace detail
+
+template <typename T, typename = void>
+struct hash {
+    std::size_t operator()(const T& v) const noexcept(noexcept(std::hash<T>()(v))) {
+        return detail::hash_int(std::hash<T>()(v));
+    }
+};
+
+template <typename T>
+struct hash<T, std::enable_if_t<std::is_integral_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>>> {
+    std::size_t operator()(T v) const noexcept {
+        if constexpr (std::is_pointer_v<T>)
+            return detail::hash_int(reinterpret_cast<std::uintptr_t>(v));
+        else
+            return detail::hash_int(static_cast<std::uint64_t>(v));
+    }
+};
+
+template <typename T>
+struct hash<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+    std::size_t operator()(T v) const noexcept {
+        if (v == 0) return detail::hash_int(0);  // +0.0 == -0.0
+        if constexpr (sizeof(T) <= 8) {
+            std::uint64_t bits = 0;
+            std::memcpy(&bits, &v, sizeof(T));
+            return detail::hash_int(bits);
+        } else {
+            return detail::hash_bytes(&v, 10);  // x87 long double: 80 significant bits
+        }
+    }
+};
+
+struct string_hash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const noexcept { return detail::hash_bytes(s.data(), s.size()); }
+};
+
+template <>
+struct hash<std::string> : string_hash {};
+template <>
+struct hash<std::string_view> : string_hash {};
+
+// --- table -------------------------------------------------------------
+
+namespace detail {
+
+using ctrl_t = signed char;
+constexpr ctrl_t ctrl_empty = -128, ctrl_deleted = -2, ctrl_sentinel = -1;
+constexpr std::size_t group_width = 16;
+
+// Bit i set for each of the 16 control bytes that matched.
+class bitmask {
+public:
+    explicit bitmask(std::uint32_t m) noexcept : mask_(m) {}
+    explicit operator bool() const noexcept { return mask_ != 0; }
+    unsigned lowest() const noexcept { return (unsigned)__builtin_ctz(mask_); }
+    unsigned leading_zeros() const noexcept { return (unsigned)__builtin_clz(mask_ << 16); }
+    // number of consecutive matches starting at byte 0
+    unsigned leading_run() const noexcept { return (unsigned)__builtin_ctz(~mask_); }
+    bitmask& operator++() noexcept {
+        mask_ &= mask_ - 1;
+        return *this;
+    }
+    // for (unsigned i : mask)
+    unsigned operator*() const noexcept { return lowest(); }
+    bitmask begin() const noexcept { return *this; }
+    bitmask end() const noexcept { return bitmask(0); }
+    bool operator!=(const bitmask& o) const noexcept { return mask_ != o.mask_; }
+
+private:
+    std::uint32_t mask_;
+};
+
+#if CSTAR_HASHMAP_SSE2
+struct group {
+    __m128i ctrl;
+    explicit group(const ctrl_t* p) noexcept : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+    bitmask match(ctrl_t h2) const noexcept {
+        return bitmask((std::uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl)));
+    }
+    bitmask match_empty() const noexcept { return match(ctrl_empty); }
+    // empty or deleted, i.e. below the sentinel
+    bitmask match_free() const noexcept {
+        return bitmask((std::uint32_t)_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(ctrl_sentinel), ctrl)));
+    }
+};
+#else
+struct group {
+    ctrl_t ctrl[group_width];
+    explicit group(const ctrl_t* p) noexcept { std::memcpy(ctrl, p, group_width); }
+    bitmask match(ctrl_t h2) const noexcept {
+        std::uint32_t m = 0;
+        for (unsigned i = 0; i < group_width; ++i) m |= (std::uint32_t)(ctrl[i] == h2) << i;
+        return bitmask(m);
+    }
+    bitmask match_empty() const noexcept { return match(ctrl_empty); }
+    bitmask match_free() const noexcept {
+        std::uint32_t m = 0;
+        for (unsigned i = 0; i < group_width; ++i) m |= (std::uint32_t)(ctrl[i] < ctrl_sentinel) << i;
+        return bitmask(m);
+    }
+};
+#endif
+
+// Control bytes of a table with no storage: a sentinel, then empties.
+inline const ctrl_t* empty_ctrl() noexcept {
+    alignas(16) static constexpr ctrl_t bytes[group_width] = {
+        ctrl_sentinel, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty,
+        ctrl_empty,    ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty};
+    return bytes;
+}
+
+// Elements a table of this capacity may hold before it must grow (7/8).
+constexpr std::size_t capacity_to_growth(std::size_t cap) noexcept { return cap - cap / 8; }
+
+template <typename K, typename V>
+struct map_policy {
+    using key_type = K;
+    using value_type = std::pair<const K, V>;
+    // The table moves elements when it grows; moving through the non-const
+    // view lets string keys be moved rather than copied.
+    union slot {
+        value_type value;
+        std::pair<K, V> mutable_value;
+        slot() {}
+        ~slot() {}
+    };
+    static const K& key(const value_type& v) noexcept { return v.first; }
+    template <typename A>
+    static void transfer(A& a, slot* to, slot* from) {
+        using traits = std::allocator_traits<A>;
+        traits::construct(a, &to->mutable_value, std::move(from->mutable_value));
+        traits::destroy(a, &from->mutable_value);
+    }
+};
+
+template <typename K>
+struct set_policy {
+    using key_type = K;
+    using value_type = K;
+    union slot {
+        value_type value;
+        slot() {}
+        ~slot() {}
+    };
+    static const K& key(const value_type& v) noexcept { return v; }
+    template <typename A>
+    static void transfer(A& a, slot* to, slot* from) {
+        using traits = std::allocator_traits<A>;
+        traits::construct(a, &to->value, std::move(from->value));
+        traits::destroy(a, &from->value);
+    }
+};
+
+template <typename Policy, typename Hash, typename Eq, typename Alloc>
+class raw_table {
+protected:
+    using slot = typename Policy::slot;
+    using key_type = typename Policy::key_type;
+    using value_type = typename Policy::value_type;
+    using value_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<value_type>;
+    using slot_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<slot>;
+    using ctrl_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<ctrl_t>;
+    using value_traits = std::allocator_traits<value_alloc>;
+
+    template <typename H, typename E, typename = void>
+    struct transparent : std::false_type {};
+    template <typename H, typename E>
+    struct transparent<H, E, std::void_t<typename H::is_transparent, typename E::is_transparent>> : std::true_type {};
+
+    // Lookups by another type use it as is when hash and equality both
+    // accept it; otherwise it is converted to key_type first.
+    template <typename Q>
+    using lookup_t = std::conditional_t<transparent<Hash, Eq>::value || std::is_same_v<Q, key_type>, const Q&, key_type>;
+
+public:
+    using size_type = std::size_t;
+    using hasher = Hash;
+    using key_equal = Eq;
+    using allocator_type = Alloc;
+
+    template <bool Const>
+    class basic_iterator {
+        friend class raw_table;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename Policy::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = std::conditional_t<Const, const value_type&, value_type&>;
+        using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+
+        basic_iterator() noexcept = default;
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        basic_iterator(const basic_iterator<false>& o) noexcept : ctrl_(o.ctrl_), slot_(o.slot_) {}
+
+        reference operator*() const noexcept { return slot_->value; }
+        pointer operator->() const noexcept { return &slot_->value; }
+        basic_iterator& operator++() noexcept {
+            ++ctrl_;
+            ++slot_;
+            skip_free();
+            return *this;
+        }
+        basic_iterator operator++(int) noexcept {
+            basic_iterator t = *this;
+            ++*this;
+            return t;
+        }
+        friend bool operator==(const basic_iterator& a, const basic_iterator& b) noexcept {
+            return a.ctrl_ == b.ctrl_;
+        }
+        friend bool operator!=(const basic_iterator& a, const basic_iterator& b) noexcept {
+            return a.ctrl_ != b.ctrl_;
+        }
+
+    private:
+        template <bool>
+        friend class basic_iterator;
+        basic_iterator(const ctrl_t* c, slot* s) noexcept : ctrl_(c), slot_(s) {}
+
+        // Stop at the next full slot or at the sentinel.
+        void skip_free() noexcept {
+            while (*ctrl_ < ctrl_sentinel) {
+                unsigned n = group(ctrl_).match_free().leading_run();
+                ctrl_ += n;
+                slot_ += n;
+            }
+        }
+
+        const ctrl_t* ctrl_ = nullptr;
+        slot* slot_ = nullptr;
+    };
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    raw_table() noexcept(std::is_nothrow_default_constructible_v<Hash>&& std::is_nothrow_default_constructible_v<Eq>&&
+                             std::is_nothrow_default_constructible_v<Alloc>) = default;
+
+    explicit raw_table(size_type bucket_count, const Hash& h = Hash(), const Eq& e = Eq(), const Alloc& a = Alloc())
+        : hash_(h), eq_(e), alloc_(a) {
+        if (bucket_count) resize(normalize(bucket_count));
+    }
+
+    raw_table(const raw_table& o)
+        : hash_(o.hash_), eq_(o.eq_),
+          alloc_(std::allocator_traits<value_alloc>::select_on_container_copy_construction(o.alloc_)) {
+        copy_from(o);
+    }
+
+    raw_table(raw_table&& o) noexcept
+        : ctrl_(o.ctrl_), slots_(o.slots_), size_(o.size_), cap_(o.cap_), growth_left_(o.growth_left_),
+          hash_(std::move(o.hash_)), eq_(std::move(o.eq_)), alloc_(std::move(o.alloc_)) {
+        o.reset_storage();
+    }
+
+    raw_table& operator=(const raw_table& o) {
+        if (this != &o) {
+            clear();
+            hash_ = o.hash_;
+            eq_ = o.eq_;
+            copy_from(o);
+        }
+        return *this;
+    }
+
+    raw_table& operator=(raw_table&& o) noexcept {
+        if (this != &o) {
+            destroy_all();
+            release();
+            ctrl_ = o.ctrl_;
+            slots_ = o.slots_;
+            size_ = o.size_;
+            cap_ = o.cap_;
+            growth_left_ = o.growth_left_;
+            hash_ = std::move(o.hash_);
+            eq_ = std::move(o.eq_);
+            alloc_ = std::move(o.alloc_);
+            o.reset_storage();
+        }
+        return *this;
+    }
+
+    ~raw_table() {
+        destroy_all();
+        release();
+    }
+
+    iterator begin() noexcept {
+        iterator it(ctrl_, slots_);
+        it.skip_free();
+        return it;
+    }
+    iterator end() noexcept { return iterator(ctrl_ + cap_, slots_ + cap_); }
+    const_iterator begin() const noexcept { return const_cast<raw_table*>(this)->begin(); }
+    const_iterator end() const noexcept { return const_cast<raw_table*>(this)->end(); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    const_iterator cend() const noexcept { return end(); }
+
+    size_type size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    size_type capacity() const noexcept { return cap_; }
+    float load_factor() const noexcept { return cap_ ? float(size_) / float(cap_) : 0.0f; }
+    hasher hash_function() const { return hash_; }
+    key_equal key_eq() const { return eq_; }
+    allocator_type get_allocator() const { return allocator_type(alloc_); }
+
+    void clear() noexcept {
+        destroy_all();
+        if (cap_) {
+            std::memset(ctrl_, (unsigned char)ctrl_empty, cap_ + group_width);
+            ctrl_[cap_] = ctrl_sentinel;
+        }
+        size_ = 0;
+        growth_left_ = capacity_to_growth(cap_);
+    }
+
+    // Make room for n elements without further growth.
+    void reserve(size_type n) {
+        if (n > size_ + growth_left_) resize(normalize(n));
+    }
+    void rehash(size_type n) {
+        size_type want = normalize(n > size_ ? n : size_);
+        if (want != cap_) resize(want);
+    }
+
+    template <typename Q>
+    iterator find(const Q& key) {
+        const lookup_t<Q>& k = key;
+        return find_hashed(k, hash_(k));
+    }
+    template <typename Q>
+    const_iterator find(const Q& key) const {
+        return const_cast<raw_table*>(this)->find(key);
+    }
+    template <typename Q>
+    bool contains(const Q& key) const {
+        return find(key) != end();
+    }
+    template <typename Q>
+    size_type count(const Q& key) const {
+        return contains(key) ? 1 : 0;
+    }
+
+    iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+    iterator erase(const_iterator pos) {
+        size_type i = size_type(pos.ctrl_ - ctrl_);
+        erase_at(i);
+        return ++iterator_at(i);
+    }
+    template <typename Q>
+    size_type erase(const Q& key) {
+        iterator it = find(key);
+        if (it == end()) return 0;
+        erase_at(size_type(it.ctrl_ - ctrl_));
+        return 1;
+    }
+
+    void swap(raw_table& o) noexcept {
+        using std::swap;
+        swap(ctrl_, o.ctrl_);
+        swap(slots_, o.slots_);
+        swap(size_, o.size_);
+        swap(cap_, o.cap_);
+        swap(growth_left_, o.growth_left_);
+        swap(hash_, o.hash_);
+        swap(eq_, o.eq_);
+        swap(alloc_, o.alloc_);
+    }
+
+protected:
+    iterator iterator_at(size_type i) noexcept { return iterator(ctrl_ + i, slots_ + i); }
+
+    static size_type h1(size_type h) noexcept { return h >> 7; }
+    static ctrl_t h2(size_type h) noexcept { return ctrl_t(h & 0x7f); }
+
+    // Smallest valid capacity (2^k - 1) whose growth limit holds n.
+    static size_type normalize(size_type n) noexcept {
+        size_type cap = 1;
+        while (capacity_to_growth(cap) < n) cap = cap * 2 + 1;
+        return cap;
+    }
+
+    template <typename Q>
+    iterator find_hashed(const Q& key, size_type h) {
+        size_type offset = h1(h) & cap_, step = 0;
+        ctrl_t tag = h2(h);
+        for (;;) {
+            group g(ctrl_ + offset);
+            for (unsigned i : g.match(tag)) {
+                size_type idx = (offset + i) & cap_;
+                if (eq_(Policy::key(slots_[idx].value), key)) return iterator_at(idx);
+            }
+            if (g.match_empty()) return end();
+            step += group_width;
+            offset = (offset + step) & cap_;
+        }
+    }
+
+    // Index of key's slot, or of a free slot claimed for it (second = true);
+    // the caller must construct the element there.
+    template <typename Q>
+    std::pair<size_type, bool> find_or_prepare(const Q& lookup) {
+        const lookup_t<Q>& key = lookup;
+        size_type h = hash_(key);
+        size_type offset = h1(h) & cap_, step = 0;
+        ctrl_t tag = h2(h);
+        for (;;) {
+            group g(ctrl_ + offset);
+            for (unsigned i : g.match(tag)) {
+                size_type idx = (offset + i) & cap_;
+                if (eq_(Policy::key(slots_[idx].value), key)) return {idx, false};
+            }
+            if (g.match_empty()) break;
+            step += group_width;
+            offset = (offset + step) & cap_;
+        }
+        return {prepare_insert(h), true};
+    }
+
+    size_type prepare_insert(size_type h) {
+        size_type target = find_free(h);
+        if (growth_left_ == 0 && ctrl_[target] != ctrl_deleted) {
+            // a table mostly full of tombstones is rebuilt at the same size
+            if (cap_ > group_width && size_ * 32 <= cap_ * 25)
+                resize(cap_);
+            else
+                resize(cap_ * 2 + 1);
+            target = find_free(h);
+        }
+        growth_left_ -= ctrl_[target] == ctrl_empty;
+        set_ctrl(target, h2(h));
+        ++size_;
+        return target;
+    }
+
+    // The element at i failed to construct: give the slot back.
+    void abandon(size_type i) noexcept {
+        --size_;
+        ++growth_left_;
+        set_ctrl(i, ctrl_empty);
+    }
+
+    size_type find_free(size_type h) const noexcept {
+        size_type offset = h1(h) & cap_, step = 0;
+        for (;;) {
+            bitmask free = group(ctrl_ + offset).match_free();
+            if (free) return (offset + free.lowest()) & cap_;
+            step += group_width;
+            offset = (offset + step) & cap_;
+        }
+    }
+
+    // Writes a control byte and its mirror past the sentinel, which lets a
+    // 16-byte group load start at any slot.
+    void set_ctrl(size_type i, ctrl_t c) noexcept {
+        ctrl_[i] = c;
+        ctrl_[((i - (group_width - 1)) & cap_) + ((group_width - 1) & cap_)] = c;
+    }
+
+    void erase_at(size_type i) noexcept {
+        value_traits::destroy(alloc_, &slots_[i].value);
+        --size_;
+        // If no probe run can have passed over this slot, it can go back to
+        // empty rather than leaving a tombstone.
+        bitmask after = group(ctrl_ + i).match_empty();
+        bitmask before = group(ctrl_ + ((i - group_width) & cap_)).match_empty();
+        bool never_full = before && after && after.lowest() + before.leading_zeros() < group_width;
+        set_ctrl(i, never_full ? ctrl_empty : ctrl_deleted);
+        growth_left_ += never_full;
+    }
+
+    void resize(size_type new_cap) {
+        ctrl_t* old_ctrl = ctrl_;
+        slot* old_slots = slots_;
+        size_type old_cap = cap_;
+
+        ctrl_alloc ca(alloc_);
+        slot_alloc sa(alloc_);
+        ctrl_t* c = std::allocator_traits<ctrl_alloc>::allocate(ca, new_cap + group_width);
+        slot* s;
+        try {
+            s = std::allocator_traits<slot_alloc>::allocate(sa, new_cap);
+        } catch (...) {
+            std::allocator_traits<ctrl_alloc>::deallocate(ca, c, new_cap + group_width);
+            throw;
+        }
+        std::memset(c, (unsigned char)ctrl_empty, new_cap + group_width);
+        c[new_cap] = ctrl_sentinel;
+        ctrl_ = c;
+        slots_ = s;
+        cap_ = new_cap;
+        growth_left_ = capacity_to_growth(new_cap) - size_;
+
+        for (size_type i = 0; i < old_cap; ++i) {
+            if (old_ctrl[i] < 0) continue;
+            size_type h = hash_(Policy::key(old_slots[i].value));
+            size_type target = find_free(h);
+            set_ctrl(target, h2(h));
+            Policy::transfer(alloc_, slots_ + target, old_slots + i);
+        }
+        if (old_cap) free_storage(old_ctrl, old_slots, old_cap);
+    }
+
+    template <typename... Args>
+    void construct_at(size_type i, Args&&... args) {
+        try {
+            value_traits::construct(alloc_, &slots_[i].value, std::forward<Args>(args)...);
+        } catch (...) {
+            abandon(i);
+            throw;
+        }
+    }
+
+    ctrl_t* ctrl_ = const_cast<ctrl_t*>(empty_ctrl());
+    slot* slots_ = nullptr;
+    size_type size_ = 0;
+    size_type cap_ = 0;
+    size_type growth_left_ = 0;
+    [[no_unique_address]] Hash hash_{};
+    [[no_unique_address]] Eq eq_{};
+    [[no_unique_address]] value_alloc alloc_{};
+
+private:
+    void destroy_all() noexcept {
+        if constexpr (!std::is_trivially_destructible_v<value_type>)
+            for (size_type i = 0; i < cap_; ++i)
+                if (ctrl_[i] >= 0) value_traits::destroy(alloc_, &slots_[i].value);
+    }
+
+    void free_storage(ctrl_t* c, slot* s, size_type cap) noexcept {
+        ctrl_alloc ca(alloc_);
+        slot_alloc sa(alloc_);
+        std::allocator_traits<ctrl_alloc>::deallocate(ca, c, cap + group_width);
+        std::allocator_traits<slot_alloc>::deallocate(sa, s, cap);
+    }
+
+    void release() noexcept {
+        if (cap_) free_storage(ctrl_, slots_, cap_);
+        reset_storage();
+    }
+
+    void reset_storage() noexcept {
+        ctrl_ = const_cast<ctrl_t*>(empty_ctrl());
+        slots_ = nullptr;
+        size_ = cap_ = growth_left_ = 0;
+    }
+
+    void copy_from(const raw_table& o) {
+        reserve(o.size_);
+        for (const value_type& v : o) {
+            size_type h = hash_(Policy::key(v));
+            size_type target = prepare_insert(h);
+            construct_at(target, v);
+        }
+    }
+};
+
+} // namespace detail
+
+// --- hash_map ----------------------------------------------------------
+
+template <typename K, typename V, typename Hash = cstar::hash<K>, typename Eq = std::equal_to<>,
+          typename Alloc = std::allocator<std::pair<const K, V>>>
+class hash_map : public detail::raw_table<detail::map_policy<K, V>, Hash, Eq, Alloc> {
+    using base = detail::raw_table<detail::map_policy<K, V>, Hash, Eq, Alloc>;
+
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<const K, V>;
+    using typename base::const_iterator;
+    using typename base::iterator;
+    using typename base::size_type;
+
+    using base::base;
+    hash_map() = default;
+    hash_map(std::initializer_list<value_type> init, size_type bucket_count = 0) : base(bucket_count) {
+        this->reserve(init.size());
+        for (const value_type& v : init) insert(v);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v) { return try_emplace(v.first, v.second); }
+    std::pair<iterator, bool> insert(value_type&& v) {
+        return try_emplace(std::move(const_cast<K&>(v.first)), std::move(v.second));
+    }
+    template <typename It>
+    void insert(It first, It last) {
+        for (; first != last; ++first) insert(*first);
+    }
+
+    // Inserts value_type(args...) unless its key is present.
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        if constexpr (sizeof...(Args) == 2) {
+            return emplace_pair(std::forward<Args>(args)...);
+        } else {
+            value_type v(std::forward<Args>(args)...);
+            return insert(std::move(v));
+        }
+    }
+
+    template <typename Q, typename... Args>
+    std::pair<iterator, bool> try_emplace(Q&& key, Args&&... args) {
+        auto [i, fresh] = this->find_or_prepare(key);
+        if (fresh)
+            this->construct_at(i, std::piecewise_construct, std::forward_as_tuple(std::forward<Q>(key)),
+                               std::forward_as_tuple(std::forward<Args>(args)...));
+        return {this->iterator_at(i), fresh};
+    }
+
+    template <typename Q, typename M>
+    std::pair<iterator, bool> insert_or_assign(Q&& key, M&& value) {
+        auto r = try_emplace(std::forward<Q>(key), std::forward<M>(value));
+        if (!r.second) r.first->second = std::forward<M>(value);
+        return r;
+    }
+
+    template <typename Q>
+    V& operator[](Q&& key) {
+        return try_emplace(std::forward<Q>(key)).first->second;
+    }
+
+    template <typename Q>
+    V& at(const Q& key) {
+        iterator it = this->find(key);
+        if (it == this->end()) throw std::out_of_range("hash_map::at: key not found");
+        return it->second;
+    }
+    template <typename Q>
+    const V& at(const Q& key) const {
+        const_iterator it = this->find(key);
+        if (it == this->end()) throw std::out_of_range("hash_map::at: key not found");
+        return it->second;
+    }
+
+    friend bool operator==(const hash_map& a, const hash_map& b) {
+        if (a.size() != b.size()) return false;
+        for (const value_type& v : a) {
+            const_iterator it = b.find(v.first);
+            if (it == b.end() || !(it->second == v.second)) return false;
+        }
+        return true;
+    }
+    friend bool operator!=(const hash_map& a, const hash_map& b) { return !(a == b); }
+
+private:
+    template <typename A, typename B>
+    std::pair<iterator, bool> emplace_pair(A&& key, B&& value) {
+        return try_emplace(std::forward<A>(key), std::forward<B>(value));
+    }
+};
+
+// --- hash_set ----------------------------------------------------------
+
+template <typename K, typename Hash = cstar::hash<K>, typename Eq = std::equal_to<>, typename Alloc = std::allocator<K>>
+class hash_set : public detail::raw_table<detail::set_policy<K>, Hash, Eq, Alloc> {
+    using base = detail::raw_table<detail::set_policy<K>, Hash, Eq, Alloc>;
+
+public:
+    using key_type = K;
+    using value_type = K;
+    using typename base::const_iterator;
+    using typename base::iterator;
+    using typename base::size_type;
+
+    using base::base;
+    hash_set() = default;
+    hash_set(std::initializer_list<K> init, size_type bucket_count = 0) : base(bucket_count) {
+        this->reserve(init.size());
+        for (const K& k : init) insert(k);
+    }
+
+    std::pair<iterator, bool> insert(const K& key) { return emplace_key(key); }
+    std::pair<iterator, bool> insert(K&& key) { return emplace_key(std::move(key)); }
+    template <typename It>
+    void insert(It first, It last) {
+        for (; first != last; ++first) insert(*first);
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        if constexpr (sizeof...(Args) == 1 && (std::is_same_v<std::decay_t<Args>, K> && ...)) {
+            return emplace_key(std::forward<Args>(args)...);
+        } else {
+            K key(std::forward<Args>(args)...);
+            return emplace_key(std::move(key));
+        }
+    }
+
+    friend bool operator==(const hash_set& a, const hash_set& b) {
+        if (a.size() != b.size()) return false;
+        for (const K& k : a)
+            if (!b.contains(k)) return false;
+        return true;
+    }
+    friend bool operator!=(const hash_set& a, const hash_set& b) { return !(a == b); }
+
+private:
+    template <typename Q>
+    std::pair<iterator, bool> emplace_key(Q&& key) {
+        auto [i, fresh] = this->find_or_prepare(key);
+        if (fresh) this->construct_at(i, std::forward<Q>(key));
+        return {this->iterator_at(i), fresh};
+    }
+};
+
+} // namespace cstar
+
+#endif // CSTLIB26_HASHMAP_H
@@ -0,0 +1,155 @@
+/*
+hotreload.h - Swappable function table for `reloadable` CStar functions.
+
+With `cstarc --hot-reload`, functions declared `reloadable returnf ...` are
+compiled into a side shared library (<name>_hot.so) and every call goes
+through a cstar::hot_module slot. A watcher thread polls the .cstar source;
+when it changes, the module re-runs the transpiler and compiler into a new
+versioned library, loads it through cstar::plugins() and swaps all slots
+at once. The process keeps its heap, globals and caches.
+
+Limits: only function bodies can change. Adding, removing or re-typing a
+reloadable function needs a restart. Old library versions stay loaded,
+because another thread may still be running code from them.
+
+Set CSTAR_HOT_RELOAD=0 to disable the watcher.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_HOTRELOAD_H
+#define CSTLIB26_HOTRELOAD_H 1
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "plugin.h"
+
+namespace cstar {
+
+class hot_module {
+public:
+    // source: file to watch; library: initial side library; rebuild: shell
+    // command producing a new library at the path substituted for {out};
+    // names: reloadable functions, in slot order (exported as cstar_hot_<name>).
+    hot_module(std::string source, std::string library, std::string rebuild,
+               std::initializer_list<const char*> names,
+               std::chrono::milliseconds poll = std::chrono::milliseconds(250))
+        : source_(std::move(source)), library_(std::move(library)), rebuild_(std::move(rebuild)),
+          names_(names.begin(), names.end()), slots_(new std::atomic<void*>[names_.size()]),
+          poll_(poll) {
+        for (std::size_t i = 0; i < names_.size(); ++i) slots_[i].store(nullptr, std::memory_order_relaxed);
+        if (!swap_in(library_)) {
+            std::cerr << "hot-reload: cannot load " << library_ << ": " << error_ << std::endl;
+            std::exit(1);
+        }
+        const char* env = std::getenv("CSTAR_HOT_RELOAD");
+        if (!(env && env[0] == '0')) {
+            stamp_ = mtime();
+            watcher_ = std::thread([this] { watch(); });
+        }
+    }
+
+    hot_module(const hot_module&) = delete;
+    hot_module& operator=(const hot_module&) = delete;
+
+    ~hot_module() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        if (watcher_.joinable()) watcher_.join();
+    }
+
+    // Current implementation of slot i; cast to the function pointer type.
+    void* fn(std::size_t i) const { return slots_[i].load(std::memory_order_acquire); }
+
+    // Rebuild and swap now. On failure the old functions stay in place.
+    bool reload() {
+        std::lock_guard<std::mutex> lock(reload_mutex_);
+        std::string out = library_ + "." + std::to_string(generation_ + 1);
+        std::string cmd = rebuild_;
+        for (std::size_t p; (p = cmd.find("{out}")) != std::string::npos;) cmd.replace(p, 5, out);
+        if (std::system(cmd.c_str()) != 0) {
+            error_ = "rebuild failed: " + cmd;
+            std::cerr << "hot-reload: " << error_ << std::endl;
+            return false;
+        }
+        if (!swap_in(out)) {
+            std::cerr << "hot-reload: " << error_ << std::endl;
+            return false;
+        }
+        std::cerr << "hot-reload: swapped in " << out << std::endl;
+        return true;
+    }
+
+    // Number of successful reloads so far.
+    unsigned generation() const { return generation_; }
+
+private:
+    bool swap_in(const std::string& path) {
+        plugin* lib = plugins().preload(path);
+        if (!lib) {
+            error_ = plugins().last_error();
+            return false;
+        }
+        // resolve everything before touching a slot, so a swap is all-or-nothing
+        std::vector<void*> fns(names_.size());
+        for (std::size_t i = 0; i < names_.size(); ++i) {
+            fns[i] = lib->symbol("cstar_hot_" + names_[i]);
+            if (!fns[i]) {
+                error_ = path + " has no reloadable function " + names_[i];
+                return false;
+            }
+        }
+        for (std::size_t i = 0; i < names_.size(); ++i) slots_[i].store(fns[i], std::memory_order_release);
+        if (path != library_) ++generation_;
+        return true;
+    }
+
+    std::filesystem::file_time_type mtime() const {
+        std::error_code ec;
+        return std::filesystem::last_write_time(source_, ec);
+    }
+
+    void watch() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!cv_.wait_for(lock, poll_, [this] { return stopping_; })) {
+            auto now = mtime();
+            if (now == stamp_) continue;
+            stamp_ = now;
+            lock.unlock();
+            reload();
+            lock.lock();
+        }
+    }
+
+    std::string source_;
+    std::string library_;
+    std::string rebuild_;
+    std::vector<std::string> names_;
+    std::unique_ptr<std::atomic<void*>[]> slots_;
+    std::chrono::milliseconds poll_;
+    std::string error_;
+    std::atomic<unsigned> generation_{0};
+
+    std::filesystem::file_time_type stamp_;
+    std::mutex mutex_;
+    std::mutex reload_mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    std::thread watcher_;
+};
+
+} // namespace cstar
+
+#endif // CSTLIB26_HOTRELOAD_H
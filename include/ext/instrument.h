@@ -0,0 +1,314 @@
+/*
+instrument.h - Call counts and timings for `cstarc --instrument`.
+
+With --instrument the compiler gives every returnf function and mainfunc
+a probe, and lists them in one site table per program:
+
+    static cstar::instrument::site cstar_sites[] = {
+        {"fib", "fib.cstar", 3},
+        {"mainfunc", "fib.cstar", 1},
+    };
+    static cstar::instrument::registry cstar_site_registry(cstar_sites);
+
+    int fib(int n) { cstar::instrument::probe cstar_probe_(cstar_sites[0]); ... }
+
+When the program exits it prints, for each function that ran, the number
+of calls, inclusive time (the function and everything it called) and
+exclusive time (its own code only), with the line it was defined on.
+The report goes to stderr, or to the file named by CSTAR_INSTRUMENT.
+
+A probe reads the clock twice and updates counters that belong to the
+calling thread, so threads never share a cache line or take a lock. The
+clock is the TSC on x86 (calibrated against steady_clock when the report
+is made) and steady_clock (clock_gettime) elsewhere. Inclusive time of
+a recursive function counts the outermost call only. Counters of a
+thread are added to the totals when it exits; those of threads still
+running at exit are read as they are. bench/bench_instrument measures
+what a probe costs.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_INSTRUMENT_H
+#define CSTLIB26_INSTRUMENT_H 1
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+namespace cstar {
+namespace instrument {
+
+// One instrumented function. id is assigned when its table is registered.
+struct site {
+    const char* name;
+    const char* file;
+    int line;
+    std::uint32_t id = 0;
+};
+
+// Clock ticks: TSC cycles where there is one, otherwise nanoseconds.
+inline std::uint64_t ticks() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+inline const char* clock_name() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    return "rdtsc";
+#else
+    return "steady_clock";
+#endif
+}
+
+namespace detail {
+
+inline std::int64_t steady_ns() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Written only by the owning thread; read by the report.
+struct counter {
+    std::atomic<std::uint64_t> calls{0}, incl{0}, excl{0};
+    std::uint32_t depth = 0; // owner only: activations on the stack
+};
+
+inline void bump(std::atomic<std::uint64_t>& a, std::uint64_t v) noexcept {
+    a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+struct totals {
+    std::uint64_t calls = 0, incl = 0, excl = 0;
+};
+
+struct thread_block;
+
+struct state {
+    std::mutex lock;
+    std::vector<site*> sites;
+    std::vector<thread_block*> threads;
+    std::vector<totals> exited; // merged from threads that have ended
+    std::uint64_t tick0 = 0;
+    std::int64_t ns0 = 0;
+};
+
+// Never destroyed: threads may still exit after static destructors run.
+inline state& global() {
+    static state* s = new state;
+    return *s;
+}
+
+struct frame {
+    std::uint64_t start = 0;
+    std::uint64_t children = 0; // inclusive ticks of finished callees
+    frame* parent = nullptr;
+    std::uint32_t id = 0;
+};
+
+struct thread_block {
+    counter* c = nullptr;
+    std::size_t n = 0;
+    frame* top = nullptr;
+
+    // Make room for site id. The report reads c under the lock, so the
+    // array is only swapped while holding it.
+    void grow(std::uint32_t id) {
+        state& g = global();
+        std::lock_guard<std::mutex> hold(g.lock);
+        std::size_t size = std::max<std::size_t>(g.sites.size(), (std::size_t)id + 1);
+        counter* bigger = new counter[size];
+        for (std::size_t i = 0; i < n; ++i) {
+            bigger[i].calls.store(c[i].calls.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            bigger[i].incl.store(c[i].incl.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            bigger[i].excl.store(c[i].excl.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            bigger[i].depth = c[i].depth;
+        }
+        if (!c) g.threads.push_back(this);
+        delete[] c;
+        c = bigger;
+        n = size;
+    }
+
+    ~thread_block() {
+        if (!c) return;
+        // calls still open (exit() from inside a function) count up to now;
+        // inner is the inclusive time of the open callee
+        std::uint64_t now = ticks(), inner = 0;
+        for (frame* f = top; f; f = f->parent) {
+            std::uint64_t t = now - f->start;
+            counter& k = c[f->id];
+            bump(k.calls, 1);
+            if (--k.depth == 0) bump(k.incl, t);
+            bump(k.excl, t - f->children - inner);
+            inner = t;
+        }
+        top = nullptr;
+        state& g = global();
+        std::lock_guard<std::mutex> hold(g.lock);
+        if (g.exited.size() < n) g.exited.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            g.exited[i].calls += c[i].calls.load(std::memory_order_relaxed);
+            g.exited[i].incl += c[i].incl.load(std::memory_order_relaxed);
+            g.exited[i].excl += c[i].excl.load(std::memory_order_relaxed);
+        }
+        g.threads.erase(std::remove(g.threads.begin(), g.threads.end(), this), g.threads.end());
+        delete[] c;
+        c = nullptr;
+        n = 0;
+    }
+};
+
+inline thread_local thread_block block;
+
+} // namespace detail
+
+// Scoped probe: one call of s, from construction to destruction.
+class probe {
+public:
+    explicit probe(site& s) noexcept {
+        detail::thread_block& b = detail::block;
+        if (s.id >= b.n) b.grow(s.id);
+        f_.id = s.id;
+        f_.parent = b.top;
+        b.top = &f_;
+        ++b.c[s.id].depth;
+        f_.start = ticks();
+    }
+
+    ~probe() {
+        std::uint64_t t = ticks() - f_.start;
+        detail::thread_block& b = detail::block;
+        detail::counter& k = b.c[f_.id];
+        detail::bump(k.calls, 1);
+        if (--k.depth == 0) detail::bump(k.incl, t);
+        detail::bump(k.excl, t - f_.children);
+        if (f_.parent) f_.parent->children += t;
+        b.top = f_.parent;
+    }
+
+    probe(const probe&) = delete;
+    probe& operator=(const probe&) = delete;
+
+private:
+    detail::frame f_;
+};
+
+// Per-site results, in nanoseconds.
+struct result {
+    const site* where;
+    std::uint64_t calls;
+    double incl_ns, excl_ns;
+};
+
+// What the exit report prints, for calls finished so far.
+inline std::vector<result> results() {
+    detail::state& g = detail::global();
+    std::vector<detail::totals> sum;
+    std::vector<site*> sites;
+    std::uint64_t tick0;
+    std::int64_t ns0;
+    {
+        std::lock_guard<std::mutex> hold(g.lock);
+        sites = g.sites;
+        sum = g.exited;
+        sum.resize(sites.size());
+        for (detail::thread_block* t : g.threads)
+            for (std::size_t i = 0; i < t->n && i < sum.size(); ++i) {
+                sum[i].calls += t->c[i].calls.load(std::memory_order_relaxed);
+                sum[i].incl += t->c[i].incl.load(std::memory_order_relaxed);
+                sum[i].excl += t->c[i].excl.load(std::memory_order_relaxed);
+            }
+        tick0 = g.tick0;
+        ns0 = g.ns0;
+    }
+
+    // ns per tick over the whole run; a short run is topped up so the
+    // ratio is measured over at least 20 ms
+    double ns_per_tick = 1.0;
+#if defined(__x86_64__) || defined(__i386__)
+    std::int64_t ns1 = detail::steady_ns();
+    if (ns1 - ns0 < 20'000'000) std::this_thread::sleep_for(std::chrono::nanoseconds(20'000'000 - (ns1 - ns0)));
+    std::uint64_t tick1 = ticks();
+    ns1 = detail::steady_ns();
+    if (tick1 > tick0) ns_per_tick = (double)(ns1 - ns0) / (double)(tick1 - tick0);
+#else
+    (void)tick0;
+    (void)ns0;
+#endif
+
+    std::vector<result> out;
+    for (std::size_t i = 0; i < sites.size(); ++i)
+        if (sum[i].calls)
+            out.push_back({sites[i], sum[i].calls, (double)sum[i].incl * ns_per_tick, (double)sum[i].excl * ns_per_tick});
+    std::sort(out.begin(), out.end(), [](const result& a, const result& b) { return a.excl_ns > b.excl_ns; });
+    return out;
+}
+
+// The table printed at exit, most exclusive time first.
+inline void report(std::FILE* out) {
+    std::vector<result> rs = results();
+    std::fprintf(out, "\n--- cstar --instrument (%s) ---\n", clock_name());
+    std::fprintf(out, "%12s %12s %12s %12s  %s\n", "calls", "incl ms", "excl ms", "excl ns/call", "function");
+    for (const result& r : rs)
+        std::fprintf(out, "%12llu %12.3f %12.3f %12.1f  %s (%s:%d)\n", (unsigned long long)r.calls, r.incl_ns / 1e6,
+                     r.excl_ns / 1e6, r.excl_ns / (double)r.calls, r.where->name, r.where->file, r.where->line);
+}
+
+namespace detail {
+
+inline void report_at_exit() {
+    const char* path = std::getenv("CSTAR_INSTRUMENT");
+    std::fflush(stdout); // after what the program printed
+    std::FILE* out = path && *path ? std::fopen(path, "w") : nullptr;
+    report(out ? out : stderr);
+    if (out) std::fclose(out);
+}
+
+} // namespace detail
+
+// Registers a program's site table and arranges for the exit report.
+class registry {
+public:
+    template <std::size_t N>
+    explicit registry(site (&sites)[N]) {
+        detail::state& g = detail::global();
+        bool first;
+        {
+            std::lock_guard<std::mutex> hold(g.lock);
+            first = g.sites.empty();
+            for (site& s : sites) {
+                s.id = (std::uint32_t)g.sites.size();
+                g.sites.push_back(&s);
+            }
+            if (first) {
+                g.tick0 = ticks();
+                g.ns0 = detail::steady_ns();
+            }
+        }
+        if (first) std::atexit(detail::report_at_exit);
+    }
+
+    registry(const registry&) = delete;
+    registry& operator=(const registry&) = delete;
+};
+
+} // namespace instrument
+} // namespace cstar
+
+#endif // CSTLIB26_INSTRUMENT_H
@@ -0,0 +1,521 @@
+/*
+memstats.h - Heap statistics for `cstarc --memstats`.
+
+Replaces the global operator new and operator delete, so it must be
+included in exactly one translation unit of a program. cstarc includes
+it in the generated program when given --memstats. At exit the program
+reports to stderr, or to the file named by CSTAR_MEMSTATS:
+
+  - allocations, frees and bytes, counted exactly;
+  - a histogram of allocation sizes (powers of two);
+  - peak and final live bytes. The peak is exact within 64 KiB per
+    thread, because threads publish their live bytes in steps;
+  - the call sites that allocate most, with estimated allocations,
+    bytes, peak live bytes and bytes still live at exit. A site reached
+    through several stacks shows the sum of their peaks.
+
+Call sites are sampled by bytes, like tcmalloc's heap profiler. On
+average one allocation per CSTAR_MEMSTATS_RATE bytes (default 256 KiB)
+has its stack recorded. Each sample is weighted by how many
+allocations of its size it stands for, so the estimates are unbiased.
+CSTAR_MEMSTATS_RATE=1 records every allocation. A site is named by the
+first frame on its stack that comes from the program rather than from
+the standard library. Code built by --memstats has debug info and #line
+directives, so this frame names a .cstar line.
+
+Every block carries a 16-byte header with its size and sample. Other
+allocations cost a few thread-local increments. Call sites need glibc's
+backtrace(); elsewhere only the totals and the histogram are kept.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_MEMSTATS_H
+#define CSTLIB26_MEMSTATS_H 1
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include "profiler.h"
+
+#if defined(__GLIBC__) && defined(CSTAR_PROFILER_SUPPORTED)
+    #define CSTAR_MEMSTATS_SITES 1
+    #include <execinfo.h>
+    #include <pthread.h>
+#endif
+
+namespace cstar {
+namespace memstats {
+
+constexpr unsigned histogram_buckets = 48; // bucket b: sizes in (2^(b-1), 2^b]
+
+struct totals {
+    std::uint64_t allocations = 0, frees = 0;
+    std::uint64_t bytes = 0, freed_bytes = 0;
+    std::int64_t live_bytes = 0, peak_live_bytes = 0;
+    std::uint64_t histogram[histogram_buckets] = {};
+};
+
+// One call site, as estimated from samples.
+struct site_stats {
+    std::string where; // "function (file:line)" once resolved
+    std::uint64_t samples = 0;
+    double allocations = 0, bytes = 0, live_bytes = 0, peak_live_bytes = 0;
+};
+
+namespace detail {
+
+constexpr std::size_t header_size = 16;
+constexpr unsigned max_frames = 12;
+constexpr unsigned max_sites = 4096;
+constexpr std::int64_t live_step = 64 * 1024;
+
+struct header {
+    std::uint64_t size;
+    std::uint32_t site;   // 1 + index into the site table; 0 when not sampled
+    std::uint32_t offset; // from the malloc'd block to the user pointer
+};
+static_assert(sizeof(header) == header_size);
+
+inline unsigned bucket(std::size_t size) noexcept {
+    if (size <= 1) return 0;
+    unsigned b = 64 - (unsigned)__builtin_clzll((unsigned long long)(size - 1));
+    return b < histogram_buckets ? b : histogram_buckets - 1;
+}
+
+// Counters of one thread. Constant-initialized and trivially destructible,
+// so operator new can use them at any time, even before main.
+struct thread_counts {
+    std::atomic<std::uint64_t> allocations, frees, bytes, freed_bytes;
+    std::atomic<std::uint64_t> histogram[histogram_buckets];
+    std::int64_t live_delta;     // not yet added to the shared live count
+    std::int64_t until_sample;   // bytes left before the next sample
+    std::uint64_t rng;
+    bool registered, busy;
+};
+
+inline thread_local thread_counts mine{};
+
+struct sampled_site {
+    std::uint64_t hash;
+    std::uint32_t depth;
+    std::uintptr_t pc[max_frames];
+    std::uint64_t samples;
+    double allocations, bytes, live_bytes, peak_live_bytes;
+};
+
+struct shared {
+    std::atomic<std::uint64_t> allocations{0}, frees{0}, bytes{0}, freed_bytes{0};
+    std::atomic<std::uint64_t> histogram[histogram_buckets] = {};
+    std::atomic<std::int64_t> live{0}, peak{0};
+    std::atomic<std::int64_t> rate{0}; // mean bytes between samples; 0 until read
+    std::atomic_flag lock = ATOMIC_FLAG_INIT;
+    thread_counts* threads[1024] = {};
+    unsigned nthreads = 0;
+    sampled_site sites[max_sites] = {};
+    unsigned nsites = 0;
+};
+
+inline shared g{};
+
+struct spin {
+    spin() noexcept {
+        while (g.lock.test_and_set(std::memory_order_acquire)) {}
+    }
+    ~spin() { g.lock.clear(std::memory_order_release); }
+};
+
+inline void add(std::atomic<std::uint64_t>& a, std::uint64_t v) noexcept {
+    a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+inline void publish_live(thread_counts& t) noexcept {
+    std::int64_t now = g.live.fetch_add(t.live_delta, std::memory_order_relaxed) + t.live_delta;
+    t.live_delta = 0;
+    std::int64_t peak = g.peak.load(std::memory_order_relaxed);
+    while (now > peak && !g.peak.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {}
+}
+
+// Move a thread's counts into the shared ones. Caller holds the lock.
+inline void retire(thread_counts& t) noexcept {
+    add(g.allocations, t.allocations.exchange(0, std::memory_order_relaxed));
+    add(g.frees, t.frees.exchange(0, std::memory_order_relaxed));
+    add(g.bytes, t.bytes.exchange(0, std::memory_order_relaxed));
+    add(g.freed_bytes, t.freed_bytes.exchange(0, std::memory_order_relaxed));
+    for (unsigned b = 0; b < histogram_buckets; ++b)
+        add(g.histogram[b], t.histogram[b].exchange(0, std::memory_order_relaxed));
+    for (unsigned i = 0; i < g.nthreads; ++i)
+        if (g.threads[i] == &t) {
+            g.threads[i] = g.threads[--g.nthreads];
+            break;
+        }
+    t.registered = false;
+}
+
+#if defined(CSTAR_MEMSTATS_SITES)
+inline void thread_exit(void*) {
+    thread_counts& t = mine;
+    publish_live(t);
+    spin hold;
+    retire(t);
+}
+
+inline pthread_key_t exit_key() {
+    static pthread_key_t key = [] {
+        pthread_key_t k;
+        pthread_key_create(&k, thread_exit);
+        return k;
+    }();
+    return key;
+}
+#endif
+
+inline void enroll(thread_counts& t) noexcept {
+    t.registered = true;
+    t.rng = (std::uint64_t)(std::uintptr_t)&t * 0x9E3779B97F4A7C15ull | 1;
+    {
+        spin hold;
+        if (g.nthreads < sizeof g.threads / sizeof g.threads[0]) g.threads[g.nthreads++] = &t;
+    }
+#if defined(CSTAR_MEMSTATS_SITES)
+    pthread_setspecific(exit_key(), &t); // thread_exit() retires the counts
+#endif
+}
+
+inline std::int64_t rate() noexcept {
+    std::int64_t r = g.rate.load(std::memory_order_relaxed);
+    if (r) return r;
+    const char* env = std::getenv("CSTAR_MEMSTATS_RATE");
+    r = env ? std::atoll(env) : 0;
+    if (r <= 0) r = 256 * 1024;
+    g.rate.store(r, std::memory_order_relaxed);
+    return r;
+}
+
+// Exponentially distributed gap to the next sample, mean rate() bytes.
+inline std::int64_t next_gap(thread_counts& t) noexcept {
+    std::int64_t r = rate();
+    if (r == 1) return 0;
+    t.rng ^= t.rng << 13;
+    t.rng ^= t.rng >> 7;
+    t.rng ^= t.rng << 17;
+    double u = ((double)(t.rng >> 11) + 0.5) / 9007199254740992.0;
+    return (std::int64_t)(-std::log(u) * (double)r);
+}
+
+// How many allocations of this size one sample stands for.
+inline double weight(std::uint64_t size) noexcept {
+    std::int64_t r = rate();
+    if (r == 1 || size == 0) return 1.0;
+    return 1.0 / (1.0 - std::exp(-(double)size / (double)r));
+}
+
+inline std::uint32_t sample(std::uint64_t size) noexcept {
+#if defined(CSTAR_MEMSTATS_SITES)
+    thread_counts& t = mine;
+    if (t.busy) return 0;
+    t.busy = true; // backtrace() may allocate the first time
+    void* frames[max_frames + 2];
+    int n = backtrace(frames, max_frames + 2);
+    t.busy = false;
+    if (n <= 2) return 0;
+    // the first two frames are sample() and operator new
+    std::uintptr_t pc[max_frames];
+    std::uint32_t depth = (std::uint32_t)std::min<int>(n - 2, (int)max_frames);
+    std::uint64_t hash = 1469598103934665603ull;
+    for (std::uint32_t i = 0; i < depth; ++i) {
+        pc[i] = (std::uintptr_t)frames[i + 2];
+        hash = (hash ^ pc[i]) * 1099511628211ull;
+    }
+    double w = weight(size);
+    spin hold;
+    unsigned slot = (unsigned)(hash % max_sites);
+    for (unsigned probe = 0; probe < max_sites; ++probe, slot = (slot + 1) % max_sites) {
+        sampled_site& s = g.sites[slot];
+        if (s.samples == 0) {
+            if (g.nsites + 1 >= max_sites) return 0;
+            ++g.nsites;
+            s.hash = hash;
+            s.depth = depth;
+            std::memcpy(s.pc, pc, depth * sizeof pc[0]);
+        } else if (s.hash != hash || s.depth != depth || std::memcmp(s.pc, pc, depth * sizeof pc[0]) != 0) {
+            continue;
+        }
+        s.samples++;
+        s.allocations += w;
+        s.bytes += w * (double)size;
+        s.live_bytes += w * (double)size;
+        s.peak_live_bytes = std::max(s.peak_live_bytes, s.live_bytes);
+        return slot + 1;
+    }
+#else
+    (void)size;
+#endif
+    return 0;
+}
+
+inline void* allocate(std::size_t size, std::size_t align) noexcept {
+    std::size_t extra = align > header_size ? align : 0;
+    if (size > SIZE_MAX - header_size - extra) return nullptr;
+    char* raw = static_cast<char*>(std::malloc(size + header_size + extra));
+    if (!raw) return nullptr;
+    char* user = raw + header_size;
+    if (extra) user = reinterpret_cast<char*>((reinterpret_cast<std::uintptr_t>(raw) + header_size + align - 1) & ~(std::uintptr_t)(align - 1));
+    header* h = reinterpret_cast<header*>(user - header_size);
+    h->size = size;
+    h->site = 0;
+    h->offset = (std::uint32_t)(user - raw);
+
+    thread_counts& t = mine;
+    if (!t.registered) enroll(t);
+    add(t.allocations, 1);
+    add(t.bytes, size);
+    add(t.histogram[bucket(size)], 1);
+    t.live_delta += (std::int64_t)size;
+    if (t.live_delta > live_step) publish_live(t);
+    t.until_sample -= (std::int64_t)size;
+    if (t.until_sample < 0) {
+        t.until_sample = next_gap(t);
+        h->site = sample(size);
+    }
+    return user;
+}
+
+inline void release(void* p) noexcept {
+    if (!p) return;
+    header* h = reinterpret_cast<header*>(static_cast<char*>(p) - header_size);
+    std::uint64_t size = h->size;
+    thread_counts& t = mine;
+    if (!t.registered) enroll(t); // a thread may free without ever allocating
+    add(t.frees, 1);
+    add(t.freed_bytes, size);
+    t.live_delta -= (std::int64_t)size;
+    if (t.live_delta < -live_step) publish_live(t);
+    if (h->site) {
+        spin hold;
+        g.sites[h->site - 1].live_bytes -= weight(size) * (double)size;
+    }
+    std::free(static_cast<char*>(p) - h->offset);
+}
+
+inline void* allocate_or_throw(std::size_t size, std::size_t align) {
+    for (;;) {
+        if (void* p = allocate(size, align)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+} // namespace detail
+
+// Record every allocation's call site from now on (rate 1), or one per
+// `bytes` bytes on average.
+inline void set_sample_rate(std::int64_t bytes) noexcept {
+    detail::g.rate.store(bytes > 0 ? bytes : 1, std::memory_order_relaxed);
+}
+
+inline totals current() noexcept {
+    using namespace detail;
+    publish_live(mine);
+    totals r;
+    spin hold;
+    r.allocations = g.allocations.load(std::memory_order_relaxed);
+    r.frees = g.frees.load(std::memory_order_relaxed);
+    r.bytes = g.bytes.load(std::memory_order_relaxed);
+    r.freed_bytes = g.freed_bytes.load(std::memory_order_relaxed);
+    for (unsigned b = 0; b < histogram_buckets; ++b) r.histogram[b] = g.histogram[b].load(std::memory_order_relaxed);
+    for (unsigned i = 0; i < g.nthreads; ++i) {
+        thread_counts& t = *g.threads[i];
+        r.allocations += t.allocations.load(std::memory_order_relaxed);
+        r.frees += t.frees.load(std::memory_order_relaxed);
+        r.bytes += t.bytes.load(std::memory_order_relaxed);
+        r.freed_bytes += t.freed_bytes.load(std::memory_order_relaxed);
+        for (unsigned b = 0; b < histogram_buckets; ++b) r.histogram[b] += t.histogram[b].load(std::memory_order_relaxed);
+    }
+    r.live_bytes = (std::int64_t)(r.bytes - r.freed_bytes);
+    r.peak_live_bytes = std::max(g.peak.load(std::memory_order_relaxed), r.live_bytes);
+    return r;
+}
+
+namespace detail {
+
+// Standard library and runtime code, which is never the site reported
+// when the program's own code is further up the stack.
+inline bool library_frame(const std::string& name, const std::string& file) {
+    static const char* const prefixes[] = {"std::", "__gnu_cxx::", "operator new", "cstar::", "void* operator new", "__"};
+    if (name.empty()) return true;
+    for (const char* p : prefixes)
+        if (name.rfind(p, 0) == 0) return true;
+    bool header = file.size() > 2 && file.compare(file.size() - 2, 2, ".h") == 0;
+    return header || (!file.empty() && file.find('.') == std::string::npos); // <vector> and friends
+}
+
+inline bool cstar_frame(const std::string& file) {
+    return file.size() > 6 && file.compare(file.size() - 6, 6, ".cstar") == 0;
+}
+
+} // namespace detail
+
+// Sampled call sites, most bytes first. Stacks are resolved to the first
+// frame of the program's own code (see the top of this file).
+inline std::vector<site_stats> sites() {
+    using namespace detail;
+    // nothing may allocate under the lock: freeing a sampled block takes it
+    std::vector<sampled_site> raw;
+    raw.reserve(max_sites);
+    {
+        spin hold;
+        for (const sampled_site& s : g.sites)
+            if (s.samples) raw.push_back(s);
+    }
+    std::vector<site_stats> out;
+#if defined(CSTAR_MEMSTATS_SITES)
+    char exe[4096];
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof exe - 1);
+    Dl_info self{};
+    dladdr(reinterpret_cast<void*>(&detail::release), &self);
+    std::vector<std::uintptr_t> addrs;
+    std::vector<profiler::detail::frame_name> names;
+    std::vector<std::size_t> first(raw.size() + 1);
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+        first[i] = names.size();
+        for (std::uint32_t f = 0; f < raw[i].depth; ++f) names.emplace_back(), addrs.push_back(raw[i].pc[f] - 1);
+    }
+    first[raw.size()] = names.size();
+    std::vector<std::uintptr_t> exe_addrs;
+    std::vector<profiler::detail::frame_name*> exe_names;
+    for (std::size_t k = 0; k < addrs.size(); ++k) {
+        Dl_info info{};
+        if (!dladdr(reinterpret_cast<void*>(addrs[k]), &info)) continue;
+        if (info.dli_sname) names[k].function = profiler::detail::demangle(info.dli_sname);
+        if (self.dli_fbase && info.dli_fbase == self.dli_fbase) {
+            const auto* ehdr = reinterpret_cast<const ElfW(Ehdr)*>(info.dli_fbase);
+            exe_addrs.push_back(ehdr->e_type == ET_EXEC ? addrs[k] : addrs[k] - (std::uintptr_t)info.dli_fbase);
+            exe_names.push_back(&names[k]);
+        }
+    }
+    if (len > 0 && !exe_addrs.empty())
+        profiler::detail::addr2line(std::string(exe, (std::size_t)len), exe_addrs, exe_names);
+
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+        std::size_t pick = first[i + 1];
+        for (std::size_t k = first[i]; k < first[i + 1] && pick == first[i + 1]; ++k)
+            if (cstar_frame(names[k].file)) pick = k;
+        for (std::size_t k = first[i]; k < first[i + 1] && pick == first[i + 1]; ++k)
+            if (!library_frame(names[k].function, names[k].file)) pick = k;
+        if (pick == first[i + 1]) pick = first[i];
+        const auto& n = names[pick];
+        std::string where = n.function.empty() ? "?" : n.function;
+        if (!n.file.empty() && n.line > 0) where += " (" + n.file + ":" + std::to_string(n.line) + ")";
+        auto it = std::find_if(out.begin(), out.end(), [&](const site_stats& s) { return s.where == where; });
+        if (it == out.end()) {
+            out.emplace_back();
+            it = out.end() - 1;
+            it->where = where;
+        }
+        it->samples += raw[i].samples;
+        it->allocations += raw[i].allocations;
+        it->bytes += raw[i].bytes;
+        it->live_bytes += std::max(0.0, raw[i].live_bytes);
+        it->peak_live_bytes += raw[i].peak_live_bytes;
+    }
+#endif
+    std::sort(out.begin(), out.end(), [](const site_stats& a, const site_stats& b) { return a.bytes > b.bytes; });
+    return out;
+}
+
+namespace detail {
+
+inline std::string human(double bytes) {
+    static const char* const units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    int u = 0;
+    while (bytes >= 1024 && u < 4) bytes /= 1024, ++u;
+    char buf[32];
+    std::snprintf(buf, sizeof buf, u ? "%.1f %s" : "%.0f %s", bytes, units[u]);
+    return buf;
+}
+
+} // namespace detail
+
+inline void report(std::FILE* out, std::size_t top = 20) {
+    totals t = current(); // before the report allocates anything itself
+    bool& busy = detail::mine.busy; // and keep its allocations out of the sites
+    bool was = busy;
+    busy = true;
+    std::vector<site_stats> ss = sites();
+    busy = was;
+    using detail::human;
+    std::fprintf(out, "\n--- cstar --memstats ---\n");
+    std::fprintf(out, "  %-14s %12llu  %s\n", "allocations", (unsigned long long)t.allocations, human((double)t.bytes).c_str());
+    std::fprintf(out, "  %-14s %12llu  %s\n", "frees", (unsigned long long)t.frees, human((double)t.freed_bytes).c_str());
+    std::fprintf(out, "  %-14s %12s\n", "peak live", human((double)t.peak_live_bytes).c_str());
+    std::fprintf(out, "  %-14s %12s  in %llu blocks\n", "live at exit", human((double)t.live_bytes).c_str(),
+                 (unsigned long long)(t.allocations - t.frees));
+    std::fprintf(out, "\n  %-14s %12s\n", "size", "allocations");
+    for (unsigned b = 0; b < histogram_buckets; ++b) {
+        if (!t.histogram[b]) continue;
+        char range[40];
+        if (b == 0) std::snprintf(range, sizeof range, "0-1");
+        else std::snprintf(range, sizeof range, "%llu-%llu", (1ull << (b - 1)) + 1, 1ull << b);
+        std::fprintf(out, "  %-14s %12llu\n", range, (unsigned long long)t.histogram[b]);
+    }
+    if (ss.empty()) return;
+    std::fprintf(out, "\n  call sites (sampled every %s on average)\n", human((double)detail::rate()).c_str());
+    std::fprintf(out, "  %12s %12s %12s %12s  %s\n", "allocations", "bytes", "peak live", "live at exit", "site");
+    for (std::size_t i = 0; i < ss.size() && i < top; ++i)
+        std::fprintf(out, "  %12.0f %12s %12s %12s  %s\n", ss[i].allocations, human(ss[i].bytes).c_str(),
+                     human(ss[i].peak_live_bytes).c_str(), human(ss[i].live_bytes).c_str(), ss[i].where.c_str());
+}
+
+namespace detail {
+
+inline void report_at_exit() {
+    std::fflush(stdout);
+    const char* path = std::getenv("CSTAR_MEMSTATS");
+    std::FILE* out = path && *path ? std::fopen(path, "w") : nullptr;
+    report(out ? out : stderr);
+    if (out) std::fclose(out);
+}
+
+inline const bool report_registered = (std::atexit(report_at_exit), true);
+
+} // namespace detail
+
+} // namespace memstats
+} // namespace cstar
+
+// The replacements: every new and delete in the program comes here.
+void* operator new(std::size_t n) { return cstar::memstats::detail::allocate_or_throw(n, 0); }
+void* operator new[](std::size_t n) { return cstar::memstats::detail::allocate_or_throw(n, 0); }
+void* operator new(std::size_t n, std::align_val_t a) { return cstar::memstats::detail::allocate_or_throw(n, (std::size_t)a); }
+void* operator new[](std::size_t n, std::align_val_t a) { return cstar::memstats::detail::allocate_or_throw(n, (std::size_t)a); }
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept { return cstar::memstats::detail::allocate(n, 0); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept { return cstar::memstats::detail::allocate(n, 0); }
+void* operator new(std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept {
+    return cstar::memstats::detail::allocate(n, (std::size_t)a);
+}
+void* operator new[](std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept {
+    return cstar::memstats::detail::allocate(n, (std::size_t)a);
+}
+void operator delete(void* p) noexcept { cstar::memstats::detail::release(p); }
+void operator delete[](void* p) noexcept { cstar::memstats::detail::release(p); }
+void operator delete(void* p, std::size_t) noexcept { cstar::memstats::detail::release(p); }
+void operator delete[](void* p, std::size_t) noexcept { cstar::memstats::detail::release(p); }
+void operator delete(void* p, std::align_val_t) noexcept { cstar::memstats::detail::release(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { cstar::memstats::detail::release(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { cstar::memstats::detail::release(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { cstar::memstats::detail::release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { cstar::memstats::detail::release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { cstar::memstats::detail::release(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { cstar::memstats::detail::release(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { cstar::memstats::detail::release(p); }
+
+#endif // CSTLIB26_MEMSTATS_H
@@ -0,0 +1,531 @@
+/*
+parallel.h - Work-stealing thread pool and parallel algorithms for CStar.
+
+cstar::thread_pool runs fork-join work on a fixed set of worker threads.
+Each worker owns a Chase-Lev deque: it pushes and pops its own tasks at
+the bottom without locking, and idle workers steal from the top of
+someone else's. Forked tasks live on the forking thread's stack, so
+splitting work allocates nothing. Idle workers spin briefly, then sleep
+until new work is pushed.
+
+The algorithms split a range in halves until pieces are no bigger than
+the grain. By default that is about eight pieces per worker; pass a grain
+to set the piece size yourself:
+
+    cstar::parallel_for(0, n, [&](std::size_t i) { out[i] = f(in[i]); });
+    cstar::parallel_for(0, n, [&](std::size_t lo, std::size_t hi) { ... }, 4096);
+    double s = cstar::parallel_reduce(0, n, 0.0, [&](std::size_t i) { return v[i]; },
+                                      [](double a, double b) { return a + b; });
+    cstar::parallel_sort(v.begin(), v.end());
+
+All of them use cstar::default_pool(), one pool per process sized to the
+machine (or CSTAR_THREADS), so nested and concurrent calls share the same
+threads instead of multiplying them. Every function also has an overload
+that takes a thread_pool& first. A call from outside the pool hands its
+root task to a worker and blocks until the work is done. Exceptions
+thrown by a task are rethrown to the caller.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_PARALLEL_H
+#define CSTLIB26_PARALLEL_H 1
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cstar {
+
+class thread_pool;
+
+namespace detail {
+
+inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// A unit of forked work. Tasks live on the stack of the thread that forked
+// them, which waits for done before returning.
+struct task {
+    void (*fn)(task*);
+    bool external = false;
+    std::atomic<bool> done{false};
+    std::exception_ptr error;
+};
+
+template <typename F>
+struct fn_task : task {
+    F* f;
+    explicit fn_task(F& body) : f(&body) { fn = &call; }
+    static void call(task* t) { (*static_cast<fn_task*>(t)->f)(); }
+};
+
+// Chase-Lev work-stealing deque with the C11 orderings of Le, Pop, Cohen
+// and Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak
+// Memory Models" (PPoPP 2013). Only the owner calls push and take; any
+// thread may steal. Grown buffers are kept until the deque dies, because
+// a thief may still be reading the old one.
+class ws_deque {
+public:
+    ws_deque() : array_(new ring(256)) {}
+    ~ws_deque() { delete array_.load(std::memory_order_relaxed); }
+
+    ws_deque(const ws_deque&) = delete;
+    ws_deque& operator=(const ws_deque&) = delete;
+
+    void push(task* t) {
+        std::int64_t b = bottom_.load(std::memory_order_relaxed);
+        std::int64_t top = top_.load(std::memory_order_acquire);
+        ring* a = array_.load(std::memory_order_relaxed);
+        if (b - top > a->mask) a = grow(a, top, b);
+        a->put(b, t);
+        bottom_.store(b + 1, std::memory_order_release); // publishes t to thieves
+    }
+
+    task* take() {
+        std::int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        ring* a = array_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        task* x = a->get(b);
+        if (t == b) {
+            // last element: race the thieves for it
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                x = nullptr;
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return x;
+    }
+
+    task* steal() {
+        std::int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+        task* x = array_.load(std::memory_order_acquire)->get(t);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr; // lost to another thief or the owner
+        return x;
+    }
+
+    bool empty() const {
+        return top_.load(std::memory_order_relaxed) >= bottom_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct ring {
+        std::int64_t mask;
+        std::unique_ptr<std::atomic<task*>[]> slots;
+        explicit ring(std::int64_t capacity) : mask(capacity - 1), slots(new std::atomic<task*>[capacity]) {}
+        task* get(std::int64_t i) const { return slots[i & mask].load(std::memory_order_relaxed); }
+        void put(std::int64_t i, task* t) { slots[i & mask].store(t, std::memory_order_relaxed); }
+    };
+
+    ring* grow(ring* old, std::int64_t top, std::int64_t bottom) {
+        ring* bigger = new ring(2 * (old->mask + 1));
+        for (std::int64_t i = top; i < bottom; ++i) bigger->put(i, old->get(i));
+        retired_.emplace_back(old);
+        array_.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    alignas(64) std::atomic<std::int64_t> top_{0};
+    alignas(64) std::atomic<std::int64_t> bottom_{0};
+    std::atomic<ring*> array_;
+    std::vector<std::unique_ptr<ring>> retired_;
+};
+
+struct worker {
+    ws_deque deque;
+    thread_pool* pool = nullptr;
+    unsigned index = 0;
+    std::uint64_t rng = 0;
+};
+
+inline thread_local worker* current_worker = nullptr;
+
+inline unsigned default_threads() {
+    if (const char* env = std::getenv("CSTAR_THREADS")) {
+        long n = std::strtol(env, nullptr, 10);
+        if (n > 0) return (unsigned)n;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+} // namespace detail
+
+class thread_pool {
+public:
+    // threads = 0 starts one worker per hardware thread.
+    explicit thread_pool(unsigned threads = 0) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        workers_.reserve(threads);
+        for (unsigned i = 0; i < threads; ++i) {
+            workers_.emplace_back(new detail::worker);
+            workers_[i]->pool = this;
+            workers_[i]->index = i;
+            workers_[i]->rng = 0x9E3779B97F4A7C15ull * (i + 1);
+        }
+        threads_.reserve(threads);
+        for (unsigned i = 0; i < threads; ++i) threads_.emplace_back([this, i] { work(*workers_[i]); });
+    }
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mu_);
+            stop_.store(true, std::memory_order_relaxed);
+        }
+        sleep_cv_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    unsigned size() const noexcept { return (unsigned)workers_.size(); }
+
+    // True on one of this pool's worker threads.
+    bool in_pool() const noexcept { return detail::current_worker && detail::current_worker->pool == this; }
+
+    // Run f on a worker and wait for it. Inside the pool, f just runs.
+    template <typename F>
+    void run(F&& f) {
+        if (in_pool()) {
+            f();
+            return;
+        }
+        detail::fn_task<std::remove_reference_t<F>> job(f);
+        job.external = true;
+        {
+            std::lock_guard<std::mutex> lock(inject_mu_);
+            injected_.push_back(&job);
+            injected_count_.fetch_add(1, std::memory_order_relaxed);
+        }
+        wake_one();
+        {
+            std::unique_lock<std::mutex> lock(done_mu_);
+            done_cv_.wait(lock, [&] { return job.done.load(std::memory_order_relaxed); });
+        }
+        if (job.error) std::rethrow_exception(job.error);
+    }
+
+    // Run f and g, possibly at the same time, and return when both are done.
+    // g is offered to other workers while this thread runs f.
+    template <typename F, typename G>
+    void invoke(F&& f, G&& g) {
+        if (!in_pool()) return run([&] { invoke(f, g); });
+        if (size() == 1) {
+            f();
+            g();
+            return;
+        }
+        detail::worker& self = *detail::current_worker;
+        detail::fn_task<std::remove_reference_t<G>> right(g);
+        self.deque.push(&right);
+        wake_one();
+
+        std::exception_ptr left_error;
+        try {
+            f();
+        } catch (...) {
+            left_error = std::current_exception();
+        }
+        if (self.deque.take() == &right) {
+            execute(&right); // nobody took it
+        } else {
+            // stolen: help with other work until the thief finishes it
+            for (unsigned idle = 0; !right.done.load(std::memory_order_acquire);) {
+                if (detail::task* t = find_work(self)) {
+                    execute(t);
+                    idle = 0;
+                } else if (++idle < 64) {
+                    detail::cpu_relax();
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        if (left_error) std::rethrow_exception(left_error);
+        if (right.error) std::rethrow_exception(right.error);
+    }
+
+private:
+    void execute(detail::task* t) {
+        try {
+            t->fn(t);
+        } catch (...) {
+            t->error = std::current_exception();
+        }
+        if (t->external) {
+            {
+                std::lock_guard<std::mutex> lock(done_mu_);
+                t->done.store(true, std::memory_order_relaxed);
+            }
+            done_cv_.notify_all();
+        } else {
+            t->done.store(true, std::memory_order_release);
+        }
+    }
+
+    detail::task* find_work(detail::worker& self) {
+        if (injected_count_.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(inject_mu_);
+            if (!injected_.empty()) {
+                detail::task* t = injected_.front();
+                injected_.pop_front();
+                injected_count_.fetch_sub(1, std::memory_order_relaxed);
+                return t;
+            }
+        }
+        std::size_t n = workers_.size();
+        self.rng ^= self.rng << 13, self.rng ^= self.rng >> 7, self.rng ^= self.rng << 17;
+        std::size_t start = (std::size_t)(self.rng % n);
+        for (std::size_t k = 0; k < n; ++k) {
+            detail::worker& victim = *workers_[(start + k) % n];
+            if (&victim == &self) continue;
+            if (detail::task* t = victim.deque.steal()) return t;
+        }
+        return nullptr;
+    }
+
+    bool has_work() const {
+        if (injected_count_.load(std::memory_order_relaxed)) return true;
+        for (auto& w : workers_)
+            if (!w->deque.empty()) return true;
+        return false;
+    }
+
+    // Pairs with the fence in sleep(): either the sleeper sees the new task
+    // or this sees the sleeper and takes the lock it waits under.
+    void wake_one() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_relaxed) == 0) return;
+        { std::lock_guard<std::mutex> lock(sleep_mu_); }
+        sleep_cv_.notify_one();
+    }
+
+    void sleep() {
+        std::unique_lock<std::mutex> lock(sleep_mu_);
+        sleepers_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!stop_.load(std::memory_order_relaxed) && !has_work()) sleep_cv_.wait(lock);
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void work(detail::worker& self) {
+        detail::current_worker = &self;
+        unsigned idle = 0;
+        while (!stop_.load(std::memory_order_relaxed)) {
+            detail::task* t = self.deque.take();
+            if (!t) t = find_work(self);
+            if (t) {
+                execute(t);
+                idle = 0;
+            } else if (++idle < 64) {
+                detail::cpu_relax();
+            } else if (idle < 128) {
+                std::this_thread::yield();
+            } else {
+                sleep();
+                idle = 0;
+            }
+        }
+        detail::current_worker = nullptr;
+    }
+
+    std::vector<std::unique_ptr<detail::worker>> workers_;
+    std::vector<std::thread> threads_;
+
+    std::mutex inject_mu_;
+    std::deque<detail::task*> injected_;
+    std::atomic<std::size_t> injected_count_{0};
+
+    std::mutex sleep_mu_;
+    std::condition_variable sleep_cv_;
+    std::atomic<unsigned> sleepers_{0};
+    std::atomic<bool> stop_{false};
+
+    std::mutex done_mu_;
+    std::condition_variable done_cv_;
+};
+
+// The process-wide pool: CSTAR_THREADS workers, or one per hardware
+// thread. Started on first use.
+inline thread_pool& default_pool() {
+    static thread_pool pool(detail::default_threads());
+    return pool;
+}
+
+namespace detail {
+
+inline std::size_t auto_grain(std::size_t n, const thread_pool& pool) {
+    return std::max<std::size_t>(1, n / (8 * (std::size_t)pool.size()));
+}
+
+// Bodies take either one index or a [lo, hi) range.
+template <typename F>
+void call_range(F& body, std::size_t lo, std::size_t hi) {
+    if constexpr (std::is_invocable_v<F&, std::size_t, std::size_t>) {
+        body(lo, hi);
+    } else {
+        for (std::size_t i = lo; i < hi; ++i) body(i);
+    }
+}
+
+template <typename F>
+void for_range(thread_pool& pool, std::size_t lo, std::size_t hi, std::size_t grain, F& body) {
+    if (hi - lo <= grain) return call_range(body, lo, hi);
+    std::size_t mid = lo + (hi - lo) / 2;
+    pool.invoke([&] { for_range(pool, lo, mid, grain, body); }, [&] { for_range(pool, mid, hi, grain, body); });
+}
+
+template <typename T, typename Body, typename Combine>
+T reduce_range(thread_pool& pool, std::size_t lo, std::size_t hi, std::size_t grain, const T& identity, Body& body,
+               Combine& combine) {
+    if (hi - lo <= grain) {
+        if constexpr (std::is_invocable_v<Body&, std::size_t, std::size_t>) {
+            return combine(identity, body(lo, hi));
+        } else {
+            T acc = identity;
+            for (std::size_t i = lo; i < hi; ++i) acc = combine(std::move(acc), body(i));
+            return acc;
+        }
+    }
+    std::size_t mid = lo + (hi - lo) / 2;
+    T left = identity, right = identity;
+    pool.invoke([&] { left = reduce_range(pool, lo, mid, grain, identity, body, combine); },
+                [&] { right = reduce_range(pool, mid, hi, grain, identity, body, combine); });
+    return combine(std::move(left), std::move(right));
+}
+
+// Merge sorted [a, a + na) and [b, b + nb) into out by splitting around
+// the middle of the longer run.
+template <typename In, typename Out, typename Compare>
+void merge_range(thread_pool& pool, In a, std::size_t na, In b, std::size_t nb, Out out, Compare& comp,
+                 std::size_t grain) {
+    if (na + nb <= grain) {
+        std::merge(std::make_move_iterator(a), std::make_move_iterator(a + na), std::make_move_iterator(b),
+                   std::make_move_iterator(b + nb), out, comp);
+        return;
+    }
+    std::size_t ma, mb;
+    if (na >= nb) {
+        ma = na / 2;
+        mb = (std::size_t)(std::lower_bound(b, b + nb, a[ma], comp) - b);
+    } else {
+        mb = nb / 2;
+        ma = (std::size_t)(std::upper_bound(a, a + na, b[mb], comp) - a);
+    }
+    pool.invoke([&] { merge_range(pool, a, ma, b, mb, out, comp, grain); },
+                [&] { merge_range(pool, a + ma, na - ma, b + mb, nb - mb, out + ma + mb, comp, grain); });
+}
+
+// Sort n elements of src. The result ends in tmp when to_tmp is set, else
+// back in src; the halves alternate between the two buffers.
+template <typename A, typename B, typename Compare>
+void sort_into(thread_pool& pool, A src, B tmp, std::size_t n, bool to_tmp, Compare& comp, std::size_t grain) {
+    if (n <= grain) {
+        std::sort(src, src + n, comp);
+        if (to_tmp) std::move(src, src + n, tmp);
+        return;
+    }
+    std::size_t mid = n / 2;
+    pool.invoke([&] { sort_into(pool, src, tmp, mid, !to_tmp, comp, grain); },
+                [&] { sort_into(pool, src + mid, tmp + mid, n - mid, !to_tmp, comp, grain); });
+    if (to_tmp) merge_range(pool, src, mid, src + mid, n - mid, tmp, comp, grain);
+    else merge_range(pool, tmp, mid, tmp + mid, n - mid, src, comp, grain);
+}
+
+} // namespace detail
+
+// Run f and g in parallel; returns when both are done.
+template <typename F, typename G>
+void parallel_invoke(thread_pool& pool, F&& f, G&& g) {
+    pool.invoke(std::forward<F>(f), std::forward<G>(g));
+}
+
+template <typename F, typename G>
+void parallel_invoke(F&& f, G&& g) {
+    default_pool().invoke(std::forward<F>(f), std::forward<G>(g));
+}
+
+// body(i) for every i in [begin, end), or body(lo, hi) for each piece.
+// grain = 0 picks a piece size from the pool size.
+template <typename F>
+void parallel_for(thread_pool& pool, std::size_t begin, std::size_t end, F&& body, std::size_t grain = 0) {
+    if (end <= begin) return;
+    std::size_t n = end - begin;
+    if (grain == 0) grain = detail::auto_grain(n, pool);
+    if (n <= grain || pool.size() == 1) return detail::call_range(body, begin, end);
+    pool.run([&] { detail::for_range(pool, begin, end, grain, body); });
+}
+
+template <typename F>
+void parallel_for(std::size_t begin, std::size_t end, F&& body, std::size_t grain = 0) {
+    parallel_for(default_pool(), begin, end, std::forward<F>(body), grain);
+}
+
+// combine(identity, body(begin), ..., body(end - 1)), grouped as a
+// balanced tree. body may also take (lo, hi) and return that piece's
+// result. combine must be associative; the grouping depends only on the
+// range, grain and pool size, so floating-point sums repeat exactly.
+template <typename T, typename Body, typename Combine>
+T parallel_reduce(thread_pool& pool, std::size_t begin, std::size_t end, T identity, Body&& body, Combine&& combine,
+                  std::size_t grain = 0) {
+    if (end <= begin) return identity;
+    std::size_t n = end - begin;
+    if (grain == 0) grain = detail::auto_grain(n, pool);
+    if (n <= grain || pool.size() == 1) return detail::reduce_range(pool, begin, end, n, identity, body, combine);
+    T result = identity;
+    pool.run([&] { result = detail::reduce_range(pool, begin, end, grain, identity, body, combine); });
+    return result;
+}
+
+template <typename T, typename Body, typename Combine>
+T parallel_reduce(std::size_t begin, std::size_t end, T identity, Body&& body, Combine&& combine,
+                  std::size_t grain = 0) {
+    return parallel_reduce(default_pool(), begin, end, std::move(identity), std::forward<Body>(body),
+                           std::forward<Combine>(combine), grain);
+}
+
+// Sort [first, last) with a parallel merge sort: std::sort on pieces of
+// grain elements, then parallel merges through a buffer of n elements.
+// Not stable.
+template <typename RandomIt, typename Compare = std::less<>>
+void parallel_sort(thread_pool& pool, RandomIt first, RandomIt last, Compare comp = Compare(), std::size_t grain = 0) {
+    std::size_t n = (std::size_t)(last - first);
+    if (grain == 0) grain = std::max<std::size_t>(8192, detail::auto_grain(n, pool));
+    if (n <= grain || pool.size() == 1) return std::sort(first, last, comp);
+    using value_type = typename std::iterator_traits<RandomIt>::value_type;
+    std::vector<value_type> buffer(std::make_move_iterator(first), std::make_move_iterator(last));
+    pool.run([&] { detail::sort_into(pool, buffer.data(), first, n, true, comp, grain); });
+}
+
+template <typename RandomIt, typename Compare = std::less<>>
+void parallel_sort(RandomIt first, RandomIt last, Compare comp = Compare(), std::size_t grain = 0) {
+    parallel_sort(default_pool(), first, last, std::move(comp), grain);
+}
+
+} // namespace cstar
+
+#endif // CSTLIB26_PARALLEL_H
@@ -0,0 +1,224 @@
+/*
+plugin.h - Shared-library plugins for CStar.
+
+cstar::plugin_registry keeps every loaded library open and caches the
+symbols resolved from it, so calling a plugin function in a loop costs
+one indirect call instead of a dlopen/dlsym/dlclose round trip:
+
+    auto* math = cstar::plugins().load("./libmathplug.so");
+    auto add = math->get<int(int, int)>("add");   // int (*)(int, int)
+    int r = add(2, 3);
+
+Pointers returned by get() and load() stay valid until the library is
+unloaded. importlib() in ext/stdcstar.h goes through the global registry.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_PLUGIN_H
+#define CSTLIB26_PLUGIN_H 1
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+    #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <dlfcn.h>
+#endif
+
+namespace cstar {
+
+enum class plugin_bind {
+    lazy,   // resolve symbols on first call (RTLD_LAZY)
+    now,    // resolve everything at load time (RTLD_NOW); fails early on missing symbols
+};
+
+namespace plugin_detail {
+    // string_view lookups into string-keyed maps without building a string
+    struct name_hash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+    };
+    struct name_eq {
+        using is_transparent = void;
+        bool operator()(std::string_view a, std::string_view b) const noexcept { return a == b; }
+    };
+
+    template<typename Map>
+    auto find(Map& m, std::string_view key) {
+#if defined(__cpp_lib_generic_unordered_lookup)
+        return m.find(key);
+#else
+        return m.find(std::string(key));
+#endif
+    }
+}
+
+// One loaded shared library and its resolved symbols.
+class plugin {
+public:
+    plugin(const plugin&) = delete;
+    plugin& operator=(const plugin&) = delete;
+
+    ~plugin() {
+#ifdef _WIN32
+        if (handle_) FreeLibrary(handle_);
+#else
+        if (handle_) dlclose(handle_);
+#endif
+    }
+
+    const std::string& path() const { return path_; }
+    // How the library was opened; see plugin_registry::preload.
+    plugin_bind binding() const { return bind_; }
+
+    // Raw symbol address, or nullptr if the library does not export it.
+    void* symbol(std::string_view name) {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            auto it = plugin_detail::find(symbols_, name);
+            if (it != symbols_.end()) return it->second;
+        }
+        std::string key(name);
+#ifdef _WIN32
+        void* addr = reinterpret_cast<void*>(GetProcAddress(handle_, key.c_str()));
+#else
+        void* addr = dlsym(handle_, key.c_str());
+#endif
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        symbols_.emplace(std::move(key), addr); // misses are cached too
+        return addr;
+    }
+
+    // Typed function pointer: get<int(int, int)>("add") -> int (*)(int, int).
+    template<typename Sig>
+    std::add_pointer_t<Sig> get(std::string_view name) {
+        static_assert(std::is_function_v<Sig>, "plugin::get<Sig>: Sig must be a function type");
+        return reinterpret_cast<std::add_pointer_t<Sig>>(symbol(name));
+    }
+
+private:
+    friend class plugin_registry;
+#ifdef _WIN32
+    using handle_t = HMODULE;
+#else
+    using handle_t = void*;
+#endif
+    plugin(std::string path, handle_t h, plugin_bind bind) : path_(std::move(path)), handle_(h), bind_(bind) {}
+
+    std::string path_;
+    handle_t handle_;
+    plugin_bind bind_;
+    std::shared_mutex mutex_;
+    std::unordered_map<std::string, void*, plugin_detail::name_hash, plugin_detail::name_eq> symbols_;
+};
+
+class plugin_registry {
+public:
+    plugin_registry() = default;
+    plugin_registry(const plugin_registry&) = delete;
+    plugin_registry& operator=(const plugin_registry&) = delete;
+
+    // Open a library once; later calls with the same path return the same
+    // plugin, opened the way the first call asked. Returns nullptr on
+    // failure (see last_error()).
+    plugin* load(const std::string& path, plugin_bind bind = plugin_bind::lazy) {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            auto it = libs_.find(path);
+            if (it != libs_.end()) return it->second.get();
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto it = libs_.find(path);
+        if (it != libs_.end()) return it->second.get();
+#ifdef _WIN32
+        (void)bind;
+        HMODULE h = LoadLibraryA(path.c_str());
+        if (!h) {
+            error_ = "LoadLibrary failed for " + path;
+            return nullptr;
+        }
+#else
+        void* h = dlopen(path.c_str(), bind == plugin_bind::now ? RTLD_NOW : RTLD_LAZY);
+        if (!h) {
+            const char* e = dlerror();
+            error_ = e ? e : ("dlopen failed for " + path);
+            return nullptr;
+        }
+#endif
+#ifdef _WIN32
+        plugin* p = new plugin(path, h, plugin_bind::now); // LoadLibrary binds at load
+#else
+        plugin* p = new plugin(path, h, bind);
+#endif
+        libs_.emplace(path, std::unique_ptr<plugin>(p));
+        return p;
+    }
+
+    // Load with every symbol bound up front, so the first call through the
+    // plugin does not pay for lazy binding. This only affects a library that
+    // is not loaded yet: one already opened lazily (by load() or importlib)
+    // is returned as it is, still lazy, because the loader cannot rebind an
+    // open library and reopening it would invalidate every pointer handed
+    // out. Check binding(), or preload before the first load.
+    plugin* preload(const std::string& path) { return load(path, plugin_bind::now); }
+
+    // Loaded plugin for path, or nullptr. Never opens anything.
+    plugin* find(const std::string& path) {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = libs_.find(path);
+        return it == libs_.end() ? nullptr : it->second.get();
+    }
+
+    template<typename Sig>
+    std::add_pointer_t<Sig> get(const std::string& path, std::string_view name) {
+        plugin* p = load(path);
+        return p ? p->get<Sig>(name) : nullptr;
+    }
+
+    // Close a library. Every plugin* and function pointer obtained from it
+    // becomes invalid. Returns false if it was not loaded.
+    bool unload(const std::string& path) {
+        std::unique_ptr<plugin> victim;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            auto it = libs_.find(path);
+            if (it == libs_.end()) return false;
+            victim = std::move(it->second);
+            libs_.erase(it);
+        }
+        return true; // victim closes the handle outside the lock
+    }
+
+    std::string last_error() const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return error_;
+    }
+
+private:
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, std::unique_ptr<plugin>> libs_;
+    std::string error_;
+};
+
+// Process-wide registry, created on first use.
+inline plugin_registry& plugins() {
+    static plugin_registry registry;
+    return registry;
+}
+
+} // namespace cstar
+
+#endif // CSTLIB26_PLUGIN_H
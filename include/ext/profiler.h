@@ -0,0 +1,463 @@
+/*
+profiler.h - Sampling profiler for CStar programs.
+
+Compile a program with `cstarc --profile-run`, which also runs it, or
+call cstar::profiler::start() from the program. A program built with
+CSTAR_PROFILER_ENV defined (--profile-run defines it) starts the
+profiler before main when CSTAR_PROFILE is set:
+
+    CSTAR_PROFILE=out.folded ./prog.exe
+    flamegraph.pl out.folded > prog.svg
+
+Without the macro the header runs nothing at startup. CSTAR_PROFILE=1
+writes profile.folded. CSTAR_PROFILE_HZ sets the rate
+(default 1000 samples per second of CPU time).
+
+SIGPROF interrupts the program on a CPU-time timer (setitimer). The
+handler walks the frame pointer chain from the interrupted registers
+and copies the return addresses into a preallocated ring; it makes no
+calls and takes no locks, so it is async-signal-safe. A background
+thread drains the ring into a table of distinct stacks. If the ring
+fills faster than it is drained, samples are dropped and counted.
+
+At exit the stacks are written as folded lines, one per stack with its
+sample count ("main;mainfunc;work;fib 42"). Functions are named through
+dladdr, or through addr2line for the executable when it is on PATH.
+Code built by --profile-run carries #line directives and debug info, so
+its frames name the .cstar file and line. Other programs need
+-fno-omit-frame-pointer for full stacks.
+
+The walk never leaves the sampled thread's stack, whose bounds are read
+with pthread_getattr_np when the thread enrolls. start() enrolls the
+thread that calls it; other threads call cstar::profiler::enroll() once
+before their work. Samples from threads that did not enroll keep only
+the interrupted pc. Even then, GCC leaves small
+leaf functions without a frame; they are still found from the sampled
+pc, but their caller is missing from the stack.
+
+CPU-time signals arrive on the kernel's tick, so the rate reached is at
+most CONFIG_HZ (often 250).
+
+Linux only; elsewhere start() returns false.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_PROFILER_H
+#define CSTLIB26_PROFILER_H 1
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#if defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+    #define CSTAR_PROFILER_SUPPORTED 1
+    #include <algorithm>
+    #include <chrono>
+    #include <condition_variable>
+    #include <cstring>
+    #include <map>
+    #include <mutex>
+    #include <thread>
+    #include <vector>
+    #include <cxxabi.h>
+    #include <dlfcn.h>
+    #include <elf.h>
+    #include <link.h>
+    #include <pthread.h>
+    #include <signal.h>
+    #include <sys/time.h>
+    #include <ucontext.h>
+    #include <unistd.h>
+#endif
+
+namespace cstar {
+namespace profiler {
+
+struct stats {
+    std::uint64_t samples = 0; // taken by the signal handler
+    std::uint64_t dropped = 0; // lost because the ring was full
+    std::uint64_t stacks = 0;  // distinct stacks so far
+};
+
+#if defined(CSTAR_PROFILER_SUPPORTED)
+
+namespace detail {
+
+constexpr unsigned max_depth = 64;
+
+// One sample. seq tells producers and the drainer whose turn the slot is
+// (Vyukov's bounded queue): pos when free, pos + 1 once written.
+struct slot {
+    std::atomic<std::uint64_t> seq;
+    std::uint32_t depth;
+    std::uintptr_t pc[max_depth];
+};
+
+struct state {
+    slot* ring = nullptr;
+    std::size_t mask = 0;
+    std::atomic<std::uint64_t> head{0}; // next slot to write
+    std::uint64_t tail = 0;             // next slot to read (drainer only)
+    std::atomic<std::uint64_t> samples{0}, dropped{0};
+
+    std::mutex lock; // guards stacks and the drainer's lifetime
+    std::map<std::vector<std::uintptr_t>, std::uint64_t> stacks;
+    std::condition_variable wake;
+    std::thread drainer;
+    bool quit = false;
+    bool running = false;
+    std::string path;
+};
+
+// Never destroyed: the exit handler runs after static destructors.
+inline state& global() {
+    static state* s = new state;
+    return *s;
+}
+
+// The calling thread's stack, [lo, hi); empty until it enrolls. Constant
+// initialized, so the signal handler reads it without a TLS guard.
+struct stack_bounds {
+    std::uintptr_t lo = 0, hi = 0;
+};
+inline thread_local stack_bounds this_stack;
+
+// Walk frame pointers from the interrupted context. Every frame must lie
+// above the interrupted stack pointer and the previous frame, and inside
+// the thread's stack; an unenrolled thread gives only the pc.
+inline unsigned unwind(const ucontext_t* uc, std::uintptr_t* out) noexcept {
+#if defined(__x86_64__)
+    std::uintptr_t pc = (std::uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+    std::uintptr_t fp = (std::uintptr_t)uc->uc_mcontext.gregs[REG_RBP];
+    std::uintptr_t sp = (std::uintptr_t)uc->uc_mcontext.gregs[REG_RSP];
+#else
+    std::uintptr_t pc = (std::uintptr_t)uc->uc_mcontext.pc;
+    std::uintptr_t fp = (std::uintptr_t)uc->uc_mcontext.regs[29];
+    std::uintptr_t sp = (std::uintptr_t)uc->uc_mcontext.sp;
+#endif
+    const stack_bounds& b = this_stack;
+    // sp outside the stack: on a sigaltstack, or a thread that did not enroll
+    std::uintptr_t hi = (sp >= b.lo && sp < b.hi) ? b.hi : 0;
+    unsigned n = 0;
+    out[n++] = pc;
+    while (n < max_depth) {
+        if (fp < sp || fp + 2 * sizeof(std::uintptr_t) > hi || (fp & (sizeof(std::uintptr_t) - 1))) break;
+        const std::uintptr_t* frame = reinterpret_cast<const std::uintptr_t*>(fp);
+        std::uintptr_t next = frame[0], ret = frame[1];
+        if (!ret) break;
+        out[n++] = ret;
+        if (next <= fp) break;
+        sp = fp;
+        fp = next;
+    }
+    return n;
+}
+
+inline void on_sigprof(int, siginfo_t*, void* context) {
+    state& g = global();
+    g.samples.fetch_add(1, std::memory_order_relaxed);
+    std::uint64_t pos = g.head.load(std::memory_order_relaxed);
+    slot* s;
+    for (;;) {
+        s = &g.ring[pos & g.mask];
+        std::uint64_t seq = s->seq.load(std::memory_order_acquire);
+        if (seq == pos) {
+            if (g.head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (seq < pos) {
+            g.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = g.head.load(std::memory_order_relaxed);
+        }
+    }
+    s->depth = unwind(static_cast<const ucontext_t*>(context), s->pc);
+    s->seq.store(pos + 1, std::memory_order_release);
+}
+
+// Move finished samples from the ring into the stack table. Caller holds g.lock.
+inline void drain(state& g) {
+    std::vector<std::uintptr_t> key;
+    for (;;) {
+        slot& s = g.ring[g.tail & g.mask];
+        if (s.seq.load(std::memory_order_acquire) != g.tail + 1) break;
+        key.assign(s.pc, s.pc + s.depth);
+        ++g.stacks[key];
+        s.seq.store(g.tail + g.mask + 1, std::memory_order_release);
+        ++g.tail;
+    }
+}
+
+struct frame_name {
+    std::string function, file;
+    int line = 0;
+};
+
+inline std::string demangle(const char* name) {
+    int status = 0;
+    char* d = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    std::string out = status == 0 && d ? d : name;
+    std::free(d);
+    return out;
+}
+
+// addr2line for addresses inside the executable. With -a -i each
+// address is printed, then "function" and "file:line" lines for every
+// function inlined there, innermost first. The last pair is the function
+// the code really belongs to, at the line that called the inlined code.
+inline void addr2line(const std::string& module, const std::vector<std::uintptr_t>& addrs,
+                      std::vector<frame_name*>& into) {
+    for (std::size_t at = 0; at < addrs.size(); at += 256) {
+        std::string cmd = "addr2line -a -i -C -f -e '" + module + "'";
+        std::size_t end = std::min(addrs.size(), at + 256);
+        char hex[32];
+        for (std::size_t i = at; i < end; ++i) {
+            std::snprintf(hex, sizeof hex, " 0x%llx", (unsigned long long)addrs[i]);
+            cmd += hex;
+        }
+        cmd += " 2>/dev/null";
+        FILE* p = popen(cmd.c_str(), "r");
+        if (!p) return;
+        char fn[4096], loc[4096];
+        std::size_t i = at - 1;
+        while (std::fgets(fn, sizeof fn, p)) {
+            fn[std::strcspn(fn, "\n")] = 0;
+            if (fn[0] == '0' && fn[1] == 'x') {
+                if (++i >= end) break;
+                continue;
+            }
+            if (i < at || !std::fgets(loc, sizeof loc, p)) break;
+            loc[std::strcspn(loc, "\n")] = 0;
+            frame_name& f = *into[i];
+            if (std::strcmp(fn, "??") != 0) f.function = fn;
+            f.file.clear();
+            f.line = 0;
+            char* colon = std::strrchr(loc, ':');
+            if (colon && loc[0] != '?') {
+                *colon = 0;
+                const char* base = std::strrchr(loc, '/');
+                f.file = base ? base + 1 : loc;
+                f.line = std::atoi(colon + 1);
+            }
+        }
+        pclose(p);
+    }
+}
+
+inline void write_folded(state& g);
+
+inline std::map<std::uintptr_t, frame_name> symbolize(const std::map<std::vector<std::uintptr_t>, std::uint64_t>& stacks) {
+    std::map<std::uintptr_t, frame_name> names;
+    for (const auto& [stack, count] : stacks)
+        for (std::size_t i = 0; i < stack.size(); ++i) names[stack[i] - (i ? 1 : 0)];
+
+    // this header is compiled into the program, so its code marks the executable
+    Dl_info self{};
+    dladdr(reinterpret_cast<void*>(&write_folded), &self);
+    std::vector<std::uintptr_t> exe_addrs;
+    std::vector<frame_name*> exe_frames;
+    for (auto& [pc, f] : names) {
+        Dl_info info{};
+        if (!dladdr(reinterpret_cast<void*>(pc), &info)) {
+            char hex[32];
+            std::snprintf(hex, sizeof hex, "0x%llx", (unsigned long long)pc);
+            f.function = hex;
+            continue;
+        }
+        std::uintptr_t base = (std::uintptr_t)info.dli_fbase;
+        if (info.dli_sname) f.function = demangle(info.dli_sname);
+        else {
+            const char* mod = info.dli_fname ? std::strrchr(info.dli_fname, '/') : nullptr;
+            char off[64];
+            std::snprintf(off, sizeof off, "+0x%llx", (unsigned long long)(pc - base));
+            f.function = std::string(mod ? mod + 1 : "?") + off;
+        }
+        if (self.dli_fbase && info.dli_fbase == self.dli_fbase) {
+            // a fixed-address executable is looked up by address, a PIE by offset
+            const auto* ehdr = reinterpret_cast<const ElfW(Ehdr)*>(base);
+            exe_addrs.push_back(ehdr->e_type == ET_EXEC ? pc : pc - base);
+            exe_frames.push_back(&f);
+        }
+    }
+    char exe[4096];
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof exe - 1);
+    if (len > 0 && !exe_addrs.empty()) addr2line(std::string(exe, (std::size_t)len), exe_addrs, exe_frames);
+    return names;
+}
+
+inline void write_folded(state& g) {
+    std::map<std::vector<std::uintptr_t>, std::uint64_t> stacks;
+    {
+        std::lock_guard<std::mutex> hold(g.lock);
+        stacks = g.stacks;
+    }
+    auto names = symbolize(stacks);
+    std::map<std::string, std::uint64_t> folded;
+    std::string line;
+    for (const auto& [stack, count] : stacks) {
+        // root first, starting at main when it is on the stack
+        std::size_t top = stack.size();
+        for (std::size_t i = 0; i < stack.size(); ++i)
+            if (names[stack[i] - (i ? 1 : 0)].function == "main") top = i + 1;
+        line.clear();
+        for (std::size_t i = top; i-- > 0;) {
+            const frame_name& f = names[stack[i] - (i ? 1 : 0)];
+            std::string label = f.function;
+            if (!f.file.empty() && f.line > 0) label += " (" + f.file + ":" + std::to_string(f.line) + ")";
+            std::replace(label.begin(), label.end(), ';', ':');
+            if (!line.empty()) line += ';';
+            line += label;
+        }
+        folded[line] += count;
+    }
+    FILE* out = std::fopen(g.path.c_str(), "w");
+    if (!out) {
+        std::fprintf(stderr, "profile: cannot write %s\n", g.path.c_str());
+        return;
+    }
+    for (const auto& [stack, count] : folded) std::fprintf(out, "%s %llu\n", stack.c_str(), (unsigned long long)count);
+    std::fclose(out);
+    std::fprintf(stderr, "profile: %llu samples (%llu dropped) in %s\n",
+                 (unsigned long long)g.samples.load(), (unsigned long long)g.dropped.load(), g.path.c_str());
+}
+
+} // namespace detail
+
+// Let samples taken on the calling thread walk its whole stack. start()
+// enrolls its caller; call this at the top of any other thread to be
+// profiled. Returns false if the stack bounds cannot be read.
+inline bool enroll() {
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) return false;
+    void* lo = nullptr;
+    std::size_t size = 0;
+    bool ok = pthread_attr_getstack(&attr, &lo, &size) == 0;
+    pthread_attr_destroy(&attr);
+    if (!ok) return false;
+    detail::this_stack.lo = (std::uintptr_t)lo;
+    detail::this_stack.hi = (std::uintptr_t)lo + size;
+    return true;
+}
+
+// Stop sampling and drain what is left. Returns false if not running.
+inline bool stop() {
+    detail::state& g = detail::global();
+    {
+        std::lock_guard<std::mutex> hold(g.lock);
+        if (!g.running) return false;
+        g.running = false;
+        g.quit = true;
+    }
+    itimerval off{};
+    setitimer(ITIMER_PROF, &off, nullptr);
+    // a signal already pending is still handled; the ring stays allocated
+    g.wake.notify_all();
+    g.drainer.join();
+    std::lock_guard<std::mutex> hold(g.lock);
+    detail::drain(g);
+    return true;
+}
+
+// Write the folded stacks gathered so far to the path given to start().
+inline void write() {
+    detail::state& g = detail::global();
+    {
+        std::lock_guard<std::mutex> hold(g.lock);
+        if (g.ring) detail::drain(g);
+    }
+    if (!g.path.empty()) detail::write_folded(g);
+}
+
+namespace detail {
+
+inline void at_exit() {
+    if (stop()) write();
+}
+
+} // namespace detail
+
+// Sample every thread's stack hz times per CPU-second; write folded
+// stacks to path when write() is called or the program exits.
+inline bool start(const std::string& path, unsigned hz = 1000, std::size_t ring_slots = 4096) {
+    detail::state& g = detail::global();
+    std::lock_guard<std::mutex> hold(g.lock);
+    if (g.running || hz == 0) return false;
+    if (!g.ring) {
+        std::size_t n = 64;
+        while (n < ring_slots) n <<= 1;
+        g.ring = new detail::slot[n];
+        std::atexit(detail::at_exit);
+        for (std::size_t i = 0; i < n; ++i) g.ring[i].seq.store(i, std::memory_order_relaxed);
+        g.mask = n - 1;
+        g.head.store(0);
+        g.tail = 0;
+    }
+    enroll();
+    g.path = path;
+
+    struct sigaction sa{};
+    sa.sa_sigaction = detail::on_sigprof;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, nullptr) != 0) return false;
+
+    // armed before the drainer exists, so a refused timer leaves nothing running
+    unsigned period = std::max(1u, 1'000'000u / hz); // microseconds
+    itimerval every{};
+    every.it_interval.tv_sec = (time_t)(period / 1'000'000u);
+    every.it_interval.tv_usec = (suseconds_t)(period % 1'000'000u);
+    every.it_value = every.it_interval;
+    if (setitimer(ITIMER_PROF, &every, nullptr) != 0) return false;
+
+    g.quit = false;
+    g.running = true;
+    g.drainer = std::thread([&g] {
+        std::unique_lock<std::mutex> hold(g.lock);
+        while (!g.quit) {
+            detail::drain(g);
+            g.wake.wait_for(hold, std::chrono::milliseconds(50));
+        }
+    });
+    return true;
+}
+
+inline stats current() {
+    detail::state& g = detail::global();
+    std::lock_guard<std::mutex> hold(g.lock);
+    if (g.ring) detail::drain(g);
+    return {g.samples.load(), g.dropped.load(), g.stacks.size()};
+}
+
+namespace detail {
+
+// In a program built with CSTAR_PROFILER_ENV defined, CSTAR_PROFILE turns
+// the profiler on before main. Nothing is allocated unless it is set.
+inline bool start_from_env() {
+    const char* path = std::getenv("CSTAR_PROFILE");
+    if (!path || !*path || std::strcmp(path, "0") == 0) return false;
+    const char* hz = std::getenv("CSTAR_PROFILE_HZ");
+    int rate = hz ? std::atoi(hz) : 1000;
+    return start(std::strcmp(path, "1") == 0 ? "profile.folded" : path, rate > 0 ? (unsigned)rate : 1000);
+}
+
+#ifdef CSTAR_PROFILER_ENV
+inline const bool started_from_env = start_from_env();
+#endif
+
+} // namespace detail
+
+#else
+
+inline bool start(const std::string&, unsigned = 1000, std::size_t = 4096) { return false; }
+inline bool enroll() { return false; }
+inline bool stop() { return false; }
+inline void write() {}
+inline stats current() { return {}; }
+
+#endif
+
+} // namespace profiler
+} // namespace cstar
+
+#endif // CSTLIB26_PROFILER_H
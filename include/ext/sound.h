@@ -1,24 +1,53 @@
-#pragma once
+/*
+sound.h - play_sound / play_music for CStar.
 
-#include <cstdlib>
+    play_sound("beep.wav");
+    play_music("theme.wav");
+
+Both play through cstar::audio::default_engine() (audio.h) and return
+once the file has finished playing: 0 on success, 1 if it could not be
+played (the reason goes to stderr). For playback that does not wait, or
+for several sounds at once, use the engine directly. Sounds stay decoded
+in memory after the first play.
+
+Only WAV files are supported.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_SOUND_H
+#define CSTLIB26_SOUND_H 1
+
+#include <cstdio>
 #include <string>
 #include <string_view>
+#include "audio.h"
 
 inline int call_sound_player(std::string_view sound_file) noexcept {
-    // Play some sound, eh?
-    std::string cmd = "python \"D:/CStar/sound_play.py\" \"";
-    cmd += std::string(sound_file);
-    cmd += "\"";
-    return std::system(cmd.c_str());
+    try {
+        auto& engine = cstar::audio::default_engine();
+        const cstar::audio::sound* s = engine.load(std::string(sound_file));
+        if (!s) {
+            std::fprintf(stderr, "play_sound: %s\n", engine.last_error().c_str());
+            return 1;
+        }
+        auto id = engine.play(s);
+        if (!id) {
+            std::fprintf(stderr, "play_sound: no free voice\n");
+            return 1;
+        }
+        engine.wait(id);
+        return 0;
+    } catch (...) {
+        return 1;
+    }
 }
 
+// Music is a long sound; it is mixed the same way.
 inline int call_music_player(std::string_view music_file) noexcept {
-    // Play some music, eh?
-    std::string cmd = "python \"D:/CStar/sound_play.py\" --music \"";
-    cmd += std::string(music_file);
-    cmd += "\"";
-    return std::system(cmd.c_str());
+    return call_sound_player(music_file);
 }
 
 #define play_sound(file) call_sound_player(file)
-#define play_music(file) call_music_player(file)
\ No newline at end of file
+#define play_music(file) call_music_player(file)
+
+#endif // CSTLIB26_SOUND_H
@@ -10,12 +10,30 @@
 #include <cstring>
 #include <csignal>
 #include <set>
+#include <sstream>
 #include <cstdlib>
 #include <type_traits>
 #include <cstdint>
 #include <cstdio>
 #include "../cstar.h"
-#include "../../keywords.h"
+#include "fastin.h"
+#include "plugin.h"
+#include "alloc.h"
+#include "hashmap.h"
+#include "text.h"
+#include "parallel.h"
+#include "sync.h"
+#include "channel.h"
+#include "profiler.h"
+#include "trace.h"
+#if defined(__cpp_impl_coroutine)
+    #include "coro.h"
+#endif
+
+// CStar programs use standard names unqualified (string, cout, to_string).
+// This directive used to arrive through keywords.h, along with a global
+// vector that was built before main in every program.
+using namespace std;
 
 #if !defined(_MSC_VER)
     #ifndef __cdecl
@@ -69,28 +87,25 @@ public:
         return endline ? std::printf("%c\n", message) : std::printf("%c", message);
     }
 
-    // --- scanf variants: accept non-const references and use correct formats ---
+    // --- scanf variants: accept non-const references, parsed by the buffered stdin reader ---
     static int __cdecl posixscanf(const char* id, std::string &out_value) {
         if (std::strcmp(id, CSTAR_IDENTIFIERS[0]) != 0) return -1;
-        char buffer[1024];
-        int result = std::scanf("%1023s", buffer);
-        if (result == 1) out_value = buffer;
-        return result;
+        return cstar::stdin_buf().scan(out_value);
     }
 
     static int __cdecl posixscanf(const char* id, int &out_value) {
         if (std::strcmp(id, CSTAR_IDENTIFIERS[1]) != 0) return -1;
-        return std::scanf("%d", &out_value);
+        return cstar::stdin_buf().scan(out_value);
     }
 
     static int __cdecl posixscanf(const char* id, double &out_value) {
         if (std::strcmp(id, CSTAR_IDENTIFIERS[2]) != 0) return -1;
-        return std::scanf("%lf", &out_value); /* use %lf for double */
+        return cstar::stdin_buf().scan(out_value);
     }
 
     static int __cdecl posixscanf(const char* id, char &out_value) {
         if (std::strcmp(id, CSTAR_IDENTIFIERS[3]) != 0) return -1;
-        return std::scanf(" %c", &out_value); /* skip whitespace */
+        return cstar::stdin_buf().scan(out_value); /* skips whitespace like " %c" */
     }
 
     // Generic fallback: convert arithmetic types to double/int and strings to std::string
@@ -139,9 +154,13 @@ public:
     template<typename T>
     static inline void ReadLine(T& input) {
         if constexpr (std::is_same_v<T, std::string>) {
-            std::getline(std::cin, input);
+            cstar::stdin_buf().read_line(input);
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            cstar::stdin_buf().read(input);
         } else {
-            std::cin >> input;
+            // user types with their own operator>>: parse one token
+            std::istringstream tok(std::string(cstar::stdin_buf().token()));
+            tok >> input;
         }
     }
 };
@@ -150,51 +169,26 @@ typedef void (*PluginFuncType)();
 
 using CSTRFORLIB = const std::string;
 
+// Runs a void() function from a shared library. The library stays loaded
+// in cstar::plugins() and the symbol is cached, so calling this in a loop
+// no longer reopens the library each time.
 static void __cdecl importlib(CSTRFORLIB& library, CSTRFORLIB& funcName) {
-    dl_handle_t handle = DL_HANDLE_ERROR;
-    // --- Step 1: Open the library file (Platform Specific) ---
-#ifdef _WIN32
-    handle = LoadLibraryA(library.c_str());
-    if (handle == DL_HANDLE_ERROR) {
-        std::cerr << "ERROR: Windows LoadLibrary failed for " << library << std::endl;
-        return;
-    }
-#else
-    handle = dlopen(library.c_str(), RTLD_LAZY);
-    if (handle == DL_HANDLE_ERROR) {
-        std::cerr << "ERROR: dlopen failed for " << library << ": " << dlerror() << std::endl;
-        return;
+    cstar::plugin* lib = cstar::plugins().find(library);
+    if (!lib) {
+        lib = cstar::plugins().load(library);
+        if (!lib) {
+            std::cerr << "ERROR: could not load " << library << ": " << cstar::plugins().last_error() << std::endl;
+            return;
+        }
+        std::cout << "Successfully loaded library: " << library << std::endl;
     }
-#endif
-
-    std::cout << "Successfully loaded library: " << library << std::endl;
-
-    // --- Step 2: Get function pointer (Platform Specific) ---
-    PluginFuncType func = nullptr;
-
-#ifdef _WIN32
-    func = (PluginFuncType)GetProcAddress(handle, funcName.c_str());
-#else
-    // Need a cast via void* to satisfy the C++ compiler when using dlsym results
-    void* raw_func_ptr = dlsym(handle, funcName.c_str());
-    func = (PluginFuncType)raw_func_ptr;
-#endif
 
+    PluginFuncType func = lib->get<void()>(funcName);
     if (!func) {
         std::cerr << "ERROR: Could not find function symbol: " << funcName << std::endl;
-    } else {
-        // --- Step 3: Execute the function ---
-        std::cout << "Executing imported function: " << funcName << std::endl;
-        func();
+        return;
     }
-
-    // --- Step 4: Close the library (Platform Specific) ---
-#ifdef _WIN32
-    FreeLibrary(handle);
-#else
-    dlclose(handle);
-#endif
-    std::cout << "Closed library handle." << std::endl;
+    func();
 }
 
 // inline globals to avoid ODR/linker problems
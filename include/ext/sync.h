@@ -0,0 +1,234 @@
+/*
+sync.h - Monitors for CStar's `synchronized`.
+
+The compiler lowers
+
+    synchronized (account) { account.balance += x; }
+    synchronized void deposit(int x) { balance += x; }
+
+to a cstar::sync_guard on the object's monitor. The guard is held until
+the block or method ends, however it is left. The same object always
+gets the same monitor:
+
+  - an object whose class derives from cstar::synchronizable carries
+    its monitor next to its data, and a cstar::monitor is its own;
+  - any other object uses one of 512 monitors in a striped table,
+    picked by hashing its address. Objects that share a stripe also
+    share a lock. Reentrancy covers one thread locking both, but two
+    threads that each hold one striped object and wait for another can
+    deadlock through a shared stripe even when the objects themselves
+    are always locked in a consistent order. Derive such classes from
+    cstar::synchronizable to give them a monitor of their own.
+
+Static synchronized methods lock a monitor per class
+(cstar::class_monitor<T>()). Synchronized free functions share
+class_monitor<void>().
+
+cstar::monitor is a reentrant mutex. Locking an unlocked monitor takes
+one compare-and-swap. Under contention it spins for a while, adapting
+the spin count to how long the lock was held before, then sleeps on a
+futex (Drepper, "Futexes Are Tricky", mutex 3). It spins only on
+machines with more than one core. A monitor also works with
+std::lock_guard and std::unique_lock.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_SYNC_H
+#define CSTLIB26_SYNC_H 1
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+#if defined(__linux__)
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace cstar {
+
+namespace detail {
+
+// Its address identifies the calling thread.
+inline thread_local char sync_thread_tag;
+
+inline void futex_wait(std::atomic<std::uint32_t>& word, std::uint32_t expected) noexcept {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+    word.wait(expected, std::memory_order_relaxed);
+#endif
+}
+
+inline void futex_wake_one(std::atomic<std::uint32_t>& word) noexcept {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+    word.notify_one();
+#endif
+}
+
+// Longest spin before sleeping; 0 on a single core, where the owner
+// cannot make progress while we spin.
+inline unsigned max_spin() noexcept {
+    static const unsigned spins = std::thread::hardware_concurrency() > 1 ? 200 : 0;
+    return spins;
+}
+
+} // namespace detail
+
+class monitor {
+public:
+    constexpr monitor() noexcept = default;
+    monitor(const monitor&) = delete;
+    monitor& operator=(const monitor&) = delete;
+
+    void lock() noexcept {
+        const void* self = &detail::sync_thread_tag;
+        if (owner_.load(std::memory_order_relaxed) == self) {
+            ++depth_;
+            return;
+        }
+        std::uint32_t c = unlocked;
+        if (!state_.compare_exchange_strong(c, locked, std::memory_order_acquire, std::memory_order_relaxed))
+            lock_slow();
+        owner_.store(self, std::memory_order_relaxed);
+        depth_ = 1;
+    }
+
+    bool try_lock() noexcept {
+        const void* self = &detail::sync_thread_tag;
+        if (owner_.load(std::memory_order_relaxed) == self) {
+            ++depth_;
+            return true;
+        }
+        std::uint32_t c = unlocked;
+        if (!state_.compare_exchange_strong(c, locked, std::memory_order_acquire, std::memory_order_relaxed))
+            return false;
+        owner_.store(self, std::memory_order_relaxed);
+        depth_ = 1;
+        return true;
+    }
+
+    void unlock() noexcept {
+        if (--depth_) return;
+        owner_.store(nullptr, std::memory_order_relaxed);
+        if (state_.exchange(unlocked, std::memory_order_release) == contended) detail::futex_wake_one(state_);
+    }
+
+    // True if the calling thread holds this monitor.
+    bool held() const noexcept { return owner_.load(std::memory_order_relaxed) == &detail::sync_thread_tag; }
+
+private:
+    static constexpr std::uint32_t unlocked = 0, locked = 1, contended = 2;
+
+    void lock_slow() noexcept {
+        // Spin up to about twice the recent average spin, so short critical
+        // sections are waited out and long ones go straight to sleep.
+        unsigned limit = std::min(detail::max_spin(), 2u * spins_.load(std::memory_order_relaxed) + 10u);
+        unsigned n = 0;
+        for (; n < limit; ++n) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+            std::uint32_t c = state_.load(std::memory_order_relaxed);
+            if (c == unlocked &&
+                state_.compare_exchange_weak(c, locked, std::memory_order_acquire, std::memory_order_relaxed))
+                break;
+        }
+        if (limit) {
+            unsigned s = spins_.load(std::memory_order_relaxed);
+            spins_.store((unsigned)((int)s + ((int)n - (int)s) / 8), std::memory_order_relaxed);
+            if (n < limit) return;
+        }
+        // Mark the lock contended and sleep. Whoever wakes takes it as
+        // contended too, since other sleepers may remain.
+        std::uint32_t c = state_.exchange(contended, std::memory_order_acquire);
+        while (c != unlocked) {
+            detail::futex_wait(state_, contended);
+            c = state_.exchange(contended, std::memory_order_acquire);
+        }
+    }
+
+    std::atomic<std::uint32_t> state_{unlocked};
+    std::uint32_t depth_ = 0; // touched only by the owner
+    std::atomic<const void*> owner_{nullptr};
+    std::atomic<unsigned> spins_{0};
+};
+
+namespace detail {
+
+struct alignas(64) monitor_stripe {
+    monitor m;
+};
+
+inline constexpr std::size_t monitor_stripe_bits = 9;
+inline monitor_stripe monitor_stripes[std::size_t(1) << monitor_stripe_bits];
+
+} // namespace detail
+
+// Base class that keeps a monitor inside each object. Copies get a fresh,
+// unlocked monitor.
+class synchronizable {
+public:
+    synchronizable() noexcept = default;
+    synchronizable(const synchronizable&) noexcept {}
+    synchronizable& operator=(const synchronizable&) noexcept { return *this; }
+
+    monitor& object_monitor() const noexcept { return monitor_; }
+
+private:
+    mutable monitor monitor_;
+};
+
+// The monitor used for the object at addr when it has none of its own.
+inline monitor& striped_monitor(const void* addr) noexcept {
+    std::uint64_t h = (std::uint64_t)(std::uintptr_t)addr * 0x9E3779B97F4A7C15ull;
+    return detail::monitor_stripes[h >> (64 - detail::monitor_stripe_bits)].m;
+}
+
+// The monitor of a class, for static synchronized methods.
+template <typename T>
+inline monitor& class_monitor() noexcept {
+    static monitor m;
+    return m;
+}
+
+template <typename T>
+inline monitor& monitor_for(T& obj) noexcept {
+    using U = std::remove_cv_t<T>;
+    if constexpr (std::is_pointer_v<U>) {
+        return monitor_for(*obj);
+    } else if constexpr (std::is_base_of_v<synchronizable, U>) {
+        return static_cast<const synchronizable&>(obj).object_monitor();
+    } else if constexpr (std::is_base_of_v<monitor, U>) {
+        return const_cast<monitor&>(static_cast<const monitor&>(obj));
+    } else {
+        return striped_monitor(std::addressof(obj));
+    }
+}
+
+// Holds an object's monitor for its lifetime; what `synchronized` becomes.
+class sync_guard {
+public:
+    template <typename T>
+    explicit sync_guard(T&& obj) noexcept : m_(monitor_for(obj)) {
+        m_.lock();
+    }
+    ~sync_guard() { m_.unlock(); }
+
+    sync_guard(const sync_guard&) = delete;
+    sync_guard& operator=(const sync_guard&) = delete;
+
+private:
+    monitor& m_;
+};
+
+} // namespace cstar
+
+#endif // CSTLIB26_SYNC_H
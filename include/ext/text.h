@@ -0,0 +1,509 @@
+/*
+text.h - String toolkit for CStar (str is std::string; everything here
+takes std::string_view, so it works on str, literals and slices alike).
+
+    str line = "  Hello, World  ";
+    std::string_view t = cstar::text::trim(line);           // "Hello, World"
+    auto fields = cstar::text::split("a,b,,c", ',');          // {"a", "b", "", "c"}
+    auto words  = cstar::text::words("  two   words ");       // {"two", "words"}
+    str low = cstar::text::lower(t);                         // "hello, world"
+    bool same = cstar::text::iequals("CStar", "cstar");      // true
+    std::size_t at = cstar::text::find(t, "World");          // 7
+    std::size_t n = cstar::text::count_lines(file_contents);
+    bool ok = cstar::text::valid_utf8(bytes);
+
+Searches return an index or cstar::text::npos. split and words return
+string_views into the input, so the input must outlive them. Case
+functions change ASCII letters only; other bytes (including every byte
+of a multibyte UTF-8 character) are left alone.
+
+The work is done 16 or 32 bytes at a time with SSE4.2 or AVX2, picked
+once through CPUID, with a plain C++ path elsewhere. Character sets
+(find_first_of, split_any, trim) are matched with nibble lookup tables,
+so sets of any size cost the same. use_isa() forces a path, e.g. to
+compare them.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_TEXT_H
+#define CSTLIB26_TEXT_H 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define CSTAR_TEXT_X86 1
+    #include <immintrin.h>
+#endif
+
+namespace cstar {
+namespace text {
+
+inline constexpr std::size_t npos = std::string_view::npos;
+
+// A set of bytes as two 16-entry nibble tables: bit (hi & 7) of low[lo]
+// is set when byte hi:lo (hi < 8) is in the set, high[] covers hi >= 8.
+struct byte_set {
+    alignas(16) std::uint8_t low[16] = {};
+    alignas(16) std::uint8_t high[16] = {};
+    alignas(16) static constexpr std::uint8_t bits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+
+    constexpr byte_set() = default;
+    constexpr byte_set(std::string_view chars) {
+        for (char ch : chars) {
+            auto c = (unsigned char)ch;
+            (c < 0x80 ? low : high)[c & 15] |= (std::uint8_t)(1u << ((c >> 4) & 7));
+        }
+    }
+    constexpr byte_set(const char* chars) : byte_set(std::string_view(chars)) {}
+    byte_set(const std::string& chars) : byte_set(std::string_view(chars)) {}
+
+    constexpr bool contains(char ch) const {
+        auto c = (unsigned char)ch;
+        return ((c < 0x80 ? low : high)[c & 15] >> ((c >> 4) & 7)) & 1;
+    }
+};
+
+inline constexpr byte_set whitespace{" \t\n\v\f\r"};
+
+namespace detail {
+
+struct kernels {
+    std::size_t (*find)(const char* h, std::size_t n, const char* needle, std::size_t m);  // m >= 2
+    std::size_t (*find_set)(const char* p, std::size_t n, const byte_set& s, bool want);
+    std::size_t (*rfind_set)(const char* p, std::size_t n, const byte_set& s, bool want);
+    std::size_t (*count)(const char* p, std::size_t n, char c);
+    void (*split_byte)(const char* p, std::size_t n, char c, bool keep_empty, std::vector<std::string_view>& out);
+    void (*split_set)(const char* p, std::size_t n, const byte_set& s, bool keep_empty,
+                      std::vector<std::string_view>& out);
+    void (*fold)(char* dst, const char* src, std::size_t n, char first);
+    bool (*equal_ci)(const char* a, const char* b, std::size_t n);
+    bool (*valid_utf8)(const char* p, std::size_t n);
+};
+
+namespace portable {
+
+inline std::size_t find(const char* h, std::size_t n, const char* needle, std::size_t m) {
+    return std::string_view(h, n).find(std::string_view(needle, m));
+}
+
+inline std::size_t find_set(const char* p, std::size_t n, const byte_set& s, bool want) {
+    for (std::size_t i = 0; i < n; ++i)
+        if (s.contains(p[i]) == want) return i;
+    return npos;
+}
+
+inline std::size_t rfind_set(const char* p, std::size_t n, const byte_set& s, bool want) {
+    while (n--)
+        if (s.contains(p[n]) == want) return n;
+    return npos;
+}
+
+inline std::size_t count(const char* p, std::size_t n, char c) {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < n; ++i) total += p[i] == c;
+    return total;
+}
+
+// Finishes a split: scans p[i, n) for separators and emits the pieces,
+// the first one starting at start.
+template <typename IsSep>
+inline void split_tail(const char* p, std::size_t n, std::size_t start, std::size_t i, IsSep is_sep,
+                       bool keep_empty, std::vector<std::string_view>& out) {
+    for (; i < n; ++i)
+        if (is_sep(p[i])) {
+            if (keep_empty || i > start) out.emplace_back(p + start, i - start);
+            start = i + 1;
+        }
+    if (keep_empty || n > start) out.emplace_back(p + start, n - start);
+}
+
+inline void split_byte(const char* p, std::size_t n, char c, bool keep_empty, std::vector<std::string_view>& out) {
+    split_tail(p, n, 0, 0, [c](char x) { return x == c; }, keep_empty, out);
+}
+
+inline void split_set(const char* p, std::size_t n, const byte_set& s, bool keep_empty,
+                      std::vector<std::string_view>& out) {
+    split_tail(p, n, 0, 0, [&s](char x) { return s.contains(x); }, keep_empty, out);
+}
+
+inline void fold(char* dst, const char* src, std::size_t n, char first) {
+    for (std::size_t i = 0; i < n; ++i) {
+        char c = src[i];
+        dst[i] = (unsigned char)(c - first) < 26 ? char(c ^ 0x20) : c;
+    }
+}
+
+inline bool equal_ci(const char* a, const char* b, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+        unsigned char x = (unsigned char)a[i], y = (unsigned char)b[i];
+        if (unsigned(x - 'A') < 26u) x |= 0x20;
+        if (unsigned(y - 'A') < 26u) y |= 0x20;
+        if (x != y) return false;
+    }
+    return true;
+}
+
+inline bool valid_utf8(const char* s, std::size_t n) {
+    auto p = reinterpret_cast<const unsigned char*>(s);
+    std::size_t i = 0;
+    while (i < n) {
+        if (p[i] < 0x80) {
+            ++i;
+            continue;
+        }
+        std::size_t len;
+        unsigned lo = 0x80, hi = 0xBF;  // allowed range of the second byte
+        unsigned c = p[i];
+        if (c >= 0xC2 && c <= 0xDF) {
+            len = 2;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            len = 3;
+            if (c == 0xE0) lo = 0xA0;  // overlong
+            if (c == 0xED) hi = 0x9F;  // surrogates
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            len = 4;
+            if (c == 0xF0) lo = 0x90;  // overlong
+            if (c == 0xF4) hi = 0x8F;  // above U+10FFFF
+        } else {
+            return false;
+        }
+        if (n - i < len || p[i + 1] < lo || p[i + 1] > hi) return false;
+        for (std::size_t k = 2; k < len; ++k)
+            if ((p[i + k] & 0xC0) != 0x80) return false;
+        i += len;
+    }
+    return true;
+}
+
+constexpr kernels table = {find, find_set, rfind_set, count, split_byte, split_set, fold, equal_ci, valid_utf8};
+
+} // namespace portable
+
+#ifdef CSTAR_TEXT_X86
+// Lookup tables of the vector UTF-8 check, indexed by a nibble. Each bit
+// names one kind of error; a pair of bytes is bad when the bit survives
+// the AND of the high and low nibble of the first byte and the high
+// nibble of the second.
+namespace utf8_tables {
+constexpr std::uint8_t too_short = 1 << 0;   // lead byte, then no continuation
+constexpr std::uint8_t too_long = 1 << 1;    // ASCII, then continuation
+constexpr std::uint8_t overlong_3 = 1 << 2;  // E0 80..9F
+constexpr std::uint8_t too_large = 1 << 3;   // F4 90..BF, F5..FF
+constexpr std::uint8_t surrogate = 1 << 4;   // ED A0..BF
+constexpr std::uint8_t overlong_2 = 1 << 5;  // C0..C1
+constexpr std::uint8_t too_large_1000 = 1 << 6;
+constexpr std::uint8_t overlong_4 = 1 << 6;  // F0 80..8F
+constexpr std::uint8_t two_conts = 1 << 7;   // continuation, then continuation
+constexpr std::uint8_t carry = too_short | too_long | two_conts;
+
+alignas(16) inline constexpr std::uint8_t byte1_high[16] = {
+    too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+    two_conts, two_conts, two_conts, two_conts,
+    too_short | overlong_2,
+    too_short,
+    too_short | overlong_3 | surrogate,
+    too_short | too_large | too_large_1000 | overlong_4};
+alignas(16) inline constexpr std::uint8_t byte1_low[16] = {
+    carry | overlong_3 | overlong_2 | overlong_4,
+    carry | overlong_2,
+    carry,
+    carry,
+    carry | too_large,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000 | surrogate,
+    carry | too_large | too_large_1000,
+    carry | too_large | too_large_1000};
+alignas(16) inline constexpr std::uint8_t byte2_high[16] = {
+    too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+    too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+    too_long | overlong_2 | two_conts | overlong_3 | too_large,
+    too_long | overlong_2 | two_conts | surrogate | too_large,
+    too_long | overlong_2 | two_conts | surrogate | too_large,
+    too_short, too_short, too_short, too_short};
+// A block whose last three bytes start a sequence longer than what is
+// left of it is incomplete; subtracting these leaves a nonzero byte.
+alignas(32) inline constexpr std::uint8_t incomplete[32] = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1};
+} // namespace utf8_tables
+
+namespace sse42 {
+#define CSTAR_TEXT_TARGET __attribute__((target("sse4.2,popcnt")))
+    struct vec {
+        using reg = __m128i;
+        static constexpr std::size_t width = 16;
+        static constexpr std::uint32_t full = 0xFFFF;
+        CSTAR_TEXT_TARGET static reg zero() { return _mm_setzero_si128(); }
+        CSTAR_TEXT_TARGET static reg load(const char* p) { return _mm_loadu_si128(reinterpret_cast<const reg*>(p)); }
+        CSTAR_TEXT_TARGET static void store(char* p, reg v) { _mm_storeu_si128(reinterpret_cast<reg*>(p), v); }
+        CSTAR_TEXT_TARGET static reg table(const std::uint8_t* t) { return _mm_load_si128(reinterpret_cast<const reg*>(t)); }
+        CSTAR_TEXT_TARGET static reg set1(char c) { return _mm_set1_epi8(c); }
+        CSTAR_TEXT_TARGET static reg eq(reg a, reg b) { return _mm_cmpeq_epi8(a, b); }
+        CSTAR_TEXT_TARGET static reg lt(reg a, reg b) { return _mm_cmplt_epi8(a, b); }
+        CSTAR_TEXT_TARGET static reg add(reg a, reg b) { return _mm_add_epi8(a, b); }
+        CSTAR_TEXT_TARGET static reg subs(reg a, reg b) { return _mm_subs_epu8(a, b); }
+        CSTAR_TEXT_TARGET static reg and_(reg a, reg b) { return _mm_and_si128(a, b); }
+        CSTAR_TEXT_TARGET static reg or_(reg a, reg b) { return _mm_or_si128(a, b); }
+        CSTAR_TEXT_TARGET static reg xor_(reg a, reg b) { return _mm_xor_si128(a, b); }
+        CSTAR_TEXT_TARGET static reg blendv(reg a, reg b, reg m) { return _mm_blendv_epi8(a, b, m); }
+        CSTAR_TEXT_TARGET static reg lookup(reg t, reg i) { return _mm_shuffle_epi8(t, i); }
+        CSTAR_TEXT_TARGET static reg lo_nibble(reg v) { return _mm_and_si128(v, _mm_set1_epi8(0x0F)); }
+        CSTAR_TEXT_TARGET static reg hi_nibble(reg v) { return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F)); }
+        CSTAR_TEXT_TARGET static std::uint32_t mask(reg v) { return (std::uint32_t)_mm_movemask_epi8(v); }
+        // input shifted right by N bytes, with the end of prev shifted in
+        template <int N>
+        CSTAR_TEXT_TARGET static reg prev(reg input, reg prev) {
+            return _mm_alignr_epi8(input, prev, 16 - N);
+        }
+    };
+#include "text_kernels.inc"
+#undef CSTAR_TEXT_TARGET
+} // namespace sse42
+
+namespace avx2 {
+#define CSTAR_TEXT_TARGET __attribute__((target("avx2,popcnt")))
+    struct vec {
+        using reg = __m256i;
+        static constexpr std::size_t width = 32;
+        static constexpr std::uint32_t full = 0xFFFFFFFF;
+        CSTAR_TEXT_TARGET static reg zero() { return _mm256_setzero_si256(); }
+        CSTAR_TEXT_TARGET static reg load(const char* p) { return _mm256_loadu_si256(reinterpret_cast<const reg*>(p)); }
+        CSTAR_TEXT_TARGET static void store(char* p, reg v) { _mm256_storeu_si256(reinterpret_cast<reg*>(p), v); }
+        CSTAR_TEXT_TARGET static reg table(const std::uint8_t* t) {
+            return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(t)));
+        }
+        CSTAR_TEXT_TARGET static reg set1(char c) { return _mm256_set1_epi8(c); }
+        CSTAR_TEXT_TARGET static reg eq(reg a, reg b) { return _mm256_cmpeq_epi8(a, b); }
+        CSTAR_TEXT_TARGET static reg lt(reg a, reg b) { return _mm256_cmpgt_epi8(b, a); }
+        CSTAR_TEXT_TARGET static reg add(reg a, reg b) { return _mm256_add_epi8(a, b); }
+        CSTAR_TEXT_TARGET static reg subs(reg a, reg b) { return _mm256_subs_epu8(a, b); }
+        CSTAR_TEXT_TARGET static reg and_(reg a, reg b) { return _mm256_and_si256(a, b); }
+        CSTAR_TEXT_TARGET static reg or_(reg a, reg b) { return _mm256_or_si256(a, b); }
+        CSTAR_TEXT_TARGET static reg xor_(reg a, reg b) { return _mm256_xor_si256(a, b); }
+        CSTAR_TEXT_TARGET static reg blendv(reg a, reg b, reg m) { return _mm256_blendv_epi8(a, b, m); }
+        CSTAR_TEXT_TARGET static reg lookup(reg t, reg i) { return _mm256_shuffle_epi8(t, i); }
+        CSTAR_TEXT_TARGET static reg lo_nibble(reg v) { return _mm256_and_si256(v, _mm256_set1_epi8(0x0F)); }
+        CSTAR_TEXT_TARGET static reg hi_nibble(reg v) {
+            return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+        }
+        CSTAR_TEXT_TARGET static std::uint32_t mask(reg v) { return (std::uint32_t)_mm256_movemask_epi8(v); }
+        template <int N>
+        CSTAR_TEXT_TARGET static reg prev(reg input, reg prev) {
+            return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - N);
+        }
+    };
+#include "text_kernels.inc"
+#undef CSTAR_TEXT_TARGET
+} // namespace avx2
+#endif
+
+} // namespace detail
+
+enum class isa { scalar, sse42, avx2 };
+
+// Widest instruction set this CPU supports.
+inline isa best_isa() {
+    static const isa best = [] {
+#ifdef CSTAR_TEXT_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) return isa::avx2;
+        if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) return isa::sse42;
+#endif
+        return isa::scalar;
+    }();
+    return best;
+}
+
+namespace detail {
+
+inline const kernels* kernels_for(isa which) {
+    switch (which) {
+#ifdef CSTAR_TEXT_X86
+    case isa::avx2:
+        return &avx2::table;
+    case isa::sse42:
+        return &sse42::table;
+#endif
+    default:
+        return &portable::table;
+    }
+}
+
+inline std::atomic<const kernels*>& active_slot() {
+    static std::atomic<const kernels*> active{kernels_for(best_isa())};
+    return active;
+}
+
+inline const kernels& active() { return *active_slot().load(std::memory_order_relaxed); }
+
+} // namespace detail
+
+// Instruction set the functions currently use.
+inline isa active_isa() {
+    const detail::kernels* k = &detail::active();
+#ifdef CSTAR_TEXT_X86
+    if (k == &detail::avx2::table) return isa::avx2;
+    if (k == &detail::sse42::table) return isa::sse42;
+#endif
+    (void)k;
+    return isa::scalar;
+}
+
+// Force a code path. Returns false, changing nothing, if the CPU cannot
+// run it.
+inline bool use_isa(isa which) {
+    if (which > best_isa()) return false;
+    detail::active_slot().store(detail::kernels_for(which), std::memory_order_relaxed);
+    return true;
+}
+
+inline const char* isa_name(isa which) {
+    switch (which) {
+    case isa::avx2:
+        return "avx2";
+    case isa::sse42:
+        return "sse4.2";
+    default:
+        return "scalar";
+    }
+}
+
+// --- searching ---------------------------------------------------------
+
+inline std::size_t find(std::string_view s, char c, std::size_t pos = 0) {
+    if (pos >= s.size()) return npos;
+    // glibc's memchr is already vectorized
+    auto hit = static_cast<const char*>(std::memchr(s.data() + pos, c, s.size() - pos));
+    return hit ? std::size_t(hit - s.data()) : npos;
+}
+
+inline std::size_t find(std::string_view s, std::string_view needle, std::size_t pos = 0) {
+    if (pos > s.size() || needle.size() > s.size() - pos) return npos;
+    if (needle.size() <= 1) return needle.empty() ? pos : find(s, needle[0], pos);
+    std::size_t r = detail::active().find(s.data() + pos, s.size() - pos, needle.data(), needle.size());
+    return r == npos ? npos : r + pos;
+}
+
+inline bool contains(std::string_view s, std::string_view needle) { return find(s, needle) != npos; }
+inline bool starts_with(std::string_view s, std::string_view prefix) {
+    return s.size() >= prefix.size() && std::memcmp(s.data(), prefix.data(), prefix.size()) == 0;
+}
+inline bool ends_with(std::string_view s, std::string_view suffix) {
+    return s.size() >= suffix.size() && std::memcmp(s.data() + s.size() - suffix.size(), suffix.data(), suffix.size()) == 0;
+}
+
+// First index at or after pos whose byte is (or, for _not_of, is not) in set.
+inline std::size_t find_first_of(std::string_view s, const byte_set& set, std::size_t pos = 0) {
+    if (pos >= s.size()) return npos;
+    std::size_t r = detail::active().find_set(s.data() + pos, s.size() - pos, set, true);
+    return r == npos ? npos : r + pos;
+}
+inline std::size_t find_first_not_of(std::string_view s, const byte_set& set, std::size_t pos = 0) {
+    if (pos >= s.size()) return npos;
+    std::size_t r = detail::active().find_set(s.data() + pos, s.size() - pos, set, false);
+    return r == npos ? npos : r + pos;
+}
+// Last index whose byte is (is not) in set.
+inline std::size_t find_last_of(std::string_view s, const byte_set& set) {
+    return detail::active().rfind_set(s.data(), s.size(), set, true);
+}
+inline std::size_t find_last_not_of(std::string_view s, const byte_set& set) {
+    return detail::active().rfind_set(s.data(), s.size(), set, false);
+}
+
+inline std::size_t count(std::string_view s, char c) { return detail::active().count(s.data(), s.size(), c); }
+
+// Lines as `wc -l` would count them, plus a last line without '\n'.
+inline std::size_t count_lines(std::string_view s) {
+    return count(s, '\n') + (!s.empty() && s.back() != '\n');
+}
+
+// --- splitting and trimming --------------------------------------------
+
+// Pieces between each sep; n separators give n + 1 pieces, some empty.
+inline std::vector<std::string_view> split(std::string_view s, char sep) {
+    std::vector<std::string_view> out;
+    detail::active().split_byte(s.data(), s.size(), sep, true, out);
+    return out;
+}
+
+// Pieces between occurrences of a whole separator string.
+inline std::vector<std::string_view> split(std::string_view s, std::string_view sep) {
+    if (sep.size() == 1) return split(s, sep[0]);
+    std::vector<std::string_view> out;
+    if (sep.empty()) {
+        out.push_back(s);
+        return out;
+    }
+    std::size_t start = 0;
+    for (std::size_t at; (at = find(s, sep, start)) != npos; start = at + sep.size()) out.push_back(s.substr(start, at - start));
+    out.push_back(s.substr(start));
+    return out;
+}
+
+// Pieces between bytes of seps, e.g. split_any(csv_line, ",;").
+inline std::vector<std::string_view> split_any(std::string_view s, const byte_set& seps, bool keep_empty = true) {
+    std::vector<std::string_view> out;
+    detail::active().split_set(s.data(), s.size(), seps, keep_empty, out);
+    return out;
+}
+
+// Runs of non-whitespace, like Python's str.split().
+inline std::vector<std::string_view> words(std::string_view s) { return split_any(s, whitespace, false); }
+
+inline std::string_view trim_left(std::string_view s, const byte_set& chars = whitespace) {
+    std::size_t i = find_first_not_of(s, chars);
+    return i == npos ? s.substr(s.size()) : s.substr(i);
+}
+inline std::string_view trim_right(std::string_view s, const byte_set& chars = whitespace) {
+    std::size_t i = find_last_not_of(s, chars);
+    return s.substr(0, i == npos ? 0 : i + 1);
+}
+inline std::string_view trim(std::string_view s, const byte_set& chars = whitespace) {
+    return trim_right(trim_left(s, chars), chars);
+}
+
+// --- case --------------------------------------------------------------
+
+inline void to_lower(std::string& s) { detail::active().fold(s.data(), s.data(), s.size(), 'A'); }
+inline void to_upper(std::string& s) { detail::active().fold(s.data(), s.data(), s.size(), 'a'); }
+
+inline std::string lower(std::string_view s) {
+    std::string out(s.size(), '\0');
+    detail::active().fold(out.data(), s.data(), s.size(), 'A');
+    return out;
+}
+inline std::string upper(std::string_view s) {
+    std::string out(s.size(), '\0');
+    detail::active().fold(out.data(), s.data(), s.size(), 'a');
+    return out;
+}
+
+// Equal ignoring ASCII case.
+inline bool iequals(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && detail::active().equal_ci(a.data(), b.data(), a.size());
+}
+
+// --- UTF-8 -------------------------------------------------------------
+
+// Well-formed UTF-8: no overlong forms, surrogates, values above
+// U+10FFFF or truncated sequences.
+inline bool valid_utf8(std::string_view s) { return detail::active().valid_utf8(s.data(), s.size()); }
+
+} // namespace text
+} // namespace cstar
+
+#endif // CSTLIB26_TEXT_H
@@ -0,0 +1,502 @@
+/*
+trace.h - Trace spans for latency debugging (TRACE_SCOPE).
+
+    returnf Ast parse(const std::string& text) {
+        TRACE_SCOPE("parse");          // from here to the end of the block
+        ...
+        if (miss) TRACE_INSTANT("cache miss");
+    }
+
+    std::thread worker([] { TRACE_THREAD("worker"); ... });
+
+Names must be string literals. The macros expand to nothing unless the
+program is built with CSTAR_TRACE defined, which `cstarc --trace` does,
+so spans can stay in hot code.
+
+Each thread writes its events into its own ring buffer: start and end
+in clock ticks and the address of the name, 24 bytes. Only the owning
+thread writes a ring, so an event is a few plain stores with no lock
+and no read-modify-write. A ring keeps the newest CSTAR_TRACE_EVENTS
+events (default 65536, 1.5 MiB) and overwrites older ones. The clock is
+the TSC on x86 and steady_clock elsewhere, as in instrument.h.
+
+snapshot() copies every ring, without stopping the threads writing
+them. Events of exited threads are kept until a new thread reuses the
+ring. A program that traced anything writes a dump at exit to the file
+named by CSTAR_TRACE_OUT (default trace.cstrace; 0 for none). The
+cstrace tool converts a dump to Chrome trace JSON, which
+ui.perfetto.dev and chrome://tracing open:
+
+    cstrace trace.cstrace trace.json
+
+A CSTAR_TRACE_OUT ending in .json gets the JSON directly.
+bench/bench_trace measures what an event costs.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
+#ifndef CSTLIB26_TRACE_H
+#define CSTLIB26_TRACE_H 1
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+#if defined(_WIN32)
+    #include <process.h>
+#else
+    #include <unistd.h>
+#endif
+#if defined(__linux__)
+    #include <sys/syscall.h>
+#endif
+
+#define CSTAR_TRACE_JOIN2(a, b) a##b
+#define CSTAR_TRACE_JOIN(a, b) CSTAR_TRACE_JOIN2(a, b)
+
+// "" name only compiles for string literals, in both modes
+#ifdef CSTAR_TRACE
+    #define TRACE_SCOPE(name) ::cstar::trace::scope CSTAR_TRACE_JOIN(cstar_trace_scope_, __LINE__)("" name)
+    #define TRACE_INSTANT(name) ::cstar::trace::instant("" name)
+    #define TRACE_THREAD(name) ::cstar::trace::name_thread(name)
+#else
+    #define TRACE_SCOPE(name) static_cast<void>(sizeof("" name))
+    #define TRACE_INSTANT(name) static_cast<void>(sizeof("" name))
+    #define TRACE_THREAD(name) static_cast<void>(0)
+#endif
+
+namespace cstar {
+namespace trace {
+
+// Clock ticks: TSC cycles where there is one, otherwise nanoseconds.
+inline std::uint64_t ticks() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+// What snapshot() returns and a dump file holds. Times are in ticks.
+struct event {
+    std::uint64_t start, end;
+    std::uint32_t name; // index into capture::names
+    std::uint32_t instant;
+};
+
+struct thread_events {
+    std::uint32_t tid = 0;
+    std::string name;
+    std::vector<event> events; // by start, enclosing spans first
+};
+
+struct capture {
+    double ns_per_tick = 1.0;
+    std::uint64_t tick0 = 0; // time 0 of the trace
+    std::uint32_t pid = 0;
+    std::vector<std::string> names;
+    std::vector<thread_events> threads;
+};
+
+namespace detail {
+
+inline std::int64_t steady_ns() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+inline std::uint32_t thread_id() noexcept {
+#if defined(__linux__)
+    return (std::uint32_t)syscall(SYS_gettid);
+#else
+    return (std::uint32_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+#endif
+}
+
+inline std::uint32_t process_id() noexcept {
+#if defined(_WIN32)
+    return (std::uint32_t)_getpid();
+#else
+    return (std::uint32_t)getpid();
+#endif
+}
+
+// Fields are relaxed atomics so snapshot() may read a slot while its
+// owner rewrites it; on x86 these are plain loads and stores.
+struct slot {
+    std::atomic<std::uint64_t> start{0}, end{0}; // end 0: an instant
+    std::atomic<const char*> name{nullptr};
+};
+
+struct ring {
+    slot* slots = nullptr;
+    std::uint64_t mask = 0;
+    // events whose writing has begun / is done; only the owner stores
+    std::atomic<std::uint64_t> begun{0}, done{0};
+    std::uint32_t tid = 0;
+    std::string name; // under the state lock
+};
+
+struct state {
+    std::mutex lock;
+    std::vector<ring*> rings; // every ring ever made, live or not
+    std::vector<ring*> spare; // rings of exited threads
+    std::size_t capacity = 0;
+    std::uint64_t tick0 = 0;
+    std::int64_t ns0 = 0;
+};
+
+// Never destroyed: threads may still trace after static destructors run.
+inline state& global() {
+    static state* s = new state;
+    return *s;
+}
+
+inline thread_local ring* mine = nullptr;
+
+// Gives the ring back when its thread exits. Only the enrolling path
+// touches it, so events pay no thread_local guard.
+struct give_back {
+    ~give_back() {
+        if (!mine) return;
+        state& g = global();
+        std::lock_guard<std::mutex> hold(g.lock);
+        g.spare.push_back(mine);
+        mine = nullptr;
+    }
+};
+
+inline void dump_at_exit();
+
+inline std::size_t capacity_from_env() {
+    const char* env = std::getenv("CSTAR_TRACE_EVENTS");
+    long long n = env ? std::atoll(env) : 0;
+    if (n <= 0) n = 65536;
+    std::size_t c = 16;
+    while (c < (std::size_t)n) c <<= 1;
+    return c;
+}
+
+__attribute__((noinline)) inline ring* enroll() {
+    static thread_local give_back on_exit;
+    (void)&on_exit;
+    state& g = global();
+    std::lock_guard<std::mutex> hold(g.lock);
+    ring* r;
+    if (!g.spare.empty()) {
+        r = g.spare.back();
+        g.spare.pop_back();
+        r->begun.store(0, std::memory_order_relaxed);
+        r->done.store(0, std::memory_order_relaxed);
+        r->name.clear();
+    } else {
+        if (g.rings.empty()) {
+            g.capacity = capacity_from_env();
+            g.tick0 = ticks();
+            g.ns0 = steady_ns();
+            std::atexit(dump_at_exit);
+        }
+        r = new ring;
+        r->slots = new slot[g.capacity];
+        r->mask = g.capacity - 1;
+        g.rings.push_back(r);
+    }
+    r->tid = thread_id();
+    mine = r;
+    return r;
+}
+
+inline void record(const char* name, std::uint64_t start, std::uint64_t end) noexcept {
+    ring* r = mine;
+    if (!r) r = enroll();
+    std::uint64_t i = r->begun.load(std::memory_order_relaxed);
+    r->begun.store(i + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release); // begun before the slot changes
+    slot& s = r->slots[i & r->mask];
+    s.start.store(start, std::memory_order_relaxed);
+    s.end.store(end, std::memory_order_relaxed);
+    s.name.store(name, std::memory_order_relaxed);
+    r->done.store(i + 1, std::memory_order_release);
+}
+
+} // namespace detail
+
+// A span from construction to destruction. name must outlive the trace.
+class scope {
+public:
+    explicit scope(const char* name) noexcept : name_(name), start_(ticks()) {}
+    ~scope() { detail::record(name_, start_, ticks()); }
+
+    scope(const scope&) = delete;
+    scope& operator=(const scope&) = delete;
+
+private:
+    const char* name_;
+    std::uint64_t start_;
+};
+
+inline void instant(const char* name) noexcept { detail::record(name, ticks(), 0); }
+
+// Names the calling thread in the trace.
+inline void name_thread(const std::string& name) {
+    detail::ring* r = detail::mine ? detail::mine : detail::enroll();
+    detail::state& g = detail::global();
+    std::lock_guard<std::mutex> hold(g.lock);
+    r->name = name;
+}
+
+// Copies every thread's events. Threads keep tracing meanwhile; an event
+// overwritten while it was being copied is left out.
+inline capture snapshot() {
+    detail::state& g = detail::global();
+    capture c;
+    c.pid = detail::process_id();
+    std::unordered_map<const char*, std::uint32_t> ids;
+    std::uint64_t tick0, tick_fit;
+    std::int64_t ns0;
+    {
+        std::lock_guard<std::mutex> hold(g.lock);
+        tick0 = tick_fit = g.tick0;
+        ns0 = g.ns0;
+        std::vector<event> copied;
+        std::vector<const char*> names;
+        for (detail::ring* r : g.rings) {
+            std::uint64_t cap = r->mask + 1;
+            std::uint64_t done = r->done.load(std::memory_order_acquire);
+            std::uint64_t first = done > cap ? done - cap : 0;
+            copied.clear();
+            names.clear();
+            for (std::uint64_t i = first; i < done; ++i) {
+                const detail::slot& s = r->slots[i & r->mask];
+                copied.push_back({s.start.load(std::memory_order_relaxed), s.end.load(std::memory_order_relaxed), 0, 0});
+                names.push_back(s.name.load(std::memory_order_relaxed));
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // slot i is rewritten by event i + cap, once that has begun
+            std::uint64_t begun = r->begun.load(std::memory_order_relaxed);
+            std::uint64_t keep = begun > cap && begun - cap > first ? begun - cap : first;
+            thread_events t;
+            t.tid = r->tid;
+            t.name = r->name;
+            for (std::uint64_t i = keep; i < done; ++i) {
+                event e = copied[i - first];
+                const char* name = names[i - first];
+                auto it = ids.find(name);
+                if (it == ids.end()) {
+                    it = ids.emplace(name, (std::uint32_t)c.names.size()).first;
+                    c.names.push_back(name ? name : "?");
+                }
+                e.name = it->second;
+                if (e.end == 0) e.end = e.start, e.instant = 1;
+                t.events.push_back(e);
+            }
+            if (t.events.empty() && t.name.empty()) continue;
+            for (const event& e : t.events) tick0 = std::min(tick0, e.start);
+            std::sort(t.events.begin(), t.events.end(), [](const event& a, const event& b) {
+                return a.start != b.start ? a.start < b.start : a.end > b.end;
+            });
+            c.threads.push_back(std::move(t));
+        }
+    }
+
+    // time 0 is the earliest event, which may have started before the
+    // first record set g.tick0. ns per tick is fitted from g.tick0 on;
+    // a short run is topped up so it is measured over at least 20 ms.
+    c.tick0 = tick0;
+#if defined(__x86_64__) || defined(__i386__)
+    std::int64_t ns1 = detail::steady_ns();
+    if (ns1 - ns0 < 20'000'000) std::this_thread::sleep_for(std::chrono::nanoseconds(20'000'000 - (ns1 - ns0)));
+    std::uint64_t tick1 = ticks();
+    ns1 = detail::steady_ns();
+    if (tick1 > tick_fit) c.ns_per_tick = (double)(ns1 - ns0) / (double)(tick1 - tick_fit);
+#else
+    (void)tick_fit;
+    (void)ns0;
+#endif
+    return c;
+}
+
+// Dump file: "CSTRACE1", then the capture field by field in native byte
+// order. Strings are a 32-bit length and the bytes.
+namespace detail {
+
+inline void put(std::string& out, const void* p, std::size_t n) { out.append((const char*)p, n); }
+
+inline void put_string(std::string& out, const std::string& s) {
+    std::uint32_t n = (std::uint32_t)s.size();
+    put(out, &n, 4);
+    out += s;
+}
+
+struct reader {
+    const std::string& in;
+    std::size_t at = 0;
+    bool ok = true;
+
+    void get(void* p, std::size_t n) {
+        if (!ok || in.size() - at < n) {
+            ok = false;
+            std::memset(p, 0, n);
+            return;
+        }
+        std::memcpy(p, in.data() + at, n);
+        at += n;
+    }
+
+    std::string get_string() {
+        std::uint32_t n = 0;
+        get(&n, 4);
+        if (!ok || in.size() - at < n) return ok = false, std::string();
+        std::string s = in.substr(at, n);
+        at += n;
+        return s;
+    }
+};
+
+inline void json_string(std::FILE* out, const std::string& s) {
+    std::fputc('"', out);
+    for (unsigned char ch : s) {
+        if (ch == '"' || ch == '\\') std::fprintf(out, "\\%c", ch);
+        else if (ch < 0x20) std::fprintf(out, "\\u%04x", ch);
+        else std::fputc(ch, out);
+    }
+    std::fputc('"', out);
+}
+
+} // namespace detail
+
+inline bool save(const capture& c, const std::string& path) {
+    std::string out = "CSTRACE1";
+    detail::put(out, &c.ns_per_tick, 8);
+    detail::put(out, &c.tick0, 8);
+    detail::put(out, &c.pid, 4);
+    std::uint32_t n = (std::uint32_t)c.names.size();
+    detail::put(out, &n, 4);
+    for (const std::string& s : c.names) detail::put_string(out, s);
+    n = (std::uint32_t)c.threads.size();
+    detail::put(out, &n, 4);
+    for (const thread_events& t : c.threads) {
+        detail::put(out, &t.tid, 4);
+        detail::put_string(out, t.name);
+        std::uint64_t count = t.events.size();
+        detail::put(out, &count, 8);
+        detail::put(out, t.events.data(), count * sizeof(event));
+    }
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(out.data(), 1, out.size(), f) == out.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+inline bool load(const std::string& path, capture& c) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+    std::string in;
+    char buf[1 << 16];
+    for (std::size_t n; (n = std::fread(buf, 1, sizeof buf, f)) > 0;) in.append(buf, n);
+    std::fclose(f);
+    if (in.compare(0, 8, "CSTRACE1") != 0) return false;
+
+    detail::reader r{in, 8};
+    c = capture();
+    r.get(&c.ns_per_tick, 8);
+    r.get(&c.tick0, 8);
+    r.get(&c.pid, 4);
+    std::uint32_t n = 0;
+    r.get(&n, 4);
+    for (std::uint32_t i = 0; i < n && r.ok; ++i) c.names.push_back(r.get_string());
+    r.get(&n, 4);
+    for (std::uint32_t i = 0; i < n && r.ok; ++i) {
+        thread_events t;
+        r.get(&t.tid, 4);
+        t.name = r.get_string();
+        std::uint64_t count = 0;
+        r.get(&count, 8);
+        if (count > (in.size() - r.at) / sizeof(event)) return false;
+        t.events.resize(count);
+        r.get(t.events.data(), count * sizeof(event));
+        for (const event& e : t.events)
+            if (e.name >= c.names.size()) return false;
+        c.threads.push_back(std::move(t));
+    }
+    return r.ok;
+}
+
+// Chrome trace event format: complete ("X") events for spans, instant
+// ("i") events, and thread names. Times are microseconds.
+inline void write_json(const capture& c, std::FILE* out) {
+    auto us = [&](std::uint64_t t) { return (double)(std::int64_t)(t - c.tick0) * c.ns_per_tick / 1e3; };
+    std::fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+    auto next = [&] {
+        if (!first) std::fprintf(out, ",\n");
+        first = false;
+    };
+    for (const thread_events& t : c.threads) {
+        std::string name = !t.name.empty() ? t.name : t.tid == c.pid ? "main" : "";
+        if (!name.empty()) {
+            next();
+            std::fprintf(out, "{\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":", c.pid, t.tid);
+            detail::json_string(out, name);
+            std::fprintf(out, "}}");
+        }
+        for (const event& e : t.events) {
+            next();
+            std::fprintf(out, "{\"ph\":\"%s\",\"pid\":%u,\"tid\":%u,\"name\":", e.instant ? "i" : "X", c.pid, t.tid);
+            detail::json_string(out, c.names[e.name]);
+            if (e.instant) std::fprintf(out, ",\"s\":\"t\",\"ts\":%.3f}", us(e.start));
+            else std::fprintf(out, ",\"ts\":%.3f,\"dur\":%.3f}", us(e.start), (double)(e.end - e.start) * c.ns_per_tick / 1e3);
+        }
+    }
+    std::fprintf(out, "\n]}\n");
+}
+
+inline bool write_json(const capture& c, const std::string& path) {
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    write_json(c, f);
+    return std::fclose(f) == 0;
+}
+
+inline std::size_t event_count(const capture& c) {
+    std::size_t n = 0;
+    for (const thread_events& t : c.threads) n += t.events.size();
+    return n;
+}
+
+namespace detail {
+
+inline void dump_at_exit() {
+    const char* env = std::getenv("CSTAR_TRACE_OUT");
+    std::string path = env && *env ? env : "trace.cstrace";
+    if (path == "0") return;
+    capture c = snapshot();
+    if (event_count(c) == 0) return;
+    bool json = path.size() > 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    if (json ? write_json(c, path) : save(c, path))
+        std::fprintf(stderr, "trace: %zu events from %zu threads in %s\n", event_count(c), c.threads.size(), path.c_str());
+    else
+        std::fprintf(stderr, "trace: cannot write %s\n", path.c_str());
+}
+
+} // namespace detail
+
+} // namespace trace
+} // namespace cstar
+
+#endif // CSTLIB26_TRACE_H
@@ -3,8 +3,28 @@
 
 #include <string>
 #include <iostream>
-#include <fstream>
-#include <vector>
+#include <cstddef>
+#include <climits>
+#include <cerrno>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <io.h>
+    typedef long long posix_off_t;
+    #ifndef _SSIZE_T_DEFINED
+    typedef long long ssize_t;
+    #define _SSIZE_T_DEFINED
+    #endif
+#else
+    #include <unistd.h>
+    typedef off_t posix_off_t;
+#endif
 
 #ifndef __types_posix
 #define __types_posix
@@ -16,111 +36,672 @@ typedef const wchar_t* POSIXWSTR;
 
 #ifndef __errors_posix
 #define __errors_posix
+// <cerrno> already provides these on POSIX hosts (same values); fill in the rest
+#ifndef EPERM
 #define EPERM 0x01
+#endif
+#ifndef ENOENT
 #define ENOENT 0x02
+#endif
+#ifndef ESRCH
 #define ESRCH 0x03
+#endif
+#ifndef EINTR
 #define EINTR 0x04
+#endif
+#ifndef EIO
 #define EIO 0x05
+#endif
+#ifndef ENXIO
 #define ENXIO 0x06
+#endif
+#ifndef E2BIG
 #define E2BIG 0x07
+#endif
+#ifndef ENOEXEC
 #define ENOEXEC 0x08
+#endif
+#ifndef EBADF
 #define EBADF 0x09
+#endif
+#ifndef ECHILD
 #define ECHILD 0x0A
+#endif
+#ifndef EAGAIN
 #define EAGAIN 0x0B
+#endif
+#ifndef ENOMEM
 #define ENOMEM 0x0C
+#endif
+#ifndef EACCES
 #define EACCES 0x0D
+#endif
+#ifndef EFAULT
 #define EFAULT 0x0E
+#endif
+#ifndef ENOTBLK
 #define ENOTBLK 0x0F
+#endif
+#ifndef EBUSY
 #define EBUSY 0x10
+#endif
+#ifndef EEXIST
 #define EEXIST 0x11
+#endif
+#ifndef EXDEV
 #define EXDEV 0x12
+#endif
+#ifndef ENODEV
 #define ENODEV 0x13
 #endif
+#endif
 
 #ifndef _LIB_POSIX_FILEIO
 #define _LIB_POSIX_FILEIO
-extern int posix_errno;
-extern std::vector<std::fstream*> fd_table;
+// per-thread, like errno
+extern thread_local int posix_errno;
 
-ssize_t fileread(std::string file, int fd, void *buf, size_t mbytes) {
-    // bad FD → EBADF equivalent, but use ENXIO (no such device/address)
-    if (fd < 0 || fd >= (int)fd_table.size() || fd_table[fd] == nullptr) {
-        posix_errno = ENXIO;
-        return -1;
+// CStar descriptor table: maps CStar descriptors to OS file descriptors.
+//
+// A CStar descriptor is (generation << 20) | slot. Lookups are lock-free:
+// each slot is one atomic word holding the OS fd, the slot generation, an
+// open bit and a count of in-flight operations. Closing clears the open
+// bit, waits for in-flight operations to drain, bumps the generation and
+// puts the slot on a free list, so slots are reused and a stale descriptor
+// from before the reuse is rejected with EBADF instead of reaching a
+// different file. Slot storage grows in segments that are never moved,
+// and the table is constant-initialized (no static-init order issues).
+//
+// Queued operations (cstar::async_io) pin the slot until their completion
+// is reaped, which may be long after the call that queued them, on the
+// same thread that would close the descriptor. Close does not wait for
+// those: it fails with EBUSY while any are outstanding.
+class posix_fd_table {
+public:
+    static constexpr unsigned index_bits = 20;
+    static constexpr unsigned max_slots = 1u << index_bits;
+
+    // Pins a slot for the duration of one operation.
+    class lease {
+    public:
+        lease() = default;
+        lease(const lease&) = delete;
+        lease& operator=(const lease&) = delete;
+        lease(lease&& o) noexcept : word_(o.word_), queued_(o.queued_) { o.word_ = nullptr; o.queued_ = nullptr; }
+        lease& operator=(lease&& o) noexcept {
+            if (this != &o) {
+                release();
+                word_ = o.word_;
+                queued_ = o.queued_;
+                o.word_ = nullptr;
+                o.queued_ = nullptr;
+            }
+            return *this;
+        }
+        ~lease() { release(); }
+
+        explicit operator bool() const { return word_ != nullptr; }
+        int osfd() const { return (int)(std::uint32_t)word_->load(std::memory_order_relaxed); }
+
+    private:
+        friend class posix_fd_table;
+        explicit lease(std::atomic<std::uint64_t>* w) : word_(w) {}
+        void release() {
+            if (queued_) queued_->fetch_sub(1, std::memory_order_release);
+            if (word_) word_->fetch_sub(ref_one, std::memory_order_release);
+            word_ = nullptr;
+            queued_ = nullptr;
+        }
+        std::atomic<std::uint64_t>* word_ = nullptr;
+        std::atomic<std::uint32_t>* queued_ = nullptr; // set for queued operations
+    };
+
+    constexpr posix_fd_table() = default;
+    posix_fd_table(const posix_fd_table&) = delete;
+    posix_fd_table& operator=(const posix_fd_table&) = delete;
+
+    ~posix_fd_table() {
+        for (auto& seg : segments_) delete[] seg.load(std::memory_order_relaxed);
     }
 
-    std::fstream* stream = fd_table[fd];
+    // Store an OS fd; returns the CStar descriptor or -1 when the table is full.
+    int insert(int osfd) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::uint32_t idx;
+        if (free_head_ != no_slot) {
+            idx = free_head_;
+            free_head_ = slot_at(idx).next_free;
+        } else {
+            if (next_unused_ == max_slots) return -1;
+            idx = next_unused_++;
+            auto& seg = segments_[idx >> seg_bits];
+            if (!seg.load(std::memory_order_relaxed)) seg.store(new slot[seg_size], std::memory_order_release);
+        }
+        slot& sl = slot_at(idx);
+        std::uint64_t gen = gen_of(sl.word.load(std::memory_order_relaxed));
+        if (gen == 0) gen = 1; // fresh slot
+        sl.word.store((std::uint32_t)osfd | (gen << gen_shift) | open_bit, std::memory_order_release);
+        return (int)((gen << index_bits) | idx);
+    }
 
-    // stream not open → ENOENT or EACCES depending on design
-    if (!stream->is_open()) {
-        posix_errno = ENOENT;   // file not found / not available
-        return -1;
+    // Look up and pin a descriptor. Sets posix_errno and returns an empty
+    // lease for a descriptor that was never valid (ENXIO) or is stale (EBADF).
+    lease acquire(int fd) {
+        slot* sl = find(fd);
+        if (!sl) {
+            // bad FD → EBADF equivalent, but use ENXIO (no such device/address)
+            posix_errno = ENXIO;
+            return lease();
+        }
+        std::uint64_t w = sl->word.load(std::memory_order_acquire);
+        for (;;) {
+            if (!(w & open_bit) || gen_of(w) != ((std::uint32_t)fd >> index_bits)) {
+                posix_errno = EBADF;
+                return lease();
+            }
+            if (sl->word.compare_exchange_weak(w, w + ref_one, std::memory_order_acquire))
+                return lease(&sl->word);
+        }
     }
 
-    if (buf == nullptr) {
-        posix_errno = EIO;      // invalid I/O buffer
-        return -1;
+    // Like acquire, for an operation that stays queued after the call
+    // returns; remove() fails with EBUSY until the lease is released.
+    lease acquire_queued(int fd) {
+        lease l = acquire(fd);
+        if (l) {
+            l.queued_ = &find(fd)->queued;
+            l.queued_->fetch_add(1, std::memory_order_acq_rel);
+        }
+        return l;
     }
 
-    stream->clear();
-    stream->seekg(stream->tellg());
+    // Unlink a descriptor and return its OS fd for the caller to close, or
+    // -1 (posix_errno set) if it is not open, or has queued operations
+    // (EBUSY). Waits for operations still running on the descriptor in
+    // other threads.
+    int remove(int fd) {
+        slot* sl = find(fd);
+        if (!sl) {
+            posix_errno = ENXIO;
+            return -1;
+        }
+        std::uint64_t w = sl->word.load(std::memory_order_acquire);
+        do {
+            if (!(w & open_bit) || gen_of(w) != ((std::uint32_t)fd >> index_bits)) {
+                posix_errno = EBADF;
+                return -1;
+            }
+        } while (!sl->word.compare_exchange_weak(w, w & ~open_bit, std::memory_order_acq_rel));
 
-    char* cbuf = (char*)buf;
-    size_t count = 0;
+        // an acquire_queued that got in before the close counts itself
+        // within a few instructions, so checking on every pass catches it
+        while ((w = sl->word.load(std::memory_order_acquire)) >> ref_shift) {
+            if (sl->queued.load(std::memory_order_acquire)) {
+                sl->word.fetch_or(open_bit, std::memory_order_acq_rel);
+                posix_errno = EBUSY;
+                return -1;
+            }
+            std::this_thread::yield();
+        }
+
+        int osfd = (int)(std::uint32_t)w;
+        std::uint64_t gen = gen_of(w) + 1;
+        if (gen > gen_mask) gen = 1;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        sl->word.store(gen << gen_shift, std::memory_order_release);
+        sl->next_free = free_head_;
+        free_head_ = (std::uint32_t)fd & (max_slots - 1);
+        return osfd;
+    }
+
+private:
+    // word layout: [63..44 in-flight refs][43 open][42..32 generation][31..0 OS fd]
+    static constexpr unsigned gen_shift = 32;
+    static constexpr std::uint64_t gen_mask = (1u << (31 - index_bits)) - 1;
+    static constexpr std::uint64_t open_bit = 1ull << 43;
+    static constexpr unsigned ref_shift = 44;
+    static constexpr std::uint64_t ref_one = 1ull << ref_shift;
+
+    static constexpr unsigned seg_bits = 10;
+    static constexpr unsigned seg_size = 1u << seg_bits;
+    static constexpr std::uint32_t no_slot = 0xFFFFFFFFu;
+
+    struct slot {
+        std::atomic<std::uint64_t> word{0};
+        std::atomic<std::uint32_t> queued{0}; // leases from acquire_queued
+        std::uint32_t next_free = no_slot;    // guarded by mutex_
+    };
+
+    static std::uint64_t gen_of(std::uint64_t w) { return (w >> gen_shift) & gen_mask; }
 
-    while (count < mbytes && stream->good()) {
-        char ch;
-        stream->get(ch);
+    slot& slot_at(std::uint32_t idx) {
+        return segments_[idx >> seg_bits].load(std::memory_order_acquire)[idx & (seg_size - 1)];
+    }
+
+    slot* find(int fd) {
+        if (fd < 0) return nullptr;
+        std::uint32_t idx = (std::uint32_t)fd & (max_slots - 1);
+        slot* seg = segments_[idx >> seg_bits].load(std::memory_order_acquire);
+        return seg ? &seg[idx & (seg_size - 1)] : nullptr;
+    }
+
+    std::atomic<slot*> segments_[max_slots >> seg_bits] = {};
+    std::mutex mutex_;
+    std::uint32_t free_head_ = no_slot;
+    std::uint32_t next_unused_ = 0;
+};
 
-        if (!stream->good())
-            break;
+extern posix_fd_table fd_table;
+
+namespace posix_detail {
+    using lease = posix_fd_table::lease;
+
+#if defined(_WIN32) || defined(_WIN64)
+    // Windows CRT I/O takes unsigned int counts
+    inline ssize_t sys_read(int ofd, void* buf, size_t n) {
+        return _read(ofd, buf, n > INT_MAX ? INT_MAX : (unsigned)n);
+    }
+    inline ssize_t sys_write(int ofd, const void* buf, size_t n) {
+        return _write(ofd, buf, n > INT_MAX ? INT_MAX : (unsigned)n);
+    }
+    // no pread/pwrite in the CRT: seek, transfer, restore (not atomic)
+    inline ssize_t sys_pread(int ofd, void* buf, size_t n, posix_off_t off) {
+        posix_off_t cur = _lseeki64(ofd, 0, SEEK_CUR);
+        if (cur < 0 || _lseeki64(ofd, off, SEEK_SET) < 0) return -1;
+        ssize_t r = sys_read(ofd, buf, n);
+        _lseeki64(ofd, cur, SEEK_SET);
+        return r;
+    }
+    inline ssize_t sys_pwrite(int ofd, const void* buf, size_t n, posix_off_t off) {
+        posix_off_t cur = _lseeki64(ofd, 0, SEEK_CUR);
+        if (cur < 0 || _lseeki64(ofd, off, SEEK_SET) < 0) return -1;
+        ssize_t r = sys_write(ofd, buf, n);
+        _lseeki64(ofd, cur, SEEK_SET);
+        return r;
+    }
+#else
+    inline ssize_t sys_read(int ofd, void* buf, size_t n) { return ::read(ofd, buf, n); }
+    inline ssize_t sys_write(int ofd, const void* buf, size_t n) { return ::write(ofd, buf, n); }
+    inline ssize_t sys_pread(int ofd, void* buf, size_t n, posix_off_t off) { return ::pread(ofd, buf, n, off); }
+    inline ssize_t sys_pwrite(int ofd, const void* buf, size_t n, posix_off_t off) { return ::pwrite(ofd, buf, n, off); }
+#endif
 
-        cbuf[count++] = ch;
+    // Repeat a transfer until mbytes are moved, EOF (read returns 0) or an
+    // error. Returns the byte count; -1 only if the first call failed.
+    template<typename Xfer>
+    inline ssize_t transfer_all(size_t mbytes, Xfer xfer) {
+        size_t done = 0;
+        while (done < mbytes) {
+            ssize_t r = xfer(done);
+            if (r > 0) { done += (size_t)r; continue; }
+            if (r == 0) break;
+            if (errno == EINTR) continue;
+            posix_errno = errno;
+            return done ? (ssize_t)done : -1;
+        }
+        posix_errno = 0;
+        return (ssize_t)done;
     }
+}
 
-    // normal read - no error
+// Open a file and return a CStar descriptor. flags/mode are the usual
+// O_* / permission bits, e.g. fileopen("log.txt", O_RDWR | O_CREAT).
+inline int fileopen(POSIXSTR path, int flags, int mode = 0644) {
+    if (path == nullptr) {
+        posix_errno = EFAULT;
+        return -1;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    int ofd = _open(path, flags | _O_BINARY, mode);
+#else
+    int ofd;
+    do { ofd = ::open(path, flags | O_CLOEXEC, mode); } while (ofd < 0 && errno == EINTR);
+#endif
+    if (ofd < 0) {
+        posix_errno = errno;
+        return -1;
+    }
+    int fd = fd_table.insert(ofd);
+    if (fd < 0) {
+#if defined(_WIN32) || defined(_WIN64)
+        _close(ofd);
+#else
+        ::close(ofd);
+#endif
+        posix_errno = EMFILE;
+        return -1;
+    }
     posix_errno = 0;
-    return (ssize_t)count;
+    return fd;
 }
 
-ssize_t filewrite(int fd, const void *buf, size_t mbytes) {
-    // invalid descriptor
-    if (fd < 0 || fd >= (int)fd_table.size() || fd_table[fd] == nullptr) {
-        posix_errno = ENXIO;
+inline int fileclose(int fd) {
+    int ofd = fd_table.remove(fd);
+    if (ofd < 0) return -1;
+#if defined(_WIN32) || defined(_WIN64)
+    int r = _close(ofd);
+#else
+    int r = ::close(ofd);
+#endif
+    posix_errno = (r < 0) ? errno : 0;
+    return r;
+}
+
+// Move the file offset used by fileread/filewrite (SEEK_SET/SEEK_CUR/SEEK_END).
+inline posix_off_t fileseek(int fd, posix_off_t offset, int whence) {
+    posix_detail::lease file = fd_table.acquire(fd);
+    if (!file) return -1;
+    int ofd = file.osfd();
+#if defined(_WIN32) || defined(_WIN64)
+    posix_off_t r = _lseeki64(ofd, offset, whence);
+#else
+    posix_off_t r = ::lseek(ofd, offset, whence);
+#endif
+    posix_errno = (r < 0) ? errno : 0;
+    return r;
+}
+
+// Read up to mbytes at the current offset. Fewer bytes means end of file
+// (or an error after some data, reported in posix_errno).
+inline ssize_t fileread(int fd, void *buf, size_t mbytes) {
+    posix_detail::lease file = fd_table.acquire(fd);
+    if (!file) return -1;
+    int ofd = file.osfd();
+
+    if (buf == nullptr) {
+        posix_errno = EIO;      // invalid I/O buffer
         return -1;
     }
 
-    std::fstream* stream = fd_table[fd];
+    char* cbuf = (char*)buf;
+    return posix_detail::transfer_all(mbytes, [&](size_t done) {
+        return posix_detail::sys_read(ofd, cbuf + done, mbytes - done);
+    });
+}
+
+// Older signature; the file name is not needed once the descriptor is open.
+inline ssize_t fileread(std::string file, int fd, void *buf, size_t mbytes) {
+    (void)file;
+    return fileread(fd, buf, mbytes);
+}
+
+// Write mbytes at the current offset and advance it.
+inline ssize_t filewrite(int fd, const void *buf, size_t mbytes) {
+    posix_detail::lease file = fd_table.acquire(fd);
+    if (!file) return -1;
+    int ofd = file.osfd();
 
-    if (!stream->is_open()) {
-        posix_errno = ENOENT;   // file not available
+    if (buf == nullptr) {
+        posix_errno = EIO;
         return -1;
     }
 
+    const char* cbuf = static_cast<const char*>(buf);
+    return posix_detail::transfer_all(mbytes, [&](size_t done) {
+        return posix_detail::sys_write(ofd, cbuf + done, mbytes - done);
+    });
+}
+
+// Positioned variants: transfer at an explicit offset without moving the
+// descriptor's own offset, so threads can share one descriptor.
+inline ssize_t filepread(int fd, void *buf, size_t mbytes, posix_off_t offset) {
+    posix_detail::lease file = fd_table.acquire(fd);
+    if (!file) return -1;
+    int ofd = file.osfd();
+
     if (buf == nullptr) {
         posix_errno = EIO;
         return -1;
     }
 
-    stream->seekp(0, std::ios::beg);
+    char* cbuf = (char*)buf;
+    return posix_detail::transfer_all(mbytes, [&](size_t done) {
+        return posix_detail::sys_pread(ofd, cbuf + done, mbytes - done, offset + (posix_off_t)done);
+    });
+}
+
+inline ssize_t filepwrite(int fd, const void *buf, size_t mbytes, posix_off_t offset) {
+    posix_detail::lease file = fd_table.acquire(fd);
+    if (!file) return -1;
+    int ofd = file.osfd();
+
+    if (buf == nullptr) {
+        posix_errno = EIO;
+        return -1;
+    }
 
     const char* cbuf = static_cast<const char*>(buf);
-    size_t written = 0;
+    return posix_detail::transfer_all(mbytes, [&](size_t done) {
+        return posix_detail::sys_pwrite(ofd, cbuf + done, mbytes - done, offset + (posix_off_t)done);
+    });
+}
+#endif
+
+// Memory-mapped files (C++20: the data is exposed as std::span<const cstar::byte>)
+#if !defined(_LIB_POSIX_FILEMAP) && __cplusplus >= 202002L && __has_include(<span>)
+#define _LIB_POSIX_FILEMAP
+#include <span>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+    #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+#endif
+
+namespace cstar {
+using byte = std::uint8_t; // element type of a mapping
+}
 
-    while (written < mbytes && stream->good()) {
-        stream->put(cbuf[written]);
+enum class map_mode { read_only, read_write };
 
-        if (!stream->good())
-            break;
+// Access-pattern hints for filemap; combine with |. Hints the platform
+// does not support are ignored.
+enum map_hint : unsigned {
+    map_normal     = 0,
+    map_sequential = 1u << 0,   // MADV_SEQUENTIAL: aggressive read-ahead
+    map_random     = 1u << 1,   // MADV_RANDOM: no read-ahead
+    map_willneed   = 1u << 2,   // MADV_WILLNEED: start paging in now
+    map_hugepages  = 1u << 3,   // MADV_HUGEPAGE: back with transparent huge pages if possible
+};
 
-        written++;
+// Owns one mapping; unmapped on destruction. Move-only.
+class mapped_region {
+public:
+    mapped_region() = default;
+    mapped_region(const mapped_region&) = delete;
+    mapped_region& operator=(const mapped_region&) = delete;
+    mapped_region(mapped_region&& o) noexcept { steal(o); }
+    mapped_region& operator=(mapped_region&& o) noexcept {
+        if (this != &o) { unmap(); steal(o); }
+        return *this;
     }
+    ~mapped_region() { unmap(); }
+
+    std::span<const cstar::byte> data() const { return { data_, size_ }; }
+    // Empty for read-only mappings.
+    std::span<cstar::byte> writable() const { return writable_ ? std::span<cstar::byte>(data_, size_) : std::span<cstar::byte>(); }
 
-    // Flush every write (matching POSIX write() immediate commit)
-    stream->flush();
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    // A mapping of an empty file is valid but empty.
+    bool is_mapped() const { return mapped_; }
+    explicit operator bool() const { return mapped_; }
 
+    // Apply more map_hint values after mapping. Returns 0 or -1 (posix_errno set).
+    int advise(unsigned hints) {
+#if !defined(_WIN32) && !defined(_WIN64)
+        if (!base_) return 0;
+        auto apply = [&](int advice) {
+            if (::madvise(base_, length_, advice) != 0) { posix_errno = errno; return -1; }
+            return 0;
+        };
+        int r = 0;
+        if (hints & map_sequential) r |= apply(MADV_SEQUENTIAL);
+        if (hints & map_random) r |= apply(MADV_RANDOM);
+        if (hints & map_willneed) r |= apply(MADV_WILLNEED);
+    #ifdef MADV_HUGEPAGE
+        // best effort: file-backed THP depends on the filesystem and kernel
+        if (hints & map_hugepages) (void)::madvise(base_, length_, MADV_HUGEPAGE);
+    #endif
+        return r;
+#else
+        (void)hints;
+        return 0;
+#endif
+    }
+
+    // Flush dirty pages of a read-write mapping to the file.
+    int sync() {
+        if (!base_ || !writable_) return 0;
+#if defined(_WIN32) || defined(_WIN64)
+        if (!FlushViewOfFile(base_, length_)) { posix_errno = EIO; return -1; }
+#else
+        if (::msync(base_, length_, MS_SYNC) != 0) { posix_errno = errno; return -1; }
+#endif
+        return 0;
+    }
+
+    void unmap() {
+        if (base_) {
+#if defined(_WIN32) || defined(_WIN64)
+            UnmapViewOfFile(base_);
+#else
+            ::munmap(base_, length_);
+#endif
+        }
+        base_ = nullptr;
+        data_ = nullptr;
+        length_ = size_ = 0;
+        mapped_ = writable_ = false;
+    }
+
+private:
+    friend mapped_region filemap(int fd, map_mode mode, std::size_t length, posix_off_t offset, unsigned hints);
+
+    void steal(mapped_region& o) {
+        base_ = o.base_; data_ = o.data_; length_ = o.length_; size_ = o.size_;
+        mapped_ = o.mapped_; writable_ = o.writable_;
+        o.base_ = nullptr; o.data_ = nullptr; o.length_ = o.size_ = 0;
+        o.mapped_ = o.writable_ = false;
+    }
+
+    void* base_ = nullptr;      // page-aligned start handed to munmap
+    cstar::byte* data_ = nullptr;    // start of the requested range
+    std::size_t length_ = 0;    // mapped length from base_
+    std::size_t size_ = 0;      // requested length
+    bool mapped_ = false;
+    bool writable_ = false;
+};
+
+// Map [offset, offset + length) of an open descriptor. length 0 maps to the
+// end of the file; offset need not be page-aligned. A read-only mapping is
+// cut off at the end of the file; a read-write one must lie within it
+// (EINVAL otherwise; grow the file first), since touching pages past the end
+// of the file raises SIGBUS. The mapping stays valid after fileclose. On
+// failure the region is empty and posix_errno is set.
+inline mapped_region filemap(int fd, map_mode mode, std::size_t length = 0, posix_off_t offset = 0,
+                             unsigned hints = map_normal) {
+    mapped_region region;
+    posix_detail::lease file = fd_table.acquire(fd);
+    if (!file) return region;
+    int ofd = file.osfd();
+
+    if (offset < 0) {
+        posix_errno = EINVAL;
+        return region;
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+    struct _stat64 st;
+    if (_fstat64(ofd, &st) != 0) { posix_errno = errno; return region; }
+    posix_off_t file_size = st.st_size;
+#else
+    struct stat st;
+    if (::fstat(ofd, &st) != 0) { posix_errno = errno; return region; }
+    posix_off_t file_size = st.st_size;
+#endif
+    std::size_t available = offset < file_size ? (std::size_t)(file_size - offset) : 0;
+    if (length > available) {
+        if (mode == map_mode::read_write) {
+            posix_errno = EINVAL;
+            return region;
+        }
+        length = available;
+    }
+    if (length == 0) length = available;
+    if (length == 0) {
+        region.mapped_ = true;
+        region.writable_ = (mode == map_mode::read_write);
+        posix_errno = 0;
+        return region;
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    posix_off_t align = (posix_off_t)si.dwAllocationGranularity;
+#else
+    posix_off_t align = (posix_off_t)::sysconf(_SC_PAGESIZE);
+#endif
+    posix_off_t base_off = offset - offset % align;
+    std::size_t lead = (std::size_t)(offset - base_off);
+    std::size_t map_len = length + lead;
+
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE fh = (HANDLE)_get_osfhandle(ofd);
+    bool rw = (mode == map_mode::read_write);
+    unsigned long long end = (unsigned long long)offset + length;
+    HANDLE mh = CreateFileMappingA(fh, nullptr, rw ? PAGE_READWRITE : PAGE_READONLY,
+                                   (DWORD)(end >> 32), (DWORD)end, nullptr);
+    if (!mh) { posix_errno = EACCES; return region; }
+    void* base = MapViewOfFile(mh, rw ? FILE_MAP_WRITE : FILE_MAP_READ,
+                               (DWORD)((unsigned long long)base_off >> 32), (DWORD)base_off, map_len);
+    CloseHandle(mh); // the view keeps the mapping object alive
+    if (!base) { posix_errno = ENOMEM; return region; }
+#else
+    int prot = (mode == map_mode::read_write) ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void* base = ::mmap(nullptr, map_len, prot, MAP_SHARED, ofd, base_off);
+    if (base == MAP_FAILED) { posix_errno = errno; return region; }
+#endif
+
+    region.base_ = base;
+    region.data_ = static_cast<cstar::byte*>(base) + lead;
+    region.length_ = map_len;
+    region.size_ = length;
+    region.mapped_ = true;
+    region.writable_ = (mode == map_mode::read_write);
+    region.advise(hints);
+    posix_errno = 0;
+    return region;
+}
+
+// Open, map and close in one step.
+inline mapped_region filemap(POSIXSTR path, map_mode mode = map_mode::read_only, unsigned hints = map_normal) {
+    int fd = fileopen(path, mode == map_mode::read_write ? O_RDWR : O_RDONLY);
+    if (fd < 0) return mapped_region();
+    mapped_region region = filemap(fd, mode, 0, 0, hints);
+    int saved = posix_errno;
+    fileclose(fd);
+    posix_errno = saved;
+    return region;
+}
+
+// Release a mapping before the region goes out of scope.
+inline int fileunmap(mapped_region& region) {
+    if (!region.is_mapped()) {
+        posix_errno = EINVAL;
+        return -1;
+    }
+    region.unmap();
     posix_errno = 0;
-    return (ssize_t)written;
+    return 0;
 }
 #endif
 #endif
\ No newline at end of file
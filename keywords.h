@@ -1,12 +1,10 @@
 #pragma once
 
-#include <iostream>
-#include <vector>
-#include <string>
+#include <array>
+#include <string_view>
 
-using namespace std;
-
-vector<string> keywords = {
+// Constant-initialized: no constructor runs and nothing is allocated before main.
+inline constexpr std::array<std::string_view, 57> keywords = {
     "if", "else", "while", "for", "return", "break", "continue",
     "switch", "case", "default", "do", "try", "catch", "throw",
     "class", "public", "private", "protected", "static", "void",
@@ -15,5 +13,6 @@ vector<string> keywords = {
     "struct", "union", "enum", "template", "typename", "this",
     "synchronized", "volatile", "extern", "sizeof", "alignof",
     "long", "short", "signed", "unsigned", "explicit", "friend",
-    "Interface", "abstract", "final", "native", "strictfp"
-};
\ No newline at end of file
+    "Interface", "abstract", "final", "native", "strictfp",
+    "async", "await"
+};
@@ -1,9 +1,365 @@
+/*
+libcstmath.cpp - CStar math library, see include/cstmath.h.
+
+The batch kernels exist once per instruction set. Each x86 path is the
+shared code in libcstmath_kernels.inc, compiled with a target attribute
+against a small register wrapper (vec), so the file builds with plain
+-O2 and no -m flags. The path is chosen on the first call from what CPUID
+reports.
+
+Copyright (c) 2025 Hoang Viet. All rights reserved.
+*/
 #include "include/cstmath.h"
 
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define CSTMATH_X86 1
+    #include <immintrin.h>
+#endif
+
 int add(int a, int b) {
     return a + b;
 }
 
+static double pow_uint(double y, unsigned k) {
+    double acc = 1.0;
+    for (; k; k >>= 1) {
+        if (k & 1) acc *= y;
+        y *= y;
+    }
+    return acc;
+}
+
 double root(double n, double r) {
-    return n*(1/r);
-}
\ No newline at end of file
+    if (r == 2.0) return std::sqrt(n);
+    bool integral = r == std::trunc(r);
+    if (n < 0 && integral && std::fmod(r, 2.0) != 0.0) return -root(-n, r);
+    double y = std::pow(n, 1.0 / r);
+    // 1/r is rounded, which can cost dozens of ulp for large n; one Newton
+    // step on y^r = n brings integer degrees back within an ulp or two
+    // (this also beats glibc's cbrt, which is off by up to 3 ulp)
+    if (integral && r >= 3.0 && r <= 64.0 && std::isnormal(y)) {
+        double p = pow_uint(y, (unsigned)r);
+        if (std::isnormal(p)) y -= y * ((p - n) / (r * p));
+    }
+    return y;
+}
+
+namespace cstar {
+namespace math {
+
+namespace {
+
+struct kernel_table {
+    isa id;
+    void (*add)(const double*, const double*, double*, std::size_t);
+    void (*mul)(const double*, const double*, double*, std::size_t);
+    void (*fma)(const double*, const double*, const double*, double*, std::size_t);
+    void (*sqrt)(const double*, double*, std::size_t);
+    void (*root)(const double*, double, double*, std::size_t);
+    void (*exp)(const double*, double*, std::size_t);
+    void (*log)(const double*, double*, std::size_t);
+    double (*dot)(const double*, const double*, std::size_t);
+    double (*sum)(const double*, std::size_t);
+    double (*min)(const double*, std::size_t);
+    double (*max)(const double*, std::size_t);
+};
+
+// 1.5 * 2^52: adding it rounds to an integer held in the low mantissa bits
+constexpr double round_magic = 0x1.8p52;
+// ln 2 split so that k * ln2_hi is exact for |k| < 2^11
+constexpr double ln2_hi = 0x1.62e42fee00000p-1;
+constexpr double ln2_lo = 0x1.a39ef35793c76p-33;
+// 1/13! ... 1/2!, 1, 1 (Horner order)
+constexpr double exp_coeff[] = {
+    1.0 / 6227020800.0, 1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0, 1.0 / 362880.0,
+    1.0 / 40320.0, 1.0 / 5040.0, 1.0 / 720.0, 1.0 / 120.0, 1.0 / 24.0, 1.0 / 6.0, 1.0 / 2.0, 1.0, 1.0,
+};
+// 2/21 ... 2/3: log(1+f) = 2 atanh(s) series in z = s^2 (Horner order)
+constexpr double log_coeff[] = {
+    2.0 / 21, 2.0 / 19, 2.0 / 17, 2.0 / 15, 2.0 / 13, 2.0 / 11, 2.0 / 9, 2.0 / 7, 2.0 / 5, 2.0 / 3,
+};
+
+namespace scalar {
+    void k_add(const double* a, const double* b, double* out, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) out[i] = a[i] + b[i];
+    }
+    void k_mul(const double* a, const double* b, double* out, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) out[i] = a[i] * b[i];
+    }
+    void k_fma(const double* a, const double* b, const double* c, double* out, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) out[i] = std::fma(a[i], b[i], c[i]);
+    }
+    void k_sqrt(const double* x, double* out, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) out[i] = std::sqrt(x[i]);
+    }
+    void k_root(const double* x, double r, double* out, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) out[i] = ::root(x[i], r);
+    }
+    void k_exp(const double* x, double* out, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) out[i] = std::exp(x[i]);
+    }
+    void k_log(const double* x, double* out, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) out[i] = std::log(x[i]);
+    }
+    double k_dot(const double* a, const double* b, std::size_t n) {
+        double s = 0.0;
+        for (std::size_t i = 0; i < n; ++i) s += a[i] * b[i];
+        return s;
+    }
+    double k_sum(const double* x, std::size_t n) {
+        double s = 0.0;
+        for (std::size_t i = 0; i < n; ++i) s += x[i];
+        return s;
+    }
+    double k_min(const double* x, std::size_t n) {
+        double r = HUGE_VAL;
+        for (std::size_t i = 0; i < n; ++i) r = x[i] < r ? x[i] : r;
+        return r;
+    }
+    double k_max(const double* x, std::size_t n) {
+        double r = -HUGE_VAL;
+        for (std::size_t i = 0; i < n; ++i) r = x[i] > r ? x[i] : r;
+        return r;
+    }
+
+    constexpr kernel_table table = {
+        isa::scalar, k_add, k_mul, k_fma, k_sqrt, k_root, k_exp, k_log, k_dot, k_sum, k_min, k_max,
+    };
+}
+
+#ifdef CSTMATH_X86
+
+namespace sse2 {
+#define CSTMATH_TARGET __attribute__((target("sse2")))
+    struct vec {
+        using reg = __m128d;
+        using mask = __m128d;
+        static constexpr isa id = isa::sse2;
+        static constexpr std::size_t width = 2;
+        static constexpr bool fused = false;
+
+        CSTMATH_TARGET static reg load(const double* p) { return _mm_loadu_pd(p); }
+        CSTMATH_TARGET static void store(double* p, reg v) { _mm_storeu_pd(p, v); }
+        CSTMATH_TARGET static reg set1(double v) { return _mm_set1_pd(v); }
+        CSTMATH_TARGET static reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+        CSTMATH_TARGET static reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+        CSTMATH_TARGET static reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+        CSTMATH_TARGET static reg div(reg a, reg b) { return _mm_div_pd(a, b); }
+        CSTMATH_TARGET static reg sqrt(reg a) { return _mm_sqrt_pd(a); }
+        CSTMATH_TARGET static reg min(reg a, reg b) { return _mm_min_pd(a, b); }
+        CSTMATH_TARGET static reg max(reg a, reg b) { return _mm_max_pd(a, b); }
+        // a * b + c, two roundings: SSE2 has no FMA
+        CSTMATH_TARGET static reg fmadd(reg a, reg b, reg c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+        CSTMATH_TARGET static mask gt(reg a, reg b) { return _mm_cmpgt_pd(a, b); }
+        CSTMATH_TARGET static reg blend(mask m, reg f, reg t) {
+            return _mm_or_pd(_mm_and_pd(m, t), _mm_andnot_pd(m, f));
+        }
+        CSTMATH_TARGET static bool all_between(reg x, double lo, double hi) {
+            return _mm_movemask_pd(_mm_and_pd(_mm_cmpge_pd(x, set1(lo)), _mm_cmple_pd(x, set1(hi)))) == 0x3;
+        }
+        CSTMATH_TARGET static double hsum(reg v) { return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v))); }
+        CSTMATH_TARGET static double hmin(reg v) { return _mm_cvtsd_f64(_mm_min_sd(v, _mm_unpackhi_pd(v, v))); }
+        CSTMATH_TARGET static double hmax(reg v) { return _mm_cvtsd_f64(_mm_max_sd(v, _mm_unpackhi_pd(v, v))); }
+        // p * 2^k, k taken from the low bits of a round_magic sum
+        CSTMATH_TARGET static reg scale2(reg p, reg kd) {
+            return _mm_castsi128_pd(_mm_add_epi64(_mm_castpd_si128(p), _mm_slli_epi64(_mm_castpd_si128(kd), 52)));
+        }
+        // x = m * 2^e with m in [1, 2), for positive normal x
+        CSTMATH_TARGET static reg split(reg x, reg& e) {
+            __m128i bits = _mm_castpd_si128(x);
+            __m128i biased = _mm_or_si128(_mm_srli_epi64(bits, 52), _mm_set1_epi64x(0x4330000000000000));
+            e = _mm_sub_pd(_mm_castsi128_pd(biased), _mm_set1_pd(0x1p52 + 1023));
+            return _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi64x(0x000fffffffffffff)),
+                                                 _mm_set1_epi64x(0x3ff0000000000000)));
+        }
+    };
+#include "libcstmath_kernels.inc"
+#undef CSTMATH_TARGET
+}
+
+namespace avx2 {
+#define CSTMATH_TARGET __attribute__((target("avx2,fma")))
+    struct vec {
+        using reg = __m256d;
+        using mask = __m256d;
+        static constexpr isa id = isa::avx2;
+        static constexpr std::size_t width = 4;
+        static constexpr bool fused = true;
+
+        CSTMATH_TARGET static reg load(const double* p) { return _mm256_loadu_pd(p); }
+        CSTMATH_TARGET static void store(double* p, reg v) { _mm256_storeu_pd(p, v); }
+        CSTMATH_TARGET static reg set1(double v) { return _mm256_set1_pd(v); }
+        CSTMATH_TARGET static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+        CSTMATH_TARGET static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+        CSTMATH_TARGET static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+        CSTMATH_TARGET static reg div(reg a, reg b) { return _mm256_div_pd(a, b); }
+        CSTMATH_TARGET static reg sqrt(reg a) { return _mm256_sqrt_pd(a); }
+        CSTMATH_TARGET static reg min(reg a, reg b) { return _mm256_min_pd(a, b); }
+        CSTMATH_TARGET static reg max(reg a, reg b) { return _mm256_max_pd(a, b); }
+        CSTMATH_TARGET static reg fmadd(reg a, reg b, reg c) { return _mm256_fmadd_pd(a, b, c); }
+        CSTMATH_TARGET static mask gt(reg a, reg b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+        CSTMATH_TARGET static reg blend(mask m, reg f, reg t) { return _mm256_blendv_pd(f, t, m); }
+        CSTMATH_TARGET static bool all_between(reg x, double lo, double hi) {
+            reg in = _mm256_and_pd(_mm256_cmp_pd(x, set1(lo), _CMP_GE_OQ), _mm256_cmp_pd(x, set1(hi), _CMP_LE_OQ));
+            return _mm256_movemask_pd(in) == 0xF;
+        }
+        CSTMATH_TARGET static __m128d fold(reg v, bool take_min, bool take_max) {
+            __m128d lo = _mm256_castpd256_pd128(v), hi = _mm256_extractf128_pd(v, 1);
+            __m128d r = take_min ? _mm_min_pd(lo, hi) : take_max ? _mm_max_pd(lo, hi) : _mm_add_pd(lo, hi);
+            __m128d s = _mm_unpackhi_pd(r, r);
+            return take_min ? _mm_min_sd(r, s) : take_max ? _mm_max_sd(r, s) : _mm_add_sd(r, s);
+        }
+        CSTMATH_TARGET static double hsum(reg v) { return _mm_cvtsd_f64(fold(v, false, false)); }
+        CSTMATH_TARGET static double hmin(reg v) { return _mm_cvtsd_f64(fold(v, true, false)); }
+        CSTMATH_TARGET static double hmax(reg v) { return _mm_cvtsd_f64(fold(v, false, true)); }
+        CSTMATH_TARGET static reg scale2(reg p, reg kd) {
+            return _mm256_castsi256_pd(
+                _mm256_add_epi64(_mm256_castpd_si256(p), _mm256_slli_epi64(_mm256_castpd_si256(kd), 52)));
+        }
+        CSTMATH_TARGET static reg split(reg x, reg& e) {
+            __m256i bits = _mm256_castpd_si256(x);
+            __m256i biased = _mm256_or_si256(_mm256_srli_epi64(bits, 52), _mm256_set1_epi64x(0x4330000000000000));
+            e = _mm256_sub_pd(_mm256_castsi256_pd(biased), _mm256_set1_pd(0x1p52 + 1023));
+            return _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000fffffffffffff)),
+                                                       _mm256_set1_epi64x(0x3ff0000000000000)));
+        }
+    };
+#include "libcstmath_kernels.inc"
+#undef CSTMATH_TARGET
+}
+
+// GCC 12's avx512fintrin.h trips -Wuninitialized on its own
+// _mm512_undefined_* placeholders
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+namespace avx512 {
+#define CSTMATH_TARGET __attribute__((target("avx512f")))
+    struct vec {
+        using reg = __m512d;
+        using mask = __mmask8;
+        static constexpr isa id = isa::avx512;
+        static constexpr std::size_t width = 8;
+        static constexpr bool fused = true;
+
+        CSTMATH_TARGET static reg load(const double* p) { return _mm512_loadu_pd(p); }
+        CSTMATH_TARGET static void store(double* p, reg v) { _mm512_storeu_pd(p, v); }
+        CSTMATH_TARGET static reg set1(double v) { return _mm512_set1_pd(v); }
+        CSTMATH_TARGET static reg add(reg a, reg b) { return _mm512_add_pd(a, b); }
+        CSTMATH_TARGET static reg sub(reg a, reg b) { return _mm512_sub_pd(a, b); }
+        CSTMATH_TARGET static reg mul(reg a, reg b) { return _mm512_mul_pd(a, b); }
+        CSTMATH_TARGET static reg div(reg a, reg b) { return _mm512_div_pd(a, b); }
+        CSTMATH_TARGET static reg sqrt(reg a) { return _mm512_sqrt_pd(a); }
+        CSTMATH_TARGET static reg min(reg a, reg b) { return _mm512_min_pd(a, b); }
+        CSTMATH_TARGET static reg max(reg a, reg b) { return _mm512_max_pd(a, b); }
+        CSTMATH_TARGET static reg fmadd(reg a, reg b, reg c) { return _mm512_fmadd_pd(a, b, c); }
+        CSTMATH_TARGET static mask gt(reg a, reg b) { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+        CSTMATH_TARGET static reg blend(mask m, reg f, reg t) { return _mm512_mask_blend_pd(m, f, t); }
+        CSTMATH_TARGET static bool all_between(reg x, double lo, double hi) {
+            return (_mm512_cmp_pd_mask(x, set1(lo), _CMP_GE_OQ) & _mm512_cmp_pd_mask(x, set1(hi), _CMP_LE_OQ)) == 0xFF;
+        }
+        CSTMATH_TARGET static double hsum(reg v) { return _mm512_reduce_add_pd(v); }
+        CSTMATH_TARGET static double hmin(reg v) { return _mm512_reduce_min_pd(v); }
+        CSTMATH_TARGET static double hmax(reg v) { return _mm512_reduce_max_pd(v); }
+        CSTMATH_TARGET static reg scale2(reg p, reg kd) {
+            return _mm512_castsi512_pd(
+                _mm512_add_epi64(_mm512_castpd_si512(p), _mm512_slli_epi64(_mm512_castpd_si512(kd), 52)));
+        }
+        CSTMATH_TARGET static reg split(reg x, reg& e) {
+            __m512i bits = _mm512_castpd_si512(x);
+            __m512i biased = _mm512_or_si512(_mm512_srli_epi64(bits, 52), _mm512_set1_epi64(0x4330000000000000));
+            e = _mm512_sub_pd(_mm512_castsi512_pd(biased), _mm512_set1_pd(0x1p52 + 1023));
+            return _mm512_castsi512_pd(_mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi64(0x000fffffffffffff)),
+                                                       _mm512_set1_epi64(0x3ff0000000000000)));
+        }
+    };
+#include "libcstmath_kernels.inc"
+#undef CSTMATH_TARGET
+}
+#pragma GCC diagnostic pop
+
+#endif // CSTMATH_X86
+
+const kernel_table* table_for(isa which) {
+    switch (which) {
+#ifdef CSTMATH_X86
+    case isa::sse2: return &sse2::table;
+    case isa::avx2: return &avx2::table;
+    case isa::avx512: return &avx512::table;
+#endif
+    default: return &scalar::table;
+    }
+}
+
+bool supported(isa which) {
+#ifdef CSTMATH_X86
+    __builtin_cpu_init();
+    switch (which) {
+    case isa::scalar: return true;
+    case isa::sse2: return __builtin_cpu_supports("sse2");
+    case isa::avx2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case isa::avx512: return __builtin_cpu_supports("avx512f");
+    }
+    return false;
+#else
+    return which == isa::scalar;
+#endif
+}
+
+// constant-initialized; resolved on the first kernel call
+std::atomic<const kernel_table*> active{nullptr};
+
+const kernel_table& kernels() {
+    const kernel_table* t = active.load(std::memory_order_relaxed);
+    if (!t) {
+        t = table_for(best_isa());
+        active.store(t, std::memory_order_relaxed);
+    }
+    return *t;
+}
+
+} // namespace
+
+isa best_isa() {
+    for (isa which : {isa::avx512, isa::avx2, isa::sse2})
+        if (supported(which)) return which;
+    return isa::scalar;
+}
+
+isa active_isa() { return kernels().id; }
+
+bool use_isa(isa which) {
+    if (!supported(which)) return false;
+    active.store(table_for(which), std::memory_order_relaxed);
+    return true;
+}
+
+const char* isa_name(isa which) {
+    switch (which) {
+    case isa::sse2: return "sse2";
+    case isa::avx2: return "avx2";
+    case isa::avx512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+void add(const double* a, const double* b, double* out, std::size_t n) { kernels().add(a, b, out, n); }
+void mul(const double* a, const double* b, double* out, std::size_t n) { kernels().mul(a, b, out, n); }
+void fma(const double* a, const double* b, const double* c, double* out, std::size_t n) { kernels().fma(a, b, c, out, n); }
+void sqrt(const double* x, double* out, std::size_t n) { kernels().sqrt(x, out, n); }
+void root(const double* x, double r, double* out, std::size_t n) { kernels().root(x, r, out, n); }
+void exp(const double* x, double* out, std::size_t n) { kernels().exp(x, out, n); }
+void log(const double* x, double* out, std::size_t n) { kernels().log(x, out, n); }
+double dot(const double* a, const double* b, std::size_t n) { return kernels().dot(a, b, n); }
+double sum(const double* x, std::size_t n) { return kernels().sum(x, n); }
+double min(const double* x, std::size_t n) { return kernels().min(x, n); }
+double max(const double* x, std::size_t n) { return kernels().max(x, n); }
+
+} // namespace math
+} // namespace cstar
@@ -1,6 +1,4 @@
 #include "include/posix_util.h"
-#include <fstream>
-#include <vector>
 
-int posix_errno = 0;
-std::vector<std::fstream*> fd_table;
\ No newline at end of file
+thread_local int posix_errno = 0;
+posix_fd_table fd_table;
\ No newline at end of file
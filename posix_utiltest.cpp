@@ -3,7 +3,7 @@
 
 #include <posix_util.h>
 #include <iostream>
-#include <fstream>
+#include <cstring>
 #include <cstdlib>
 
 
@@ -12,28 +12,21 @@ usingfunc::integerfunc mainfunc() {
     using namespace std;
     
         cout << "DEBUG A" << endl;
-        fstream* file = new fstream("test.txt", ios::in | ios::out | ios::binary | ios::trunc);
+        int fd = fileopen("test.txt", O_RDWR | O_CREAT | O_TRUNC);
         cout << "DEBUG B" << endl;
     
-        if (!file->is_open()) {
+        if (fd < 0) {
             cerr << "Failed to open file." << endl;
             return ENOENT;
         }
     
-        fd_table.push_back(file);
-        int fd = fd_table.size() - 1;
-    
-        cout << "Write stream pointer: " << file << endl;
-        cout << "fd_table[fd] (write): " << fd_table[fd] << endl;
-        cout << "fd_table[fd] (read): " << fd_table[fd] << endl;
-    
         POSIXSTR content = "Hello, POSIX file I/O!\n";
         filewrite(fd, content, strlen(content));
     
-        fd_table[fd]->seekg(0);
+        fileseek(fd, 0, SEEK_SET);
     
         char buffer[128] = {0};
-        ssize_t bytesRead = fileread("test.txt", fd, buffer, sizeof(buffer));
+        ssize_t bytesRead = fileread(fd, buffer, sizeof(buffer) - 1);
         if (bytesRead < 0) {
             cerr << "fileread failed with error: " << posix_errno << endl;
         } else {
@@ -41,9 +34,7 @@ usingfunc::integerfunc mainfunc() {
             cout << "Content:\n" << buffer << endl;
         }
     
-        file->close();
-        delete file;
-        fd_table[fd] = nullptr;
+        fileclose(fd);
         return EXIT_S;
 }
 